@@ -0,0 +1,111 @@
+#ifndef ALLOCATOR_STATS_H
+#define ALLOCATOR_STATS_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// This header file provides the (opt-in) statistics collected by the
+// BlockAllocator family of classes.
+//
+// If the symbol CUTILS_ALLOCATOR_STATS is not defined, then no
+// statistics are collected and the ALLOCATOR_STATS macro compiles to
+// nothing. Since this changes the layout of the allocators, the symbol
+// MUST be defined (or not) consistently across a whole program.
+
+#ifdef CUTILS_ALLOCATOR_STATS
+#define ALLOCATOR_STATS(...) __VA_ARGS__
+#else
+#define ALLOCATOR_STATS(...)
+#endif
+
+/// \brief The AllocatorStats structure holds a snapshot of the
+/// statistics of a BlockAllocator.
+///
+/// The "current" values refer to the blocks allocated since the
+/// allocator was created or last cleared, the "total" values refer to
+/// the whole lifetime of the allocator.
+typedef struct AllocatorStats {
+  /// \brief True if the statistics have been collected (that is
+  /// CUTILS_ALLOCATOR_STATS has been defined).
+  bool   enabled;
+
+  /// \brief The size of each block.
+  size_t blockSize;
+
+  /// \brief The current number of blocks.
+  size_t numBlocks;
+
+  /// \brief The largest number of blocks ever held at one time.
+  size_t highWaterNumBlocks;
+
+  /// \brief The total number of blocks ever allocated.
+  size_t totalNumBlocks;
+
+  /// \brief The current number of (sub)structures allocated.
+  size_t numAllocations;
+
+  /// \brief The total number of (sub)structures ever allocated.
+  size_t totalNumAllocations;
+
+  /// \brief The current number of bytes requested.
+  size_t bytesRequested;
+
+  /// \brief The current number of bytes reserved in blocks.
+  size_t bytesReserved;
+
+  /// \brief The largest number of bytes ever reserved at one time.
+  size_t highWaterBytesReserved;
+
+  /// \brief The number of unused bytes at the end of the (current)
+  /// blocks which have been filled.
+  size_t tailWasteBytes;
+
+  /// \brief The largest number of unused bytes at the end of any one
+  /// filled block.
+  size_t maxTailWasteBytes;
+
+  /// \brief The number of times the blocks have been cleared.
+  size_t numClears;
+
+  /// \brief The number of seconds since the allocator was created.
+  double elapsedSeconds;
+
+  /// \brief The total number of allocations per second since the
+  /// allocator was created.
+  double allocationsPerSecond;
+} AllocatorStats;
+
+/// \brief (Internal) Return the current monotonic time in seconds.
+inline double allocatorStatsNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec/1e9;
+}
+
+/// \brief Dump a (human readable) snapshot of the statistics of the
+/// allocator with the name provided.
+inline void dumpAllocatorStats(FILE *logFile,
+                               const char *allocatorName,
+                               const AllocatorStats &stats) {
+  fprintf(logFile, "AllocatorStats: %s\n", allocatorName);
+  if (!stats.enabled) {
+    fprintf(logFile, "  (not collected, define CUTILS_ALLOCATOR_STATS)\n");
+  }
+  fprintf(logFile, "             blockSize = %zu\n", stats.blockSize);
+  fprintf(logFile, "             numBlocks = %zu (high water %zu, total %zu)\n",
+          stats.numBlocks, stats.highWaterNumBlocks, stats.totalNumBlocks);
+  fprintf(logFile, "        numAllocations = %zu (total %zu)\n",
+          stats.numAllocations, stats.totalNumAllocations);
+  fprintf(logFile, "        bytesRequested = %zu\n", stats.bytesRequested);
+  fprintf(logFile, "         bytesReserved = %zu (high water %zu)\n",
+          stats.bytesReserved, stats.highWaterBytesReserved);
+  fprintf(logFile, "        tailWasteBytes = %zu (max per block %zu)\n",
+          stats.tailWasteBytes, stats.maxTailWasteBytes);
+  fprintf(logFile, "             numClears = %zu\n", stats.numClears);
+  fprintf(logFile, "  allocationsPerSecond = %f (over %f seconds)\n",
+          stats.allocationsPerSecond, stats.elapsedSeconds);
+}
+
+#endif
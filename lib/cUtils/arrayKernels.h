@@ -0,0 +1,561 @@
+#ifndef ARRAY_KERNELS_H
+#define ARRAY_KERNELS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "cUtils/assertions.h"
+
+// This header file provides the sorting and searching kernels used by
+// the VarArray class (see VarArray::sort, VarArray::find, ...).
+//
+// The kernels work on plain (contiguous) arrays of items, and are
+// selected at compile time by the ArrayKernelTraits of the item type:
+//
+// - integer items are sorted by an LSD radix sort (which is also
+//   stable) and searched using SSE2 (if it is available),
+//
+// - all other items are sorted by an introsort (or a merge sort when
+//   the sort must be stable) and searched one item at a time, using
+//   operator< and operator== respectively.
+//
+// The kernels are serial, unless they are explicitly given a pool of
+// workers (see parallelSort), so this header does not depend upon the
+// WorkerPool (or pthreads).
+
+#ifndef ArrayKernelsInsertionSortMax
+#define ArrayKernelsInsertionSortMax 16
+#endif
+
+#ifndef ArrayKernelsParallelSortMinItems
+#define ArrayKernelsParallelSortMinItems (1 << 20)
+#endif
+
+/// \brief The default ordering of items (using operator<).
+template<class ItemT>
+struct ArrayLess {
+  bool operator()(const ItemT &anItem, const ItemT &otherItem) const {
+    return anItem < otherItem;
+  }
+};
+
+/// \brief Sort the numItems items using insertion sort (which is
+/// stable, and fastest for very small arrays).
+template<class ItemT, class CompareT>
+void insertionSortItems(ItemT *items, size_t numItems,
+                        const CompareT &compare) {
+  for (size_t i = 1; i < numItems; i++) {
+    ItemT anItem = items[i];
+    size_t j = i;
+    for ( ; j && compare(anItem, items[j - 1]); j--) items[j] = items[j - 1];
+    items[j] = anItem;
+  }
+}
+
+/// \brief (Internal) Move the item at parent down the (binary, max)
+/// heap of the first numItems items.
+template<class ItemT, class CompareT>
+void heapSiftDownItem(ItemT *items, size_t parent, size_t numItems,
+                      const CompareT &compare) {
+  ItemT anItem = items[parent];
+  while (true) {
+    size_t child = 2*parent + 1;
+    if (numItems <= child) break;
+    if ((child + 1 < numItems) && compare(items[child], items[child + 1])) {
+      child++;
+    }
+    if (!compare(anItem, items[child])) break;
+    items[parent] = items[child];
+    parent = child;
+  }
+  items[parent] = anItem;
+}
+
+/// \brief Sort the numItems items using heap sort (the O(n log n)
+/// fallback of the introsort).
+template<class ItemT, class CompareT>
+void heapSortItems(ItemT *items, size_t numItems, const CompareT &compare) {
+  for (size_t parent = numItems/2; parent--; ) {
+    heapSiftDownItem(items, parent, numItems, compare);
+  }
+  for (size_t end = numItems; 1 < end; ) {
+    end--;
+    ItemT anItem = items[end];
+    items[end]   = items[0];
+    items[0]     = anItem;
+    heapSiftDownItem(items, 0, end, compare);
+  }
+}
+
+/// \brief (Internal) Sort the numItems items using introsort, falling
+/// back to heap sort once maxDepth partitions have been made.
+template<class ItemT, class CompareT>
+void introSortItems(ItemT *items, size_t numItems,
+                    const CompareT &compare, size_t maxDepth) {
+  while (ArrayKernelsInsertionSortMax < numItems) {
+    if (!maxDepth) {
+      heapSortItems(items, numItems, compare);
+      return;
+    }
+    maxDepth--;
+    // move the median of the first, middle and last items to the front
+    ItemT *first  = items;
+    ItemT *middle = items + numItems/2;
+    ItemT *last   = items + numItems - 1;
+    ItemT *median = middle;
+    if (compare(*first, *middle)) {
+      if (compare(*middle, *last))     median = middle;
+      else if (compare(*first, *last)) median = last;
+      else                             median = first;
+    } else {
+      if (compare(*first, *last))       median = first;
+      else if (compare(*middle, *last)) median = last;
+      else                              median = middle;
+    }
+    ItemT pivot = *median;
+    *median     = *first;
+    *first      = pivot;
+    // Hoare partition around the pivot
+    size_t i = 0;
+    size_t j = numItems;
+    while (true) {
+      do i++; while ((i < numItems) && compare(items[i], pivot));
+      do j--; while (compare(pivot, items[j]));
+      if (j <= i) break;
+      ItemT anItem = items[i];
+      items[i] = items[j];
+      items[j] = anItem;
+    }
+    items[0] = items[j];
+    items[j] = pivot;
+    // recurse into the smaller part, loop on the larger
+    if (j < numItems - j - 1) {
+      introSortItems(items, j, compare, maxDepth);
+      items    += j + 1;
+      numItems -= j + 1;
+    } else {
+      introSortItems(items + j + 1, numItems - j - 1, compare, maxDepth);
+      numItems = j;
+    }
+  }
+  insertionSortItems(items, numItems, compare);
+}
+
+/// \brief Sort the numItems items using introsort (quick sort with
+/// median of three pivots, insertion sort for small partitions and
+/// heap sort if the partitioning goes badly). The sort is NOT stable.
+template<class ItemT, class CompareT>
+void compareSortItems(ItemT *items, size_t numItems,
+                      const CompareT &compare) {
+  size_t maxDepth = 0;
+  for (size_t n = numItems; n; n >>= 1) maxDepth += 2;
+  introSortItems(items, numItems, compare, maxDepth);
+}
+
+/// \brief Sort the numItems items using a (bottom up) merge sort, which
+/// is stable (equal items keep their order).
+template<class ItemT, class CompareT>
+void mergeSortItems(ItemT *items, size_t numItems, const CompareT &compare) {
+  const size_t runSize = ArrayKernelsInsertionSortMax;
+  for (size_t start = 0; start < numItems; start += runSize) {
+    size_t runItems = numItems - start;
+    if (runSize < runItems) runItems = runSize;
+    insertionSortItems(items + start, runItems, compare);
+  }
+  if (numItems <= runSize) return;
+  ItemT *buffer = (ItemT*)calloc(numItems, sizeof(ItemT));
+  ASSERT(buffer);
+  ItemT *source = items;
+  ItemT *dest   = buffer;
+  for (size_t width = runSize; width < numItems; width *= 2) {
+    for (size_t start = 0; start < numItems; start += 2*width) {
+      size_t middle = start + width;
+      size_t end    = middle + width;
+      if (numItems < middle) middle = numItems;
+      if (numItems < end)    end    = numItems;
+      size_t i = start, j = middle, k = start;
+      while ((i < middle) && (j < end)) {
+        if (compare(source[j], source[i])) dest[k++] = source[j++];
+        else                               dest[k++] = source[i++];
+      }
+      while (i < middle) dest[k++] = source[i++];
+      while (j < end)    dest[k++] = source[j++];
+    }
+    ItemT *swap = source;
+    source = dest;
+    dest   = swap;
+  }
+  if (source != items) memcpy(items, source, numItems*sizeof(ItemT));
+  free(buffer);
+}
+
+/// \brief Return the position of the first of the numItems (sorted)
+/// items which is not ordered before anItem (or numItems if there is
+/// none).
+///
+/// The search is branch free (the loop only depends upon numItems),
+/// which avoids the mispredicted branches of a classic binary search.
+template<class ItemT, class CompareT>
+size_t lowerBoundItem(const ItemT *items, size_t numItems,
+                      const ItemT &anItem, const CompareT &compare) {
+  if (!numItems) return 0;
+  const ItemT *base = items;
+  while (1 < numItems) {
+    size_t half = numItems/2;
+    base      = compare(base[half - 1], anItem) ? base + half : base;
+    numItems -= half;
+  }
+  return (base - items) + (compare(*base, anItem) ? 1 : 0);
+}
+
+/// \brief Return the position of the first of the numItems items which
+/// is equal to anItem (or numItems if there is none).
+template<class ItemT>
+size_t scalarFindItem(const ItemT *items, size_t numItems,
+                      const ItemT &anItem) {
+  for (size_t i = 0; i < numItems; i++) {
+    if (items[i] == anItem) return i;
+  }
+  return numItems;
+}
+
+/// \brief Return the number of the numItems items which are equal to
+/// anItem.
+template<class ItemT>
+size_t scalarCountItems(const ItemT *items, size_t numItems,
+                        const ItemT &anItem) {
+  size_t count = 0;
+  for (size_t i = 0; i < numItems; i++) {
+    if (items[i] == anItem) count++;
+  }
+  return count;
+}
+
+#ifdef __SSE2__
+/// \brief (Internal) The SSE2 comparison of integers ItemWidth bytes
+/// wide.
+template<size_t ItemWidth>
+struct SimdEqual;
+
+template<>
+struct SimdEqual<1> {
+  static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
+};
+
+template<>
+struct SimdEqual<2> {
+  static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+};
+
+template<>
+struct SimdEqual<4> {
+  static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+};
+
+template<>
+struct SimdEqual<8> {
+  // SSE2 has no 64 bit comparison, so both 32 bit halves must match
+  static __m128i equal(__m128i a, __m128i b) {
+    __m128i halves = _mm_cmpeq_epi32(a, b);
+    return _mm_and_si128(halves,
+                         _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+  }
+};
+
+/// \brief (Internal) Return the SSE2 register with every lane equal to
+/// the (integer) anItem.
+template<class ItemT>
+inline __m128i simdSplat(const ItemT &anItem) {
+  ItemT lanes[16/sizeof(ItemT)];
+  for (size_t i = 0; i < 16/sizeof(ItemT); i++) lanes[i] = anItem;
+  return _mm_loadu_si128((const __m128i*)lanes);
+}
+
+/// \brief Return the position of the first of the numItems (integer)
+/// items which is equal to anItem (or numItems if there is none),
+/// comparing 64 bytes of items at a time.
+template<class ItemT>
+size_t simdFindItem(const ItemT *items, size_t numItems,
+                    const ItemT &anItem) {
+  const size_t lanes = 16/sizeof(ItemT);
+  __m128i target = simdSplat(anItem);
+  size_t i = 0;
+  for ( ; i + 4*lanes <= numItems; i += 4*lanes) {
+    const __m128i *vectors = (const __m128i*)(items + i);
+    __m128i match0 = SimdEqual<sizeof(ItemT)>::equal(
+      _mm_loadu_si128(vectors), target);
+    __m128i match1 = SimdEqual<sizeof(ItemT)>::equal(
+      _mm_loadu_si128(vectors + 1), target);
+    __m128i match2 = SimdEqual<sizeof(ItemT)>::equal(
+      _mm_loadu_si128(vectors + 2), target);
+    __m128i match3 = SimdEqual<sizeof(ItemT)>::equal(
+      _mm_loadu_si128(vectors + 3), target);
+    __m128i anyMatch = _mm_or_si128(_mm_or_si128(match0, match1),
+                                    _mm_or_si128(match2, match3));
+    if (_mm_movemask_epi8(anyMatch)) {
+      uint64_t mask = (uint64_t)(uint32_t)_mm_movemask_epi8(match0) |
+        ((uint64_t)(uint32_t)_mm_movemask_epi8(match1) << 16) |
+        ((uint64_t)(uint32_t)_mm_movemask_epi8(match2) << 32) |
+        ((uint64_t)(uint32_t)_mm_movemask_epi8(match3) << 48);
+      return i + __builtin_ctzll(mask)/sizeof(ItemT);
+    }
+  }
+  for ( ; i + lanes <= numItems; i += lanes) {
+    int mask = _mm_movemask_epi8(SimdEqual<sizeof(ItemT)>::equal(
+      _mm_loadu_si128((const __m128i*)(items + i)), target));
+    if (mask) return i + __builtin_ctz(mask)/sizeof(ItemT);
+  }
+  return i + scalarFindItem(items + i, numItems - i, anItem);
+}
+
+/// \brief Return the number of the numItems (integer) items which are
+/// equal to anItem.
+template<class ItemT>
+size_t simdCountItems(const ItemT *items, size_t numItems,
+                      const ItemT &anItem) {
+  const size_t lanes = 16/sizeof(ItemT);
+  __m128i target = simdSplat(anItem);
+  size_t numMatchingBytes = 0;
+  size_t i = 0;
+  for ( ; i + lanes <= numItems; i += lanes) {
+    int mask = _mm_movemask_epi8(SimdEqual<sizeof(ItemT)>::equal(
+      _mm_loadu_si128((const __m128i*)(items + i)), target));
+    numMatchingBytes += __builtin_popcount(mask);
+  }
+  return numMatchingBytes/sizeof(ItemT) +
+    scalarCountItems(items + i, numItems - i, anItem);
+}
+#else
+template<class ItemT>
+size_t simdFindItem(const ItemT *items, size_t numItems,
+                    const ItemT &anItem) {
+  return scalarFindItem(items, numItems, anItem);
+}
+
+template<class ItemT>
+size_t simdCountItems(const ItemT *items, size_t numItems,
+                      const ItemT &anItem) {
+  return scalarCountItems(items, numItems, anItem);
+}
+#endif
+
+/// \brief The ArraySerialTasks structure is a stand in for a
+/// WorkerPool which runs each batch of tasks in the calling thread.
+///
+/// It is the pool used by the serial kernels, and may be used wherever
+/// a kernel expects a pool of workers.
+struct ArraySerialTasks {
+  size_t getNumWorkers(void) const { return 1; }
+  void runTasks(size_t numTasks, void (*task)(size_t, void*),
+                void *context) {
+    for (size_t taskNum = 0; taskNum < numTasks; taskNum++) {
+      task(taskNum, context);
+    }
+  }
+};
+
+/// \brief (Internal) The state of a parallel radix sort, shared by the
+/// tasks of each pass.
+template<class ItemT, class KeyT>
+struct RadixSortContext {
+  ItemT  *source;
+  ItemT  *dest;
+  size_t  numItems;
+  size_t  chunkSize;
+  size_t  shift;
+  KeyT    signFlip;
+  size_t (*counts)[256];
+};
+
+/// \brief (Internal) The WorkerPool task which counts the digits of one
+/// chunk of the items.
+template<class ItemT, class KeyT>
+void radixCountTask(size_t chunkNum, void *aContext) {
+  RadixSortContext<ItemT, KeyT> *context =
+    (RadixSortContext<ItemT, KeyT>*)aContext;
+  size_t *counts = context->counts[chunkNum];
+  memset(counts, 0, 256*sizeof(size_t));
+  size_t start = chunkNum*context->chunkSize;
+  size_t end   = start + context->chunkSize;
+  if (context->numItems < end) end = context->numItems;
+  for (size_t i = start; i < end; i++) {
+    KeyT key = ((KeyT)context->source[i]) ^ context->signFlip;
+    counts[(key >> context->shift) & 0xFF]++;
+  }
+}
+
+/// \brief (Internal) The WorkerPool task which scatters one chunk of
+/// the items (its counts have been replaced by its offsets).
+template<class ItemT, class KeyT>
+void radixScatterTask(size_t chunkNum, void *aContext) {
+  RadixSortContext<ItemT, KeyT> *context =
+    (RadixSortContext<ItemT, KeyT>*)aContext;
+  size_t *offsets = context->counts[chunkNum];
+  size_t start = chunkNum*context->chunkSize;
+  size_t end   = start + context->chunkSize;
+  if (context->numItems < end) end = context->numItems;
+  for (size_t i = start; i < end; i++) {
+    KeyT key = ((KeyT)context->source[i]) ^ context->signFlip;
+    context->dest[offsets[(key >> context->shift) & 0xFF]++] =
+      context->source[i];
+  }
+}
+
+/// \brief Sort the numItems integer items using an LSD radix sort
+/// (eight bits per pass), which is stable.
+///
+/// KeyT is the unsigned integer type of the same width as ItemT, and
+/// signFlip is its sign bit for signed items (zero otherwise). Passes
+/// in which every item has the same digit are skipped.
+///
+/// If aPool (a WorkerPool, or any class with the same getNumWorkers
+/// and runTasks methods) is not NULL and has more than one worker,
+/// each pass counts and then scatters chunks of the items in parallel,
+/// using per chunk digit offsets so that the sort remains stable.
+template<class ItemT, class KeyT, class PoolT>
+void radixSortItems(ItemT *items, size_t numItems, KeyT signFlip,
+                    PoolT *aPool) {
+  if (numItems <= ArrayKernelsInsertionSortMax) {
+    insertionSortItems(items, numItems, ArrayLess<ItemT>());
+    return;
+  }
+  size_t numChunks = 1;
+  if (aPool && (1 < aPool->getNumWorkers())) {
+    numChunks = 4*aPool->getNumWorkers();
+  }
+  ItemT *buffer = (ItemT*)calloc(numItems, sizeof(ItemT));
+  ASSERT(buffer);
+  RadixSortContext<ItemT, KeyT> context;
+  context.source    = items;
+  context.dest      = buffer;
+  context.numItems  = numItems;
+  context.chunkSize = (numItems + numChunks - 1)/numChunks;
+  context.signFlip  = signFlip;
+  context.counts    = (size_t(*)[256])calloc(numChunks, 256*sizeof(size_t));
+  ASSERT(context.counts);
+  for (context.shift = 0; context.shift < 8*sizeof(KeyT);
+       context.shift += 8) {
+    if (1 < numChunks) {
+      aPool->runTasks(numChunks, radixCountTask<ItemT, KeyT>, &context);
+    } else {
+      radixCountTask<ItemT, KeyT>(0, &context);
+    }
+    // turn the counts into the offset of each (digit, chunk), skipping
+    // the pass if every item has the same digit
+    size_t offset = 0;
+    bool   skipPass = false;
+    for (size_t digit = 0; digit < 256; digit++) {
+      size_t digitStart = offset;
+      for (size_t chunk = 0; chunk < numChunks; chunk++) {
+        size_t count = context.counts[chunk][digit];
+        context.counts[chunk][digit] = offset;
+        offset += count;
+      }
+      if (offset - digitStart == numItems) skipPass = true;
+    }
+    if (skipPass) continue;
+    if (1 < numChunks) {
+      aPool->runTasks(numChunks, radixScatterTask<ItemT, KeyT>, &context);
+    } else {
+      radixScatterTask<ItemT, KeyT>(0, &context);
+    }
+    ItemT *swap    = context.source;
+    context.source = context.dest;
+    context.dest   = swap;
+  }
+  if (context.source != items) {
+    memcpy(items, context.source, numItems*sizeof(ItemT));
+  }
+  free(context.counts);
+  free(buffer);
+}
+
+/// \brief Sort the numItems integer items using a (serial) LSD radix
+/// sort (see radixSortItems above).
+template<class ItemT, class KeyT>
+void radixSortItems(ItemT *items, size_t numItems, KeyT signFlip) {
+  radixSortItems(items, numItems, signFlip, (ArraySerialTasks*)NULL);
+}
+
+/// \brief The ArrayKernelTraits template class selects the sorting and
+/// searching kernels used for items of type ItemT.
+///
+/// By default items are compared using operator< and operator==, and
+/// are always sorted serially (even when given a pool of workers).
+template<class ItemT>
+struct ArrayKernelTraits {
+  static void sort(ItemT *items, size_t numItems) {
+    compareSortItems(items, numItems, ArrayLess<ItemT>());
+  }
+  static void stableSort(ItemT *items, size_t numItems) {
+    mergeSortItems(items, numItems, ArrayLess<ItemT>());
+  }
+  template<class PoolT>
+  static void parallelSort(ItemT *items, size_t numItems, PoolT *aPool) {
+    compareSortItems(items, numItems, ArrayLess<ItemT>());
+  }
+  template<class PoolT>
+  static void parallelStableSort(ItemT *items, size_t numItems,
+                                 PoolT *aPool) {
+    mergeSortItems(items, numItems, ArrayLess<ItemT>());
+  }
+  static size_t find(const ItemT *items, size_t numItems,
+                     const ItemT &anItem) {
+    return scalarFindItem(items, numItems, anItem);
+  }
+  static size_t count(const ItemT *items, size_t numItems,
+                      const ItemT &anItem) {
+    return scalarCountItems(items, numItems, anItem);
+  }
+};
+
+#define ARRAY_KERNEL_TRAITS_FOR_INTEGER(IntT, KeyT, signFlip)           \
+template<>                                                              \
+struct ArrayKernelTraits<IntT> {                                        \
+  static void sort(IntT *items, size_t numItems) {                      \
+    radixSortItems(items, numItems, (KeyT)(signFlip));                  \
+  }                                                                     \
+  static void stableSort(IntT *items, size_t numItems) {                \
+    radixSortItems(items, numItems, (KeyT)(signFlip));                  \
+  }                                                                     \
+  template<class PoolT>                                                 \
+  static void parallelSort(IntT *items, size_t numItems,                \
+                           PoolT *aPool) {                              \
+    radixSortItems(items, numItems, (KeyT)(signFlip), aPool);           \
+  }                                                                     \
+  template<class PoolT>                                                 \
+  static void parallelStableSort(IntT *items, size_t numItems,          \
+                                 PoolT *aPool) {                        \
+    radixSortItems(items, numItems, (KeyT)(signFlip), aPool);           \
+  }                                                                     \
+  static size_t find(const IntT *items, size_t numItems,                \
+                     const IntT &anItem) {                              \
+    return simdFindItem(items, numItems, anItem);                       \
+  }                                                                     \
+  static size_t count(const IntT *items, size_t numItems,               \
+                      const IntT &anItem) {                             \
+    return simdCountItems(items, numItems, anItem);                     \
+  }                                                                     \
+}
+
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(unsigned char,      uint8_t,  0);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(signed char,        uint8_t,  0x80);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(unsigned short,     uint16_t, 0);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(short,              uint16_t, 0x8000U);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(unsigned int,       uint32_t, 0);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(int,                uint32_t, 0x80000000U);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(unsigned long,      unsigned long, 0);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(long,               unsigned long,
+                                ~(~0UL >> 1));
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(unsigned long long, unsigned long long, 0);
+ARRAY_KERNEL_TRAITS_FOR_INTEGER(long long,          unsigned long long,
+                                ~(~0ULL >> 1));
+
+#undef ARRAY_KERNEL_TRAITS_FOR_INTEGER
+
+#endif
@@ -5,220 +5,349 @@
 // more information to be provided than simply the failure of a given
 // condition.
 //
-// If the symbol DEBUG is not defined, then no ASSERTion is ever
-// compiled.
+// Assertions are classified by their cost, and the macro
+// CUTILS_ASSERT_LEVEL selects (at compile time) which of them are
+// compiled:
 //
-// If the symbol DEBUG is defined, then ASSERTions are compiled and
-// more usefully, the function names of recent calls on the stack are
-// appended to the failure message.
-
-#ifndef DEBUG
-
-//////////////////////////////////////////////////////////////////////////////
-// WE ARE NOT IN DEBUG/DEVELOPMENT
-// SO REMOVE ALL ASSERTS
-#define ASSERT(cond)
-#define ASSERT_MESSAGE(cond, message)
-#define ASSERT_INSIDE_DELETE(cond)
-#define FalseOrAssertionFailure(message) return false
-//////////////////////////////////////////////////////////////////////////////
+//   0 : no assertions,
+//   1 : only ASSERT_CHEAP (O(1) checks cheap enough for production),
+//   2 : ASSERT_CHEAP and ASSERT/ASSERT_MESSAGE (the normal checks,
+//       including the O(1) invariants of the containers),
+//   3 : all assertions, including ASSERT_EXPENSIVE (the paranoid
+//       checks, such as O(n) invariants).
+//
+// The ASSERT_INVARIANT (normal) and ASSERT_EXPENSIVE_INVARIANT
+// (paranoid) macros are used for the invariants checked on every
+// operation of a container. When compiled, they only check the
+// calls sampled by the InvariantSampler (by default all of them).
+//
+// If CUTILS_ASSERT_LEVEL is not defined it defaults to 3 if the
+// symbol DEBUG is defined, and 0 otherwise.
+//
+// When an assertion fails, the function names of recent calls on the
+// stack are reported together with the failure message.
 
-#else // DEBUG defined
+#ifndef CUTILS_ASSERT_LEVEL
+#ifdef DEBUG
+#define CUTILS_ASSERT_LEVEL 3
+#else
+#define CUTILS_ASSERT_LEVEL 0
+#endif
+#endif
 
-//////////////////////////////////////////////////////////////////////////////
-// WE want the full debug/development assertion system
-//////////////////////////////////////////////////////////////////////////////
+/// \def CUTILS_UNLIKELY(condition)
+/// \brief Hint to the compiler that the condition is (almost always)
+/// false.
+#define CUTILS_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
 
-#include <string>
+#include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <execinfo.h>
 #include <errno.h>
 #include <cxxabi.h>
-#define MAX_FRAMES 10
+
+/// \brief The maximum number of return addresses recorded by an
+/// AssertionFailure.
+#define ASSERTION_FAILURE_MAX_FRAMES 8
 
 /// \brief The AssertionFailure class provides a convenient way to
 /// report more information than the simple failure of an assertion.
 ///
 /// The AssertionFailure exception, when used inside of the provided
-/// ASSERT or ASSERT_MESSAGE macros, adds recent call stack information
+/// ASSERT or ASSERT_MESSAGE macros, records the recent call stack
 /// using ideas suggested by Rafael Baptista's excellent blog article:
 /// [Generate Stack Traces on Crash Portably in
 /// C++](http://oroboro.com/stack-trace-on-crash/)
 ///
-/// The AsertionFailure class as well as the ASSERT/ASSERT_MESSAGE
-/// macros are only defined if the C/C++ macro DEBUG has been defined.
+/// Raising an AssertionFailure does NOT use the heap. The message
+/// MUST be a static string, and the recent call stack is recorded as
+/// raw return addresses in a fixed size buffer inside the exception.
+/// The return addresses are only symbolized (which does use the heap)
+/// when the failure is reported (see printReport). AssertionFailures
+/// SHOULD be caught by reference.
 ///
-/// To use this assertion framework the bandit/assertion_exception.h
-/// file MUST be installed in either the system or local include
-/// directories. A copy of this file can be [download
-/// here](https://github.com/joakimkarlsson/bandit)
+/// The AssertionFailure class is always defined, while the ASSERT
+/// macros are only compiled at the appropriate CUTILS_ASSERT_LEVEL.
 class AssertionFailure {
 
 public:
 
-  class MessageHolder {
-  public:
-    MessageHolder(const char *aMessage, bool shouldFreeMessage = false) {
-      next        = NULL;
-      message     = aMessage;
-      freeMessage = shouldFreeMessage;
-    }
-    ~MessageHolder(void) {
-      if (next) delete next;
-      if (freeMessage && message) free((void*)message);
+  /// \brief Construct a new instance of AssertionFailure (without any
+  /// recent call stack).
+  AssertionFailure(const char   *aMessage,
+                   const char   *aFileName   = NULL,
+                   const size_t  aLineNumber = 0) {
+    message     = aMessage;
+    fileName    = aFileName;
+    lineNumber  = aLineNumber;
+    numFrames   = 0;
+  };
+
+  /// \brief Record the recent call stack (of the caller).
+  void captureStackTrace(void) __attribute__((noinline)) {
+    void *stackReturnAddressList[ASSERTION_FAILURE_MAX_FRAMES+1];
+    int numReturnAddresses =
+      backtrace(stackReturnAddressList, ASSERTION_FAILURE_MAX_FRAMES+1);
+    // ignore the return address of this method
+    numFrames = (1 < numReturnAddresses) ? numReturnAddresses - 1 : 0;
+    memcpy(frames, stackReturnAddressList+1, numFrames*sizeof(void*));
+  }
+
+  /// \brief Record the file name and line number at which this
+  /// failure was (eventually) caught, as well as the recent call
+  /// stack, if the failure does not already have them.
+  void locate(const char *aFileName, const size_t aLineNumber) {
+    if (fileName) return;
+    fileName   = aFileName;
+    lineNumber = aLineNumber;
+    if (!numFrames) captureStackTrace();
+  }
+
+  /// \brief Throw a new AssertionFailure which records the recent
+  /// call stack.
+  ///
+  /// This method is typically, automatically, called by the ASSERT
+  /// and/or ASSERT_MESSAGE macros.
+  static void fail(const char   *aMessage,
+                   const char   *aFileName,
+                   const size_t  aLineNumber)
+    __attribute__((noinline, noreturn, cold)) {
+    AssertionFailure failure(aMessage, aFileName, aLineNumber);
+    failure.captureStackTrace();
+    throw failure;
+  }
+
+  /// \brief Call backtrace once so that its (lazy) initialization,
+  /// which uses the heap, does not happen when the first assertion
+  /// fails.
+  static bool warmUp(void) {
+    void *stackReturnAddress[1];
+    backtrace(stackReturnAddress, 1);
+    return true;
+  }
+
+  /// \brief Return the number of recorded return addresses.
+  size_t getNumFrames(void) const {
+    return numFrames;
+  }
+
+  /// \brief Write the (demangled) function name of a recorded return
+  /// address into the buffer provided.
+  ///
+  /// Functions without a (dynamic) symbol are named "static".
+  void getFrameName(size_t frameNum, char *buffer, size_t bufferSize) const {
+    if (!bufferSize) return;
+    buffer[0] = 0;
+    if (numFrames <= frameNum) return;
+    char **stackFrameSymbols = backtrace_symbols(frames+frameNum, 1);
+    if (!stackFrameSymbols) return;
+    char *callName = NULL;
+    for ( char *p = stackFrameSymbols[0]; *p; p++) {
+      if (*p == '(') callName = ++p;
+      if (*p == '+') *p = 0;
+      if (*p == ')') *p = 0;
     }
-    MessageHolder *addMessage(const char *aMessage, bool shouldFreeMessage = false) {
-      MessageHolder *newMessage =
-        new MessageHolder(aMessage, shouldFreeMessage);
-      newMessage->next = next;
-      next = newMessage;
-      return next;
+    const char *functionName = "static";
+    int status = -1;
+    char *demangledName = NULL;
+    if (callName && *callName) {
+      functionName  = callName;
+      demangledName = abi::__cxa_demangle(callName, NULL, NULL, &status);
+      if ((status == 0) && demangledName) functionName = demangledName;
     }
-    MessageHolder *getLastMessage(void) {
-      MessageHolder *lastMessage = next;
-      if (!lastMessage) return this;
-      for ( ; lastMessage->next ; lastMessage = lastMessage->next);
-      return lastMessage;
+    snprintf(buffer, bufferSize, "%s", functionName);
+    if (demangledName) free(demangledName);
+    free(stackFrameSymbols);
+  }
+
+  /// \brief Print the message and (symbolized) recent call stack,
+  /// one line each, starting each line with the prefix provided.
+  void printReport(FILE *aFile, const char *prefix) const {
+    fprintf(aFile, "%s%s\n", prefix, message);
+    if (!numFrames) return;
+    fprintf(aFile, "%sRecent call stack:\n", prefix);
+    char frameName[1024];
+    for (size_t i = 0; i < numFrames; i++) {
+      getFrameName(i, frameName, 1024);
+      fprintf(aFile, "%s  %s\n", prefix, frameName);
     }
+  }
 
-    MessageHolder *next;
-    const char *message;
-    bool       freeMessage;
-  };
+  const char *message;
+  const char *fileName;
+  size_t      lineNumber;
+  void       *frames[ASSERTION_FAILURE_MAX_FRAMES];
+  size_t      numFrames;
+};
 
-  /// \brief Construct a new instance of AssertionFailure.
-  AssertionFailure(const char *aMessage, bool shouldFreeMessage = false) {
-    messages    = new MessageHolder(aMessage, shouldFreeMessage);
-    fileName    = NULL;
-    lineNumber  = 0;
-  };
+/// \brief The InvariantSampler class decides which calls of the
+/// ASSERT_INVARIANT (and ASSERT_EXPENSIVE_INVARIANT) macros actually
+/// check their condition.
+///
+/// By default every call is checked. Checking only every Nth call
+/// (setSampleRate) or each call with a probability p
+/// (setSampleProbability) keeps some invariant coverage at close to
+/// the speed of a build without invariant checks. The initial sample
+/// rate can be set using the CUTILS_INVARIANT_SAMPLE_RATE environment
+/// variable.
+///
+/// The counter and random number generator used are thread local. The
+/// sample rate and probability are shared by all threads, and are read
+/// and written using relaxed atomics, as a thread only needs to see a
+/// change eventually.
+class InvariantSampler {
 
-  /// \brief Construct a new instance of AssertionFailure.
-  AssertionFailure(MessageHolder *someMessages) {
-    messages    = someMessages;
-    fileName    = NULL;
-    lineNumber  = 0;
-  };
+public:
 
-  /// \brief Construct a new instance of AssertionFailure which
-  /// explicitly contains file name and line number information.
+  /// \brief Check the invariants on every Nth call (on each thread).
   ///
-  /// This can be used together with Bandit tests outside of the
-  /// Assertion framework.
-  AssertionFailure(const char   *aMessage,
-                   const char   *aFileName,
-                   const size_t  aLineNumber,
-                   bool          shouldFreeMessage = false) {
-    messages    = new MessageHolder(aMessage, shouldFreeMessage);
-    fileName    = aFileName;
-    lineNumber  = aLineNumber;
-  };
+  /// A rate of 0 or 1 checks every call.
+  static void setSampleRate(size_t aSampleRate) {
+    __atomic_store_n(&sampleThreshold(), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&sampleRate(), aSampleRate, __ATOMIC_RELAXED);
+  }
 
-  /// \brief Construct a new instance of AssertionFailure which
-  /// explicitly contains file name and line number information.
+  /// \brief Check the invariants of each call with the probability
+  /// provided (between 0.0 and 1.0).
   ///
-  /// This can be used together with Bandit tests outside of the
-  /// Assertion framework.
-  AssertionFailure(MessageHolder *someMessages,
-                   const char    *aFileName,
-                   const size_t   aLineNumber) {
-    messages    = someMessages;
-    fileName    = aFileName;
-    lineNumber  = aLineNumber;
-  };
+  /// A probability of 0.0 (or less) checks no calls at all.
+  static void setSampleProbability(double aProbability) {
+    if (1.0 <= aProbability) {
+      setSampleRate(1);
+      return;
+    }
+    if (aProbability < 0.0) aProbability = 0.0;
+    __atomic_store_n(&sampleRate(), 0, __ATOMIC_RELAXED);
+    // a threshold of zero denotes "not sampling by probability", so
+    // the threshold is offset by one
+    uint64_t threshold = 1 + (uint64_t)(aProbability*4294967296.0);
+    __atomic_store_n(&sampleThreshold(), threshold, __ATOMIC_RELAXED);
+  }
 
-  /// \brief Add the recent function call information from the call
-  /// stack and then rethrow the exception.
-  ///
-  /// This method is typically, automatically, called by the ASSERT
-  /// and/or ASSERT_MESSAGE macros.
-  static void addStackTrace(MessageHolder *someMessages,
-                            const char    *aFileName,
-                            const size_t   aLineNumber) {
-    MessageHolder *messages = someMessages;
-    // now add the filename and line numbers provided....
-    // and add recent call stack information...
-    void *stackReturnAddressList[MAX_FRAMES+1];
-    size_t numFrames = backtrace(stackReturnAddressList, MAX_FRAMES);
-    if (1 < numFrames) {
-      messages = messages->addMessage("Recent call stack:");
-      if (6 < numFrames) numFrames = 6;
-      char **stackFrameSymbols =
-        backtrace_symbols(stackReturnAddressList, numFrames);
-      for (size_t i = 2; i < numFrames; i++) {
-        char *callName   = NULL;
-        /*char *callOffset = NULL;*/
-        char *localSymbols = strdup(stackFrameSymbols[i]);
-        for ( char *p = localSymbols; *p; p++) {
-          if (*p == '(') callName = ++p;
-          if (*p == '+') { *p = 0; /*callOffset = ++p;*/ }
-          if (*p == ')') *p = 0;
-        }
-        size_t functionNameBufferSize = 1024;
-        char functionNameBuffer[1024];
-        int status = 0;
-        char *functionNameResult =
-          abi::__cxa_demangle(callName, functionNameBuffer+2,
-                              &functionNameBufferSize, &status);
-        char *functionName = callName;
-        if (status == 0) functionName = functionNameResult;
-        // the next line string MUST be at least 2 + strlen("static")
-        // longer than strlen(functionName);
-        char *nextLine = (char*)calloc(strlen(functionName)+10, sizeof(char));
-        nextLine[0] = ' ';
-        nextLine[1] = ' ';
-        if (strlen(functionName)) strcat(nextLine, functionName);
-        else                      strcat(nextLine, "static");
-        messages = messages->addMessage(nextLine, true);
-        if (localSymbols) free(localSymbols);
-      }
-      if (stackFrameSymbols) free(stackFrameSymbols);
+  /// \brief Return true if the current call should check its
+  /// invariant.
+  static bool shouldCheck(void) {
+    uint64_t threshold = getSampleThreshold();
+    if (threshold) {
+      // a xorshift64 pseudo random number generator
+      static __thread uint64_t state = 0;
+      if (!state) state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)(size_t)&state;
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      return (state >> 32) < (threshold - 1);
     }
-    throw AssertionFailure(someMessages, aFileName, aLineNumber);
+    size_t rate = getSampleRate();
+    if (rate <= 1) return true;
+    static __thread size_t counter = 0;
+    if (++counter < rate) return false;
+    counter = 0;
+    return true;
   }
 
-  MessageHolder *messages;
-  const char *fileName;
-  size_t     lineNumber;
+  /// \brief (Internal) The current sample rate (0 if sampling by
+  /// probability).
+  static size_t getSampleRate(void) {
+    return __atomic_load_n(&sampleRate(), __ATOMIC_RELAXED);
+  }
+
+  /// \brief (Internal) One more than the current probability threshold
+  /// (out of 2^32), or 0 if sampling by rate.
+  static uint64_t getSampleThreshold(void) {
+    return __atomic_load_n(&sampleThreshold(), __ATOMIC_RELAXED);
+  }
+
+protected:
+
+  /// \brief Get the initial sample rate from the
+  /// CUTILS_INVARIANT_SAMPLE_RATE environment variable (default 1).
+  static size_t getInitialSampleRate(void) {
+    const char *envValue = getenv("CUTILS_INVARIANT_SAMPLE_RATE");
+    if (!envValue) return 1;
+    return strtoul(envValue, NULL, 10);
+  }
+
+  /// \brief (Internal) The storage of the current sample rate.
+  static size_t &sampleRate(void) {
+    static size_t rate = getInitialSampleRate();
+    return rate;
+  }
+
+  /// \brief (Internal) The storage of the current probability
+  /// threshold.
+  static uint64_t &sampleThreshold(void) {
+    static uint64_t threshold = 0;
+    return threshold;
+  }
 };
 
-#define ASSERT(condition)						\
-  if (!(condition)) {							\
-    AssertionFailure::addStackTrace(					\
-      new AssertionFailure::MessageHolder("("#condition") is false"), 	\
-      __FILE__, __LINE__);						\
+#if 0 < CUTILS_ASSERT_LEVEL
+/// \brief (Internal) Ensures backtrace has been initialized before
+/// any assertion fails.
+static const bool assertionFailureWarmedUp = AssertionFailure::warmUp();
+#endif
+
+/// \def CUTILS_ASSERT_ALWAYS(condition, message)
+/// \brief (Internal) Throw an AssertionFailure if the condition is
+/// false (whatever the assertion level).
+#define CUTILS_ASSERT_ALWAYS(condition, message)			\
+  if (CUTILS_UNLIKELY(!(condition))) {					\
+    AssertionFailure::fail(message, __FILE__, __LINE__);		\
   }
 
+#if 1 <= CUTILS_ASSERT_LEVEL
+#define ASSERT_CHEAP(condition)						\
+  CUTILS_ASSERT_ALWAYS(condition, "("#condition") is false")
+#define FalseOrAssertionFailure(message) throw AssertionFailure(message)
+#else
+#define ASSERT_CHEAP(condition)
+#define FalseOrAssertionFailure(message) return false
+#endif
+
+#if 2 <= CUTILS_ASSERT_LEVEL
+#define ASSERT(condition)						\
+  CUTILS_ASSERT_ALWAYS(condition, "("#condition") is false")
+
 #define ASSERT_MESSAGE(condition, message)				\
-  if (!(condition)) {							\
-    AssertionFailure::addStackTrace(					\
-      new AssertionFailure::MessageHolder(				\
-        "("#condition") is false "#message),				\
-      __FILE__, __LINE__);						\
-  }
+  CUTILS_ASSERT_ALWAYS(condition, "("#condition") is false "#message)
 
 #define ASSERT_INSIDE_DELETE(condition)					\
   try {									\
-    try {								\
-      if (!(condition)) {						\
-        throw AssertionFailure("("#condition") is false inside delete");\
-      }									\
-    } catch (AssertionFailure af) {					\
-      AssertionFailure::addStackTrace(af.messages, __FILE__, __LINE__);	\
+    if (!(condition)) {							\
+      AssertionFailure::fail("("#condition") is false inside delete",	\
+                             __FILE__, __LINE__);			\
     }									\
-  } catch (AssertionFailure af) {					\
+  } catch (AssertionFailure &af) {					\
+    af.locate(__FILE__, __LINE__);					\
     printf("-->>> assertion failure inside delete\n");			\
     printf("----> %s(%zu)\n", af.fileName, af.lineNumber);		\
-    for (AssertionFailure::MessageHolder *curMessage = af.messages ;	\
-         curMessage ; curMessage = curMessage->next) {			\
-      printf("----> %s\n", curMessage->message);			\
-    }									\
-    if (af.messages) delete af.messages;				\
+    af.printReport(stdout, "----> ");					\
   }
 
-#define FalseOrAssertionFailure(message) throw AssertionFailure(message)
+#define ASSERT_INVARIANT(condition)					\
+  if (InvariantSampler::shouldCheck()) {				\
+    CUTILS_ASSERT_ALWAYS(condition, "("#condition") is false")		\
+  }
+#else
+#define ASSERT(condition)
+#define ASSERT_MESSAGE(condition, message)
+#define ASSERT_INSIDE_DELETE(condition)
+#define ASSERT_INVARIANT(condition)
+#endif
 
-#endif // DEBUG defined
+#if 3 <= CUTILS_ASSERT_LEVEL
+#define ASSERT_EXPENSIVE(condition)					\
+  CUTILS_ASSERT_ALWAYS(condition, "("#condition") is false")
+
+#define ASSERT_EXPENSIVE_INVARIANT(condition)				\
+  if (InvariantSampler::shouldCheck()) {				\
+    CUTILS_ASSERT_ALWAYS(condition, "("#condition") is false")		\
+  }
+#else
+#define ASSERT_EXPENSIVE(condition)
+#define ASSERT_EXPENSIVE_INVARIANT(condition)
+#endif
 
 #endif // ASSERTIONS_H not defined
@@ -1,7 +1,10 @@
 #ifndef BIT_SET_H
 #define BIT_SET_H
 
+#include <stdint.h>
 #include <cUtils/assertions.h>
+#include <cUtils/tracing.h>
+#include <cUtils/memoryUsage.h>
 
 // Determine the architecture (64bit vs 32bit) to determine a number of
 // constants
@@ -34,7 +37,7 @@ class BitSet {
 
     BitSet(void) {
       root = NULL;
-      ASSERT(invariant());
+      ASSERT_EXPENSIVE_INVARIANT(invariant());
     }
 
     ~BitSet(void) {
@@ -42,20 +45,20 @@ class BitSet {
     }
 
     bool getBit(size_t bitNum) const {
-      ASSERT(invariant());
+      ASSERT_EXPENSIVE_INVARIANT(invariant());
       size_t bitOffset = num2offset(bitNum);
       size_t bitMask   = getBitMask(bitNum);
       for (Segment *curSeg = root; curSeg; curSeg = curSeg->next) {
         if (bitOffset < curSeg->offset) return false;
         size_t itemNum = bitOffset - curSeg->offset;
-        if (curSeg->numItems < itemNum) continue;
+        if (curSeg->numItems <= itemNum) continue;
         return (curSeg->bits[itemNum] & bitMask) ? true : false;
       }
       return false;
     }
 
     void manipulateBit(size_t bitNum, bool toggleBit, bool setBit) {
-      ASSERT(invariant());
+      ASSERT_EXPENSIVE_INVARIANT(invariant());
       size_t bitOffset = num2offset(bitNum);
       size_t bitMask   = getBitMask(bitNum);
       Segment *prevPrevSeg = NULL;
@@ -68,7 +71,7 @@ class BitSet {
         if (bitOffset < curSeg->offset) {
           addSegmentBetween(bitNum, root, prevPrevSeg, prevSeg, curSeg);
         }
-        if ((curSeg->offset + curSeg->numItems) < bitOffset) continue;
+        if ((curSeg->offset + curSeg->numItems) <= bitOffset) continue;
         size_t itemNum = bitOffset - curSeg->offset;
         if (toggleBit)   curSeg->bits[itemNum] ^= bitMask;
         else if (setBit) curSeg->bits[itemNum] |= bitMask;
@@ -116,21 +119,62 @@ class BitSet {
 
     BitSet clone(void) {
       BitSet copyBitSet;
+      size_t numSegments __attribute__((unused)) = 0; // only traced
+      size_t numItems    __attribute__((unused)) = 0; // only traced
       if (root) {
         copyBitSet.root      = copySegment(root);
         Segment *curSeg      = root->next;
         Segment *prevCopySeg = copyBitSet.root;
+        numSegments = 1;
+        numItems    = root->numItems;
         for ( ; curSeg ; curSeg = curSeg->next ) {
           Segment *copySeg = copySegment(curSeg);
           ASSERT(copySeg);
           prevCopySeg->next = copySeg;
           prevCopySeg       = copySeg;
+          numSegments++;
+          numItems += curSeg->numItems;
         }
         prevCopySeg->next = NULL;
       }
+      CUTILS_TRACE(TraceBitSetClone, numSegments, numItems);
       return copyBitSet;
     }
 
+    /// \brief Visit each segment of the bit set (in ascending order).
+    ///
+    /// The visitor is called as visitor(firstBitNum, words, numWords)
+    /// where the numWords words (each BIT_SET_ITEM_BITS bits) hold the
+    /// bits starting at firstBitNum. Bits outside of the segments are
+    /// clear.
+    template<class VisitorT>
+    void forEachSegment(VisitorT &visitor) const {
+      ASSERT_EXPENSIVE_INVARIANT(invariant());
+      for (Segment *curSeg = root; curSeg; curSeg = curSeg->next) {
+        visitor(offset2num(curSeg->offset),
+                (const size_t*)curSeg->bits, (size_t)curSeg->numItems);
+      }
+    }
+
+    /// \brief Report the memory used by this bit set.
+    ///
+    /// Each segment is one allocation, its words are used bytes and its
+    /// header is overhead, so a bit set fragmented into many small
+    /// segments has a low fillRatio.
+    MemoryUsage memoryUsage(void) const {
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes = sizeof(BitSet);
+      for (Segment *curSeg = root; curSeg; curSeg = curSeg->next) {
+        usage.numAllocations++;
+        usage.bytesReserved += sizeof(Segment) + curSeg->numItems*sizeof(size_t);
+        usage.bytesUsed     += curSeg->numItems*sizeof(size_t);
+        usage.bytesOverhead += sizeof(Segment);
+      }
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
   protected:
 
     static size_t num2offset(size_t aNumber) {
@@ -140,7 +184,7 @@ class BitSet {
       return anOffset<<BIT_SET_SHIFT;
     }
     static size_t getBitMask(size_t bitNum) {
-      return 1 << ((bitNum & BIT_SET_MASK)-1);
+      return ((size_t)1) << (bitNum & BIT_SET_MASK);
     }
 
     typedef struct Segment {
@@ -172,6 +216,7 @@ class BitSet {
       if (((size_t)BIT_SET_UINT_MAX) <= offset + numItems) {
         return NULL;
       }
+      CUTILS_TRACE(TraceBitSetSegmentInsert, offset, numItems);
       size_t numMembers = numItems + sizeof(Segment)/BIT_SET_ITEM_SIZE;
       Segment *segment =
         (Segment*)calloc(numMembers, sizeof(size_t));
@@ -207,7 +252,8 @@ class BitSet {
         return;
       }
 
-      BIT_SET_UINT bitOffset = BitSet::num2offset(bitNum);
+      BIT_SET_UINT bitOffset __attribute__((unused)) = // only used by ASSERTs
+        BitSet::num2offset(bitNum);
 
       if (!prevPrevSeg && !prevSeg && curSeg) {
         // only the curSeg has been added
@@ -220,10 +266,10 @@ class BitSet {
         return;
       }
 
-      if (!prevPrevSeg && prevSeg && !curSeg) {
-        // only the prevSeg has been added
-        ASSERT(root == prevSeg);
-        ASSERT((prevSeg->offset + prevSeg->numItems) < bitOffset);
+      if (prevSeg && !curSeg) {
+        // we are beyond the last segment (prevSeg)
+        ASSERT(prevPrevSeg || (root == prevSeg));
+        ASSERT((prevSeg->offset + prevSeg->numItems) <= bitOffset);
         // need to add a new segment AFTER the current one...
         prevSeg->next = newSegment(bitNum, 63, prevSeg->next);
         curSeg = prevSeg->next;
@@ -232,7 +278,7 @@ class BitSet {
 
       if (prevSeg && curSeg) {
         // we need to add a new segment between prevSeg and curSeg
-        ASSERT(prevSeg->offset + prevSeg->numItems < bitOffset);
+        ASSERT(prevSeg->offset + prevSeg->numItems <= bitOffset);
         ASSERT(bitOffset < curSeg->offset);
         ASSERT(prevSeg->next == curSeg);
         prevSeg->next = newSegment(bitNum, 63, prevSeg->next);
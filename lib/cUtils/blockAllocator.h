@@ -5,6 +5,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "cUtils/varArray.h"
+#include "cUtils/blockSource.h"
+#include "cUtils/allocatorStats.h"
+#include "cUtils/tracing.h"
+#include "cUtils/memoryUsage.h"
 
 /// \brief The BlockAllocator class holds the information required
 /// to allocate multiple blocks of related (sub)structures.
@@ -40,22 +44,41 @@ class BlockAllocator {
 
     /// \brief Create a new block allocator which allocates a given
     /// blockSize.
-    BlockAllocator(size_t aBlockSize) {
+    ///
+    /// The blocks are obtained from aBlockSource, or, if this is NULL,
+    /// from the default (calloc/free based) BlockSource. The
+    /// aBlockSource MUST outlive this block allocator.
+    BlockAllocator(size_t aBlockSize, BlockSource *aBlockSource = NULL) {
       blockSize = aBlockSize;
+      blockSource = aBlockSource;
+      if (!blockSource) blockSource = BlockSource::getDefault();
       curAllocationByte = NULL;
       endAllocationByte = NULL;
-      ASSERT(invariant());
+      bytesAllocated    = 0;
+      ALLOCATOR_STATS(
+        memset(&stats, 0, sizeof(AllocatorStats));
+        statsStartTime = allocatorStatsNow();
+      )
+      ASSERT_INVARIANT(invariant());
     }
 
     /// \brief Clear (free) all of the blocks.
     void clearBlocks(void) {
       while(blocks.getNumItems()) {
         char* aBlock = blocks.popItem();
-        if (aBlock) free(aBlock);
+        if (aBlock) blockSource->freeBlock(aBlock, blockSize);
       }
       curAllocationByte = NULL;
       endAllocationByte = NULL;
-      ASSERT(invariant());
+      bytesAllocated    = 0;
+      ALLOCATOR_STATS(
+        stats.numClears++;
+        stats.numBlocks         = 0;
+        stats.numAllocations    = 0;
+        stats.bytesRequested    = 0;
+        stats.tailWasteBytes    = 0;
+      )
+      ASSERT_INVARIANT(invariant());
     }
 
     /// \brief Destory the block allocator and all of its blocks.
@@ -69,31 +92,110 @@ class BlockAllocator {
 
     /// \brief Allocate a new (sub)structure of the given size.
     char *allocateNewStructure(size_t structureSize) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       if (endAllocationByte <= curAllocationByte + structureSize) {
         // we need to allocate a new block
         addNewBlock();
       }
       char *newStructure = curAllocationByte;
       curAllocationByte += structureSize;
-      ASSERT(invariant());
+      bytesAllocated    += structureSize;
+      ALLOCATOR_STATS(
+        stats.numAllocations++;
+        stats.totalNumAllocations++;
+        stats.bytesRequested += structureSize;
+      )
+      ASSERT_INVARIANT(invariant());
       return newStructure;
     }
 
+    /// \brief Return the size of each allocation block (the largest
+    /// (sub)structure which can be allocated).
+    size_t getBlockSize(void) const {
+      return blockSize;
+    }
+
     bool isEmpty(void) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       return 0 == blocks.getNumItems();
     }
 
+    /// \brief Take a snapshot of the statistics of this allocator.
+    ///
+    /// If CUTILS_ALLOCATOR_STATS has not been defined, only the
+    /// blockSize, numBlocks and bytesReserved are provided.
+    void getStats(AllocatorStats &snapshot) const {
+      memset(&snapshot, 0, sizeof(AllocatorStats));
+      ALLOCATOR_STATS(
+        snapshot = stats;
+        snapshot.enabled = true;
+        snapshot.highWaterBytesReserved = stats.highWaterNumBlocks*blockSize;
+        snapshot.elapsedSeconds = allocatorStatsNow() - statsStartTime;
+        if (0 < snapshot.elapsedSeconds)
+          snapshot.allocationsPerSecond =
+            stats.totalNumAllocations / snapshot.elapsedSeconds;
+      )
+      snapshot.blockSize     = blockSize;
+      snapshot.numBlocks     = blocks.getNumItems();
+      snapshot.bytesReserved = blocks.getNumItems()*blockSize;
+    }
+
+    /// \brief Dump a (human readable) snapshot of the statistics of
+    /// this allocator.
+    void dumpStats(FILE *logFile, const char *allocatorName) const {
+      AllocatorStats snapshot;
+      getStats(snapshot);
+      dumpAllocatorStats(logFile, allocatorName, snapshot);
+    }
+
+    /// \brief Report the memory used by this allocator.
+    ///
+    /// The blocks are reserved bytes, the (sub)structures allocated
+    /// from them are used bytes and the table of blocks is overhead.
+    /// The bytesWasted are the unused tails of the filled blocks
+    /// together with the rest of the current block.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage blockTable = blocks.memoryUsage();
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(BlockAllocator);
+      usage.numAllocations = blocks.getNumItems() + blockTable.numAllocations;
+      usage.bytesReserved  =
+        blocks.getNumItems()*blockSize + blockTable.bytesReserved;
+      usage.bytesUsed      = bytesAllocated;
+      usage.bytesOverhead  = blockTable.bytesReserved;
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
   protected:
 
     /// \brief Add a new allocation block to this blockAllocator.
+    ///
+    /// Throws an AssertionFailure (leaving this blockAllocator unchanged)
+    /// if the BlockSource can not provide a new block.
     void addNewBlock(void) {
-      ASSERT(invariant());
-      curAllocationByte = (char*)calloc(blockSize, 1);
+      ASSERT_INVARIANT(invariant());
+      char *newBlock = blockSource->allocateBlock(blockSize);
+      CUTILS_ASSERT_ALWAYS(newBlock, "BlockSource could not allocate a block");
+      ALLOCATOR_STATS(
+        if (curAllocationByte) {
+          size_t tailWaste = (endAllocationByte - 1) - curAllocationByte;
+          stats.tailWasteBytes += tailWaste;
+          if (stats.maxTailWasteBytes < tailWaste)
+            stats.maxTailWasteBytes = tailWaste;
+        }
+        stats.numBlocks++;
+        stats.totalNumBlocks++;
+        if (stats.highWaterNumBlocks < stats.numBlocks)
+          stats.highWaterNumBlocks = stats.numBlocks;
+      )
+      curAllocationByte = newBlock;
       endAllocationByte = curAllocationByte + blockSize + 1;
       blocks.pushItem(curAllocationByte);
-      ASSERT(invariant());
+      CUTILS_TRACE(TraceBlockAlloc, blockSize, blocks.getNumItems());
+      ASSERT_INVARIANT(invariant());
     }
 
     /// \brief The current block from which allocations are being made.
@@ -105,8 +207,23 @@ class BlockAllocator {
     /// \brief The size of each new allocation block
     size_t blockSize;
 
+    /// \brief The number of bytes allocated (as (sub)structures) since
+    /// this allocator was created or last cleared.
+    size_t bytesAllocated;
+
     /// \brief The blocks from which to allocate new sub-structures.
     VarArray<char*> blocks;
+
+    /// \brief The source of new (and sink of old) blocks.
+    BlockSource *blockSource;
+
+#ifdef CUTILS_ALLOCATOR_STATS
+    /// \brief The statistics collected for this allocator.
+    AllocatorStats stats;
+
+    /// \brief The (monotonic) time at which this allocator was created.
+    double statsStartTime;
+#endif
 };
 
 #endif
@@ -0,0 +1,213 @@
+#ifndef BLOCK_SOURCE_H
+#define BLOCK_SOURCE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// Not all versions of the system headers provide the flags used
+// below, so we (re)define them where needed. The Linux values have
+// been stable for a very long time.
+#if defined(__linux__) && !defined(MAP_HUGETLB)
+#define MAP_HUGETLB 0x40000
+#endif
+#if defined(__linux__) && !defined(MADV_HUGEPAGE)
+#define MADV_HUGEPAGE 14
+#endif
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+#ifndef BLOCK_SOURCE_MPOL_BIND
+#define BLOCK_SOURCE_MPOL_BIND 2
+#endif
+
+#ifndef BlockSourceHugePageSize
+#define BlockSourceHugePageSize (2*1024*1024)
+#endif
+
+/// \brief The BlockSource class provides the (zeroed) memory blocks
+/// used by a BlockAllocator.
+///
+/// The default BlockSource simply uses calloc/free. Subclasses can
+/// provide blocks from other sources (such as mmap).
+class BlockSource {
+  public:
+
+    /// \brief Destroy a BlockSource.
+    virtual ~BlockSource(void) { }
+
+    /// \brief Allocate a new zeroed block of (at least) blockSize
+    /// bytes.
+    ///
+    /// Returns NULL if no block could be allocated.
+    virtual char *allocateBlock(size_t blockSize) {
+      return (char*)calloc(blockSize, 1);
+    }
+
+    /// \brief Free a block previously returned by allocateBlock using
+    /// the same blockSize.
+    virtual void freeBlock(char *aBlock, size_t /* blockSize */) {
+      if (aBlock) free(aBlock);
+    }
+
+    /// \brief (Internal) get the default (calloc/free based)
+    /// BlockSource.
+    static BlockSource *getDefault(void) {
+      static BlockSource defaultBlockSource;
+      return &defaultBlockSource;
+    }
+};
+
+/// \brief The MmapBlockSource class provides memory blocks which are
+/// directly mmapped from the operating system.
+///
+/// Large blocks can (optionally) be backed by huge pages, to reduce
+/// the number of TLB misses, prefaulted, and/or bound to a given NUMA
+/// node. Only blocks of at least BlockSourceHugePageSize bytes are
+/// backed by (and rounded up to) huge pages, smaller blocks are always
+/// rounded up to normal pages.
+///
+/// All of these options are requests, if the operating system is not
+/// able to honour a given option (for example there are no huge pages
+/// reserved) then the block is allocated without it.
+class MmapBlockSource : public BlockSource {
+  public:
+
+    /// \brief The options which can be combined when creating an
+    /// MmapBlockSource.
+    enum Options {
+      /// \brief Use explicit (reserved) huge pages via MAP_HUGETLB.
+      UseHugeTLB      = 0x1,
+      /// \brief Advise the kernel to use transparent huge pages via
+      /// madvise(MADV_HUGEPAGE).
+      AdviseHugePages = 0x2,
+      /// \brief Prefault all pages of each new block (once any huge page
+      /// advice and NUMA binding have been applied).
+      Populate        = 0x4
+    };
+
+    /// \brief Create a new MmapBlockSource using someOptions.
+    ///
+    /// If aNumaNode is not negative, then each new block is bound to
+    /// that NUMA node (if mbind is available).
+    MmapBlockSource(int someOptions = 0, int aNumaNode = -1) {
+      options  = someOptions;
+      numaNode = aNumaNode;
+      pageSize = sysconf(_SC_PAGESIZE);
+    }
+
+    /// \brief Destroy an MmapBlockSource.
+    virtual ~MmapBlockSource(void) { }
+
+    /// \brief Return true if a block of blockSize bytes is backed by
+    /// huge pages.
+    bool usesHugePages(size_t blockSize) const {
+      return (options & (UseHugeTLB | AdviseHugePages)) &&
+        (BlockSourceHugePageSize <= blockSize);
+    }
+
+    /// \brief Compute the number of bytes actually mapped for a given
+    /// blockSize.
+    size_t getMappedSize(size_t blockSize) const {
+      size_t roundTo = pageSize;
+      if (usesHugePages(blockSize)) roundTo = BlockSourceHugePageSize;
+      return ((blockSize + roundTo - 1) / roundTo) * roundTo;
+    }
+
+    /// \brief Allocate a new zeroed block of (at least) blockSize
+    /// bytes by mmapping anonymous memory.
+    ///
+    /// The block is mapped without MAP_POPULATE, since the pages
+    /// faulted in by mmap would ignore both the huge page advice and
+    /// the NUMA binding (which are only applied to the mapping
+    /// afterwards). Any prefaulting is done last.
+    virtual char *allocateBlock(size_t blockSize) {
+      size_t mappedSize = getMappedSize(blockSize);
+      int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+      void *aBlock = MAP_FAILED;
+#ifdef MAP_HUGETLB
+      if ((options & UseHugeTLB) && usesHugePages(blockSize)) {
+        aBlock = mapMemory(mappedSize, flags | MAP_HUGETLB);
+      }
+#endif
+      if (aBlock == MAP_FAILED) {
+        aBlock = mapMemory(mappedSize, flags);
+        if (aBlock == MAP_FAILED) return NULL;
+        if (usesHugePages(blockSize)) adviseHugePages(aBlock, mappedSize);
+      }
+      bindToNumaNode(aBlock, mappedSize);
+      if (options & Populate) prefault(aBlock, mappedSize);
+      return (char*)aBlock;
+    }
+
+    /// \brief Unmap a block previously returned by allocateBlock using
+    /// the same blockSize.
+    virtual void freeBlock(char *aBlock, size_t blockSize) {
+      if (aBlock) munmap(aBlock, getMappedSize(blockSize));
+    }
+
+  protected:
+
+    /// \brief Map mappedSize bytes of anonymous memory using the mmap
+    /// flags provided (returns MAP_FAILED on failure).
+    virtual void *mapMemory(size_t mappedSize, int flags) {
+      return mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+
+    /// \brief Advise the kernel to back the memory provided with
+    /// transparent huge pages.
+    virtual void adviseHugePages(void *aBlock, size_t mappedSize) {
+#ifdef MADV_HUGEPAGE
+      madvise(aBlock, mappedSize, MADV_HUGEPAGE);
+#endif
+    }
+
+    /// \brief Fault in every page of the memory provided.
+    ///
+    /// MADV_POPULATE_WRITE (Linux 5.14) is used if it is available,
+    /// otherwise the first byte of each page is written.
+    virtual void prefault(void *aBlock, size_t mappedSize) {
+#ifdef MADV_POPULATE_WRITE
+      if (madvise(aBlock, mappedSize, MADV_POPULATE_WRITE) == 0) return;
+#endif
+      volatile char *bytes = (volatile char*)aBlock;
+      for (size_t offset = 0; offset < mappedSize; offset += pageSize) {
+        bytes[offset] = 0;
+      }
+    }
+
+    /// \brief Bind the memory provided to the numaNode (if any).
+    ///
+    /// We use the raw system call so that libnuma is not required.
+    /// Failures are ignored, the memory simply remains unbound.
+    virtual void bindToNumaNode(void *aBlock, size_t mappedSize) {
+#if defined(__linux__) && defined(SYS_mbind)
+      if (numaNode < 0) return;
+      size_t bitsPerWord = sizeof(unsigned long)*8;
+      if (numaNode >= (int)(bitsPerWord*4)) return;
+      unsigned long nodeMask[4] = { 0, 0, 0, 0 };
+      nodeMask[numaNode / bitsPerWord] |= 1UL << (numaNode % bitsPerWord);
+      syscall(SYS_mbind, aBlock, mappedSize, BLOCK_SOURCE_MPOL_BIND,
+              nodeMask, bitsPerWord*4 + 1, 0);
+#endif
+    }
+
+    /// \brief The (bitwise or of the) Options requested.
+    int options;
+
+    /// \brief The NUMA node to which new blocks are bound (or -1 if
+    /// blocks are not bound).
+    int numaNode;
+
+    /// \brief The size of the (normal) pages used to round up each
+    /// block which is not backed by huge pages.
+    size_t pageSize;
+};
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "cUtils/assertions.h"
+#include "cUtils/hashing.h"
+#include "cUtils/memoryUsage.h"
+
+/// \brief The default number of bits (per expected item) of a
+/// BloomFilter.
+#ifndef BloomFilterBitsPerItem
+#define BloomFilterBitsPerItem 12
+#endif
+
+/// \brief The default number of counters (per expected item) of a
+/// CountingBloomFilter.
+#ifndef BloomFilterCountersPerItem
+#define BloomFilterCountersPerItem 12
+#endif
+
+/// \brief The number of keys whose hashes are computed (and whose
+/// blocks are prefetched) ahead of the batched probes.
+#ifndef BloomFilterBatchSize
+#define BloomFilterBatchSize 16
+#endif
+
+/// \brief (Internal) The BloomFilterProbe class derives the block and
+/// the eight lane positions probed for a key from its 64 bit hash.
+///
+/// The high 32 bits of the hash select the block (by a multiply and
+/// shift, so any number of blocks may be used) while the low 32 bits,
+/// multiplied by a distinct odd salt for each lane, select the
+/// position within each of the eight 64 bit lanes of the block.
+struct BloomFilterProbe {
+
+  /// \brief The number of 64 bit lanes in a (64 byte) block.
+  static const size_t numLanes = 8;
+
+  /// \brief Return the block probed for aHash.
+  static size_t getBlockNum(uint64_t aHash, size_t numBlocks) {
+    return (size_t)(((aHash >> 32)*(uint64_t)numBlocks) >> 32);
+  }
+
+  /// \brief Return the position (of positionBits bits) within lane
+  /// laneNum probed for aHash.
+  static size_t getPosition(uint64_t aHash, size_t laneNum,
+                            size_t positionBits) {
+    static const uint32_t salts[numLanes] = {
+      0x47B6137BU, 0x44974D91U, 0x8824AD5BU, 0xA2B7289DU,
+      0x705495C7U, 0x2DF1424BU, 0x9EFC4947U, 0x5C6BFB31U
+    };
+    return
+      (uint32_t)(((uint32_t)aHash)*salts[laneNum]) >> (32 - positionBits);
+  }
+
+  /// \brief Allocate (zeroed) cache line aligned storage for numBlocks
+  /// blocks.
+  static uint64_t *newBlocks(size_t numBlocks) {
+    void *blocks = NULL;
+    size_t numBytes = numBlocks*numLanes*sizeof(uint64_t);
+    if (posix_memalign(&blocks, 64, numBytes)) blocks = NULL;
+    ASSERT(blocks);
+    memset(blocks, 0, numBytes);
+    return (uint64_t*)blocks;
+  }
+
+  /// \brief Return the number of blocks needed for someItems items of
+  /// slotsPerItem slots each (of slotsPerBlock slots per block).
+  static size_t getNumBlocks(size_t someItems, size_t slotsPerItem,
+                             size_t slotsPerBlock) {
+    size_t numBlocks =
+      (someItems*slotsPerItem + slotsPerBlock - 1)/slotsPerBlock;
+    if (!numBlocks) numBlocks = 1;
+    ASSERT(numBlocks <= 0xFFFFFFFFULL);
+    return numBlocks;
+  }
+};
+
+/// \brief (Internal) The BloomFilterBlocks template class holds the
+/// cache line blocks shared by the BloomFilter and CountingBloomFilter
+/// classes, together with their batched insertions and queries.
+///
+/// FilterT is the filter class derived from this class, which provides
+/// the insertHash and mayContainHash methods used by the batches.
+template<class KeyT, class TraitsT, class FilterT>
+class BloomFilterBlocks {
+  public:
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a BloomFilterBlocks class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (!blocks)
+        throw AssertionFailure("no blocks");
+      if (((uintptr_t)blocks) % 64)
+        throw AssertionFailure("blocks not aligned");
+      return true;
+    }
+
+    /// \brief Create numBlocks (zeroed) blocks.
+    BloomFilterBlocks(size_t aNumBlocks) {
+      numBlocks = aNumBlocks;
+      blocks    = BloomFilterProbe::newBlocks(numBlocks);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy the blocks.
+    ~BloomFilterBlocks(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      if (blocks) free(blocks);
+      blocks    = NULL;
+      numBlocks = 0;
+    }
+
+    /// \brief Return the number of (cache line) blocks.
+    size_t getNumBlocks(void) const {
+      return numBlocks;
+    }
+
+    /// \brief Insert aKey.
+    void insertKey(const KeyT &aKey) {
+      getFilter().insertHash(TraitsT::hash(aKey));
+    }
+
+    /// \brief Insert the numKeys keys starting at someKeys.
+    void insertKeys(const KeyT *someKeys, size_t numKeys) {
+      ASSERT_INVARIANT(invariant());
+      uint64_t hashes[BloomFilterBatchSize];
+      for (size_t first = 0; first < numKeys; first += BloomFilterBatchSize) {
+        size_t batchSize =
+          hashBatch(someKeys + first, numKeys - first, hashes);
+        for (size_t i = 0; i < batchSize; i++) {
+          getFilter().insertHash(hashes[i]);
+        }
+      }
+    }
+
+    /// \brief Return false if aKey has certainly not been inserted.
+    bool mayContain(const KeyT &aKey) const {
+      return getFilter().mayContainHash(TraitsT::hash(aKey));
+    }
+
+    /// \brief Query the numKeys keys starting at someKeys, setting the
+    /// corresponding results (if results is not NULL).
+    ///
+    /// Returns the number of keys which may have been inserted.
+    size_t mayContainKeys(const KeyT *someKeys, size_t numKeys,
+                          bool *results = NULL) const {
+      ASSERT_INVARIANT(invariant());
+      uint64_t hashes[BloomFilterBatchSize];
+      size_t numFound = 0;
+      for (size_t first = 0; first < numKeys; first += BloomFilterBatchSize) {
+        size_t batchSize =
+          hashBatch(someKeys + first, numKeys - first, hashes);
+        for (size_t i = 0; i < batchSize; i++) {
+          bool isFound = getFilter().mayContainHash(hashes[i]);
+          if (results) results[first + i] = isFound;
+          if (isFound) numFound++;
+        }
+      }
+      return numFound;
+    }
+
+    /// \brief Remove all of the keys from the filter.
+    void clearKeys(void) {
+      memset(blocks, 0, numBlocks*bytesPerBlock);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this filter.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(FilterT);
+      usage.numAllocations = 1;
+      usage.bytesReserved  = numBlocks*bytesPerBlock;
+      usage.bytesUsed      = usage.bytesReserved;
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief The number of bytes in each block.
+    static const size_t bytesPerBlock = BloomFilterProbe::numLanes*8;
+
+    /// \brief (Internal) Return the filter derived from these blocks.
+    FilterT &getFilter(void) {
+      return *static_cast<FilterT*>(this);
+    }
+
+    const FilterT &getFilter(void) const {
+      return *static_cast<const FilterT*>(this);
+    }
+
+    /// \brief (Internal) Return the block probed for aHash.
+    uint64_t *getBlock(uint64_t aHash) const {
+      return blocks + BloomFilterProbe::numLanes*
+        BloomFilterProbe::getBlockNum(aHash, numBlocks);
+    }
+
+    /// \brief (Internal) Hash (at most BloomFilterBatchSize of) the
+    /// numKeys keys starting at someKeys, prefetching their blocks.
+    ///
+    /// Returns the number of keys hashed.
+    size_t hashBatch(const KeyT *someKeys, size_t numKeys,
+                     uint64_t *hashes) const {
+      size_t batchSize = numKeys;
+      if (BloomFilterBatchSize < batchSize) batchSize = BloomFilterBatchSize;
+      for (size_t i = 0; i < batchSize; i++) {
+        hashes[i] = TraitsT::hash(someKeys[i]);
+        __builtin_prefetch(getBlock(hashes[i]));
+      }
+      return batchSize;
+    }
+
+    /// \brief The (cache line aligned) blocks.
+    uint64_t *blocks;
+
+    /// \brief The number of blocks.
+    size_t numBlocks;
+
+  private:
+
+    /// \brief BloomFilterBlocks MUST NOT be copied (the blocks would be
+    /// freed twice).
+    BloomFilterBlocks(const BloomFilterBlocks &other);
+    void operator=(const BloomFilterBlocks &other);
+};
+
+/// \brief The BloomFilter template class holds the information
+/// required to answer (approximate) membership queries for keys of
+/// type KeyT.
+///
+/// A query for a key which was inserted always returns true, while a
+/// query for any other key returns false except with a small (false
+/// positive) probability, which falls as the bits per item rise (about
+/// 0.5% at the default of 12 bits per item).
+///
+/// The filter is a "split block" Bloom filter. The bits are held in
+/// cache line (64 byte) blocks of eight 64 bit lanes. Each key sets (or
+/// tests) exactly one bit in each lane of exactly one block, all eight
+/// bits being derived from the key's single 64 bit hash (see
+/// BloomFilterProbe). So an insertion or a query touches one cache
+/// line, and a query compares the whole block with the key's eight bit
+/// mask (using SSE2 if it is available).
+///
+/// The batched insertKeys and mayContainKeys hash a batch of keys and
+/// prefetch their blocks before probing them, so that the cache misses
+/// of the batch overlap (see BloomFilterBlocks).
+///
+/// TraitsT provides the (static) hash function of the keys (see
+/// HashTraits).
+template<class KeyT, class TraitsT = HashTraits<KeyT> >
+class BloomFilter
+  : public BloomFilterBlocks<KeyT, TraitsT, BloomFilter<KeyT, TraitsT> > {
+  public:
+
+    /// \brief The blocks of bits of this filter.
+    typedef BloomFilterBlocks<KeyT, TraitsT, BloomFilter> Blocks;
+
+    /// \brief Create an (empty) BloomFilter sized for expectedItems
+    /// items of bitsPerItem bits each.
+    BloomFilter(size_t expectedItems,
+                size_t bitsPerItem = BloomFilterBitsPerItem)
+      : Blocks(BloomFilterProbe::getNumBlocks(expectedItems, bitsPerItem,
+                                              bitsPerBlock)) { }
+
+    /// \brief Return the number of bits.
+    size_t getNumBits(void) const {
+      return this->numBlocks*bitsPerBlock;
+    }
+
+    /// \brief Insert the key with this (64 bit) hash.
+    void insertHash(uint64_t aHash) {
+      uint64_t *block = this->getBlock(aHash);
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum++) {
+        block[laneNum] |= getLaneBit(aHash, laneNum);
+      }
+    }
+
+    /// \brief Return false if the key with this (64 bit) hash has
+    /// certainly not been inserted.
+    bool mayContainHash(uint64_t aHash) const {
+      const uint64_t *block = this->getBlock(aHash);
+      uint64_t masks[numLanes];
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum++) {
+        masks[laneNum] = getLaneBit(aHash, laneNum);
+      }
+#ifdef __SSE2__
+      // every bit of the mask must be set in the block
+      __m128i missing = _mm_setzero_si128();
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum += 2) {
+        __m128i blockLanes = _mm_load_si128((const __m128i*)(block + laneNum));
+        __m128i maskLanes  = _mm_loadu_si128((const __m128i*)(masks + laneNum));
+        missing =
+          _mm_or_si128(missing, _mm_andnot_si128(blockLanes, maskLanes));
+      }
+      __m128i isZero = _mm_cmpeq_epi8(missing, _mm_setzero_si128());
+      return _mm_movemask_epi8(isZero) == 0xFFFF;
+#else
+      uint64_t missing = 0;
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum++) {
+        missing |= masks[laneNum] & ~block[laneNum];
+      }
+      return !missing;
+#endif
+    }
+
+    /// \brief Add every key inserted into other to this filter (which
+    /// MUST have the same number of blocks).
+    ///
+    /// Returns false (leaving this filter unchanged) if the numbers of
+    /// blocks differ.
+    bool unionWith(const BloomFilter &other) {
+      ASSERT_INVARIANT(this->invariant());
+      if (this->numBlocks != other.numBlocks) return false;
+      size_t numWords = this->numBlocks*numLanes;
+      for (size_t i = 0; i < numWords; i++) {
+        this->blocks[i] |= other.blocks[i];
+      }
+      return true;
+    }
+
+  protected:
+
+    /// \brief The number of 64 bit lanes in each block.
+    static const size_t numLanes = BloomFilterProbe::numLanes;
+
+    /// \brief The number of bits in each block.
+    static const size_t bitsPerBlock = Blocks::bytesPerBlock*8;
+
+    /// \brief (Internal) Return the bit of lane laneNum set for aHash.
+    static uint64_t getLaneBit(uint64_t aHash, size_t laneNum) {
+      return 1ULL << BloomFilterProbe::getPosition(aHash, laneNum, 6);
+    }
+};
+
+/// \brief The CountingBloomFilter template class holds the information
+/// required to answer (approximate) membership queries for keys of
+/// type KeyT which may also be removed.
+///
+/// The filter has the same "split block" layout as a BloomFilter but
+/// each of its 64 bit lanes holds sixteen 4 bit counters (rather than
+/// 64 bits), so each key increments (or decrements, or tests) exactly
+/// one counter in each lane of exactly one cache line block. A counter
+/// which reaches 15 is saturated and is never decremented again, so a
+/// removal never introduces a false negative (but the false positive
+/// rate of a filter with many saturated counters will rise).
+///
+/// A key MUST only be removed if it has been inserted (and not yet
+/// removed). TraitsT provides the (static) hash function of the keys
+/// (see HashTraits).
+template<class KeyT, class TraitsT = HashTraits<KeyT> >
+class CountingBloomFilter
+  : public BloomFilterBlocks<KeyT, TraitsT,
+                             CountingBloomFilter<KeyT, TraitsT> > {
+  public:
+
+    /// \brief The blocks of counters of this filter.
+    typedef BloomFilterBlocks<KeyT, TraitsT, CountingBloomFilter> Blocks;
+
+    /// \brief Create an (empty) CountingBloomFilter sized for
+    /// expectedItems items of countersPerItem counters each.
+    CountingBloomFilter(size_t expectedItems,
+                        size_t countersPerItem = BloomFilterCountersPerItem)
+      : Blocks(BloomFilterProbe::getNumBlocks(expectedItems,
+                                              countersPerItem,
+                                              countersPerBlock)) { }
+
+    /// \brief Return the number of (4 bit) counters.
+    size_t getNumCounters(void) const {
+      return this->numBlocks*countersPerBlock;
+    }
+
+    /// \brief Insert the key with this (64 bit) hash.
+    void insertHash(uint64_t aHash) {
+      uint64_t *block = this->getBlock(aHash);
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum++) {
+        size_t shift = getCounterShift(aHash, laneNum);
+        if (((block[laneNum] >> shift) & maxCount) != maxCount) {
+          block[laneNum] += 1ULL << shift;
+        }
+      }
+    }
+
+    /// \brief Remove the key with this (64 bit) hash.
+    ///
+    /// Returns false (leaving the filter unchanged) if the key has
+    /// certainly not been inserted.
+    bool removeHash(uint64_t aHash) {
+      if (!mayContainHash(aHash)) return false;
+      uint64_t *block = this->getBlock(aHash);
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum++) {
+        size_t shift = getCounterShift(aHash, laneNum);
+        if (((block[laneNum] >> shift) & maxCount) != maxCount) {
+          block[laneNum] -= 1ULL << shift;
+        }
+      }
+      return true;
+    }
+
+    /// \brief Remove aKey.
+    ///
+    /// Returns false (leaving the filter unchanged) if aKey has
+    /// certainly not been inserted.
+    bool removeKey(const KeyT &aKey) {
+      return removeHash(TraitsT::hash(aKey));
+    }
+
+    /// \brief Return false if the key with this (64 bit) hash has
+    /// certainly not been inserted.
+    bool mayContainHash(uint64_t aHash) const {
+      const uint64_t *block = this->getBlock(aHash);
+      bool isFound = true;
+      for (size_t laneNum = 0; laneNum < numLanes; laneNum++) {
+        size_t shift = getCounterShift(aHash, laneNum);
+        isFound &= (((block[laneNum] >> shift) & maxCount) != 0);
+      }
+      return isFound;
+    }
+
+  protected:
+
+    /// \brief The number of 64 bit lanes in each block.
+    static const size_t numLanes = BloomFilterProbe::numLanes;
+
+    /// \brief The largest (saturated) count of a counter.
+    static const uint64_t maxCount = 0xF;
+
+    /// \brief The number of (4 bit) counters in each block.
+    static const size_t countersPerBlock = Blocks::bytesPerBlock*2;
+
+    /// \brief (Internal) Return the shift of the counter of lane
+    /// laneNum used by aHash.
+    static size_t getCounterShift(uint64_t aHash, size_t laneNum) {
+      return BloomFilterProbe::getPosition(aHash, laneNum, 4)*4;
+    }
+};
+
+#endif
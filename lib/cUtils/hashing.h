@@ -0,0 +1,113 @@
+#ifndef HASHING_H
+#define HASHING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// This header file provides the (non-cryptographic) hash functions
+// used by the cUtils hashed containers.
+//
+// All of the hashes are 64 bits wide and are well mixed in both their
+// high and low bits, so containers may use any subset of the bits.
+
+/// \brief Mix (finalize) a 64 bit value so that every input bit
+/// affects every output bit (the MurmurHash3 fmix64 finalizer).
+inline uint64_t hashMix64(uint64_t aValue) {
+  aValue ^= aValue >> 33;
+  aValue *= 0xFF51AFD7ED558CCDULL;
+  aValue ^= aValue >> 33;
+  aValue *= 0xC4CEB9FE1A85EC53ULL;
+  aValue ^= aValue >> 33;
+  return aValue;
+}
+
+/// \brief Hash numBytes bytes starting at someBytes.
+///
+/// The bytes are consumed eight at a time (using unaligned loads), so
+/// this is considerably faster than a byte at a time hash (such as
+/// FNV-1a) for all but the shortest strings.
+inline uint64_t hashBytes(const void *someBytes, size_t numBytes,
+                          uint64_t aSeed = 0) {
+  const unsigned char *bytePtr = (const unsigned char*)someBytes;
+  uint64_t hash = aSeed ^ (numBytes * 0x9E3779B97F4A7C15ULL);
+  for ( ; 8 <= numBytes; bytePtr += 8, numBytes -= 8) {
+    uint64_t word;
+    memcpy(&word, bytePtr, 8);
+    hash  = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 31;
+  }
+  if (numBytes) {
+    // read the (1 to 7) remaining bytes using fixed size (so inlined)
+    // loads, overlapping the two loads if needed
+    uint64_t word = 0;
+    if (4 <= numBytes) {
+      uint32_t lowWord, highWord;
+      memcpy(&lowWord,  bytePtr, 4);
+      memcpy(&highWord, bytePtr + numBytes - 4, 4);
+      word = (((uint64_t)highWord) << 32) | lowWord;
+    } else {
+      word = (((uint64_t)bytePtr[0]) << 16) |
+        (((uint64_t)bytePtr[numBytes >> 1]) << 8) | bytePtr[numBytes - 1];
+    }
+    hash  = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 31;
+  }
+  return hashMix64(hash);
+}
+
+/// \brief Hash a (NUL terminated) string.
+inline uint64_t hashString(const char *aString) {
+  return hashBytes(aString, strlen(aString));
+}
+
+/// \brief The HashTraits template class provides the hash and equality
+/// of the keys of the hashed containers.
+///
+/// By default the bytes of a key are hashed and keys are compared
+/// using operator==, which is correct for integers and for plain old
+/// data types without padding. Other key types should provide a
+/// specialization.
+template<class KeyT>
+struct HashTraits {
+  static uint64_t hash(const KeyT &aKey) {
+    return hashBytes(&aKey, sizeof(KeyT));
+  }
+  static bool equal(const KeyT &aKey, const KeyT &otherKey) {
+    return aKey == otherKey;
+  }
+};
+
+#define HASH_TRAITS_FOR_INTEGER(IntT)                           \
+template<>                                                      \
+struct HashTraits<IntT> {                                       \
+  static uint64_t hash(const IntT &aKey) {                      \
+    return hashMix64((uint64_t)aKey);                           \
+  }                                                             \
+  static bool equal(const IntT &aKey, const IntT &otherKey) {   \
+    return aKey == otherKey;                                    \
+  }                                                             \
+}
+
+HASH_TRAITS_FOR_INTEGER(int);
+HASH_TRAITS_FOR_INTEGER(unsigned int);
+HASH_TRAITS_FOR_INTEGER(long);
+HASH_TRAITS_FOR_INTEGER(unsigned long);
+HASH_TRAITS_FOR_INTEGER(long long);
+HASH_TRAITS_FOR_INTEGER(unsigned long long);
+
+#undef HASH_TRAITS_FOR_INTEGER
+
+/// \brief The HashTraits of (NUL terminated) strings, which are
+/// hashed and compared by their contents (not their addresses).
+template<>
+struct HashTraits<const char*> {
+  static uint64_t hash(const char * const &aKey) {
+    return hashString(aKey);
+  }
+  static bool equal(const char * const &aKey, const char * const &otherKey) {
+    return strcmp(aKey, otherKey) == 0;
+  }
+};
+
+#endif
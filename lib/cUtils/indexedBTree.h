@@ -0,0 +1,698 @@
+#ifndef INDEXED_B_TREE_H
+#define INDEXED_B_TREE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cUtils/arrayKernels.h"
+#include "cUtils/memoryUsage.h"
+#include "cUtils/typedIndexedAllocator.h"
+#include "cUtils/varArray.h"
+
+/// \brief The maximum height of an IndexedBTree (far more than can be
+/// reached with 32 bit node indexes).
+#define IndexedBTreeMaxHeight 32
+
+/// \brief (Internal) The IndexedBTreeFanout template class computes
+/// the number of keys held in each node of an IndexedBTree so that a
+/// node fits in NodeBytes bytes.
+///
+/// A leaf holds a key and a value per slot, while an inner node holds
+/// a key and a 32 bit child index per slot (and one more child).
+template<class KeyT, class ValueT, size_t NodeBytes>
+struct IndexedBTreeFanout {
+  static const size_t linkBytes = (sizeof(ValueT) < 4) ? 4 : sizeof(ValueT);
+  static const size_t slotBytes = sizeof(KeyT) + linkBytes;
+  static const size_t fitKeys   = (NodeBytes - 8 - linkBytes)/slotBytes;
+  static const size_t numKeys   = (fitKeys < 4) ? 4 : fitKeys;
+};
+
+/// \brief The IndexedBTree template class holds the information
+/// required to map (ordered) keys of type KeyT to values of type
+/// ValueT.
+///
+/// The tree is a B+-tree: all of the key/value pairs are held, in key
+/// order, in the leaves (which are linked in key order for range
+/// scans), while the inner nodes hold only the separating keys and the
+/// children. The nodes are allocated from a TypedIndexedAllocator and
+/// refer to each other by their 32 bit node indexes (rather than
+/// pointers). Each node is sized to NodeBytes bytes (a few cache
+/// lines), so a lookup visits one node per level of a shallow tree
+/// and searches each node with a short, branch free, linear scan.
+///
+/// Compared to a std::map this avoids the per item allocations and
+/// the pointer chasing through a deep binary tree, and a range scan
+/// walks contiguous keys.
+///
+/// A tree may be bulk loaded from a sorted VarArray of entries, which
+/// packs the leaves full. Erasing an item does not rebalance the tree
+/// (emptied nodes stay in place until the tree is cleared), which
+/// suits maps which are mostly loaded and queried.
+///
+/// The nodes are allocated from zeroed memory and are never
+/// constructed nor destroyed, so KeyT and ValueT should be plain old
+/// data types. CompareT provides the strict (less than) ordering of
+/// the keys (see ArrayLess).
+template<class KeyT, class ValueT, class CompareT = ArrayLess<KeyT>,
+         size_t NodeBytes = 256, size_t NodeBitShift = 6>
+class IndexedBTree {
+
+  public:
+
+    /// \brief A key/value entry (used to bulk load the tree).
+    typedef struct Entry {
+      KeyT   key;
+      ValueT value;
+    } Entry;
+
+    /// \brief The number of keys held by each node.
+    static const size_t nodeKeys =
+      IndexedBTreeFanout<KeyT, ValueT, NodeBytes>::numKeys;
+
+    /// \brief The node index used when there is no such node.
+    static const uint32_t noNode = 0xFFFFFFFF;
+
+    /// \brief A node of the tree.
+    ///
+    /// A leaf holds numKeys keys and their values and the index of the
+    /// next leaf (in key order). An inner node holds numKeys separating
+    /// keys and numKeys+1 children, the key keys[i] being the smallest
+    /// key which may be found below children[i+1].
+    typedef struct Node {
+      uint32_t numKeys;
+      uint32_t nextLeaf;
+      KeyT     keys[nodeKeys];
+      union {
+        ValueT   values[nodeKeys];
+        uint32_t children[nodeKeys + 1];
+      };
+    } Node;
+
+    /// \brief The Iterator class walks the items of an IndexedBTree in
+    /// key order along the linked leaves.
+    ///
+    /// Items MUST NOT be inserted or erased while an iterator is in
+    /// use.
+    class Iterator {
+      public:
+
+        /// \brief Return true if there are more items to visit.
+        bool hasMoreItems(void) {
+          skipEmptyLeaves();
+          return leafIndex != noNode;
+        }
+
+        /// \brief Get the next item (in key order).
+        ///
+        /// Returns false if there are no more items.
+        bool nextItem(KeyT &aKey, ValueT &aValue) {
+          if (!hasMoreItems()) return false;
+          Node &leaf = tree->nodes[leafIndex];
+          aKey   = leaf.keys[slotNum];
+          aValue = leaf.values[slotNum];
+          slotNum++;
+          return true;
+        }
+
+      protected:
+
+        Iterator(const IndexedBTree *aTree, uint32_t aLeafIndex,
+                 size_t aSlotNum) {
+          tree      = aTree;
+          leafIndex = aLeafIndex;
+          slotNum   = aSlotNum;
+        }
+
+        /// \brief (Internal) Move on to the next leaf with an item to
+        /// visit.
+        void skipEmptyLeaves(void) {
+          while ((leafIndex != noNode) &&
+                 (tree->nodes[leafIndex].numKeys <= slotNum)) {
+            leafIndex = tree->nodes[leafIndex].nextLeaf;
+            slotNum   = 0;
+          }
+        }
+
+        const IndexedBTree *tree;
+
+        uint32_t leafIndex;
+
+        size_t slotNum;
+
+        friend class IndexedBTree;
+    };
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a IndexedBTree class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if ((root == noNode) != (height == 0))
+        throw AssertionFailure("root and height disagree");
+      if ((root != noNode) && (nodes.nextIndex() <= root))
+        throw AssertionFailure("root not allocated");
+      if (IndexedBTreeMaxHeight < height)
+        throw AssertionFailure("tree too high");
+      return nodes.invariant();
+    }
+
+    /// \brief An (expensive) invariant which checks the order of every
+    /// key and the links between every node.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool treeInvariant(void) const {
+      invariant();
+      if (root == noNode) {
+        if (numItems) throw AssertionFailure("items without a root");
+        return true;
+      }
+      uint32_t lastLeaf = noNode;
+      size_t numFound = checkSubtree(root, height - 1, NULL, NULL, lastLeaf);
+      if (numFound != numItems)
+        throw AssertionFailure("incorrect number of items");
+      if (nodes[lastLeaf].nextLeaf != noNode)
+        throw AssertionFailure("last leaf linked");
+      return true;
+    }
+
+    /// \brief Create an (empty) IndexedBTree.
+    ///
+    /// The blocks of nodes are obtained from aBlockSource (see
+    /// BlockAllocator).
+    IndexedBTree(BlockSource *aBlockSource = NULL,
+                 const CompareT &aCompare = CompareT())
+      : nodes(aBlockSource), compare(aCompare) {
+      root      = noNode;
+      firstLeaf = noNode;
+      height    = 0;
+      numItems  = 0;
+      numLeaves = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy the IndexedBTree and all of its nodes.
+    ~IndexedBTree(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      root     = noNode;
+      height   = 0;
+      numItems = 0;
+    }
+
+    /// \brief Return the number of items (keys) in the tree.
+    size_t getNumItems(void) const {
+      return numItems;
+    }
+
+    /// \brief Return the number of levels of nodes in the tree.
+    size_t getHeight(void) const {
+      return height;
+    }
+
+    /// \brief Return the number of nodes allocated.
+    size_t getNumNodes(void) const {
+      return nodes.nextIndex();
+    }
+
+    /// \brief Return a pointer to the value of this key (or NULL if the
+    /// key is not in the tree).
+    ValueT *find(const KeyT &aKey) const {
+      ASSERT_INVARIANT(invariant());
+      if (root == noNode) return NULL;
+      Node &leaf = nodes[findLeaf(aKey)];
+      size_t slotNum = lowerBound(leaf, aKey);
+      if ((slotNum < leaf.numKeys) && !compare(aKey, leaf.keys[slotNum])) {
+        return &leaf.values[slotNum];
+      }
+      return NULL;
+    }
+
+    /// \brief Return true if this key is in the tree.
+    bool contains(const KeyT &aKey) const {
+      return find(aKey) != NULL;
+    }
+
+    /// \brief Set the value of this key (inserting the key if it is not
+    /// already in the tree).
+    ///
+    /// Returns true if the key was inserted.
+    bool insert(const KeyT &aKey, const ValueT &aValue) {
+      ASSERT_INVARIANT(invariant());
+      if (root == noNode) {
+        root      = newNode();
+        firstLeaf = root;
+        height    = 1;
+        numLeaves = 1;
+      }
+      // descend, remembering the path in case the leaf must split
+      uint32_t pathNodes[IndexedBTreeMaxHeight];
+      size_t   pathSlots[IndexedBTreeMaxHeight];
+      uint32_t nodeIndex = root;
+      for (size_t level = height - 1; 0 < level; level--) {
+        Node &inner = nodes[nodeIndex];
+        size_t childNum = upperBound(inner, aKey);
+        pathNodes[level] = nodeIndex;
+        pathSlots[level] = childNum;
+        nodeIndex = inner.children[childNum];
+      }
+      Node &leaf = nodes[nodeIndex];
+      size_t slotNum = lowerBound(leaf, aKey);
+      if ((slotNum < leaf.numKeys) && !compare(aKey, leaf.keys[slotNum])) {
+        leaf.values[slotNum] = aValue;
+        return false;
+      }
+      numItems++;
+      if (leaf.numKeys < nodeKeys) {
+        insertIntoLeaf(leaf, slotNum, aKey, aValue);
+        ASSERT_INVARIANT(invariant());
+        return true;
+      }
+      // split the leaf, then insert the separator into each parent in
+      // turn until one has room (or a new root is required)
+      KeyT separator;
+      uint32_t rightIndex = splitLeaf(nodeIndex, slotNum, aKey, aValue,
+                                      separator);
+      for (size_t level = 1; level < height; level++) {
+        Node &inner = nodes[pathNodes[level]];
+        if (inner.numKeys < nodeKeys) {
+          insertIntoInner(inner, pathSlots[level], separator, rightIndex);
+          ASSERT_INVARIANT(invariant());
+          return true;
+        }
+        rightIndex = splitInner(pathNodes[level], pathSlots[level],
+                                separator, rightIndex, separator);
+      }
+      growRoot(separator, rightIndex);
+      ASSERT_INVARIANT(invariant());
+      return true;
+    }
+
+    /// \brief Remove this key (and its value) from the tree.
+    ///
+    /// Returns true if the key was in the tree. The tree is not
+    /// rebalanced.
+    bool erase(const KeyT &aKey) {
+      ASSERT_INVARIANT(invariant());
+      if (root == noNode) return false;
+      Node &leaf = nodes[findLeaf(aKey)];
+      size_t slotNum = lowerBound(leaf, aKey);
+      if ((leaf.numKeys <= slotNum) || compare(aKey, leaf.keys[slotNum])) {
+        return false;
+      }
+      size_t numMoved = leaf.numKeys - slotNum - 1;
+      memmove(&leaf.keys[slotNum], &leaf.keys[slotNum + 1],
+              numMoved*sizeof(KeyT));
+      memmove(&leaf.values[slotNum], &leaf.values[slotNum + 1],
+              numMoved*sizeof(ValueT));
+      leaf.numKeys--;
+      numItems--;
+      ASSERT_INVARIANT(invariant());
+      return true;
+    }
+
+    /// \brief Replace the contents of the tree with the (strictly)
+    /// sorted someEntries, packing the leaves full.
+    ///
+    /// Returns false (leaving the tree unchanged) if the keys of
+    /// someEntries are not strictly increasing.
+    bool loadSorted(const VarArray<Entry> &someEntries) {
+      ASSERT_INVARIANT(invariant());
+      size_t numEntries = someEntries.getNumItems();
+      for (size_t i = 1; i < numEntries; i++) {
+        if (!compare(someEntries[i - 1].key, someEntries[i].key)) return false;
+      }
+      clearItems();
+      if (!numEntries) return true;
+      // fill the leaves (spreading the entries evenly), the nodes (and
+      // first keys) of each level alternate between the two arrays
+      VarArray<uint32_t> levelNodes[2];
+      VarArray<KeyT>     levelKeys[2];
+      size_t level     = 0;
+      size_t levelSize = (numEntries + nodeKeys - 1)/nodeKeys;
+      size_t entryNum  = 0;
+      uint32_t prevLeaf = noNode;
+      levelNodes[level].reserve(levelSize);
+      levelKeys[level].reserve(levelSize);
+      for (size_t nodeNum = 0; nodeNum < levelSize; nodeNum++) {
+        uint32_t leafIndex = newNode();
+        Node &leaf = nodes[leafIndex];
+        leaf.numKeys = getShare(numEntries, levelSize, nodeNum);
+        for (size_t slotNum = 0; slotNum < leaf.numKeys; slotNum++) {
+          leaf.keys[slotNum]   = someEntries[entryNum].key;
+          leaf.values[slotNum] = someEntries[entryNum].value;
+          entryNum++;
+        }
+        if (prevLeaf == noNode) firstLeaf = leafIndex;
+        else nodes[prevLeaf].nextLeaf = leafIndex;
+        prevLeaf = leafIndex;
+        levelNodes[level].pushItem(leafIndex);
+        levelKeys[level].pushItem(leaf.keys[0]);
+      }
+      numItems  = numEntries;
+      numLeaves = levelSize;
+      height    = 1;
+      // then each level of inner nodes until a single root remains
+      while (1 < levelNodes[level].getNumItems()) {
+        VarArray<uint32_t> &childNodes = levelNodes[level];
+        VarArray<KeyT>     &childKeys  = levelKeys[level];
+        VarArray<uint32_t> &upperNodes = levelNodes[1 - level];
+        VarArray<KeyT>     &upperKeys  = levelKeys[1 - level];
+        size_t numChildren = childNodes.getNumItems();
+        size_t upperSize   = (numChildren + nodeKeys)/(nodeKeys + 1);
+        size_t childNum    = 0;
+        upperNodes.clearItems();
+        upperKeys.clearItems();
+        upperNodes.reserve(upperSize);
+        upperKeys.reserve(upperSize);
+        for (size_t nodeNum = 0; nodeNum < upperSize; nodeNum++) {
+          uint32_t innerIndex = newNode();
+          Node &inner = nodes[innerIndex];
+          size_t share = getShare(numChildren, upperSize, nodeNum);
+          upperKeys.pushItem(childKeys[childNum]);
+          for (size_t i = 0; i < share; i++, childNum++) {
+            inner.children[i] = childNodes[childNum];
+            if (i) inner.keys[i - 1] = childKeys[childNum];
+          }
+          inner.numKeys = share - 1;
+          upperNodes.pushItem(innerIndex);
+        }
+        level = 1 - level;
+        height++;
+      }
+      root = levelNodes[level][0];
+      ASSERT_EXPENSIVE(treeInvariant());
+      return true;
+    }
+
+    /// \brief Return an iterator over every item (in key order).
+    Iterator getIterator(void) const {
+      return Iterator(this, firstLeaf, 0);
+    }
+
+    /// \brief Return an iterator starting at the first item whose key
+    /// is not less than aKey.
+    Iterator getIteratorFrom(const KeyT &aKey) const {
+      ASSERT_INVARIANT(invariant());
+      if (root == noNode) return Iterator(this, noNode, 0);
+      uint32_t leafIndex = findLeaf(aKey);
+      return Iterator(this, leafIndex, lowerBound(nodes[leafIndex], aKey));
+    }
+
+    /// \brief Visit each item (in key order).
+    ///
+    /// The visitor is called as visitor(key, value). Items MUST NOT be
+    /// inserted or erased while the tree is being visited.
+    template<class VisitorT>
+    void forEachItem(VisitorT &visitor) const {
+      ASSERT_INVARIANT(invariant());
+      for (uint32_t leafIndex = firstLeaf; leafIndex != noNode;
+           leafIndex = nodes[leafIndex].nextLeaf) {
+        Node &leaf = nodes[leafIndex];
+        for (size_t slotNum = 0; slotNum < leaf.numKeys; slotNum++) {
+          visitor(leaf.keys[slotNum], leaf.values[slotNum]);
+        }
+      }
+    }
+
+    /// \brief Visit each item whose key is not less than lowKey and is
+    /// less than highKey (in key order).
+    ///
+    /// The visitor is called as visitor(key, value). Items MUST NOT be
+    /// inserted or erased while the tree is being visited.
+    template<class VisitorT>
+    void forEachItemInRange(const KeyT &lowKey, const KeyT &highKey,
+                            VisitorT &visitor) const {
+      ASSERT_INVARIANT(invariant());
+      if (root == noNode) return;
+      uint32_t leafIndex = findLeaf(lowKey);
+      size_t slotNum = lowerBound(nodes[leafIndex], lowKey);
+      for ( ; leafIndex != noNode;
+            leafIndex = nodes[leafIndex].nextLeaf, slotNum = 0) {
+        Node &leaf = nodes[leafIndex];
+        for ( ; slotNum < leaf.numKeys; slotNum++) {
+          if (!compare(leaf.keys[slotNum], highKey)) return;
+          visitor(leaf.keys[slotNum], leaf.values[slotNum]);
+        }
+      }
+    }
+
+    /// \brief Remove all of the items (and free all of the nodes).
+    void clearItems(void) {
+      nodes.clearBlocks();
+      root      = noNode;
+      firstLeaf = noNode;
+      height    = 0;
+      numItems  = 0;
+      numLeaves = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this tree.
+    ///
+    /// The keys and values of the items are used bytes, while the inner
+    /// nodes, the node headers and the table of node blocks are
+    /// overhead (so the spare slots of the leaves are wasted).
+    MemoryUsage memoryUsage(void) const {
+      MemoryUsage nodeUsage = nodes.memoryUsage();
+      size_t numInner = nodes.nextIndex() - numLeaves;
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(IndexedBTree);
+      usage.numAllocations = nodeUsage.numAllocations;
+      usage.bytesReserved  = nodeUsage.bytesReserved;
+      usage.bytesUsed      = numItems*(sizeof(KeyT) + sizeof(ValueT));
+      usage.bytesOverhead  = nodeUsage.bytesOverhead +
+        numInner*sizeof(Node) +
+        numLeaves*(sizeof(Node) - nodeKeys*(sizeof(KeyT) + sizeof(ValueT)));
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief (Internal) Allocate a new (empty) node.
+    uint32_t newNode(void) {
+      size_t nodeIndex = nodes.allocateNewStructure();
+      ASSERT(nodeIndex < noNode);
+      nodes[nodeIndex].nextLeaf = noNode;
+      return (uint32_t)nodeIndex;
+    }
+
+    /// \brief (Internal) Return the share of numItems items given to
+    /// node nodeNum when they are spread evenly over numNodes nodes.
+    static size_t getShare(size_t someItems, size_t numNodes, size_t nodeNum) {
+      return someItems/numNodes + ((nodeNum < someItems % numNodes) ? 1 : 0);
+    }
+
+    /// \brief (Internal) Return the number of keys of aNode which are
+    /// less than aKey.
+    size_t lowerBound(const Node &aNode, const KeyT &aKey) const {
+      size_t slotNum = 0;
+      for (size_t i = 0; i < aNode.numKeys; i++) {
+        slotNum += compare(aNode.keys[i], aKey);
+      }
+      return slotNum;
+    }
+
+    /// \brief (Internal) Return the number of keys of aNode which are
+    /// not greater than aKey (the child of an inner node to descend).
+    size_t upperBound(const Node &aNode, const KeyT &aKey) const {
+      size_t slotNum = 0;
+      for (size_t i = 0; i < aNode.numKeys; i++) {
+        slotNum += !compare(aKey, aNode.keys[i]);
+      }
+      return slotNum;
+    }
+
+    /// \brief (Internal) Return the index of the leaf which holds (or
+    /// would hold) aKey.
+    uint32_t findLeaf(const KeyT &aKey) const {
+      uint32_t nodeIndex = root;
+      for (size_t level = height - 1; 0 < level; level--) {
+        Node &inner = nodes[nodeIndex];
+        nodeIndex = inner.children[upperBound(inner, aKey)];
+      }
+      return nodeIndex;
+    }
+
+    /// \brief (Internal) Insert aKey and aValue at slotNum of a leaf
+    /// which has room.
+    static void insertIntoLeaf(Node &leaf, size_t slotNum,
+                               const KeyT &aKey, const ValueT &aValue) {
+      ASSERT(leaf.numKeys < nodeKeys);
+      size_t numMoved = leaf.numKeys - slotNum;
+      memmove(&leaf.keys[slotNum + 1], &leaf.keys[slotNum],
+              numMoved*sizeof(KeyT));
+      memmove(&leaf.values[slotNum + 1], &leaf.values[slotNum],
+              numMoved*sizeof(ValueT));
+      leaf.keys[slotNum]   = aKey;
+      leaf.values[slotNum] = aValue;
+      leaf.numKeys++;
+    }
+
+    /// \brief (Internal) Insert aKey at keyNum of an inner node which
+    /// has room, with aChild to its right.
+    static void insertIntoInner(Node &inner, size_t keyNum,
+                                const KeyT &aKey, uint32_t aChild) {
+      ASSERT(inner.numKeys < nodeKeys);
+      size_t numMoved = inner.numKeys - keyNum;
+      memmove(&inner.keys[keyNum + 1], &inner.keys[keyNum],
+              numMoved*sizeof(KeyT));
+      memmove(&inner.children[keyNum + 2], &inner.children[keyNum + 1],
+              numMoved*sizeof(uint32_t));
+      inner.keys[keyNum]         = aKey;
+      inner.children[keyNum + 1] = aChild;
+      inner.numKeys++;
+    }
+
+    /// \brief (Internal) Split the (full) leaf leafIndex, inserting
+    /// aKey and aValue at slotNum, returning the index of the new right
+    /// leaf and its smallest key (as the separator).
+    uint32_t splitLeaf(uint32_t leafIndex, size_t slotNum,
+                       const KeyT &aKey, const ValueT &aValue,
+                       KeyT &separator) {
+      uint32_t rightIndex = newNode();
+      Node &leaf  = nodes[leafIndex];
+      Node &right = nodes[rightIndex];
+      size_t numLeft = (nodeKeys + 1)/2;
+      if (slotNum < numLeft) {
+        // the new item belongs in the left leaf
+        size_t numRight = nodeKeys - (numLeft - 1);
+        memcpy(right.keys, &leaf.keys[numLeft - 1], numRight*sizeof(KeyT));
+        memcpy(right.values, &leaf.values[numLeft - 1],
+               numRight*sizeof(ValueT));
+        right.numKeys = numRight;
+        leaf.numKeys  = numLeft - 1;
+        insertIntoLeaf(leaf, slotNum, aKey, aValue);
+      } else {
+        size_t numRight = nodeKeys - numLeft;
+        memcpy(right.keys, &leaf.keys[numLeft], numRight*sizeof(KeyT));
+        memcpy(right.values, &leaf.values[numLeft], numRight*sizeof(ValueT));
+        right.numKeys = numRight;
+        leaf.numKeys  = numLeft;
+        insertIntoLeaf(right, slotNum - numLeft, aKey, aValue);
+      }
+      right.nextLeaf = leaf.nextLeaf;
+      leaf.nextLeaf  = rightIndex;
+      numLeaves++;
+      separator = right.keys[0];
+      return rightIndex;
+    }
+
+    /// \brief (Internal) Split the (full) inner node innerIndex,
+    /// inserting aKey at keyNum with aChild to its right, returning the
+    /// index of the new right node and the key promoted to the parent.
+    uint32_t splitInner(uint32_t innerIndex, size_t keyNum,
+                        KeyT aKey, uint32_t aChild, KeyT &promoted) {
+      // gather the keys and children (including the new ones) in order
+      KeyT     allKeys[nodeKeys + 1];
+      uint32_t allChildren[nodeKeys + 2];
+      Node &inner = nodes[innerIndex];
+      memcpy(allKeys, inner.keys, keyNum*sizeof(KeyT));
+      allKeys[keyNum] = aKey;
+      memcpy(&allKeys[keyNum + 1], &inner.keys[keyNum],
+             (nodeKeys - keyNum)*sizeof(KeyT));
+      memcpy(allChildren, inner.children, (keyNum + 1)*sizeof(uint32_t));
+      allChildren[keyNum + 1] = aChild;
+      memcpy(&allChildren[keyNum + 2], &inner.children[keyNum + 1],
+             (nodeKeys - keyNum)*sizeof(uint32_t));
+      // the middle key moves up, the rest are split between the nodes
+      uint32_t rightIndex = newNode();
+      Node &right = nodes[rightIndex];
+      size_t numLeft  = (nodeKeys + 1)/2;
+      size_t numRight = nodeKeys - numLeft;
+      memcpy(inner.keys, allKeys, numLeft*sizeof(KeyT));
+      memcpy(inner.children, allChildren, (numLeft + 1)*sizeof(uint32_t));
+      inner.numKeys = numLeft;
+      memcpy(right.keys, &allKeys[numLeft + 1], numRight*sizeof(KeyT));
+      memcpy(right.children, &allChildren[numLeft + 1],
+             (numRight + 1)*sizeof(uint32_t));
+      right.numKeys = numRight;
+      promoted = allKeys[numLeft];
+      return rightIndex;
+    }
+
+    /// \brief (Internal) Add a new root above the current root, with
+    /// rightIndex to the right of separator.
+    void growRoot(const KeyT &separator, uint32_t rightIndex) {
+      uint32_t newRoot = newNode();
+      Node &inner = nodes[newRoot];
+      inner.keys[0]     = separator;
+      inner.children[0] = root;
+      inner.children[1] = rightIndex;
+      inner.numKeys     = 1;
+      root = newRoot;
+      height++;
+    }
+
+    /// \brief (Internal) Check the subtree at nodeIndex (of the given
+    /// level) whose keys must lie in [lowKey, highKey), returning the
+    /// number of items found and following the chain of leaves.
+    size_t checkSubtree(uint32_t nodeIndex, size_t level,
+                        const KeyT *lowKey, const KeyT *highKey,
+                        uint32_t &lastLeaf) const {
+      if (nodes.nextIndex() <= nodeIndex)
+        throw AssertionFailure("node not allocated");
+      Node &aNode = nodes[nodeIndex];
+      if (nodeKeys < aNode.numKeys)
+        throw AssertionFailure("too many keys");
+      for (size_t i = 0; i < aNode.numKeys; i++) {
+        if (i && !compare(aNode.keys[i - 1], aNode.keys[i]))
+          throw AssertionFailure("keys out of order");
+        if (lowKey && compare(aNode.keys[i], *lowKey))
+          throw AssertionFailure("key below its subtree");
+        if (highKey && !compare(aNode.keys[i], *highKey))
+          throw AssertionFailure("key above its subtree");
+      }
+      if (!level) {
+        uint32_t expected = (lastLeaf == noNode) ?
+          firstLeaf : nodes[lastLeaf].nextLeaf;
+        if (expected != nodeIndex)
+          throw AssertionFailure("leaves incorrectly linked");
+        lastLeaf = nodeIndex;
+        return aNode.numKeys;
+      }
+      size_t numFound = 0;
+      for (size_t i = 0; i <= aNode.numKeys; i++) {
+        const KeyT *childLow  = i ? &aNode.keys[i - 1] : lowKey;
+        const KeyT *childHigh = (i < aNode.numKeys) ? &aNode.keys[i] : highKey;
+        numFound += checkSubtree(aNode.children[i], level - 1,
+                                 childLow, childHigh, lastLeaf);
+      }
+      return numFound;
+    }
+
+    /// \brief The nodes (leaves and inner nodes).
+    TypedIndexedAllocator<Node, NodeBitShift> nodes;
+
+    /// \brief The ordering of the keys.
+    CompareT compare;
+
+    /// \brief The index of the root node (or noNode).
+    uint32_t root;
+
+    /// \brief The index of the leaf holding the smallest keys (or
+    /// noNode).
+    uint32_t firstLeaf;
+
+    /// \brief The number of levels of nodes (zero if there is no root).
+    size_t height;
+
+    /// \brief The number of items in the tree.
+    size_t numItems;
+
+    /// \brief The number of leaves.
+    size_t numLeaves;
+
+  private:
+
+    /// \brief IndexedBTrees MUST NOT be copied (the nodes would be
+    /// freed twice).
+    IndexedBTree(const IndexedBTree &other);
+    void operator=(const IndexedBTree &other);
+};
+
+#endif
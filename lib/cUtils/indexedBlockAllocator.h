@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "cUtils/blockAllocator.h"
+#include "cUtils/workerPool.h"
 
 /// \brief The IndexedBlockAllocator class holds the information
 /// required to allocate multiple blocks of related (sub)structures
@@ -30,19 +31,23 @@ class IndexedBlockAllocator : public BlockAllocator {
     ///
     /// ABitSize determines the balance between block size and the
     /// number of blocks.
+    ///
+    /// The blocks are obtained from aBlockSource (see BlockAllocator).
     IndexedBlockAllocator(size_t anItemSize,
-                          size_t aBitShift = 5)
-                        : BlockAllocator( (1<<aBitShift)*anItemSize ){
+                          size_t aBitShift = 5,
+                          BlockSource *aBlockSource = NULL)
+                        : BlockAllocator( (1<<aBitShift)*anItemSize,
+                                          aBlockSource ){
       itemSize = anItemSize;
       bitShift = aBitShift;
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
     }
 
     /// \brief Allocate an indexed new (sub)structure.
     ///
     /// The indexes returns are contiquous.
     size_t allocateNewStructure(void) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       char * itemPtr =  BlockAllocator::allocateNewStructure(itemSize);
       size_t blockNum = blocks.getNumItems() - 1;
       return (blockNum << bitShift) + (itemPtr - blocks.getTop())/itemSize;
@@ -57,7 +62,7 @@ class IndexedBlockAllocator : public BlockAllocator {
     /// \brief Compute the char* pointer corresponding to this
     /// itemNumber.
     char *getItemPtr(size_t itemNum) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       size_t blockNum = itemNum >> bitShift;
       if (blocks.getNumItems() <= blockNum) return NULL;
       char *blockPtr = blocks.getItem(blockNum, NULL);
@@ -68,12 +73,113 @@ class IndexedBlockAllocator : public BlockAllocator {
       return itemPtr;
     }
 
+    /// \brief Return the number of items which have been allocated in
+    /// the block blockNum.
+    size_t getNumItemsInBlock(size_t blockNum) const {
+      size_t numBlocks = blocks.getNumItems();
+      if (numBlocks <= blockNum) return 0;
+      if (blockNum + 1 < numBlocks) return ((size_t)1)<<bitShift;
+      return (curAllocationByte - blocks.getTop())/itemSize;
+    }
+
+    /// \brief Visit each block of allocated items.
+    ///
+    /// The visitor is called as visitor(firstItemNum, blockPtr,
+    /// numItemsInBlock) where the items firstItemNum to
+    /// firstItemNum+numItemsInBlock-1 are contiguous in memory starting
+    /// at blockPtr.
+    template<class VisitorT>
+    void forEachBlock(VisitorT &visitor) {
+      ASSERT_INVARIANT(invariant());
+      size_t numBlocks = blocks.getNumItems();
+      for (size_t blockNum = 0; blockNum < numBlocks; blockNum++) {
+        visitor(blockNum << bitShift, blocks[blockNum],
+                getNumItemsInBlock(blockNum));
+      }
+    }
+
+    /// \brief Visit each allocated item (in index order).
+    ///
+    /// The visitor is called as visitor(itemNum, itemPtr). The block
+    /// lookup is made once per block rather than once per item.
+    template<class VisitorT>
+    void forEachItem(VisitorT &visitor) {
+      ItemVisitor<VisitorT> itemVisitor(visitor, itemSize);
+      forEachBlock(itemVisitor);
+    }
+
+    /// \brief Visit each block of allocated items, in parallel, using
+    /// the workers in aPool (or the default WorkerPool if aPool is
+    /// NULL).
+    ///
+    /// The visitor is called exactly as in forEachBlock, but blocks
+    /// are visited concurrently and in no particular order, so the
+    /// visitor MUST be thread safe and MUST NOT throw. No items may be
+    /// allocated while the blocks are being visited.
+    template<class VisitorT>
+    void parallelForEachBlock(VisitorT &visitor, WorkerPool *aPool = NULL) {
+      ASSERT_INVARIANT(invariant());
+      if (!aPool) aPool = WorkerPool::getDefault();
+      BlockTaskContext<VisitorT> context = { this, &visitor };
+      aPool->runTasks(blocks.getNumItems(),
+                      runBlockTask<VisitorT>, &context);
+    }
+
+    /// \brief Visit each allocated item, in parallel, handing whole
+    /// blocks to the workers in aPool (or the default WorkerPool if
+    /// aPool is NULL).
+    ///
+    /// The visitor is called exactly as in forEachItem, with the same
+    /// restrictions as parallelForEachBlock.
+    template<class VisitorT>
+    void parallelForEach(VisitorT &visitor, WorkerPool *aPool = NULL) {
+      ItemVisitor<VisitorT> itemVisitor(visitor, itemSize);
+      parallelForEachBlock(itemVisitor, aPool);
+    }
+
   protected:
 
+    /// \brief (Internal) Adapts an item visitor into a block visitor.
+    template<class VisitorT>
+    class ItemVisitor {
+      public:
+        ItemVisitor(VisitorT &aVisitor, size_t anItemSize)
+          : visitor(aVisitor), itemSize(anItemSize) { }
+
+        void operator()(size_t firstItemNum, char *blockPtr,
+                        size_t numItemsInBlock) {
+          char *itemPtr = blockPtr;
+          for (size_t i = 0; i < numItemsInBlock; i++, itemPtr += itemSize) {
+            visitor(firstItemNum + i, itemPtr);
+          }
+        }
+
+        VisitorT &visitor;
+        size_t    itemSize;
+    };
+
+    /// \brief (Internal) The context of a parallel visit of blocks.
+    template<class VisitorT>
+    struct BlockTaskContext {
+      IndexedBlockAllocator *allocator;
+      VisitorT              *visitor;
+    };
+
+    /// \brief (Internal) The WorkerPool task which visits one block.
+    template<class VisitorT>
+    static void runBlockTask(size_t blockNum, void *aContext) {
+      BlockTaskContext<VisitorT> *context =
+        (BlockTaskContext<VisitorT>*)aContext;
+      IndexedBlockAllocator *allocator = context->allocator;
+      (*context->visitor)(blockNum << allocator->bitShift,
+                          allocator->blocks[blockNum],
+                          allocator->getNumItemsInBlock(blockNum));
+    }
+
     /// \brief Override the BlockAllocator::allocateNewStructure to
     /// prevent its use.
     size_t allocateNewStructure(size_t structureSize) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       return 0;
     }
 
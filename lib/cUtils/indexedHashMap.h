@@ -0,0 +1,497 @@
+#ifndef INDEXED_HASH_MAP_H
+#define INDEXED_HASH_MAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "cUtils/hashing.h"
+#include "cUtils/memoryUsage.h"
+#include "cUtils/typedIndexedAllocator.h"
+#include "cUtils/varArray.h"
+
+/// \brief The IndexedHashMap template class holds the information
+/// required to map keys of type KeyT to values of type ValueT.
+///
+/// The map is an open addressing ("SwissTable" style) hash table:
+///
+/// - The key/value entries are stored, in the order they were
+///   inserted, in a TypedIndexedAllocator and are identified by stable
+///   32 bit entry indexes. Entries never move, so pointers to values
+///   remain valid until the entry is erased. Erased entries are reused
+///   by later insertions.
+///
+/// - The index table holds one control byte per slot (empty, deleted
+///   or the low 7 bits of the hash of a full slot) together with an
+///   array of slots holding the entry index and the high 32 bits of
+///   the hash.
+///
+/// A lookup compares a whole group of 16 control bytes at once (using
+/// SSE2 if it is available) and only visits the slots (and then the
+/// entries) whose 7 bit hashes match, so a typical lookup touches the
+/// control bytes, one slot and one entry. Rehashing moves only the
+/// index table, never the entries.
+///
+/// The entries are allocated from zeroed memory and are never
+/// constructed nor destroyed, so KeyT and ValueT should be plain old
+/// data types. TraitsT provides the (static) hash and equal functions
+/// of the keys (see HashTraits).
+template<class KeyT, class ValueT,
+         class TraitsT = HashTraits<KeyT>, size_t EntryBitShift = 8>
+class IndexedHashMap {
+
+  public:
+
+    /// \brief A key/value entry.
+    typedef struct Entry {
+      KeyT   key;
+      ValueT value;
+    } Entry;
+
+    /// \brief The entry index returned when there is no such entry.
+    static const uint32_t noEntry = 0xFFFFFFFF;
+
+    /// \brief The number of control bytes compared at once.
+    static const size_t groupWidth = 16;
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a IndexedHashMap class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (capacity & (capacity - 1))
+        throw AssertionFailure("capacity not a power of two");
+      if (capacity && (capacity < groupWidth))
+        throw AssertionFailure("capacity smaller than a group");
+      if ((numItems + numDeleted)*8 > capacity*7)
+        throw AssertionFailure("index table too full");
+      if (numItems + freeEntries.getNumItems() != entries.nextIndex())
+        throw AssertionFailure("incorrect number of entries");
+      return entries.invariant();
+    }
+
+    /// \brief Create an (empty) IndexedHashMap.
+    ///
+    /// The blocks of entries are obtained from aBlockSource (see
+    /// BlockAllocator).
+    IndexedHashMap(BlockSource *aBlockSource = NULL)
+      : entries(aBlockSource) {
+      ctrl       = NULL;
+      slots      = NULL;
+      capacity   = 0;
+      numItems   = 0;
+      numDeleted = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy the IndexedHashMap and all of its entries.
+    ~IndexedHashMap(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      if (ctrl)  free(ctrl);
+      if (slots) free(slots);
+      ctrl     = NULL;
+      slots    = NULL;
+      capacity = 0;
+      numItems = 0;
+    }
+
+    /// \brief Return the number of items (keys) in the map.
+    size_t getNumItems(void) const {
+      return numItems;
+    }
+
+    /// \brief Return the number of slots in the index table.
+    size_t getCapacity(void) const {
+      return capacity;
+    }
+
+    /// \brief Return the index of the entry with this key (or noEntry).
+    uint32_t findEntry(const KeyT &aKey) const {
+      KeyMatcher matcher(aKey);
+      return findEntryUsing(TraitsT::hash(aKey), matcher);
+    }
+
+    /// \brief Return a pointer to the value of this key (or NULL if the
+    /// key is not in the map).
+    ValueT *find(const KeyT &aKey) const {
+      uint32_t entryIndex = findEntry(aKey);
+      if (entryIndex == noEntry) return NULL;
+      return &entries[entryIndex].value;
+    }
+
+    /// \brief Return true if this key is in the map.
+    bool contains(const KeyT &aKey) const {
+      return findEntry(aKey) != noEntry;
+    }
+
+    /// \brief Return the index of the entry with this key, inserting a
+    /// new entry (with a zeroed value) if the key is not in the map.
+    ///
+    /// Sets wasInserted to true if a new entry was inserted.
+    uint32_t findOrInsertEntry(const KeyT &aKey, bool &wasInserted) {
+      KeyMatcher matcher(aKey);
+      uint32_t entryIndex =
+        findOrInsertEntryUsing(TraitsT::hash(aKey), matcher, wasInserted);
+      if (wasInserted) entries[entryIndex].key = aKey;
+      return entryIndex;
+    }
+
+    /// \brief Set the value of this key (inserting the key if it is not
+    /// already in the map).
+    ///
+    /// Returns true if the key was inserted.
+    bool insert(const KeyT &aKey, const ValueT &aValue) {
+      bool wasInserted = false;
+      uint32_t entryIndex = findOrInsertEntry(aKey, wasInserted);
+      entries[entryIndex].value = aValue;
+      return wasInserted;
+    }
+
+    /// \brief Remove this key (and its value) from the map.
+    ///
+    /// Returns true if the key was in the map.
+    bool erase(const KeyT &aKey) {
+      ASSERT_INVARIANT(invariant());
+      KeyMatcher matcher(aKey);
+      size_t slotNum = findSlotUsing(TraitsT::hash(aKey), matcher);
+      if (slotNum == noSlot) return false;
+      freeEntries.pushItem(slots[slotNum].entryIndex);
+      setCtrl(ctrl, capacity, slotNum, ctrlDeleted);
+      numDeleted++;
+      numItems--;
+      ASSERT_INVARIANT(invariant());
+      return true;
+    }
+
+    /// \brief Get a reference to the entry at this entryIndex WITHOUT
+    /// any range checking (outside of DEBUG builds).
+    Entry &getEntry(uint32_t entryIndex) const {
+      return entries[entryIndex];
+    }
+
+    /// \brief Ensure that the index table can hold someItems items
+    /// without being rehashed.
+    void reserve(size_t someItems) {
+      ASSERT_INVARIANT(invariant());
+      size_t newCapacity = (capacity ? capacity : groupWidth);
+      while (newCapacity*7 < someItems*8) newCapacity *= 2;
+      if (capacity < newCapacity) rehash(newCapacity);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Remove all of the items from the map (keeping the
+    /// capacity of the index table).
+    void clearItems(void) {
+      entries.clearBlocks();
+      freeEntries.clearItems();
+      if (ctrl) memset(ctrl, ctrlEmpty, capacity + groupWidth);
+      numItems   = 0;
+      numDeleted = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Visit each item (in no particular order).
+    ///
+    /// The visitor is called as visitor(key, value). Items MUST NOT be
+    /// inserted or erased while the map is being visited.
+    template<class VisitorT>
+    void forEachItem(VisitorT &visitor) const {
+      ASSERT_INVARIANT(invariant());
+      for (size_t slotNum = 0; slotNum < capacity; slotNum++) {
+        if (ctrl[slotNum] < 0) continue;
+        Entry &entry = entries[slots[slotNum].entryIndex];
+        visitor(entry.key, entry.value);
+      }
+    }
+
+    /// \brief Return the index of the entry with this hash for which
+    /// matcher(entry) is true (or noEntry).
+    ///
+    /// This allows the map to be searched using something other than a
+    /// KeyT (for example a string which has not yet been interned). The
+    /// hash MUST be the one TraitsT would compute for the matching key.
+    template<class MatcherT>
+    uint32_t findEntryUsing(uint64_t aHash, const MatcherT &matcher) const {
+      size_t slotNum = findSlotUsing(aHash, matcher);
+      if (slotNum == noSlot) return noEntry;
+      return slots[slotNum].entryIndex;
+    }
+
+    /// \brief Return the index of the entry with this hash for which
+    /// matcher(entry) is true, inserting a new (zeroed) entry if there
+    /// is no such entry.
+    ///
+    /// Sets wasInserted to true if a new entry was inserted, in which
+    /// case the caller MUST set the entry's key (to a key with this
+    /// hash).
+    template<class MatcherT>
+    uint32_t findOrInsertEntryUsing(uint64_t aHash, const MatcherT &matcher,
+                                    bool &wasInserted) {
+      ASSERT_INVARIANT(invariant());
+      size_t slotNum = findSlotUsing(aHash, matcher);
+      if (slotNum != noSlot) {
+        wasInserted = false;
+        return slots[slotNum].entryIndex;
+      }
+      growIfNeeded();
+      uint32_t hashHigh = (uint32_t)(aHash >> 32);
+      slotNum = findFirstNonFull(ctrl, capacity - 1, hashHigh);
+      if (ctrl[slotNum] == ctrlDeleted) numDeleted--;
+      setCtrl(ctrl, capacity, slotNum, (int8_t)(aHash & 0x7F));
+      slots[slotNum].entryIndex = newEntry();
+      slots[slotNum].hashHigh   = hashHigh;
+      numItems++;
+      wasInserted = true;
+      ASSERT_INVARIANT(invariant());
+      return slots[slotNum].entryIndex;
+    }
+
+    /// \brief Report the memory used by this map.
+    ///
+    /// The entries of the items are used bytes, while the index table,
+    /// the table of entry blocks and the list of free entries are
+    /// overhead.
+    MemoryUsage memoryUsage(void) const {
+      MemoryUsage entryUsage = entries.memoryUsage();
+      MemoryUsage freeUsage  = freeEntries.memoryUsage();
+      size_t tableBytes = 0;
+      if (capacity) tableBytes = capacity + groupWidth + capacity*sizeof(Slot);
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(IndexedHashMap);
+      usage.numAllocations = entryUsage.numAllocations +
+        freeUsage.numAllocations + (capacity ? 2 : 0);
+      usage.bytesReserved  = entryUsage.bytesReserved +
+        freeUsage.bytesReserved + tableBytes;
+      usage.bytesUsed      = numItems*sizeof(Entry);
+      usage.bytesOverhead  = entryUsage.bytesOverhead +
+        freeUsage.bytesReserved + tableBytes;
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief The control byte of an empty slot.
+    static const int8_t ctrlEmpty   = -128;
+
+    /// \brief The control byte of a slot whose item has been erased.
+    static const int8_t ctrlDeleted = -2;
+
+    /// \brief The slot number returned when there is no such slot.
+    static const size_t noSlot = ~((size_t)0);
+
+    /// \brief A slot of the index table.
+    typedef struct Slot {
+      uint32_t entryIndex;
+      uint32_t hashHigh;
+    } Slot;
+
+    /// \brief (Internal) Matches the entry with a given key.
+    class KeyMatcher {
+      public:
+        KeyMatcher(const KeyT &aKey) : key(aKey) { }
+
+        bool operator()(const Entry &anEntry) const {
+          return TraitsT::equal(anEntry.key, key);
+        }
+
+        const KeyT &key;
+    };
+
+#ifdef __SSE2__
+    /// \brief Return the bit mask of the control bytes in the group at
+    /// groupPtr which are equal to aCtrl.
+    static uint32_t matchGroup(const int8_t *groupPtr, int8_t aCtrl) {
+      __m128i group = _mm_loadu_si128((const __m128i*)groupPtr);
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(aCtrl), group));
+    }
+
+    /// \brief Return the bit mask of the control bytes in the group at
+    /// groupPtr which are empty or deleted.
+    static uint32_t matchGroupNonFull(const int8_t *groupPtr) {
+      __m128i group = _mm_loadu_si128((const __m128i*)groupPtr);
+      return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), group));
+    }
+#else
+    /// \brief (Internal) Load eight control bytes as a word (with the
+    /// first byte in the low bits).
+    static uint64_t loadCtrlWord(const int8_t *ctrlPtr) {
+      uint64_t word;
+      memcpy(&word, ctrlPtr, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      return word;
+    }
+
+    /// \brief (Internal) Pack the high bit of each of the eight bytes
+    /// of aWord into the low eight bits.
+    static uint32_t packHighBits(uint64_t aWord) {
+      return (uint32_t)((((aWord >> 7) & 0x0101010101010101ULL) *
+                         0x0102040810204080ULL) >> 56);
+    }
+
+    /// \brief Return the bit mask of the control bytes in the group at
+    /// groupPtr which are equal to aCtrl.
+    ///
+    /// The bytes are compared eight at a time, which may report false
+    /// matches for full slots (but never for empty or deleted slots),
+    /// which is harmless since every match is checked against the high
+    /// bits of the hash and the key.
+    static uint32_t matchGroup(const int8_t *groupPtr, int8_t aCtrl) {
+      if (aCtrl == ctrlEmpty) {
+        uint64_t lowWord  = loadCtrlWord(groupPtr);
+        uint64_t highWord = loadCtrlWord(groupPtr + 8);
+        lowWord  &= ~(lowWord  << 6);
+        highWord &= ~(highWord << 6);
+        return packHighBits(lowWord) | (packHighBits(highWord) << 8);
+      }
+      uint64_t pattern = 0x0101010101010101ULL * (uint8_t)aCtrl;
+      uint64_t lowWord  = loadCtrlWord(groupPtr)     ^ pattern;
+      uint64_t highWord = loadCtrlWord(groupPtr + 8) ^ pattern;
+      lowWord  = (lowWord  - 0x0101010101010101ULL) & ~lowWord;
+      highWord = (highWord - 0x0101010101010101ULL) & ~highWord;
+      return packHighBits(lowWord) | (packHighBits(highWord) << 8);
+    }
+
+    /// \brief Return the bit mask of the control bytes in the group at
+    /// groupPtr which are empty or deleted.
+    static uint32_t matchGroupNonFull(const int8_t *groupPtr) {
+      return packHighBits(loadCtrlWord(groupPtr)) |
+        (packHighBits(loadCtrlWord(groupPtr + 8)) << 8);
+    }
+#endif
+
+    /// \brief Set the control byte of slotNum, together with its copy
+    /// (for the first group) after the end of the control bytes.
+    ///
+    /// The copies allow a group to be loaded starting at any slot.
+    static void setCtrl(int8_t *someCtrl, size_t aCapacity,
+                        size_t slotNum, int8_t aCtrl) {
+      someCtrl[slotNum] = aCtrl;
+      if (slotNum < groupWidth) someCtrl[aCapacity + slotNum] = aCtrl;
+    }
+
+    /// \brief Return the first empty or deleted slot on the probe
+    /// sequence of hashHigh.
+    static size_t findFirstNonFull(const int8_t *someCtrl, size_t aMask,
+                                   uint32_t hashHigh) {
+      size_t groupStart = hashHigh & aMask;
+      for (size_t stride = groupWidth; ; stride += groupWidth) {
+        uint32_t nonFull = matchGroupNonFull(someCtrl + groupStart);
+        if (nonFull) return (groupStart + __builtin_ctz(nonFull)) & aMask;
+        groupStart = (groupStart + stride) & aMask;
+      }
+    }
+
+    /// \brief Return the slot of the entry with this hash for which
+    /// matcher(entry) is true (or noSlot).
+    ///
+    /// The groups are probed triangularly, which visits every group of
+    /// a power of two sized table, and the probe stops at the first
+    /// group containing an empty slot.
+    template<class MatcherT>
+    size_t findSlotUsing(uint64_t aHash, const MatcherT &matcher) const {
+      if (!capacity) return noSlot;
+      int8_t   hashLow  = (int8_t)(aHash & 0x7F);
+      uint32_t hashHigh = (uint32_t)(aHash >> 32);
+      size_t   mask     = capacity - 1;
+      size_t groupStart = hashHigh & mask;
+      for (size_t stride = groupWidth; ; stride += groupWidth) {
+        const int8_t *groupPtr = ctrl + groupStart;
+        for (uint32_t matches = matchGroup(groupPtr, hashLow);
+             matches ; matches &= matches - 1) {
+          size_t slotNum = (groupStart + __builtin_ctz(matches)) & mask;
+          if ((slots[slotNum].hashHigh == hashHigh) &&
+              matcher(entries[slots[slotNum].entryIndex])) return slotNum;
+        }
+        if (matchGroup(groupPtr, ctrlEmpty)) return noSlot;
+        groupStart = (groupStart + stride) & mask;
+      }
+    }
+
+    /// \brief Allocate a (zeroed) entry, reusing an erased entry if
+    /// there is one.
+    uint32_t newEntry(void) {
+      if (freeEntries.getNumItems()) {
+        uint32_t entryIndex = freeEntries.popItem();
+        memset(&entries[entryIndex], 0, sizeof(Entry));
+        return entryIndex;
+      }
+      size_t entryIndex = entries.allocateNewStructure();
+      ASSERT_MESSAGE(entryIndex < noEntry, "too many IndexedHashMap entries");
+      return (uint32_t)entryIndex;
+    }
+
+    /// \brief Rehash (or resize) the index table if inserting one more
+    /// item would make it too full.
+    ///
+    /// The table is kept at most 7/8 full. If the items alone would
+    /// fill at most 25/32 of the table (so the table is full because of
+    /// the deleted slots) it is rehashed at the same capacity, otherwise
+    /// the capacity is doubled.
+    void growIfNeeded(void) {
+      if (!capacity) {
+        rehash(groupWidth);
+        return;
+      }
+      if ((numItems + numDeleted + 1)*8 <= capacity*7) return;
+      if ((numItems + 1)*32 <= capacity*25) rehash(capacity);
+      else                                  rehash(capacity*2);
+    }
+
+    /// \brief Move all of the full slots into a new index table with
+    /// newCapacity slots (dropping the deleted slots).
+    ///
+    /// The control bytes hold the low 7 bits of each hash and the slots
+    /// hold the high 32 bits, so no keys (or entries) are touched.
+    void rehash(size_t newCapacity) {
+      ASSERT((numItems*8) <= (newCapacity*7));
+      int8_t *newCtrl  = (int8_t*)malloc(newCapacity + groupWidth);
+      Slot   *newSlots = (Slot*)malloc(newCapacity*sizeof(Slot));
+      ASSERT(newCtrl && newSlots);
+      memset(newCtrl, ctrlEmpty, newCapacity + groupWidth);
+      for (size_t slotNum = 0; slotNum < capacity; slotNum++) {
+        if (ctrl[slotNum] < 0) continue;
+        size_t newSlotNum =
+          findFirstNonFull(newCtrl, newCapacity - 1, slots[slotNum].hashHigh);
+        setCtrl(newCtrl, newCapacity, newSlotNum, ctrl[slotNum]);
+        newSlots[newSlotNum] = slots[slotNum];
+      }
+      if (ctrl)  free(ctrl);
+      if (slots) free(slots);
+      ctrl       = newCtrl;
+      slots      = newSlots;
+      capacity   = newCapacity;
+      numDeleted = 0;
+    }
+
+    /// \brief The key/value entries.
+    TypedIndexedAllocator<Entry, EntryBitShift> entries;
+
+    /// \brief The indexes of the erased entries (available for reuse).
+    VarArray<uint32_t> freeEntries;
+
+    /// \brief The control bytes of the index table (followed by a copy
+    /// of the first group of control bytes).
+    int8_t *ctrl;
+
+    /// \brief The slots of the index table.
+    Slot *slots;
+
+    /// \brief The (power of two) number of slots in the index table.
+    size_t capacity;
+
+    /// \brief The number of items in the map.
+    size_t numItems;
+
+    /// \brief The number of deleted slots in the index table.
+    size_t numDeleted;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef INDEXED_OBJECT_POOL_H
+#define INDEXED_OBJECT_POOL_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cUtils/indexedBlockAllocator.h"
+
+/// \brief The IndexedObjectPool class extends the IndexedBlockAllocator
+/// so that indexed items can be released and then re-used.
+///
+/// Released items are kept on a free list which is threaded through
+/// the released items themselves, so the free list requires no extra
+/// memory. For this reason each item is at least sizeof(size_t) bytes.
+///
+/// If the C/C++ macro DEBUG has been defined, then each index also has
+/// a generation counter which is incremented every time the item is
+/// allocated or released. An even generation denotes a live item, an
+/// odd generation denotes a released item. This allows the use of
+/// stale indexes to be caught.
+class IndexedObjectPool : public IndexedBlockAllocator {
+
+  public:
+
+    /// \brief The index used to denote the end of the free list.
+    static const size_t noIndex = ~((size_t)0);
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a IndexedObjectPool class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (itemSize < sizeof(size_t))
+        throw AssertionFailure("item size too small for free list");
+      if (numLiveItems + numFreeItems != numAllocatedItems)
+        throw AssertionFailure("incorrect live and free item counts");
+      if ((freeList == noIndex) != (numFreeItems == 0))
+        throw AssertionFailure("free list does not match free item count");
+      return IndexedBlockAllocator::invariant();
+    }
+
+    /// \brief Create a new indexed object pool which allocates items of
+    /// (at least) a given anItemSize.
+    ///
+    /// ABitShift determines the balance between block size and the
+    /// number of blocks.
+    ///
+    /// The blocks are obtained from aBlockSource (see BlockAllocator).
+    IndexedObjectPool(size_t anItemSize,
+                      size_t aBitShift = 5,
+                      BlockSource *aBlockSource = NULL)
+                    : IndexedBlockAllocator(
+                        (anItemSize < sizeof(size_t) ?
+                           sizeof(size_t) : anItemSize),
+                        aBitShift, aBlockSource) {
+      freeList          = noIndex;
+      numLiveItems      = 0;
+      numFreeItems      = 0;
+      numAllocatedItems = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Clear (free) all of the blocks together with the free
+    /// list.
+    void clearBlocks(void) {
+      IndexedBlockAllocator::clearBlocks();
+      freeList          = noIndex;
+      numLiveItems      = 0;
+      numFreeItems      = 0;
+      numAllocatedItems = 0;
+#ifdef DEBUG
+      generations.clearItems();
+#endif
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Allocate an item, re-using a previously released item if
+    /// one is available.
+    ///
+    /// The contents of a re-used item are NOT cleared.
+    size_t allocate(void) {
+      ASSERT_INVARIANT(invariant());
+      size_t itemNum = freeList;
+      if (itemNum != noIndex) {
+        // items need not be aligned for a size_t, so we use memcpy
+        memcpy(&freeList, IndexedBlockAllocator::getItemPtr(itemNum),
+               sizeof(size_t));
+        numFreeItems--;
+#ifdef DEBUG
+        size_t generation = generations.getItem(itemNum, 0);
+        ASSERT(generation & 0x1); // the item MUST have been released
+        generations.setItem(itemNum, generation+1);
+#endif
+      } else {
+        itemNum = IndexedBlockAllocator::allocateNewStructure();
+        numAllocatedItems++;
+#ifdef DEBUG
+        ASSERT(itemNum == generations.getNumItems());
+        generations.pushItem(0);
+#endif
+      }
+      numLiveItems++;
+      ASSERT_INVARIANT(invariant());
+      return itemNum;
+    }
+
+    /// \brief Release the item at itemNum back onto the free list.
+    ///
+    /// The first sizeof(size_t) bytes of the item are overwritten.
+    void release(size_t itemNum) {
+      ASSERT_INVARIANT(invariant());
+      char *itemPtr = IndexedBlockAllocator::getItemPtr(itemNum);
+      ASSERT_MESSAGE(itemPtr, "released an index which was never allocated");
+      if (!itemPtr) return;
+#ifdef DEBUG
+      size_t generation = generations.getItem(itemNum, 0);
+      ASSERT_MESSAGE(!(generation & 0x1), "released an item twice");
+      generations.setItem(itemNum, generation+1);
+#endif
+      memcpy(itemPtr, &freeList, sizeof(size_t));
+      freeList = itemNum;
+      numLiveItems--;
+      numFreeItems++;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Compute the char* pointer corresponding to this
+    /// (live) itemNumber.
+    ///
+    /// Returns NULL if the itemNum has never been allocated.
+    char *getItemPtr(size_t itemNum) {
+#ifdef DEBUG
+      ASSERT_MESSAGE(!(generations.getItem(itemNum, 0) & 0x1),
+        "used the index of a released item");
+#endif
+      return IndexedBlockAllocator::getItemPtr(itemNum);
+    }
+
+    /// \brief Compute the char* pointer corresponding to this
+    /// itemNumber, checking that the item has not been released (or
+    /// re-used) since the generation provided was obtained.
+    char *getItemPtr(size_t itemNum, size_t aGeneration) {
+#ifdef DEBUG
+      ASSERT_MESSAGE(generations.getItem(itemNum, 0) == aGeneration,
+        "used a stale index");
+#else
+      (void)aGeneration;
+#endif
+      return getItemPtr(itemNum);
+    }
+
+    /// \brief Return the current generation of the item at itemNum.
+    ///
+    /// Generations are only tracked if DEBUG is defined, otherwise
+    /// this is always zero.
+    size_t getGeneration(size_t itemNum) const {
+#ifdef DEBUG
+      return generations.getItem(itemNum, 0);
+#else
+      (void)itemNum;
+      return 0;
+#endif
+    }
+
+    /// \brief Return the number of items which are currently allocated
+    /// and have not been released.
+    size_t getNumLiveItems(void) const {
+      return numLiveItems;
+    }
+
+    /// \brief Return the number of released items currently on the
+    /// free list.
+    size_t getNumFreeItems(void) const {
+      return numFreeItems;
+    }
+
+  protected:
+
+    /// \brief Override the IndexedBlockAllocator::allocateNewStructure
+    /// to prevent its use (which would bypass the free list).
+    size_t allocateNewStructure(void) {
+      return allocate();
+    }
+
+    /// \brief The index of the most recently released item (or noIndex
+    /// if there are no released items).
+    size_t freeList;
+
+    /// \brief The number of allocated items which have not been
+    /// released.
+    size_t numLiveItems;
+
+    /// \brief The number of released items on the free list.
+    size_t numFreeItems;
+
+    /// \brief The total number of items ever taken from the underlying
+    /// IndexedBlockAllocator.
+    size_t numAllocatedItems;
+
+#ifdef DEBUG
+    /// \brief The generation counter of each allocated index.
+    VarArray<size_t> generations;
+#endif
+};
+
+#endif
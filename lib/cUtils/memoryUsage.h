@@ -0,0 +1,89 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// This header file provides the description of the memory footprint of
+// the cUtils containers (see the memoryUsage method of the VarArray,
+// BitSet and BlockAllocator classes).
+//
+// Unlike the AllocatorStats, the memory usage is always available,
+// since it is computed from the current state of a container when it
+// is requested.
+
+/// \brief The MemoryUsage structure holds a snapshot of the memory
+/// used by a container.
+///
+/// The heap bytes reserved by a container are split into the bytes
+/// used to hold its items, the bytes used for its own bookkeeping
+/// (segment headers, block tables, ...) and the bytes wasted (spare
+/// capacity or the unused tails of blocks).
+typedef struct MemoryUsage {
+  /// \brief The size of the container object itself.
+  size_t objectBytes;
+
+  /// \brief The number of (separate) heap allocations (arrays,
+  /// segments or blocks).
+  size_t numAllocations;
+
+  /// \brief The number of heap bytes reserved.
+  size_t bytesReserved;
+
+  /// \brief The number of heap bytes which hold items.
+  size_t bytesUsed;
+
+  /// \brief The number of heap bytes used for bookkeeping.
+  size_t bytesOverhead;
+
+  /// \brief The number of heap bytes which are neither used nor
+  /// overhead.
+  size_t bytesWasted;
+
+  /// \brief The fraction of the reserved heap bytes which hold items
+  /// (1.0 if no bytes have been reserved).
+  double fillRatio;
+} MemoryUsage;
+
+/// \brief (Internal) Compute the bytesWasted and fillRatio from the
+/// other fields of someUsage.
+inline void finishMemoryUsage(MemoryUsage &someUsage) {
+  someUsage.bytesWasted = 0;
+  if (someUsage.bytesUsed + someUsage.bytesOverhead < someUsage.bytesReserved)
+    someUsage.bytesWasted = someUsage.bytesReserved -
+      (someUsage.bytesUsed + someUsage.bytesOverhead);
+  someUsage.fillRatio = 1.0;
+  if (someUsage.bytesReserved)
+    someUsage.fillRatio =
+      ((double)someUsage.bytesUsed) / someUsage.bytesReserved;
+}
+
+/// \brief Add someUsage into the totalUsage (for example to report the
+/// memory used by a collection of containers).
+inline void addMemoryUsage(MemoryUsage &totalUsage,
+                           const MemoryUsage &someUsage) {
+  totalUsage.objectBytes    += someUsage.objectBytes;
+  totalUsage.numAllocations += someUsage.numAllocations;
+  totalUsage.bytesReserved  += someUsage.bytesReserved;
+  totalUsage.bytesUsed      += someUsage.bytesUsed;
+  totalUsage.bytesOverhead  += someUsage.bytesOverhead;
+  finishMemoryUsage(totalUsage);
+}
+
+/// \brief Dump a (human readable) snapshot of the memory used by the
+/// container with the name provided.
+inline void dumpMemoryUsage(FILE *logFile,
+                            const char *containerName,
+                            const MemoryUsage &someUsage) {
+  fprintf(logFile, "MemoryUsage: %s\n", containerName);
+  fprintf(logFile, "     objectBytes = %zu\n", someUsage.objectBytes);
+  fprintf(logFile, "  numAllocations = %zu\n", someUsage.numAllocations);
+  fprintf(logFile, "   bytesReserved = %zu\n", someUsage.bytesReserved);
+  fprintf(logFile, "       bytesUsed = %zu\n", someUsage.bytesUsed);
+  fprintf(logFile, "   bytesOverhead = %zu\n", someUsage.bytesOverhead);
+  fprintf(logFile, "     bytesWasted = %zu\n", someUsage.bytesWasted);
+  fprintf(logFile, "       fillRatio = %f\n", someUsage.fillRatio);
+}
+
+#endif
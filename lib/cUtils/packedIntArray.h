@@ -0,0 +1,362 @@
+#ifndef PACKED_INT_ARRAY_H
+#define PACKED_INT_ARRAY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "cUtils/assertions.h"
+#include "cUtils/memoryUsage.h"
+
+#ifndef PackedIntArrayMinCapacity
+#define PackedIntArrayMinCapacity 64
+#endif
+
+/// \brief The PackedIntArray class holds the information required to
+/// manage a variable array of unsigned integers, each stored in only
+/// bitWidth bits.
+///
+/// The items are packed end to end into an array of 64 bit words (an
+/// item may straddle two words), so an array of 10 to 20 bit values
+/// (indexes into an IndexedBlockAllocator, enum tags, ...) uses a third
+/// to a sixth of the memory of a VarArray<size_t>.
+///
+/// The bit width is chosen at runtime. Whenever an item too large for
+/// the current bit width is pushed (or set), the whole array is
+/// widened (repacked) to the width of the new item.
+///
+/// Getting (or setting) an item reads (or writes) at most two words
+/// without branching on the position of the item. When BMI2 is
+/// available, the items are extracted using BZHI. The getItems method unpacks a run of items into a buffer
+/// without the per item work of locating the item's words (items of
+/// at most 56 bits are extracted from independent unaligned eight
+/// byte loads, wider items by streaming through the words).
+class PackedIntArray {
+  public:
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a PackedIntArray class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if ((bitWidth < 1) || (64 < bitWidth))
+        throw AssertionFailure("bit width out of range");
+      if (capacity < numItems)
+        throw AssertionFailure("too many items");
+      if (!words && capacity)
+        throw AssertionFailure("no words");
+      return true;
+    }
+
+    /// \brief Create an (empty) PackedIntArray whose items are (at
+    /// first) aBitWidth bits wide.
+    PackedIntArray(size_t aBitWidth = 1) {
+      ASSERT_CHEAP((0 < aBitWidth) && (aBitWidth <= 64));
+      bitWidth = aBitWidth;
+      numItems = 0;
+      capacity = 0;
+      words    = NULL;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy a PackedIntArray.
+    ~PackedIntArray(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      if (words) free(words);
+      words    = NULL;
+      numItems = 0;
+      capacity = 0;
+    }
+
+    /// \brief Return the current number of items in the array.
+    size_t getNumItems(void) const {
+      return numItems;
+    }
+
+    /// \brief Return the number of items the array can hold (at the
+    /// current bit width) before it must grow.
+    size_t getCapacity(void) const {
+      return capacity;
+    }
+
+    /// \brief Return the number of bits used to store each item.
+    size_t getBitWidth(void) const {
+      return bitWidth;
+    }
+
+    /// \brief Return the number of bits needed to store anItem.
+    static size_t bitsNeeded(uint64_t anItem) {
+      return anItem ? (64 - __builtin_clzll(anItem)) : 1;
+    }
+
+    /// \brief Ensure that the array can hold someItems items (at the
+    /// current bit width) without growing.
+    void reserve(size_t someItems) {
+      ASSERT_INVARIANT(invariant());
+      if (capacity < someItems) repack(someItems, bitWidth);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Widen each item to newBitWidth bits (which has no effect
+    /// if the items are already at least that wide).
+    void widen(size_t newBitWidth) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(newBitWidth <= 64);
+      if (bitWidth < newBitWidth) repack(capacity, newBitWidth);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Push a new item onto the "top" of the array (widening the
+    /// array if the item is too large).
+    void pushItem(uint64_t anItem) {
+      ASSERT_INVARIANT(invariant());
+      if (CUTILS_UNLIKELY(getMask(bitWidth) < anItem)) {
+        widen(bitsNeeded(anItem));
+      }
+      if (capacity <= numItems) {
+        size_t newCapacity = 2*capacity;
+        if (newCapacity < PackedIntArrayMinCapacity) {
+          newCapacity = PackedIntArrayMinCapacity;
+        }
+        repack(newCapacity, bitWidth);
+      }
+      storeItem(numItems, anItem);
+      numItems++;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Get the requested item.
+    ///
+    /// Returns the default provided if the itemNumber is out of range.
+    uint64_t getItem(size_t itemNumber, uint64_t defaultItem) const {
+      ASSERT_INVARIANT(invariant());
+      if (numItems <= itemNumber) return defaultItem;
+      return loadItem(itemNumber);
+    }
+
+    /// \brief Get the requested item WITHOUT any range checking
+    /// (outside of DEBUG builds).
+    uint64_t operator[](size_t itemNumber) const {
+      ASSERT(itemNumber < numItems);
+      return loadItem(itemNumber);
+    }
+
+    /// \brief Set the requested item to the value provided (widening
+    /// the array if the value is too large).
+    void setItem(size_t itemNumber, uint64_t anItem) {
+      ASSERT_INVARIANT(invariant());
+      if (numItems <= itemNumber) return;
+      if (CUTILS_UNLIKELY(getMask(bitWidth) < anItem)) {
+        widen(bitsNeeded(anItem));
+      }
+      storeItem(itemNumber, anItem);
+    }
+
+    /// \brief Get the top item
+    uint64_t getTop(void) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems);
+      return loadItem(numItems - 1);
+    }
+
+    /// \brief Remove and return the "top" item on the array.
+    uint64_t popItem(void) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems); // incorrectly matched push/pops
+      numItems--;
+      return loadItem(numItems);
+    }
+
+    /// \brief Unpack (at most) someItems items, starting at
+    /// firstItemNumber, into the buffer provided.
+    ///
+    /// Returns the number of items unpacked.
+    template<class IntT>
+    size_t getItems(size_t firstItemNumber, size_t someItems,
+                    IntT *buffer) const {
+      ASSERT_INVARIANT(invariant());
+      if (numItems <= firstItemNumber) return 0;
+      if (numItems - firstItemNumber < someItems) {
+        someItems = numItems - firstItemNumber;
+      }
+      if (!someItems) return 0;
+      // whole (little endian) bytes are simply widened (which the
+      // compiler vectorizes)
+      if ((bitWidth == 8) || (bitWidth == 16) || (bitWidth == 32)) {
+        const unsigned char *bytes =
+          ((const unsigned char*)words) + firstItemNumber*(bitWidth/8);
+        if (bitWidth == 8) {
+          for (size_t i = 0; i < someItems; i++) buffer[i] = bytes[i];
+        } else if (bitWidth == 16) {
+          const uint16_t *halves = (const uint16_t*)bytes;
+          for (size_t i = 0; i < someItems; i++) buffer[i] = halves[i];
+        } else {
+          const uint32_t *quarters = (const uint32_t*)bytes;
+          for (size_t i = 0; i < someItems; i++) buffer[i] = quarters[i];
+        }
+        return someItems;
+      }
+      uint64_t mask   = getMask(bitWidth);
+      size_t   bitNum = firstItemNumber*bitWidth;
+      if (bitWidth <= 56) {
+        // each item lies within the (unaligned) eight bytes starting at
+        // its first byte, so the items are independent loads and shifts
+        const unsigned char *bytes = (const unsigned char*)words;
+        for (size_t i = 0; i < someItems; i++, bitNum += bitWidth) {
+          uint64_t bits;
+          memcpy(&bits, bytes + (bitNum >> 3), 8);
+          buffer[i] = (IntT)((bits >> (bitNum & 7)) & mask);
+        }
+        return someItems;
+      }
+      // otherwise stream through the words, keeping the numBits
+      // unconsumed bits of the current word in bits
+      const uint64_t *wordPtr = words + (bitNum >> 6);
+      uint64_t bits    = (*wordPtr++) >> (bitNum & 63);
+      size_t   numBits = 64 - (bitNum & 63);
+      for (size_t i = 0; i < someItems; i++) {
+        if (bitWidth <= numBits) {
+          buffer[i] = (IntT)(bits & mask);
+          bits      = (bitWidth < 64) ? (bits >> bitWidth) : 0;
+          numBits  -= bitWidth;
+        } else {
+          uint64_t nextWord = *wordPtr++;
+          size_t   bitsUsed = bitWidth - numBits;
+          buffer[i] = (IntT)((bits | (nextWord << numBits)) & mask);
+          bits      = (bitsUsed < 64) ? (nextWord >> bitsUsed) : 0;
+          numBits   = 64 - bitsUsed;
+        }
+      }
+      return someItems;
+    }
+
+    /// \brief Remove all items from this array (keeping its bit width).
+    void clearItems(void) {
+      numItems = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this array.
+    ///
+    /// Only the bits of the items (rounded up to whole bytes) are used
+    /// bytes.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(PackedIntArray);
+      usage.numAllocations = (words ? 1 : 0);
+      usage.bytesReserved  = (words ? getNumWords(capacity, bitWidth)*8 : 0);
+      usage.bytesUsed      = (numItems*bitWidth + 7)/8;
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief (Internal) Return the mask of the bits of an item
+    /// aBitWidth bits wide.
+    static uint64_t getMask(size_t aBitWidth) {
+      return (~0ULL) >> (64 - aBitWidth);
+    }
+
+    /// \brief (Internal) Return the number of words needed to hold
+    /// someItems items of aBitWidth bits (including the spare word
+    /// which allows every item to be read as two words).
+    static size_t getNumWords(size_t someItems, size_t aBitWidth) {
+      return (someItems*aBitWidth + 63)/64 + 1;
+    }
+
+    /// \brief (Internal) Load the item at itemNumber.
+    uint64_t loadItem(size_t itemNumber) const {
+      return loadItem(words, bitWidth, itemNumber);
+    }
+
+    /// \brief (Internal) Load the item at itemNumber from someWords
+    /// packed aBitWidth bits per item.
+    static uint64_t loadItem(const uint64_t *someWords, size_t aBitWidth,
+                             size_t itemNumber) {
+      size_t bitNum = itemNumber*aBitWidth;
+      size_t offset = bitNum & 63;
+      const uint64_t *wordPtr = someWords + (bitNum >> 6);
+      // the high word is shifted in two steps, so that an offset of
+      // zero shifts it out entirely (rather than by an undefined 64)
+      uint64_t bits = (wordPtr[0] >> offset) |
+        ((wordPtr[1] << 1) << (63 - offset));
+#ifdef __BMI2__
+      return _bzhi_u64(bits, (unsigned int)aBitWidth);
+#else
+      return bits & getMask(aBitWidth);
+#endif
+    }
+
+    /// \brief (Internal) Store anItem (which MUST fit in bitWidth bits)
+    /// at itemNumber.
+    void storeItem(size_t itemNumber, uint64_t anItem) {
+      storeItem(words, bitWidth, itemNumber, anItem);
+    }
+
+    /// \brief (Internal) Store anItem (which MUST fit in aBitWidth bits)
+    /// at itemNumber in someWords packed aBitWidth bits per item.
+    static void storeItem(uint64_t *someWords, size_t aBitWidth,
+                          size_t itemNumber, uint64_t anItem) {
+      ASSERT(anItem <= getMask(aBitWidth));
+      size_t bitNum = itemNumber*aBitWidth;
+      size_t offset = bitNum & 63;
+      uint64_t *wordPtr = someWords + (bitNum >> 6);
+      uint64_t lowMask  = getMask(aBitWidth) << offset;
+      wordPtr[0] = (wordPtr[0] & ~lowMask) | (anItem << offset);
+      if (64 < offset + aBitWidth) {
+        size_t   highShift = 64 - offset;
+        uint64_t highMask  = getMask(aBitWidth) >> highShift;
+        wordPtr[1] = (wordPtr[1] & ~highMask) | (anItem >> highShift);
+      }
+    }
+
+    /// \brief (Internal) Repack the items into new words with room for
+    /// newCapacity items of newBitWidth bits.
+    void repack(size_t newCapacity, size_t newBitWidth) {
+      ASSERT(numItems <= newCapacity);
+      ASSERT(bitWidth <= newBitWidth);
+      uint64_t *newWords =
+        (uint64_t*)calloc(getNumWords(newCapacity, newBitWidth), 8);
+      ASSERT(newWords);
+      if (words && (newBitWidth == bitWidth)) {
+        memcpy(newWords, words, ((numItems*bitWidth + 63)/64)*8);
+      } else if (words) {
+        for (size_t i = 0; i < numItems; i++) {
+          storeItem(newWords, newBitWidth, i, loadItem(i));
+        }
+      }
+      if (words) free(words);
+      words    = newWords;
+      capacity = newCapacity;
+      bitWidth = newBitWidth;
+    }
+
+    /// \brief The number of bits used to store each item.
+    size_t bitWidth;
+
+    /// \brief The current number of items in the array.
+    size_t numItems;
+
+    /// \brief The number of items the words can hold.
+    size_t capacity;
+
+    /// \brief The packed items.
+    uint64_t *words;
+
+  private:
+
+    /// \brief PackedIntArrays MUST NOT be copied (the words would be
+    /// freed twice).
+    PackedIntArray(const PackedIntArray &other);
+    void operator=(const PackedIntArray &other);
+};
+
+#endif
@@ -0,0 +1,342 @@
+#ifndef RANK_SELECT_BIT_SET_H
+#define RANK_SELECT_BIT_SET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "cUtils/assertions.h"
+#include "cUtils/bitSet.h"
+#include "cUtils/memoryUsage.h"
+
+/// \brief The log2 of the number of bits in each block of a
+/// RankSelectBitSet (eight 64 bit words, a cache line).
+#define RankSelectBlockShift 9
+
+/// \brief The log2 of the number of blocks in each superblock of a
+/// RankSelectBitSet (so that the rank of a block within its superblock
+/// fits in 16 bits).
+#define RankSelectSuperShift 7
+
+/// \brief The number of set bits between the select samples of a
+/// RankSelectBitSet.
+#ifndef RankSelectSampleRate
+#define RankSelectSampleRate 4096
+#endif
+
+/// \brief The RankSelectBitSet class holds an immutable copy of a
+/// BitSet together with the directories required to answer rank and
+/// select queries in (near) constant time.
+///
+/// - rank(bitNum) returns the number of set bits before bitNum (for
+///   example to map a sparse id to a dense index),
+///
+/// - select(n) returns the position of the n-th set bit (counting from
+///   zero), which maps a dense index back to its sparse id.
+///
+/// The bits are held in 64 bit words grouped into 512 bit blocks (one
+/// cache line) and 65536 bit superblocks. The directories hold the
+/// (64 bit) number of set bits before each superblock and the (16 bit)
+/// number of set bits before each block within its superblock, which
+/// costs about 3.1% of the bits. A rank query adds the two directory
+/// entries to the popcounts of (at most) eight words of one block.
+///
+/// A select query starts at the block holding the nearest preceding
+/// sample (one is taken every RankSelectSampleRate set bits), finds the
+/// block holding the n-th set bit using the block directory, and then
+/// the word and bit within that block (using PDEP when BMI2 is
+/// available).
+class RankSelectBitSet {
+  public:
+
+    /// \brief The position returned by select when there is no such
+    /// set bit.
+    static const size_t noBit = ~((size_t)0);
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a RankSelectBitSet class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (numWords % wordsPerBlock)
+        throw AssertionFailure("partial block");
+      if (numWords && (!words || !superRanks || !blockRanks))
+        throw AssertionFailure("missing directories");
+      if (numWords && (superRanks[getNumSuperblocks()] != numSetBits))
+        throw AssertionFailure("set bits miscounted");
+      return true;
+    }
+
+    /// \brief Create a RankSelectBitSet holding a copy of the bits of
+    /// aBitSet.
+    RankSelectBitSet(const BitSet &aBitSet) {
+      BitExtent extent = { 0 };
+      aBitSet.forEachSegment(extent);
+      allocateWords(extent.endBitNum);
+      BitCopier copier = { words };
+      aBitSet.forEachSegment(copier);
+      buildDirectories();
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Create a RankSelectBitSet holding a copy of the
+    /// someWords words (bit i of the set being bit i%64 of word i/64).
+    RankSelectBitSet(const uint64_t *someWords, size_t someNumWords) {
+      allocateWords(someNumWords*64);
+      if (someNumWords) memcpy(words, someWords, someNumWords*8);
+      buildDirectories();
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy a RankSelectBitSet.
+    ~RankSelectBitSet(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      if (words)         free(words);
+      if (superRanks)    free(superRanks);
+      if (blockRanks)    free(blockRanks);
+      if (selectSamples) free(selectSamples);
+      words         = NULL;
+      superRanks    = NULL;
+      blockRanks    = NULL;
+      selectSamples = NULL;
+      numWords      = 0;
+    }
+
+    /// \brief Return the number of bits held (every bit at or beyond
+    /// this is clear).
+    size_t getNumBits(void) const {
+      return numWords*64;
+    }
+
+    /// \brief Return the number of set bits.
+    size_t getNumSetBits(void) const {
+      return numSetBits;
+    }
+
+    /// \brief Return the value of bit bitNum.
+    bool getBit(size_t bitNum) const {
+      if (numWords*64 <= bitNum) return false;
+      return (words[bitNum >> 6] >> (bitNum & 63)) & 1;
+    }
+
+    /// \brief Return the number of set bits before (not including)
+    /// bitNum.
+    size_t rank(size_t bitNum) const {
+      ASSERT_INVARIANT(invariant());
+      if (numWords*64 <= bitNum) return numSetBits;
+      size_t blockNum = bitNum >> RankSelectBlockShift;
+      size_t wordNum  = bitNum >> 6;
+      size_t setBits  = getBlockRank(blockNum);
+      for (size_t i = blockNum*wordsPerBlock; i < wordNum; i++) {
+        setBits += __builtin_popcountll(words[i]);
+      }
+      uint64_t lowBits = words[wordNum] & ((1ULL << (bitNum & 63)) - 1);
+      return setBits + __builtin_popcountll(lowBits);
+    }
+
+    /// \brief Return the position of the n-th set bit (counting from
+    /// zero), or noBit if there are not that many set bits.
+    size_t select(size_t n) const {
+      ASSERT_INVARIANT(invariant());
+      if (numSetBits <= n) return noBit;
+      // the n-th set bit is in a block between those of the samples
+      // either side of it
+      size_t sampleNum = n/RankSelectSampleRate;
+      size_t lowBlock  = selectSamples[sampleNum];
+      size_t highBlock = getNumBlocks() - 1;
+      if (sampleNum + 1 < numSamples) highBlock = selectSamples[sampleNum + 1];
+      // find the last block whose rank is at most n
+      while (8 < highBlock - lowBlock) {
+        size_t middleBlock = lowBlock + (highBlock - lowBlock)/2;
+        if (getBlockRank(middleBlock) <= n) lowBlock  = middleBlock;
+        else                                highBlock = middleBlock - 1;
+      }
+      while ((lowBlock < highBlock) && (getBlockRank(lowBlock + 1) <= n)) {
+        lowBlock++;
+      }
+      // then the word within the block, and the bit within the word
+      size_t remaining = n - getBlockRank(lowBlock);
+      size_t wordNum   = lowBlock*wordsPerBlock;
+      while (true) {
+        size_t wordBits = __builtin_popcountll(words[wordNum]);
+        if (remaining < wordBits) break;
+        remaining -= wordBits;
+        wordNum++;
+      }
+      return wordNum*64 + selectInWord(words[wordNum], remaining);
+    }
+
+    /// \brief Report the memory used by this bit set.
+    ///
+    /// The words are used bytes while the rank and select directories
+    /// are overhead.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(RankSelectBitSet);
+      if (numWords) {
+        usage.numAllocations = 4;
+        usage.bytesUsed      = numWords*8;
+        usage.bytesOverhead  = (getNumSuperblocks() + 1)*sizeof(uint64_t) +
+          getNumBlocks()*sizeof(uint16_t) + numSamples*sizeof(uint32_t);
+        usage.bytesReserved  = usage.bytesUsed + usage.bytesOverhead;
+      }
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief The number of words in each block.
+    static const size_t wordsPerBlock = (1 << RankSelectBlockShift)/64;
+
+    /// \brief (Internal) Finds the end of the bits of a BitSet.
+    typedef struct BitExtent {
+      size_t endBitNum;
+
+      void operator()(size_t firstBitNum, const size_t * /* someWords */,
+                      size_t someNumWords) {
+        endBitNum = firstBitNum + someNumWords*BIT_SET_ITEM_BITS;
+      }
+    } BitExtent;
+
+    /// \brief (Internal) Copies the bits of a BitSet into the words.
+    typedef struct BitCopier {
+      uint64_t *words;
+
+      void operator()(size_t firstBitNum, const size_t *someWords,
+                      size_t someNumWords) {
+        for (size_t i = 0; i < someNumWords; i++) {
+          size_t bitNum = firstBitNum + i*BIT_SET_ITEM_BITS;
+          words[bitNum >> 6] |= ((uint64_t)someWords[i]) << (bitNum & 63);
+        }
+      }
+    } BitCopier;
+
+    /// \brief (Internal) Return the number of blocks.
+    size_t getNumBlocks(void) const {
+      return numWords/wordsPerBlock;
+    }
+
+    /// \brief (Internal) Return the number of superblocks.
+    size_t getNumSuperblocks(void) const {
+      return (getNumBlocks() + (1 << RankSelectSuperShift) - 1) >>
+        RankSelectSuperShift;
+    }
+
+    /// \brief (Internal) Return the number of set bits before the block
+    /// blockNum.
+    size_t getBlockRank(size_t blockNum) const {
+      return superRanks[blockNum >> RankSelectSuperShift] +
+        blockRanks[blockNum];
+    }
+
+    /// \brief (Internal) Return the position of the n-th set bit of
+    /// aWord (which MUST have more than n set bits).
+    static size_t selectInWord(uint64_t aWord, size_t n) {
+#ifdef __BMI2__
+      return __builtin_ctzll(_pdep_u64(1ULL << n, aWord));
+#else
+      // skip whole bytes, then clear the lowest set bits of the byte
+      size_t bitNum = 0;
+      while (true) {
+        size_t byteBits = __builtin_popcount((unsigned int)(aWord & 0xFF));
+        if (n < byteBits) break;
+        n      -= byteBits;
+        aWord >>= 8;
+        bitNum += 8;
+      }
+      for ( ; n; n--) aWord &= aWord - 1;
+      return bitNum + __builtin_ctzll(aWord);
+#endif
+    }
+
+    /// \brief (Internal) Allocate (zeroed) whole blocks of words to
+    /// hold someBits bits.
+    void allocateWords(size_t someBits) {
+      size_t bitsPerBlock = wordsPerBlock*64;
+      numWords = ((someBits + bitsPerBlock - 1)/bitsPerBlock)*wordsPerBlock;
+      words         = NULL;
+      superRanks    = NULL;
+      blockRanks    = NULL;
+      selectSamples = NULL;
+      numSetBits    = 0;
+      numSamples    = 0;
+      if (!numWords) return;
+      words = (uint64_t*)calloc(numWords, sizeof(uint64_t));
+      ASSERT(words);
+    }
+
+    /// \brief (Internal) Count the set bits of every block, building
+    /// the rank directories and the select samples.
+    void buildDirectories(void) {
+      if (!numWords) return;
+      size_t numBlocks = getNumBlocks();
+      superRanks = (uint64_t*)calloc(getNumSuperblocks() + 1, sizeof(uint64_t));
+      blockRanks = (uint16_t*)calloc(numBlocks, sizeof(uint16_t));
+      ASSERT(superRanks && blockRanks);
+      size_t setBits = 0;
+      for (size_t blockNum = 0; blockNum < numBlocks; blockNum++) {
+        size_t superNum = blockNum >> RankSelectSuperShift;
+        if (!(blockNum & ((1 << RankSelectSuperShift) - 1))) {
+          superRanks[superNum] = setBits;
+        }
+        blockRanks[blockNum] = (uint16_t)(setBits - superRanks[superNum]);
+        for (size_t i = 0; i < wordsPerBlock; i++) {
+          setBits += __builtin_popcountll(words[blockNum*wordsPerBlock + i]);
+        }
+      }
+      superRanks[getNumSuperblocks()] = setBits;
+      numSetBits = setBits;
+      // sample the block holding every RankSelectSampleRate-th set bit
+      numSamples = (numSetBits + RankSelectSampleRate - 1)/RankSelectSampleRate;
+      selectSamples = (uint32_t*)calloc(numSamples + 1, sizeof(uint32_t));
+      ASSERT(selectSamples);
+      size_t sampleNum = 0;
+      for (size_t blockNum = 0; blockNum < numBlocks; blockNum++) {
+        size_t endRank = (blockNum + 1 < numBlocks) ?
+          getBlockRank(blockNum + 1) : numSetBits;
+        while ((sampleNum < numSamples) &&
+               (sampleNum*RankSelectSampleRate < endRank)) {
+          selectSamples[sampleNum++] = (uint32_t)blockNum;
+        }
+      }
+    }
+
+    /// \brief The bits (in whole blocks).
+    uint64_t *words;
+
+    /// \brief The number of words.
+    size_t numWords;
+
+    /// \brief The number of set bits.
+    size_t numSetBits;
+
+    /// \brief The number of set bits before each superblock (and, at
+    /// the end, the total).
+    uint64_t *superRanks;
+
+    /// \brief The number of set bits before each block, within its
+    /// superblock.
+    uint16_t *blockRanks;
+
+    /// \brief The block holding every RankSelectSampleRate-th set bit.
+    uint32_t *selectSamples;
+
+    /// \brief The number of select samples.
+    size_t numSamples;
+
+  private:
+
+    /// \brief RankSelectBitSets MUST NOT be copied.
+    RankSelectBitSet(const RankSelectBitSet &other);
+    void operator=(const RankSelectBitSet &other);
+};
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef SOA_VAR_ARRAY_H
+#define SOA_VAR_ARRAY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cUtils/assertions.h"
+#include "cUtils/memoryUsage.h"
+
+#ifndef SoAVarArrayMinCapacity
+#define SoAVarArrayMinCapacity 16
+#endif
+
+#ifndef SoAVarArrayColumnAlignment
+#define SoAVarArrayColumnAlignment 64
+#endif
+
+/// \brief (Internal) The SoAFieldType template class selects the type
+/// of field FieldNum of the fields FirstT, RestT...
+template<size_t FieldNum, class FirstT, class... RestT>
+struct SoAFieldType {
+  typedef typename SoAFieldType<FieldNum - 1, RestT...>::Type Type;
+};
+
+template<class FirstT, class... RestT>
+struct SoAFieldType<0, FirstT, RestT...> {
+  typedef FirstT Type;
+};
+
+/// \brief The SoAVarArray template class holds the information
+/// required to manage a variable array of records whose fields have
+/// the types FieldTs..., stored as a "structure of arrays".
+///
+/// Each field is stored in its own contiguous column, so a scan which
+/// reads one or two fields only moves those fields through the cache
+/// (rather than whole records), and the loops over a column can be
+/// vectorized by the compiler. The columns are held in a single
+/// allocation, each column starting on a SoAVarArrayColumnAlignment
+/// byte boundary.
+///
+/// The items are pushed, popped and got (field by field) much as for
+/// a VarArray. All of the columns grow together, doubling their
+/// capacity, so growth is amortized O(1). As for a VarArray, the
+/// fields are copied (using memcpy) when the array grows and are never
+/// constructed nor destroyed, so each FieldT should be a plain old
+/// data type.
+template<class... FieldTs>
+class SoAVarArray {
+  public:
+
+    /// \brief The number of fields (columns) in each item.
+    static const size_t numFields = sizeof...(FieldTs);
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a SoAVarArray class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (capacity < numItems)
+        throw AssertionFailure("too many items");
+      if (!block && capacity)
+        throw AssertionFailure("no columns");
+      for (size_t fieldNum = 0; fieldNum < numFields; fieldNum++) {
+        if (((uintptr_t)columns[fieldNum]) % SoAVarArrayColumnAlignment)
+          throw AssertionFailure("column not aligned");
+      }
+      return true;
+    }
+
+    /// \brief Create an (empty) SoAVarArray.
+    SoAVarArray(void) {
+      numItems = 0;
+      capacity = 0;
+      block    = NULL;
+      for (size_t fieldNum = 0; fieldNum < numFields; fieldNum++) {
+        columns[fieldNum] = NULL;
+      }
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy a SoAVarArray.
+    ~SoAVarArray(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      if (block) free(block);
+      block    = NULL;
+      numItems = 0;
+      capacity = 0;
+    }
+
+    /// \brief Return the current number of items in the array.
+    size_t getNumItems(void) const {
+      return numItems;
+    }
+
+    /// \brief Return the number of items the array can hold before it
+    /// must grow.
+    size_t getCapacity(void) const {
+      return capacity;
+    }
+
+    /// \brief Ensure that the array can hold someItems items without
+    /// growing.
+    void reserve(size_t someItems) {
+      ASSERT_INVARIANT(invariant());
+      if (capacity < someItems) resize(someItems);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Push a new item (one value for each field) onto the "top"
+    /// of the array.
+    void pushItem(const FieldTs &... someFields) {
+      ASSERT_INVARIANT(invariant());
+      if (capacity <= numItems) {
+        resize(capacity ? 2*capacity : SoAVarArrayMinCapacity);
+      }
+      setFields<0>(numItems, someFields...);
+      numItems++;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Get (each field of) the requested item.
+    ///
+    /// Returns false (leaving the fields unchanged) if the itemNumber
+    /// is out of range.
+    bool getItem(size_t itemNumber, FieldTs &... someFields) const {
+      ASSERT_INVARIANT(invariant());
+      if (numItems <= itemNumber) return false;
+      getFields<0>(itemNumber, someFields...);
+      return true;
+    }
+
+    /// \brief Set (each field of) the requested item to the values
+    /// provided.
+    void setItem(size_t itemNumber, const FieldTs &... someFields) {
+      ASSERT_INVARIANT(invariant());
+      if (itemNumber < numItems) setFields<0>(itemNumber, someFields...);
+    }
+
+    /// \brief Get a reference to field FieldNum of the requested item
+    /// WITHOUT any range checking (outside of DEBUG builds).
+    template<size_t FieldNum>
+    typename SoAFieldType<FieldNum, FieldTs...>::Type &
+    getField(size_t itemNumber) const {
+      ASSERT(itemNumber < numItems);
+      return getColumn<FieldNum>()[itemNumber];
+    }
+
+    /// \brief Get the column holding field FieldNum of every item (or
+    /// NULL if no space has been allocated).
+    ///
+    /// The column is aligned to SoAVarArrayColumnAlignment bytes and
+    /// holds getNumItems() valid items. The column moves whenever the
+    /// array grows.
+    template<size_t FieldNum>
+    typename SoAFieldType<FieldNum, FieldTs...>::Type *
+    getColumn(void) const {
+      typedef typename SoAFieldType<FieldNum, FieldTs...>::Type FieldT;
+      return (FieldT*)__builtin_assume_aligned(columns[FieldNum],
+                                               SoAVarArrayColumnAlignment);
+    }
+
+    /// \brief Get (each field of) the top item.
+    void getTop(FieldTs &... someFields) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems);
+      getFields<0>(numItems - 1, someFields...);
+    }
+
+    /// \brief Remove the "top" item from the array, getting each of its
+    /// fields.
+    void popItem(FieldTs &... someFields) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems); // incorrectly matched push/pops
+      numItems--;
+      getFields<0>(numItems, someFields...);
+    }
+
+    /// \brief Remove all items from this array.
+    void clearItems(void) {
+      numItems = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this array.
+    ///
+    /// The alignment padding between the columns is overhead.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(SoAVarArray);
+      usage.numAllocations = (block ? 1 : 0);
+      usage.bytesReserved  = getBlockSize(capacity);
+      usage.bytesUsed      = numItems*getItemSize();
+      usage.bytesOverhead  = usage.bytesReserved - capacity*getItemSize();
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief (Internal) Return the size of field fieldNum.
+    static size_t getFieldSize(size_t fieldNum) {
+      static const size_t fieldSizes[] = { sizeof(FieldTs)... };
+      return fieldSizes[fieldNum];
+    }
+
+    /// \brief (Internal) Return the total size of the fields of an
+    /// item.
+    static size_t getItemSize(void) {
+      size_t itemSize = 0;
+      for (size_t fieldNum = 0; fieldNum < numFields; fieldNum++) {
+        itemSize += getFieldSize(fieldNum);
+      }
+      return itemSize;
+    }
+
+    /// \brief (Internal) Return the size of a column of someItems
+    /// items of field fieldNum (rounded up to the column alignment).
+    static size_t getColumnSize(size_t fieldNum, size_t someItems) {
+      size_t columnSize = someItems*getFieldSize(fieldNum);
+      return (columnSize + SoAVarArrayColumnAlignment - 1) &
+        ~((size_t)SoAVarArrayColumnAlignment - 1);
+    }
+
+    /// \brief (Internal) Return the size of the block holding the
+    /// columns of someItems items.
+    static size_t getBlockSize(size_t someItems) {
+      if (!someItems) return 0;
+      size_t blockSize = 0;
+      for (size_t fieldNum = 0; fieldNum < numFields; fieldNum++) {
+        blockSize += getColumnSize(fieldNum, someItems);
+      }
+      return blockSize;
+    }
+
+    /// \brief (Internal) Move all of the columns into a new (zeroed)
+    /// block with room for newCapacity items.
+    void resize(size_t newCapacity) {
+      ASSERT(numItems <= newCapacity);
+      void *newBlock = NULL;
+      size_t blockSize = getBlockSize(newCapacity);
+      if (posix_memalign(&newBlock, SoAVarArrayColumnAlignment, blockSize)) {
+        newBlock = NULL;
+      }
+      ASSERT(newBlock);
+      memset(newBlock, 0, blockSize);
+      char *columnPtr = (char*)newBlock;
+      for (size_t fieldNum = 0; fieldNum < numFields; fieldNum++) {
+        if (numItems) {
+          memcpy(columnPtr, columns[fieldNum],
+                 numItems*getFieldSize(fieldNum));
+        }
+        columns[fieldNum] = columnPtr;
+        columnPtr += getColumnSize(fieldNum, newCapacity);
+      }
+      if (block) free(block);
+      block    = newBlock;
+      capacity = newCapacity;
+    }
+
+    /// \brief (Internal) Store the fields (from FieldNum on) of the
+    /// item at itemNumber.
+    template<size_t FieldNum>
+    void setFields(size_t /* itemNumber */) { }
+
+    template<size_t FieldNum, class FieldT, class... RestT>
+    void setFields(size_t itemNumber, const FieldT &aField,
+                   const RestT &... restFields) {
+      ((FieldT*)columns[FieldNum])[itemNumber] = aField;
+      setFields<FieldNum + 1>(itemNumber, restFields...);
+    }
+
+    /// \brief (Internal) Load the fields (from FieldNum on) of the item
+    /// at itemNumber.
+    template<size_t FieldNum>
+    void getFields(size_t /* itemNumber */) const { }
+
+    template<size_t FieldNum, class FieldT, class... RestT>
+    void getFields(size_t itemNumber, FieldT &aField,
+                   RestT &... restFields) const {
+      aField = ((FieldT*)columns[FieldNum])[itemNumber];
+      getFields<FieldNum + 1>(itemNumber, restFields...);
+    }
+
+    /// \brief The current number of items in the array.
+    size_t numItems;
+
+    /// \brief The number of items each column can hold.
+    size_t capacity;
+
+    /// \brief The (single) allocation holding all of the columns.
+    void *block;
+
+    /// \brief The start of the column of each field.
+    void *columns[sizeof...(FieldTs)];
+
+  private:
+
+    /// \brief SoAVarArrays MUST NOT be copied (the columns would be
+    /// freed twice).
+    SoAVarArray(const SoAVarArray &other);
+    void operator=(const SoAVarArray &other);
+};
+
+#endif
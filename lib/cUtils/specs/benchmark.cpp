@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cUtils/specs/specs.h"
+
+/// \brief (Internal) Return the value of an environment variable as a
+/// size_t, or the defaultValue if it is not set (or zero).
+static size_t getEnvSize(const char *envName, size_t defaultValue) {
+  const char *envValue = getenv(envName);
+  if (!envValue) return defaultValue;
+  size_t value = strtoul(envValue, NULL, 10);
+  if (!value) return defaultValue;
+  return value;
+}
+
+SpecBenchmark::SpecBenchmark(const char *aName, size_t someSamples) {
+  name             = aName;
+  phase            = Starting;
+  sampleIterations = 1;
+  iterationsLeft   = 0;
+  sampleStartNs    = 0;
+  numSamplesTaken  = 0;
+  numSamples       = someSamples;
+  if (!numSamples) {
+    numSamples =
+      getEnvSize("CUTILS_BENCHMARK_SAMPLES", SpecBenchmarkDefaultSamples);
+  }
+  if (SpecBenchmarkMaxSamples < numSamples) {
+    numSamples = SpecBenchmarkMaxSamples;
+  }
+  targetSampleNs =
+    getEnvSize("CUTILS_BENCHMARK_SAMPLE_NS", SpecBenchmarkDefaultSampleNs);
+}
+
+double SpecBenchmark::nowNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec*1e9 + now.tv_nsec;
+}
+
+bool SpecBenchmark::nextSample(void) {
+  double sampleNs = nowNs() - sampleStartNs;
+  switch (phase) {
+    case Starting:
+      phase            = Calibrating;
+      sampleIterations = 1;
+      break;
+    case Calibrating:
+      if (sampleNs < targetSampleNs) {
+        // grow the sample towards the target time, but by no more
+        // than a factor of ten at a time
+        double scale = (sampleNs < targetSampleNs/10) ?
+          10 : (1.2*targetSampleNs)/sampleNs;
+        size_t newIterations = (size_t)(sampleIterations*scale);
+        if (sampleIterations < newIterations) {
+          sampleIterations = newIterations;
+          break;
+        }
+      }
+      // the sample is long enough... so warm up using one more sample
+      phase = WarmingUp;
+      break;
+    case WarmingUp:
+      phase           = Sampling;
+      numSamplesTaken = 0;
+      break;
+    case Sampling:
+      samples[numSamplesTaken++] = sampleNs/sampleIterations;
+      if (numSamples <= numSamplesTaken) {
+        phase = Finished;
+        return false;
+      }
+      break;
+    case Finished:
+      return false;
+  }
+  iterationsLeft = sampleIterations - 1;
+  sampleStartNs  = nowNs();
+  return true;
+}
+
+/// \brief (Internal) Compare two doubles for qsort.
+static int compareSamples(const void *a, const void *b) {
+  double aSample = *(const double*)a;
+  double bSample = *(const double*)b;
+  if (aSample < bSample) return -1;
+  if (bSample < aSample) return 1;
+  return 0;
+}
+
+void SpecBenchmark::getResult(BenchmarkResult &result) {
+  memset(&result, 0, sizeof(BenchmarkResult));
+  result.name          = name;
+  result.numIterations = sampleIterations;
+  result.numSamples    = numSamplesTaken;
+  if (!numSamplesTaken) return;
+
+  double sortedSamples[SpecBenchmarkMaxSamples];
+  memcpy(sortedSamples, samples, numSamplesTaken*sizeof(double));
+  qsort(sortedSamples, numSamplesTaken, sizeof(double), compareSamples);
+
+  double totalNs = 0;
+  for (size_t i = 0; i < numSamplesTaken; i++) totalNs += sortedSamples[i];
+  result.meanNs = totalNs/numSamplesTaken;
+  result.minNs  = sortedSamples[0];
+  size_t middle = numSamplesTaken/2;
+  if (numSamplesTaken & 0x1) result.medianNs = sortedSamples[middle];
+  else result.medianNs = (sortedSamples[middle-1] + sortedSamples[middle])/2;
+  // the nearest rank definition of the 99th percentile
+  size_t p99Rank = (99*numSamplesTaken + 99)/100;
+  result.p99Ns = sortedSamples[p99Rank-1];
+}
+
+void SpecBenchmark::report(void) {
+  BenchmarkResult result;
+  getResult(result);
+  SpecRunner::get()->logBenchmark(result);
+}
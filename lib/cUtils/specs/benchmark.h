@@ -0,0 +1,168 @@
+#ifndef CUTILS_BENCHMARK_H
+#define CUTILS_BENCHMARK_H
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#ifndef SpecBenchmarkMaxSamples
+#define SpecBenchmarkMaxSamples 1000
+#endif
+
+#ifndef SpecBenchmarkDefaultSamples
+#define SpecBenchmarkDefaultSamples 20
+#endif
+
+#ifndef SpecBenchmarkDefaultSampleNs
+#define SpecBenchmarkDefaultSampleNs 1000000
+#endif
+
+/// \def benchmark(name)
+/// \brief Opens a benchmark of the code between the braces which
+/// follow.
+///
+/// The code is run repeatedly, first to calibrate the number of
+/// iterations in each sample and warm up, then for a number of timed
+/// samples. The (per iteration) timings are reported to the current
+/// SpecRunner.
+///
+/// The number of samples and the target time of each sample can be
+/// set using the CUTILS_BENCHMARK_SAMPLES and CUTILS_BENCHMARK_SAMPLE_NS
+/// environment variables.
+///
+/// There MUST be a corresponding endBenchmark();
+#define benchmark(name)						\
+  {								\
+    SpecBenchmark specBenchmark(name, 0);			\
+    while (specBenchmark.keepRunning())
+
+/// \def benchmarkSamples(name, numSamples)
+/// \brief Opens a benchmark which uses the given number of samples
+/// (see benchmark).
+///
+/// There MUST be a corresponding endBenchmark();
+#define benchmarkSamples(name, numSamples)			\
+  {								\
+    SpecBenchmark specBenchmark(name, numSamples);		\
+    while (specBenchmark.keepRunning())
+
+/// \def endBenchmark()
+/// \brief Closes a benchmark and reports its timings.
+#define endBenchmark()						\
+    specBenchmark.report();					\
+  }
+
+/// \brief Prevent the compiler from optimizing away the computation of
+/// a value which is otherwise unused inside of a benchmark.
+template<class ValueT>
+inline void specDoNotOptimize(ValueT const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// \brief Prevent the compiler from optimizing away the computation of
+/// a value which is otherwise unused inside of a benchmark.
+template<class ValueT>
+inline void specDoNotOptimize(ValueT &value) {
+  asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+/// \brief Force the compiler to assume that all memory has been both
+/// read and written.
+inline void specClobberMemory(void) {
+  asm volatile("" : : : "memory");
+}
+
+/// \brief The BenchmarkResult structure holds the (per iteration)
+/// timings of one benchmark.
+typedef struct BenchmarkResult {
+  /// \brief The name of the benchmark.
+  const char *name;
+
+  /// \brief The number of iterations in each timed sample.
+  size_t numIterations;
+
+  /// \brief The number of timed samples.
+  size_t numSamples;
+
+  /// \brief The fastest sample (in nanoseconds per iteration).
+  double minNs;
+
+  /// \brief The median sample (in nanoseconds per iteration).
+  double medianNs;
+
+  /// \brief The 99th percentile sample (in nanoseconds per iteration).
+  double p99Ns;
+
+  /// \brief The mean of all samples (in nanoseconds per iteration).
+  double meanNs;
+} BenchmarkResult;
+
+/// \brief (Internal) The SpecBenchmark class holds the state of one
+/// benchmark while it is being run by the benchmark/endBenchmark
+/// macros.
+class SpecBenchmark {
+public:
+
+  /// \brief Create a SpecBenchmark with the given name.
+  ///
+  /// If someSamples is zero the default number of samples is used.
+  SpecBenchmark(const char *aName, size_t someSamples);
+
+  /// \brief Return true while the benchmarked code should be run
+  /// (again).
+  ///
+  /// The clock is only read at the end of each sample.
+  bool keepRunning(void) {
+    if (__builtin_expect(iterationsLeft != 0, 1)) {
+      iterationsLeft--;
+      return true;
+    }
+    return nextSample();
+  }
+
+  /// \brief Compute the results of this benchmark.
+  void getResult(BenchmarkResult &result);
+
+  /// \brief Report the results of this benchmark to the current
+  /// SpecRunner.
+  void report(void);
+
+protected:
+
+  /// \brief The phases of a benchmark.
+  enum Phase { Starting, Calibrating, WarmingUp, Sampling, Finished };
+
+  /// \brief Finish the current sample and start the next (if any).
+  bool nextSample(void);
+
+  /// \brief Return the current monotonic time in nanoseconds.
+  static double nowNs(void);
+
+  /// \brief The name of this benchmark.
+  const char *name;
+
+  /// \brief The current phase of this benchmark.
+  Phase phase;
+
+  /// \brief The number of iterations in each sample.
+  size_t sampleIterations;
+
+  /// \brief The number of iterations left in the current sample.
+  size_t iterationsLeft;
+
+  /// \brief The (monotonic) start time of the current sample.
+  double sampleStartNs;
+
+  /// \brief The target time of each sample.
+  double targetSampleNs;
+
+  /// \brief The number of timed samples to take.
+  size_t numSamples;
+
+  /// \brief The number of timed samples taken.
+  size_t numSamplesTaken;
+
+  /// \brief The (per iteration) time of each timed sample.
+  double samples[SpecBenchmarkMaxSamples];
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "cUtils/specs/jsonRunner.h"
+
+JsonRunner::JsonRunner(FILE *aLogFile) {
+  logFile                   = aLogFile;
+
+  describeName              = NULL;
+  itName                    = NULL;
+  descriptionFailed         = false;
+  descriptionPending        = false;
+  specFailed                = false;
+  specPending               = false;
+
+  memset(&results, 0, sizeof(SpecResults));
+};
+
+JsonRunner::~JsonRunner(void) { };
+
+void JsonRunner::writeJsonString(FILE *aFile, const char *aString) {
+  if (!aString) {
+    fprintf(aFile, "null");
+    return;
+  }
+  fputc('"', aFile);
+  for (const char *p = aString; *p; p++) {
+    unsigned char c = *p;
+    switch (c) {
+      case '"'  : fputs("\\\"", aFile); break;
+      case '\\' : fputs("\\\\", aFile); break;
+      case '\n' : fputs("\\n",  aFile); break;
+      case '\r' : fputs("\\r",  aFile); break;
+      case '\t' : fputs("\\t",  aFile); break;
+      default:
+        if (c < 0x20) fprintf(aFile, "\\u%04x", c);
+        else          fputc(c, aFile);
+    }
+  }
+  fputc('"', aFile);
+}
+
+void JsonRunner::writeJsonDouble(FILE *aFile, const char *format,
+                                 double aValue) {
+  if (!isfinite(aValue)) {
+    fprintf(aFile, "null");
+    return;
+  }
+  fprintf(aFile, format, aValue);
+}
+
+void JsonRunner::beginRecord(const char *recordType) {
+  fprintf(logFile, "{\"type\":\"%s\",\"describe\":", recordType);
+  writeJsonString(logFile, describeName);
+  fprintf(logFile, ",\"it\":");
+  writeJsonString(logFile, itName);
+}
+
+void JsonRunner::endRecord(void) {
+  fprintf(logFile, "}\n");
+}
+
+void JsonRunner::beginFailure(const char *failureKind,
+                              const char *fileName, size_t lineNum) {
+  beginRecord("failure");
+  fprintf(logFile, ",\"kind\":\"%s\",\"file\":", failureKind);
+  writeJsonString(logFile, fileName);
+  fprintf(logFile, ",\"line\":%zu", lineNum);
+}
+
+void JsonRunner::beginDescription(bool runDescribe,
+                                  const char *firstMessage,
+                                  ...) { // uses varargs
+  va_list apDescribe;
+  va_start(apDescribe, firstMessage);
+
+  describeName       = firstMessage;
+  itName             = NULL;
+  descriptionFailed  = false;
+  descriptionPending = !runDescribe;
+  results.numDescriptions++;
+  if (descriptionPending) results.numPendingDescriptions++;
+
+  beginRecord("describe");
+  fprintf(logFile, ",\"pending\":%s,\"messages\":[",
+          (descriptionPending ? "true" : "false"));
+  const char *separator = "";
+  for (const char* message = va_arg(apDescribe, const char*) ;
+       message ;
+       message = va_arg(apDescribe, const char*) ) {
+    fputs(separator, logFile);
+    writeJsonString(logFile, message);
+    separator = ",";
+  }
+  fprintf(logFile, "]");
+  endRecord();
+
+  va_end(apDescribe);
+};
+
+int JsonRunner::endDescription(void) {
+  itName = NULL;
+  if (descriptionFailed) {
+    results.numFailedDescriptions++;
+    return 1;
+  }
+  if (!descriptionPending) results.numSuccessfulDescriptions++;
+  return 0;
+};
+
+void JsonRunner::beginItSpec(bool runIt,
+                             const char *firstMessage,
+                             ...) { // uses varargs
+  itName      = firstMessage;
+  specFailed  = false;
+  specPending = !runIt;
+  results.numSpecs++;
+  if (specPending) results.numPendingSpecs++;
+};
+
+void JsonRunner::endItSpec(void) {
+  const char *status = "passed";
+  if (specFailed) {
+    descriptionFailed = true;
+    results.numFailedSpecs++;
+    status = "failed";
+  } else if (specPending) {
+    status = "pending";
+  } else results.numSuccessfulSpecs++;
+  beginRecord("it");
+  fprintf(logFile, ",\"status\":\"%s\"", status);
+  endRecord();
+  itName = NULL;
+};
+
+#define SHOULD_FAILED		\
+  specFailed        = true;	\
+  descriptionFailed = true;	\
+  results.numFailedShoulds++
+
+void JsonRunner::assertionFailure(const AssertionFailure &af) {
+  beginFailure("assertion", af.fileName, af.lineNumber);
+  fprintf(logFile, ",\"messages\":[");
+  writeJsonString(logFile, af.message);
+  fprintf(logFile, "],\"stack\":[");
+  char frameName[1024];
+  for (size_t i = 0; i < af.getNumFrames(); i++) {
+    if (i) fputs(",", logFile);
+    af.getFrameName(i, frameName, 1024);
+    writeJsonString(logFile, frameName);
+  }
+  fprintf(logFile, "]");
+  endRecord();
+  SHOULD_FAILED;
+};
+
+void JsonRunner::assertShouldReachThisPoint(bool sense,
+                                            const char *fileName,
+                                            size_t lineNum,
+                                            ...) {
+  va_list apSucceed;
+  va_start(apSucceed, lineNum);
+
+  if (!sense) {
+    beginFailure("shouldNotReachThisPoint", fileName, lineNum);
+    fprintf(logFile, ",\"messages\":[");
+    const char *separator = "";
+    for (const char *message = va_arg(apSucceed, const char*) ;
+         message ;
+         message = va_arg(apSucceed, const char*) ) {
+      fputs(separator, logFile);
+      writeJsonString(logFile, message);
+      separator = ",";
+    }
+    fprintf(logFile, "]");
+    endRecord();
+    SHOULD_FAILED;
+  }
+
+  va_end(apSucceed);
+};
+
+bool JsonRunner::assertShouldEqual(bool sense,
+         const char* actualStr,   int64_t actualValue,
+         const char* expectedStr, int64_t expectedValue,
+         const char* fileName, size_t lineNum) {
+  results.numShoulds++;
+  bool condition = (actualValue == expectedValue);
+  if (condition != sense) {
+    beginFailure(sense ? "shouldBeEqual" : "shouldNotBeEqual",
+                 fileName, lineNum);
+    fprintf(logFile, ",\"actualExpr\":");
+    writeJsonString(logFile, actualStr);
+    fprintf(logFile, ",\"actual\":%lld,\"expectedExpr\":",
+            (long long int)actualValue);
+    writeJsonString(logFile, expectedStr);
+    fprintf(logFile, ",\"expected\":%lld", (long long int)expectedValue);
+    endRecord();
+    SHOULD_FAILED;
+  } else results.numSuccessfulShoulds++;
+  return condition;
+};
+
+bool JsonRunner::assertShouldEqual(bool sense,
+         const char* actualStr,   void *actualValue,
+         const char* expectedStr, void *expectedValue,
+         const char* fileName, size_t lineNum) {
+  results.numShoulds++;
+  bool condition = (actualValue == expectedValue);
+  if (condition != sense) {
+    beginFailure(sense ? "shouldBeEqual" : "shouldNotBeEqual",
+                 fileName, lineNum);
+    fprintf(logFile, ",\"actualExpr\":");
+    writeJsonString(logFile, actualStr);
+    fprintf(logFile, ",\"actual\":\"%p\",\"expectedExpr\":", actualValue);
+    writeJsonString(logFile, expectedStr);
+    fprintf(logFile, ",\"expected\":\"%p\"", expectedValue);
+    endRecord();
+    SHOULD_FAILED;
+  } else results.numSuccessfulShoulds++;
+  return condition;
+};
+
+bool JsonRunner::assertShouldEqual(bool sense,
+         const char* actualStr,   const char *actualValue,
+         const char* expectedStr, const char *expectedValue,
+         const char* fileName, size_t lineNum) {
+  results.numShoulds++;
+  bool condition = (strcmp(actualValue, expectedValue) == 0);
+  if (condition != sense) {
+    beginFailure(sense ? "shouldBeEqual" : "shouldNotBeEqual",
+                 fileName, lineNum);
+    fprintf(logFile, ",\"actualExpr\":");
+    writeJsonString(logFile, actualStr);
+    fprintf(logFile, ",\"actual\":");
+    writeJsonString(logFile, actualValue);
+    fprintf(logFile, ",\"expectedExpr\":");
+    writeJsonString(logFile, expectedStr);
+    fprintf(logFile, ",\"expected\":");
+    writeJsonString(logFile, expectedValue);
+    endRecord();
+    SHOULD_FAILED;
+  } else results.numSuccessfulShoulds++;
+  return condition;
+};
+
+void JsonRunner::logSize(const char* objTypeName, size_t objTypeSize) {
+  beginRecord("value");
+  fprintf(logFile, ",\"kind\":\"size\",\"name\":");
+  writeJsonString(logFile, objTypeName);
+  fprintf(logFile, ",\"value\":%zu", objTypeSize);
+  endRecord();
+};
+
+void JsonRunner::logValueUInt(const char* valueName, size_t value) {
+  beginRecord("value");
+  fprintf(logFile, ",\"kind\":\"uint\",\"name\":");
+  writeJsonString(logFile, valueName);
+  fprintf(logFile, ",\"value\":%zu", value);
+  endRecord();
+};
+
+void JsonRunner::logValueHInt(const char* valueName, size_t value) {
+  beginRecord("value");
+  fprintf(logFile, ",\"kind\":\"hint\",\"name\":");
+  writeJsonString(logFile, valueName);
+  fprintf(logFile, ",\"value\":%zu", value);
+  endRecord();
+};
+
+void JsonRunner::logValueInt(const char* valueName, long value) {
+  beginRecord("value");
+  fprintf(logFile, ",\"kind\":\"int\",\"name\":");
+  writeJsonString(logFile, valueName);
+  fprintf(logFile, ",\"value\":%ld", value);
+  endRecord();
+};
+
+void JsonRunner::logValueDbl(const char* valueName, double value) {
+  beginRecord("value");
+  fprintf(logFile, ",\"kind\":\"double\",\"name\":");
+  writeJsonString(logFile, valueName);
+  fprintf(logFile, ",\"value\":");
+  writeJsonDouble(logFile, "%.17g", value);
+  endRecord();
+};
+
+void JsonRunner::logBenchmark(const BenchmarkResult &result) {
+  beginRecord("benchmark");
+  fprintf(logFile, ",\"name\":");
+  writeJsonString(logFile, result.name);
+  fprintf(logFile, ",\"iterations\":%zu,\"samples\":%zu",
+          result.numIterations, result.numSamples);
+  fprintf(logFile, ",\"min_ns\":");
+  writeJsonDouble(logFile, "%.3f", result.minNs);
+  fprintf(logFile, ",\"median_ns\":");
+  writeJsonDouble(logFile, "%.3f", result.medianNs);
+  fprintf(logFile, ",\"p99_ns\":");
+  writeJsonDouble(logFile, "%.3f", result.p99Ns);
+  fprintf(logFile, ",\"mean_ns\":");
+  writeJsonDouble(logFile, "%.3f", result.meanNs);
+  endRecord();
+};
+
+void JsonRunner::logMemoryUsage(const char* containerName,
+                                const MemoryUsage &usage) {
+  beginRecord("memory");
+  fprintf(logFile, ",\"name\":");
+  writeJsonString(logFile, containerName);
+  fprintf(logFile, ",\"object_bytes\":%zu,\"allocations\":%zu"
+          ",\"reserved_bytes\":%zu,\"used_bytes\":%zu"
+          ",\"overhead_bytes\":%zu,\"wasted_bytes\":%zu"
+          ",\"fill_ratio\":",
+          usage.objectBytes, usage.numAllocations,
+          usage.bytesReserved, usage.bytesUsed,
+          usage.bytesOverhead, usage.bytesWasted);
+  writeJsonDouble(logFile, "%.6f", usage.fillRatio);
+  endRecord();
+};
+
+void JsonRunner::logReport(void) {
+  fprintf(logFile, "{\"type\":\"summary\"");
+  fprintf(logFile, ",\"descriptions\":{\"failed\":%zu,\"succeeded\":%zu"
+          ",\"pending\":%zu,\"total\":%zu}",
+          results.numFailedDescriptions,  results.numSuccessfulDescriptions,
+          results.numPendingDescriptions, results.numDescriptions);
+  fprintf(logFile, ",\"specs\":{\"failed\":%zu,\"succeeded\":%zu"
+          ",\"pending\":%zu,\"total\":%zu}",
+          results.numFailedSpecs, results.numSuccessfulSpecs, results.numPendingSpecs, results.numSpecs);
+  fprintf(logFile, ",\"shoulds\":{\"failed\":%zu,\"succeeded\":%zu"
+          ",\"pending\":%zu,\"total\":%zu}",
+          results.numFailedShoulds, results.numSuccessfulShoulds, (size_t)0, results.numShoulds);
+  endRecord();
+  fflush(logFile);
+}
+
+SpecRunner *JsonRunner::newWorkerRunner(FILE *aLogFile) {
+  return new JsonRunner(aLogFile);
+}
+
+void JsonRunner::getResults(SpecResults &someResults) {
+  someResults = results;
+}
+
+void JsonRunner::addResults(const SpecResults &someResults) {
+  addSpecResults(results, someResults);
+}
+
+FILE *JsonRunner::getLogFile(void) {
+  return logFile;
+}
+
+void JsonRunner::logAbortedDescription(const char *reason) {
+  results.numDescriptions++;
+  results.numFailedDescriptions++;
+  beginFailure("aborted", NULL, 0);
+  fprintf(logFile, ",\"reason\":");
+  writeJsonString(logFile, reason);
+  endRecord();
+}
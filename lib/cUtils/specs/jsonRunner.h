@@ -0,0 +1,182 @@
+#ifndef CUTILS_JSON_RUNNER_H
+#define CUTILS_JSON_RUNNER_H
+
+#include <stdio.h>
+#include "cUtils/specs/specs.h"
+
+/// \brief A SpecRunner which reports machine readable results.
+///
+/// The JsonRunner class writes one JSON object (record) per line (the
+/// "JSON lines" format). Each record has a "type" field which is one
+/// of:
+///
+/// - "describe"  : the start of a description,
+/// - "it"        : the result ("passed", "failed" or "pending") of an
+///                 "it" specification,
+/// - "failure"   : the details of a failed should or assertion,
+/// - "value"     : a value logged using specSize, specUValue, ...,
+/// - "benchmark" : the timings of a benchmark,
+/// - "memory"    : the memory used by a container (see specMemoryUsage),
+/// - "summary"   : the overall counts (written by logReport).
+///
+/// Records (other than "summary") include the name of the enclosing
+/// description ("describe") and, if any, "it" specification ("it").
+///
+/// A typical usage might be:
+///
+/// \code{.cpp}
+///
+///  int main(int argc, char* argv[]) {
+///    FILE *resultsFile = fopen("results.jsonl", "w");
+///    int result = SpecRunner::runAllUsing(new JsonRunner(resultsFile));
+///    fclose(resultsFile);
+///    return result;
+///  }
+///
+/// \endcode
+///
+/// Two such results files can be compared using the compareSpecResults
+/// function (or tool).
+class JsonRunner : public SpecRunner {
+public:
+
+  /// \brief Create a JsonRunner.
+  JsonRunner(FILE *aLogFile = stdout);
+
+  /// \brief Destroy a JsonRunner.
+  ~JsonRunner(void);
+
+  /// \brief Instrument the begining of a description.
+  void beginDescription(bool runDescribe,
+                        const char *firstMessage,
+                        ...); // uses varargs
+
+  /// \brief Instrument the end of a description.
+  int endDescription(void);
+
+  /// \brief Instrument the begining of a "it" specfication.
+  void beginItSpec(bool runIt,
+                   const char *firstMessage,
+                   ...); // uses varargs
+
+  /// \brief Instrument the end of a "it" specfication.
+  void endItSpec(void);
+
+  /// \brief Report an assertion failure.
+  void assertionFailure(const AssertionFailure &af);
+
+  /// \brief Report the lack of success in reaching a given point.
+  void assertShouldReachThisPoint(bool sense,
+                                  const char *fileName,
+                                  size_t lineNum,
+                                  ...); // uses varargs!
+
+  /// \brief Report the failure of an equal/not-equal condition.
+  ///
+  /// Returns the value of the condition.
+  bool assertShouldEqual(bool sense,
+         const char* actualStr,   int64_t actualValue,
+         const char* expectedStr, int64_t expectedValue,
+         const char* fileName, size_t lineNum);
+
+  /// \brief Report the failure of an equal/not-equal condition.
+  ///
+  /// Returns the value of the condition.
+  bool assertShouldEqual(bool sense,
+         const char* actualStr,   void *actualValue,
+         const char* expectedStr, void *expectedValue,
+         const char* fileName, size_t lineNum);
+
+  /// \brief Report the failure of an equal/not-equal condition.
+  ///
+  /// Returns the value of the condition.
+  bool assertShouldEqual(bool sense,
+         const char* actualStr,   const char *actualValue,
+         const char* expectedStr, const char *expectedValue,
+         const char* fileName, size_t lineNum);
+
+  /// \brief Report the size of a given object type.
+  void logSize(const char* objTypeName, size_t objTypeSize);
+
+  /// \brief Report the value of an unsigned integer.
+  void logValueUInt(const char* valueName, size_t value);
+
+  /// \brief Report the Hexadecimal value of an unsigned integer.
+  void logValueHInt(const char* valueName, size_t value);
+
+  /// \brief Report the value of an signed integer.
+  void logValueInt(const char* valueName, long value);
+
+  /// \brief Report the value of an floating point number.
+  void logValueDbl(const char* valueName, double   value);
+
+  /// \brief Report the timings of a benchmark.
+  void logBenchmark(const BenchmarkResult &result);
+
+  /// \brief Report the memory used by a container.
+  void logMemoryUsage(const char* containerName, const MemoryUsage &usage);
+
+  /// \brief Report the success/failure of these specs.
+  void logReport(void);
+
+  /// \brief Create a new JsonRunner which reports to aLogFile.
+  SpecRunner *newWorkerRunner(FILE *aLogFile);
+
+  /// \brief Get the counts of descriptions, specs and shoulds.
+  void getResults(SpecResults &someResults);
+
+  /// \brief Add someResults to the counts of descriptions, specs and
+  /// shoulds.
+  void addResults(const SpecResults &someResults);
+
+  /// \brief Get the io FILE pointer on which reports are made.
+  FILE *getLogFile(void);
+
+  /// \brief Report (and count as failed) a description which did not
+  /// complete.
+  void logAbortedDescription(const char *reason);
+
+  /// \brief Write aString as a (quoted and escaped) JSON string.
+  static void writeJsonString(FILE *aFile, const char *aString);
+
+  /// \brief Write aValue as a JSON number using the (printf) format,
+  /// or as null if aValue is a NaN or infinite (which JSON can not
+  /// represent).
+  static void writeJsonDouble(FILE *aFile, const char *format, double aValue);
+
+protected:
+
+  /// \brief Write the fields which start every record of the given
+  /// type.
+  void beginRecord(const char *recordType);
+
+  /// \brief Write the end of a record.
+  void endRecord(void);
+
+  /// \brief Write the start of a failure record.
+  void beginFailure(const char *failureKind,
+                    const char *fileName, size_t lineNum);
+
+  /// \brief The io FILE pointer for the file/stream on which the
+  /// records should be written.
+  ///
+  /// By default this is stdout.
+  FILE *logFile;
+
+  /// \brief The name of the current description.
+  const char *describeName;
+
+  /// \brief The name of the current "it" specification (or NULL if
+  /// we are not inside an "it" specification).
+  const char *itName;
+
+  bool descriptionFailed;
+  bool descriptionPending;
+  bool specFailed;
+  bool specPending;
+
+  /// \brief The counts of descriptions, specs and shoulds.
+  SpecResults results;
+};
+
+#endif
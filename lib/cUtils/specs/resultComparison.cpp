@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cUtils/varArray.h"
+#include "cUtils/specs/resultComparison.h"
+
+#define MAX_FIELD_SIZE 1024
+
+bool getJsonRecordField(const char *record,
+                        const char *fieldName,
+                        char *buffer,
+                        size_t bufferSize) {
+  if (!record || !fieldName || !buffer || !bufferSize) return false;
+  size_t fieldNameLen = strlen(fieldName);
+  const char *fieldPtr = record;
+  while ((fieldPtr = strchr(fieldPtr, '"'))) {
+    fieldPtr++;
+    if (strncmp(fieldPtr, fieldName, fieldNameLen) == 0 &&
+        fieldPtr[fieldNameLen] == '"' &&
+        fieldPtr[fieldNameLen+1] == ':') break;
+    // skip over the rest of this string
+    for ( ; *fieldPtr && (*fieldPtr != '"') ; fieldPtr++) {
+      if ((*fieldPtr == '\\') && fieldPtr[1]) fieldPtr++;
+    }
+    if (!*fieldPtr) return false;
+    fieldPtr++;
+  }
+  if (!fieldPtr) return false;
+  const char *valuePtr = fieldPtr + fieldNameLen + 2;
+  size_t valueLen = 0;
+  if (*valuePtr == '"') {
+    for (valuePtr++; *valuePtr && (*valuePtr != '"'); valuePtr++) {
+      char c = *valuePtr;
+      if ((c == '\\') && valuePtr[1]) {
+        valuePtr++;
+        c = *valuePtr;
+        if (c == 'n') c = '\n';
+        else if (c == 't') c = '\t';
+        else if (c == 'r') c = '\r';
+      }
+      if (valueLen + 1 < bufferSize) buffer[valueLen++] = c;
+    }
+  } else {
+    for ( ; *valuePtr && (*valuePtr != ',') && (*valuePtr != '}') ;
+          valuePtr++) {
+      if (valueLen + 1 < bufferSize) buffer[valueLen++] = *valuePtr;
+    }
+  }
+  buffer[valueLen] = 0;
+  return true;
+}
+
+/// \brief (Internal) The benchmark timings of one results file.
+typedef struct BenchmarkTiming {
+  char   *key;
+  double medianNs;
+} BenchmarkTiming;
+
+/// \brief (Internal) Load all of the benchmark records from a results
+/// file.
+static void loadBenchmarkTimings(FILE *resultsFile,
+                                 VarArray<BenchmarkTiming> &timings) {
+  char  *line     = NULL;
+  size_t lineSize = 0;
+  char describeName[MAX_FIELD_SIZE];
+  char itName[MAX_FIELD_SIZE];
+  char benchmarkName[MAX_FIELD_SIZE];
+  char fieldValue[MAX_FIELD_SIZE];
+  while (0 < getline(&line, &lineSize, resultsFile)) {
+    if (!getJsonRecordField(line, "type", fieldValue, MAX_FIELD_SIZE))
+      continue;
+    if (strcmp(fieldValue, "benchmark") != 0) continue;
+    if (!getJsonRecordField(line, "describe", describeName, MAX_FIELD_SIZE))
+      describeName[0] = 0;
+    if (!getJsonRecordField(line, "it", itName, MAX_FIELD_SIZE))
+      itName[0] = 0;
+    if (!getJsonRecordField(line, "name", benchmarkName, MAX_FIELD_SIZE))
+      continue;
+    // a benchmark without any samples has a null median
+    if (!getJsonRecordField(line, "median_ns", fieldValue, MAX_FIELD_SIZE) ||
+        (strcmp(fieldValue, "null") == 0)) continue;
+    BenchmarkTiming timing;
+    size_t keySize =
+      strlen(describeName) + strlen(itName) + strlen(benchmarkName) + 3;
+    timing.key = (char*)calloc(keySize, sizeof(char));
+    snprintf(timing.key, keySize, "%s/%s/%s",
+             describeName, itName, benchmarkName);
+    timing.medianNs = strtod(fieldValue, NULL);
+    timings.pushItem(timing);
+  }
+  if (line) free(line);
+}
+
+/// \brief (Internal) Free the keys of the benchmark timings.
+static void freeBenchmarkTimings(VarArray<BenchmarkTiming> &timings) {
+  for (size_t i = 0; i < timings.getNumItems(); i++) {
+    free(timings[i].key);
+  }
+  timings.clearItems();
+}
+
+size_t compareSpecResults(FILE *baselineFile,
+                          FILE *currentFile,
+                          double threshold,
+                          FILE *reportFile) {
+  VarArray<BenchmarkTiming> baselineTimings;
+  VarArray<BenchmarkTiming> currentTimings;
+  loadBenchmarkTimings(baselineFile, baselineTimings);
+  loadBenchmarkTimings(currentFile,  currentTimings);
+
+  size_t numRegressions = 0;
+  size_t numMissing     = 0;
+  for (size_t i = 0; i < currentTimings.getNumItems(); i++) {
+    BenchmarkTiming &current = currentTimings[i];
+    BenchmarkTiming *baseline = NULL;
+    for (size_t j = 0; j < baselineTimings.getNumItems(); j++) {
+      if (strcmp(baselineTimings[j].key, current.key) == 0) {
+        baseline = &baselineTimings[j];
+        break;
+      }
+    }
+    if (!baseline) {
+      if (reportFile) {
+        fprintf(reportFile, "NEW:        %s = %.2f ns\n",
+                current.key, current.medianNs);
+      }
+      continue;
+    }
+    double change = 0;
+    if (0 < baseline->medianNs) {
+      change = (current.medianNs - baseline->medianNs)/baseline->medianNs;
+    }
+    const char *verdict = "OK:        ";
+    if (threshold < change) {
+      verdict = "REGRESSION:";
+      numRegressions++;
+    } else if (change < -threshold) {
+      verdict = "IMPROVED:  ";
+    }
+    if (reportFile) {
+      fprintf(reportFile, "%s %s = %.2f ns (baseline %.2f ns, %+.1f%%)\n",
+              verdict, current.key, current.medianNs,
+              baseline->medianNs, change*100);
+    }
+  }
+  for (size_t j = 0; j < baselineTimings.getNumItems(); j++) {
+    BenchmarkTiming &baseline = baselineTimings[j];
+    bool found = false;
+    for (size_t i = 0; !found && (i < currentTimings.getNumItems()); i++) {
+      found = (strcmp(currentTimings[i].key, baseline.key) == 0);
+    }
+    if (found) continue;
+    numMissing++;
+    if (reportFile) {
+      fprintf(reportFile, "MISSING:    %s (baseline %.2f ns)\n",
+              baseline.key, baseline.medianNs);
+    }
+  }
+  if (reportFile) {
+    fprintf(reportFile, "%zu of %zu benchmarks regressed by more than %.1f%%\n",
+            numRegressions, currentTimings.getNumItems(), threshold*100);
+    if (numMissing) {
+      fprintf(reportFile, "%zu baseline benchmarks are missing\n",
+              numMissing);
+    }
+  }
+
+  freeBenchmarkTimings(baselineTimings);
+  freeBenchmarkTimings(currentTimings);
+  return numRegressions;
+}
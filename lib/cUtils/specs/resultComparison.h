@@ -0,0 +1,34 @@
+#ifndef CUTILS_RESULT_COMPARISON_H
+#define CUTILS_RESULT_COMPARISON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// \brief Compare the benchmark records of two results files written
+/// by a JsonRunner.
+///
+/// Benchmarks are matched using the names of their description, "it"
+/// specification and benchmark. A benchmark has regressed if its
+/// current median time exceeds its baseline median time by more than
+/// the threshold (as a fraction, so 0.10 is 10%). A summary line for
+/// each benchmark is written to the reportFile (if not NULL), including
+/// the baseline benchmarks which are missing from the current results
+/// (these are reported, but are not counted as regressions).
+///
+/// Returns the number of regressed benchmarks.
+size_t compareSpecResults(FILE *baselineFile,
+                          FILE *currentFile,
+                          double threshold,
+                          FILE *reportFile);
+
+/// \brief (Internal) Extract the (unescaped) value of the field
+/// fieldName from a single line JSON record.
+///
+/// Returns false if the record does not have the field. Values longer
+/// than bufferSize-1 are truncated.
+bool getJsonRecordField(const char *record,
+                        const char *fieldName,
+                        char *buffer,
+                        size_t bufferSize);
+
+#endif
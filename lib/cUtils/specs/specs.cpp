@@ -1,22 +1,40 @@
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
+#include "cUtils/workerPool.h"
 #include "cUtils/specs/specs.h"
 #include "cUtils/specs/verboseRunner.h"
 
-SpecRunner *SpecRunner::runner = NULL;
+__thread SpecRunner *SpecRunner::runner = NULL;
+
+SpecFilter SpecRunner::filter = { NULL, NULL, NULL, 0, 0, false, false };
+
+bool SpecRunner::filterParsed = false;
+
+__thread FILE *SpecRunner::listFile = NULL;
 
 typedef struct RunnerInfo {
   RunnerInfo *next;
   RunnerFunc func;
+  const char *name;
 } RunnerInfo;
 
 static RunnerInfo *runnerList = NULL;
 
-int SpecRunner::registerRunner(RunnerFunc aRunner) {
+int SpecRunner::registerRunner(RunnerFunc aRunner, const char *aName) {
   RunnerInfo *newInfo =
     (RunnerInfo*)calloc(1, sizeof(RunnerInfo));
     newInfo->next = NULL;
     newInfo->func = aRunner;
+    newInfo->name = aName;
 
   if (runnerList) {
     RunnerInfo *curRunner = runnerList;
@@ -28,17 +46,508 @@ int SpecRunner::registerRunner(RunnerFunc aRunner) {
   return 1;
 }
 
+const SpecFilter &SpecRunner::getFilter(void) {
+  return filter;
+}
+
+/// \brief (Internal) Parse a shard specification ("i/N") into the
+/// filter.
+///
+/// Returns false if the shard specification is malformed.
+static bool parseShard(const char *shardSpec, SpecFilter &aFilter) {
+  char *endPtr = NULL;
+  size_t shardNum = strtoul(shardSpec, &endPtr, 10);
+  if ((endPtr == shardSpec) || (*endPtr != '/')) return false;
+  const char *numShardsPtr = endPtr + 1;
+  size_t numShards = strtoul(numShardsPtr, &endPtr, 10);
+  if ((endPtr == numShardsPtr) || *endPtr) return false;
+  if (!numShards || (numShards <= shardNum)) return false;
+  aFilter.shardNum  = shardNum;
+  aFilter.numShards = numShards;
+  return true;
+}
+
+bool SpecRunner::parseOptions(int argc, char *argv[]) {
+  if (filterParsed) return false;
+  filterParsed = true;
+  SpecFilter newFilter = filter;
+  bool ok = parseOptions(argc, argv, newFilter);
+  filter = newFilter;
+  return ok;
+}
+
+bool SpecRunner::parseOptions(int argc, char *argv[], SpecFilter &aFilter) {
+  bool ok = true;
+
+  const char *envValue = NULL;
+  if ((envValue = getenv("CUTILS_SPECS_DESCRIBE"))) {
+    aFilter.describePattern = envValue;
+  }
+  if ((envValue = getenv("CUTILS_SPECS_IT")))  aFilter.itPattern  = envValue;
+  if ((envValue = getenv("CUTILS_SPECS_TAG"))) aFilter.tagPattern = envValue;
+  if ((envValue = getenv("CUTILS_SPECS_SHARD"))) {
+    ok = parseShard(envValue, aFilter) && ok;
+  }
+  if ((envValue = getenv("CUTILS_SPECS_LIST"))) {
+    aFilter.listOnly = (*envValue && (strcmp(envValue, "0") != 0));
+  }
+  if ((envValue = getenv("CUTILS_SPECS_BENCHMARKS"))) {
+    aFilter.runBenchmarks = (*envValue && (strcmp(envValue, "0") != 0));
+  }
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--describe=", 11) == 0) {
+      aFilter.describePattern = argv[i]+11;
+    } else if (strncmp(argv[i], "--it=", 5) == 0) {
+      aFilter.itPattern = argv[i]+5;
+    } else if (strncmp(argv[i], "--tag=", 6) == 0) {
+      aFilter.tagPattern = argv[i]+6;
+    } else if (strncmp(argv[i], "--shard=", 8) == 0) {
+      ok = parseShard(argv[i]+8, aFilter) && ok;
+    } else if (strcmp(argv[i], "--list") == 0) {
+      aFilter.listOnly = true;
+    } else if (strcmp(argv[i], "--benchmarks") == 0) {
+      aFilter.runBenchmarks = true;
+    }
+  }
+  return ok;
+}
+
+/// \brief (Internal) Return true if aString matches the (glob)
+/// pattern (a NULL pattern matches everything).
+static bool matchesPattern(const char *pattern, const char *aString) {
+  if (!pattern) return true;
+  if (!aString) aString = "";
+  return fnmatch(pattern, aString, 0) == 0;
+}
+
+bool SpecRunner::selectDescribe(const char *aName) {
+  return selectDescribe(filter, aName);
+}
+
+bool SpecRunner::selectDescribe(const SpecFilter &aFilter, const char *aName) {
+  if (!aName) aName = "";
+  if (!matchesPattern(aFilter.describePattern, aName)) return false;
+  if (aFilter.numShards) {
+    // the FNV-1a hash of the name
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = aName; *p; p++) {
+      hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    if ((hash % aFilter.numShards) != aFilter.shardNum) return false;
+  }
+  return true;
+}
+
+/// \brief (Internal) Return true if one of the tags ("[tag]") in
+/// aMessage matches the (glob) pattern.
+static bool hasMatchingTag(const char *pattern, const char *aMessage) {
+  char tag[256];
+  const char *tagStart = aMessage;
+  while ((tagStart = strchr(tagStart, '['))) {
+    tagStart++;
+    const char *tagEnd = strchr(tagStart, ']');
+    if (!tagEnd) break;
+    size_t tagLen = tagEnd - tagStart;
+    if (255 < tagLen) tagLen = 255;
+    memcpy(tag, tagStart, tagLen);
+    tag[tagLen] = 0;
+    if (fnmatch(pattern, tag, 0) == 0) return true;
+    tagStart = tagEnd + 1;
+  }
+  return false;
+}
+
+bool SpecRunner::selectItSpec(const char *firstMessage, ...) {
+  va_list apIt;
+  va_start(apIt, firstMessage);
+  bool selected = selectItSpecV(filter, firstMessage, apIt);
+  va_end(apIt);
+  if (selected && listFile) {
+    fprintf(listFile, "  %s\n", firstMessage);
+    return false;
+  }
+  return selected;
+}
+
+bool SpecRunner::selectItSpec(const SpecFilter &aFilter,
+                              const char *firstMessage, ...) {
+  va_list apIt;
+  va_start(apIt, firstMessage);
+  bool selected = selectItSpecV(aFilter, firstMessage, apIt);
+  va_end(apIt);
+  return selected;
+}
+
+bool SpecRunner::selectItSpecV(const SpecFilter &aFilter,
+                               const char *firstMessage,
+                               va_list apIt) {
+  bool selected = matchesPattern(aFilter.itPattern, firstMessage);
+  if (selected && (aFilter.tagPattern || !aFilter.runBenchmarks)) {
+    bool tagMatched  = !aFilter.tagPattern;
+    bool isBenchmark = false;
+    for (const char *message = firstMessage ;
+         message ;
+         message = va_arg(apIt, const char*) ) {
+      if (!tagMatched) {
+        tagMatched = hasMatchingTag(aFilter.tagPattern, message);
+      }
+      if (!isBenchmark) isBenchmark = hasMatchingTag("benchmark", message);
+    }
+    selected = tagMatched && (aFilter.runBenchmarks || !isBenchmark);
+  }
+  return selected;
+}
+
+size_t SpecRunner::getSelectedDescribes(RunnerFunc *&funcs) {
+  size_t numDescribes = 0;
+  RunnerInfo *curRunner = runnerList;
+  for ( ; curRunner ; curRunner = curRunner->next) numDescribes++;
+  funcs = (RunnerFunc*)calloc(numDescribes+1, sizeof(RunnerFunc));
+  numDescribes = 0;
+  curRunner = runnerList;
+  for ( ; curRunner ; curRunner = curRunner->next) {
+    if (selectDescribe(curRunner->name)) funcs[numDescribes++] = curRunner->func;
+  }
+  return numDescribes;
+}
+
+void SpecRunner::listAll(FILE *aFile) {
+  SpecRunner *savedRunner = runner;
+  runner   = new SpecRunner(); // which reports nothing
+  listFile = aFile;
+  RunnerInfo *curRunner = runnerList;
+  for ( ; curRunner ; curRunner = curRunner->next) {
+    if (!selectDescribe(curRunner->name)) continue;
+    fprintf(aFile, "%s\n", (curRunner->name ? curRunner->name : "(unnamed)"));
+    (*(curRunner->func))();
+  }
+  listFile = NULL;
+  delete runner;
+  runner = savedRunner;
+}
+
 int SpecRunner::runAllUsing(SpecRunner *aRunner) {
   runner = aRunner;
   int numFailures = 0;
-  RunnerInfo *curRunner = runnerList;
-  for ( ; curRunner ; curRunner = curRunner->next) {
-    numFailures += (*(curRunner->func))();
+  RunnerFunc *funcs = NULL;
+  size_t numDescribes = getSelectedDescribes(funcs);
+  for (size_t i = 0; i < numDescribes; i++) {
+    numFailures += (*(funcs[i]))();
   };
+  free(funcs);
   aRunner->logReport();
   return numFailures;
 }
 
+/// \brief (Internal) The state of one describe run by
+/// runAllInParallelUsing.
+typedef struct ParallelDescribe {
+  RunnerFunc  func;
+  char       *output;
+  size_t      outputSize;
+  SpecResults results;
+  int         numFailures;
+} ParallelDescribe;
+
+/// \brief (Internal) The state shared by all of the describes run by
+/// runAllInParallelUsing.
+typedef struct ParallelContext {
+  SpecRunner       *mainRunner;
+  ParallelDescribe *describes;
+} ParallelContext;
+
+void SpecRunner::runDescribeTask(size_t describeNum, void *aContext) {
+  ParallelContext  *context  = (ParallelContext*)aContext;
+  ParallelDescribe *describe = context->describes + describeNum;
+  FILE *outputFile = open_memstream(&describe->output, &describe->outputSize);
+  SpecRunner *callersRunner = runner;
+  runner = context->mainRunner->newWorkerRunner(outputFile);
+  describe->numFailures = (*(describe->func))();
+  runner->getResults(describe->results);
+  delete runner;
+  runner = callersRunner;
+  fclose(outputFile);
+}
+
+int SpecRunner::runAllInParallelUsing(SpecRunner *aRunner,
+                                      size_t numWorkers) {
+  runner = aRunner;
+  RunnerFunc *funcs = NULL;
+  size_t numDescribes = getSelectedDescribes(funcs);
+
+  ParallelContext context;
+  context.mainRunner = aRunner;
+  context.describes  =
+    (ParallelDescribe*)calloc(numDescribes+1, sizeof(ParallelDescribe));
+  for (size_t i = 0; i < numDescribes; i++) {
+    context.describes[i].func = funcs[i];
+  }
+  free(funcs);
+
+  WorkerPool pool(numWorkers);
+  pool.runTasks(numDescribes, runDescribeTask, &context);
+
+  int numFailures = 0;
+  FILE *logFile = aRunner->getLogFile();
+  for (size_t i = 0; i < numDescribes; i++) {
+    ParallelDescribe *describe = context.describes + i;
+    if (logFile && describe->output) {
+      fwrite(describe->output, 1, describe->outputSize, logFile);
+    }
+    if (describe->output) free(describe->output);
+    aRunner->addResults(describe->results);
+    numFailures += describe->numFailures;
+  }
+  free(context.describes);
+  aRunner->logReport();
+  return numFailures;
+}
+
+/// \brief (Internal) The state of one describe run by
+/// runAllForkedUsing.
+typedef struct ForkedDescribe {
+  RunnerFunc  func;
+  pid_t       pid;
+  int         logFd;
+  int         resultsFd;
+  double      startTime;
+  FILE       *output;
+  char       *outputBuffer;
+  size_t      outputSize;
+  bool        timedOut;
+  bool        finished;
+} ForkedDescribe;
+
+/// \brief (Internal) The results sent by a forked describe to its
+/// parent.
+typedef struct ForkedResults {
+  SpecResults results;
+  int         numFailures;
+} ForkedResults;
+
+/// \brief (Internal) The current (monotonic) time in seconds.
+static double forkedNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+/// \brief (Internal) Fork a child process which runs one describe,
+/// writing its reports to one pipe and its results to another.
+///
+/// Returns false if the child could not be started.
+bool SpecRunner::startForkedDescribe(SpecRunner *aRunner,
+                                     ForkedDescribe *describe) {
+  int logPipe[2];
+  int resultsPipe[2];
+  if (pipe(logPipe)) return false;
+  if (pipe(resultsPipe)) {
+    close(logPipe[0]);
+    close(logPipe[1]);
+    return false;
+  }
+  // do not let the child inherit (and repeat) any buffered output
+  fflush(NULL);
+  describe->pid = fork();
+  if (describe->pid < 0) {
+    close(logPipe[0]);     close(logPipe[1]);
+    close(resultsPipe[0]); close(resultsPipe[1]);
+    return false;
+  }
+  if (!describe->pid) {
+    // the child
+    close(logPipe[0]);
+    close(resultsPipe[0]);
+    FILE *logFile = fdopen(logPipe[1], "w");
+    // line buffer the reports so that they survive a crash
+    setvbuf(logFile, NULL, _IOLBF, 0);
+    ForkedResults forkedResults;
+    memset(&forkedResults, 0, sizeof(ForkedResults));
+    runner = aRunner->newWorkerRunner(logFile);
+    forkedResults.numFailures = (*(describe->func))();
+    runner->getResults(forkedResults.results);
+    fflush(logFile);
+    ssize_t written =
+      write(resultsPipe[1], &forkedResults, sizeof(ForkedResults));
+    _exit((written == sizeof(ForkedResults)) ? 0 : 1);
+  }
+  // the parent
+  close(logPipe[1]);
+  close(resultsPipe[1]);
+  describe->logFd     = logPipe[0];
+  describe->resultsFd = resultsPipe[0];
+  describe->startTime = forkedNow();
+  return true;
+}
+
+/// \brief (Internal) Collect the results of a finished (or killed)
+/// child, reporting an aborted description if the child did not
+/// complete normally.
+///
+/// Returns the number of failures of the describe.
+int SpecRunner::finishForkedDescribe(SpecRunner *aRunner,
+                                     ForkedDescribe *describe) {
+  int status = 0;
+  while ((waitpid(describe->pid, &status, 0) < 0) && (errno == EINTR));
+  ForkedResults forkedResults;
+  memset(&forkedResults, 0, sizeof(ForkedResults));
+  ssize_t numRead =
+    read(describe->resultsFd, &forkedResults, sizeof(ForkedResults));
+  close(describe->resultsFd);
+  close(describe->logFd);
+  describe->finished = true;
+
+  SpecRunner *reportRunner = aRunner->newWorkerRunner(describe->output);
+  int numFailures = 0;
+  if (describe->timedOut) {
+    reportRunner->logAbortedDescription("timed out");
+    numFailures = 1;
+  } else if (WIFSIGNALED(status)) {
+    char reason[100];
+    snprintf(reason, 100, "killed by signal %d (%s)",
+             WTERMSIG(status), strsignal(WTERMSIG(status)));
+    reportRunner->logAbortedDescription(reason);
+    numFailures = 1;
+  } else if ((numRead != sizeof(ForkedResults)) ||
+             !WIFEXITED(status) || WEXITSTATUS(status)) {
+    reportRunner->logAbortedDescription("exited without reporting results");
+    numFailures = 1;
+  } else {
+    numFailures = forkedResults.numFailures;
+    reportRunner->addResults(forkedResults.results);
+  }
+  reportRunner->getResults(forkedResults.results);
+  delete reportRunner;
+  fclose(describe->output);
+  describe->output = NULL;
+  aRunner->addResults(forkedResults.results);
+  return numFailures;
+}
+
+int SpecRunner::runAllForkedUsing(SpecRunner *aRunner,
+                                  size_t maxChildren,
+                                  double timeoutSeconds) {
+  runner = aRunner;
+  RunnerFunc *funcs = NULL;
+  size_t numDescribes = getSelectedDescribes(funcs);
+  int numFailures = runForkedDescribes(aRunner, funcs, numDescribes,
+                                       maxChildren, timeoutSeconds);
+  free(funcs);
+  aRunner->logReport();
+  return numFailures;
+}
+
+int SpecRunner::runForkedDescribes(SpecRunner *aRunner,
+                                   RunnerFunc *funcs,
+                                   size_t numDescribes,
+                                   size_t maxChildren,
+                                   double timeoutSeconds) {
+  if (!maxChildren) {
+    long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    maxChildren = (0 < numProcessors) ? numProcessors : 1;
+  }
+
+  ForkedDescribe *describes =
+    (ForkedDescribe*)calloc(numDescribes+1, sizeof(ForkedDescribe));
+  struct pollfd  *pollFds =
+    (struct pollfd*)calloc(maxChildren+1, sizeof(struct pollfd));
+  size_t         *pollDescribes =
+    (size_t*)calloc(maxChildren+1, sizeof(size_t));
+  for (size_t i = 0; i < numDescribes; i++) {
+    describes[i].func   = funcs[i];
+    describes[i].output = open_memstream(&describes[i].outputBuffer,
+                                         &describes[i].outputSize);
+  }
+
+  int    numFailures   = 0;
+  size_t nextDescribe  = 0;
+  size_t numRunning    = 0;
+  size_t numFinished   = 0;
+  char   readBuffer[4096];
+  while (numFinished < numDescribes) {
+    // start as many children as we are allowed
+    while ((numRunning < maxChildren) && (nextDescribe < numDescribes)) {
+      ForkedDescribe *describe = describes + nextDescribe++;
+      if (startForkedDescribe(aRunner, describe)) {
+        numRunning++;
+      } else {
+        SpecRunner *reportRunner = aRunner->newWorkerRunner(describe->output);
+        reportRunner->logAbortedDescription("could not be forked");
+        SpecResults results;
+        reportRunner->getResults(results);
+        delete reportRunner;
+        fclose(describe->output);
+        describe->output   = NULL;
+        describe->finished = true;
+        aRunner->addResults(results);
+        numFailures++;
+        numFinished++;
+      }
+    }
+    if (!numRunning) continue;
+
+    // wait for output from (or the timeout of) the running children
+    double now = forkedNow();
+    int pollTimeout = -1;
+    size_t numPollFds = 0;
+    for (size_t i = 0; i < nextDescribe; i++) {
+      ForkedDescribe *describe = describes + i;
+      if (describe->finished) continue;
+      pollFds[numPollFds].fd      = describe->logFd;
+      pollFds[numPollFds].events  = POLLIN;
+      pollFds[numPollFds].revents = 0;
+      pollDescribes[numPollFds]   = i;
+      numPollFds++;
+      if (0 < timeoutSeconds) {
+        double timeLeft = describe->startTime + timeoutSeconds - now;
+        int timeLeftMs = (0 < timeLeft) ? (int)(timeLeft*1000) + 1 : 0;
+        if ((pollTimeout < 0) || (timeLeftMs < pollTimeout)) {
+          pollTimeout = timeLeftMs;
+        }
+      }
+    }
+    if ((poll(pollFds, numPollFds, pollTimeout) < 0) && (errno != EINTR)) {
+      pollTimeout = 0; // treat a failed poll as a timeout
+    }
+
+    now = forkedNow();
+    for (size_t i = 0; i < numPollFds; i++) {
+      ForkedDescribe *describe = describes + pollDescribes[i];
+      bool childDone = false;
+      if (pollFds[i].revents) {
+        ssize_t numRead = read(describe->logFd, readBuffer, 4096);
+        if (0 < numRead) fwrite(readBuffer, 1, numRead, describe->output);
+        else if ((numRead == 0) || (errno != EINTR)) childDone = true;
+      }
+      if (!childDone && (0 < timeoutSeconds) &&
+          (describe->startTime + timeoutSeconds <= now)) {
+        kill(describe->pid, SIGKILL);
+        describe->timedOut = true;
+        childDone          = true;
+      }
+      if (childDone) {
+        numFailures += finishForkedDescribe(aRunner, describe);
+        numRunning--;
+        numFinished++;
+      }
+    }
+  }
+
+  FILE *logFile = aRunner->getLogFile();
+  for (size_t i = 0; i < numDescribes; i++) {
+    ForkedDescribe *describe = describes + i;
+    if (logFile && describe->outputBuffer) {
+      fwrite(describe->outputBuffer, 1, describe->outputSize, logFile);
+    }
+    if (describe->outputBuffer) free(describe->outputBuffer);
+  }
+  free(pollDescribes);
+  free(pollFds);
+  free(describes);
+  return numFailures;
+}
+
 SpecRunner *SpecRunner::get(void) {
   if (!runner) runner = new VerboseRunner();
   return runner;
@@ -60,7 +569,7 @@ void SpecRunner::beginItSpec(bool runIt,
 
 void SpecRunner::endItSpec(void) { };
 
-void SpecRunner::assertionFailure(AssertionFailure af) {  };
+void SpecRunner::assertionFailure(const AssertionFailure &af) {  };
 
 void SpecRunner::assertShouldReachThisPoint(bool sense,
                                             const char *fileName,
@@ -93,5 +602,22 @@ void SpecRunner::logValueUInt(const char* valueName, size_t value) { };
 void SpecRunner::logValueHInt(const char* valueName, size_t value) { };
 void SpecRunner::logValueInt(const char* valueName, long value) { };
 void SpecRunner::logValueDbl(const char* valueName, double   value) { };
+void SpecRunner::logBenchmark(const BenchmarkResult &result) { };
+void SpecRunner::logMemoryUsage(const char* containerName,
+                                const MemoryUsage &usage) { };
 
 void SpecRunner::logReport(void) { };
+
+SpecRunner *SpecRunner::newWorkerRunner(FILE *aLogFile) {
+  return new SpecRunner();
+};
+
+void SpecRunner::getResults(SpecResults &someResults) {
+  memset(&someResults, 0, sizeof(SpecResults));
+};
+
+void SpecRunner::addResults(const SpecResults &someResults) { };
+
+FILE *SpecRunner::getLogFile(void) { return NULL; };
+
+void SpecRunner::logAbortedDescription(const char *reason) { };
@@ -2,8 +2,11 @@
 #define CUTILS_SPECS_H
 
 #include <stdarg.h>
+#include <stdio.h>
 
 #include "cUtils/assertions.h"
+#include "cUtils/memoryUsage.h"
+#include "cUtils/specs/benchmark.h"
 
 /// \def pending_describe(className)
 /// \brief Describes a collection of specifications.
@@ -60,7 +63,7 @@ int run ## className(void) {						    \
 /// AND it MUST correspond to the same name used in the corresponding
 /// describe(className).
 #define endDescribe(className)				\
-  catch (AssertionFailure af) {				\
+  catch (AssertionFailure &af) {				\
     SpecRunner::get()->assertionFailure(af);		\
   } catch (SpecificationFailed sf) {			\
     /* do nothing */					\
@@ -68,33 +71,39 @@ int run ## className(void) {						    \
   return SpecRunner::get()->endDescription();		\
 }							\
 static int localRunner =				\
-  SpecRunner::registerRunner(run ## className)
+  SpecRunner::registerRunner(run ## className, #className)
 
 /// \def pending_it(message)
 /// \brief Opens an "it" specification which will not be run.
 ///
 /// There MUST be a corresponding endIt();
 #define pending_it(...)						\
+  if (SpecRunner::selectItSpec(__VA_ARGS__, NULL)) {		\
   SpecRunner::get()->beginItSpec(false, __VA_ARGS__, NULL);	\
   if (false) try 
 
 /// \def it(message)
 /// \brief Opens an "it" specification.
 ///
+/// The "it" specification is only run if it has been selected by the
+/// current SpecFilter (see SpecRunner::selectItSpec).
+///
 /// There MUST be a corresponding endIt();
 #define it(...)							\
+  if (SpecRunner::selectItSpec(__VA_ARGS__, NULL)) {		\
   SpecRunner::get()->beginItSpec(true, __VA_ARGS__, NULL);	\
   try
 
 /// \def endIt()
 /// \brief Closes an "it" specification.
 #define endIt()						\
-  catch (AssertionFailure af) {				\
+  catch (AssertionFailure &af) {				\
     SpecRunner::get()->assertionFailure(af);		\
   } catch (SpecificationFailed sf) {			\
     /* do nothing */					\
   }							\
-  SpecRunner::get()->endItSpec()
+  SpecRunner::get()->endItSpec();			\
+  } do { } while (false)
 
 /// \def shouldReachThisPoint()
 /// \brief Asserts that we have succeeded if we reach this point.
@@ -170,6 +179,12 @@ static int localRunner =				\
 /// \brief Reports the hexadecimal value of a given unsigned integer
 #define specHValue(objValue) SpecRunner::get()->logValueHInt(#objValue, ((size_t)(objValue)));
 
+/// \def specMemoryUsage(container)
+/// \brief Reports the memory used by a given container (any object
+/// with a memoryUsage method, such as a VarArray, BitSet or
+/// BlockAllocator).
+#define specMemoryUsage(container) SpecRunner::get()->logMemoryUsage(#container, (container).memoryUsage());
+
 /// \brief SpecificationFailed is thrown if a specification failed
 /// (such as shouldNotBeNULL) for which it is unlikely the rest of the
 /// specification should continue.
@@ -182,6 +197,84 @@ class SpecificationFailed {
 /// a SpecRunner.
 typedef int (*RunnerFunc)(void);
 
+/// \brief (Internal) The state of one describe run by
+/// SpecRunner::runAllForkedUsing.
+struct ForkedDescribe;
+
+/// \brief The SpecResults structure holds the counts of the
+/// descriptions, specs and shoulds which have been run by a
+/// SpecRunner.
+typedef struct SpecResults {
+  size_t numDescriptions;
+  size_t numSpecs;
+  size_t numShoulds;
+  size_t numFailedDescriptions;
+  size_t numFailedSpecs;
+  size_t numFailedShoulds;
+  size_t numSuccessfulDescriptions;
+  size_t numSuccessfulSpecs;
+  size_t numSuccessfulShoulds;
+  size_t numPendingDescriptions;
+  size_t numPendingSpecs;
+} SpecResults;
+
+/// \brief Add the counts in someResults to the totalResults.
+inline void addSpecResults(SpecResults &totalResults,
+                           const SpecResults &someResults) {
+  totalResults.numDescriptions           += someResults.numDescriptions;
+  totalResults.numSpecs                  += someResults.numSpecs;
+  totalResults.numShoulds                += someResults.numShoulds;
+  totalResults.numFailedDescriptions     += someResults.numFailedDescriptions;
+  totalResults.numFailedSpecs            += someResults.numFailedSpecs;
+  totalResults.numFailedShoulds          += someResults.numFailedShoulds;
+  totalResults.numSuccessfulDescriptions += someResults.numSuccessfulDescriptions;
+  totalResults.numSuccessfulSpecs        += someResults.numSuccessfulSpecs;
+  totalResults.numSuccessfulShoulds      += someResults.numSuccessfulShoulds;
+  totalResults.numPendingDescriptions    += someResults.numPendingDescriptions;
+  totalResults.numPendingSpecs           += someResults.numPendingSpecs;
+}
+
+/// \brief The SpecFilter structure selects which describes and "it"
+/// specifications are run (or listed).
+///
+/// Patterns are shell style globs (see fnmatch). A NULL pattern
+/// matches everything.
+typedef struct SpecFilter {
+  /// \brief The pattern which the name of a describe must match.
+  const char *describePattern;
+
+  /// \brief The pattern which the (first) message of an "it"
+  /// specification must match.
+  const char *itPattern;
+
+  /// \brief The pattern which one of the tags of an "it" specification
+  /// must match.
+  ///
+  /// Tags are written inside square brackets in the messages of an
+  /// "it" specification, for example: it("should be fast", "[bench]").
+  const char *tagPattern;
+
+  /// \brief The shard (0 to numShards-1) to be run.
+  size_t shardNum;
+
+  /// \brief The number of shards (or zero, if not sharded).
+  ///
+  /// Describes are allocated to shards using a hash of their name, so
+  /// the allocation does not depend upon the link order of the
+  /// describes.
+  size_t numShards;
+
+  /// \brief List (rather than run) the selected describes and "it"
+  /// specifications.
+  bool listOnly;
+
+  /// \brief Run (or list) the "it" specifications tagged "[benchmark]".
+  ///
+  /// Benchmarks take far longer than the other specifications, so
+  /// they are skipped unless they have been asked for.
+  bool runBenchmarks;
+} SpecFilter;
+
 /// \brief A (very) simple BDD/RSpec/CSpec inspired specification framework.
 ///
 /// The SpecRunner class and its subclasses (together with a collection
@@ -203,9 +296,17 @@ typedef int (*RunnerFunc)(void);
 ///      shouldBeEqual(aVarArray.numItems, 0);
 ///    } endIt();
 ///
+///    it("should push items quickly") {
+///      VarArray<int> aVarArray;
+///      benchmark("pushItem") {
+///        aVarArray.pushItem(1);
+///      } endBenchmark();
+///    } endIt();
+///
 ///  } endDescribe(VarArray);
 ///
 ///  int main(int argc, char* argv[]) {
+///    SpecRunner::parseOptions(argc, argv);
 ///    return SpecRunner::runAllUsing(new VerboseRunner());
 ///  }
 ///
@@ -233,7 +334,7 @@ public:
   virtual void endItSpec(void);
 
   /// \brief Report an assertion failure.
-  virtual void assertionFailure(AssertionFailure af);
+  virtual void assertionFailure(const AssertionFailure &af);
 
   /// \brief Report the lack of success in reaching a given point.
   virtual void assertShouldReachThisPoint(bool sense,
@@ -279,25 +380,189 @@ public:
   /// \brief Report the value of an floating point number.
   virtual void logValueDbl(const char* valueName, double   value);
 
+  /// \brief Report the timings of a benchmark.
+  virtual void logBenchmark(const BenchmarkResult &result);
+
+  /// \brief Report the memory used by a container.
+  virtual void logMemoryUsage(const char* containerName,
+                              const MemoryUsage &usage);
+
   /// \brief Report the success/failure of these specs.
   virtual void logReport(void);
 
+  /// \brief Create a new SpecRunner, of the same kind as this one,
+  /// which reports to aLogFile.
+  ///
+  /// This is used to create the (per describe) runners of
+  /// runAllInParallelUsing.
+  virtual SpecRunner *newWorkerRunner(FILE *aLogFile);
+
+  /// \brief Get the counts of descriptions, specs and shoulds.
+  virtual void getResults(SpecResults &someResults);
+
+  /// \brief Add someResults to the counts of descriptions, specs and
+  /// shoulds.
+  virtual void addResults(const SpecResults &someResults);
+
+  /// \brief Get the io FILE pointer on which reports are made (or NULL
+  /// if there is none).
+  virtual FILE *getLogFile(void);
+
+  /// \brief Report (and count as failed) a description which did not
+  /// complete, for example because its process crashed or timed out.
+  virtual void logAbortedDescription(const char *reason);
+
   /// \brief Register the SpecRunner (or subclass) which will be used
   /// to manage the specifications.
-  static int registerRunner(RunnerFunc aRunner);
+  static int registerRunner(RunnerFunc aRunner, const char *aName = NULL);
+
+  /// \brief Get the current SpecFilter.
+  static const SpecFilter &getFilter(void);
+
+  /// \brief Set the current SpecFilter from the environment variables
+  /// and then from the command line arguments (see the three argument
+  /// parseOptions).
+  ///
+  /// The current SpecFilter is read (without locks) by every thread
+  /// running specifications, so it can only be set once, before any
+  /// specifications are run. Returns false if it has already been set
+  /// or if an argument is malformed.
+  static bool parseOptions(int argc, char *argv[]);
+
+  /// \brief Update aFilter from the environment variables and then
+  /// from the command line arguments.
+  ///
+  /// The (environment variables and) arguments recognized are:
+  ///
+  /// - (CUTILS_SPECS_DESCRIBE)   --describe=pattern
+  /// - (CUTILS_SPECS_IT)         --it=pattern
+  /// - (CUTILS_SPECS_TAG)        --tag=pattern
+  /// - (CUTILS_SPECS_SHARD)      --shard=i/N
+  /// - (CUTILS_SPECS_LIST)       --list
+  /// - (CUTILS_SPECS_BENCHMARKS) --benchmarks
+  ///
+  /// Any other arguments are ignored. Returns false if an argument is
+  /// malformed.
+  static bool parseOptions(int argc, char *argv[], SpecFilter &aFilter);
+
+  /// \brief Return true if the named describe is selected by the
+  /// current SpecFilter.
+  static bool selectDescribe(const char *aName);
+
+  /// \brief Return true if the named describe is selected by aFilter.
+  static bool selectDescribe(const SpecFilter &aFilter, const char *aName);
+
+  /// \brief Return true if the "it" specification with these
+  /// messages is selected by the current SpecFilter.
+  ///
+  /// "it" specifications tagged "[benchmark]" are only selected if
+  /// the SpecFilter's runBenchmarks is set.
+  ///
+  /// When listing, the "it" specification is listed and false is
+  /// returned.
+  static bool selectItSpec(const char *firstMessage, ...); // uses varargs!
+
+  /// \brief Return true if the "it" specification with these
+  /// messages is selected by aFilter (nothing is ever listed).
+  static bool selectItSpec(const SpecFilter &aFilter,
+                           const char *firstMessage, ...); // uses varargs!
+
+  /// \brief List the selected describes, and their selected "it"
+  /// specifications, on aFile.
+  ///
+  /// Only the "it" specifications are skipped, so any code in the
+  /// body of a describe (outside of its "it" specifications) is run.
+  static void listAll(FILE *aFile);
 
   /// \brief Run all registered specifications using the SpecRunner
   /// provided.
   static int runAllUsing(SpecRunner *aSpecRunner);
 
+  /// \brief Run all registered specifications using numWorkers
+  /// threads (or one per processor if numWorkers is zero).
+  ///
+  /// Each describe is run, on a worker thread, by its own SpecRunner
+  /// (obtained from aSpecRunner->newWorkerRunner) whose reports are
+  /// buffered. Once all describes have been run, the buffered reports
+  /// are written to aSpecRunner's log file in registration order and
+  /// the results of every describe are added to aSpecRunner's results
+  /// before its logReport.
+  ///
+  /// The describes MUST be independent of each other. Benchmark
+  /// timings taken while other describes are running will be noisy.
+  static int runAllInParallelUsing(SpecRunner *aSpecRunner,
+                                   size_t numWorkers = 0);
+
+  /// \brief Run all registered specifications, each describe in its
+  /// own (forked) child process, using the SpecRunner provided.
+  ///
+  /// At most maxChildren children (or one per processor if maxChildren
+  /// is zero) are run at the same time. Each child reports, over a
+  /// pipe, using its own SpecRunner (obtained from
+  /// aSpecRunner->newWorkerRunner). A describe whose child crashes, or
+  /// which runs for longer than timeoutSeconds (if not zero) and is
+  /// killed, is reported as an aborted (failed) description, while the
+  /// remaining describes continue to run. The reports are written to
+  /// aSpecRunner's log file in registration order.
+  static int runAllForkedUsing(SpecRunner *aSpecRunner,
+                               size_t maxChildren = 0,
+                               double timeoutSeconds = 0);
+
   /// \brief (Internal) get the currently registered SpecRunner
-  /// instance.
+  /// instance (of the calling thread).
   static SpecRunner *get(void);
 
 protected:
 
-  /// \brief The currently registered SpecRunner instance.
-  static SpecRunner *runner;
+  /// \brief The currently registered SpecRunner instance (of each
+  /// thread).
+  static __thread SpecRunner *runner;
+
+  /// \brief The current SpecFilter (which is only set by the two
+  /// argument parseOptions).
+  static SpecFilter filter;
+
+  /// \brief True once the current SpecFilter has been set.
+  static bool filterParsed;
+
+  /// \brief The file on which "it" specifications are being listed
+  /// (or NULL if the calling thread is not listing).
+  static __thread FILE *listFile;
+
+  /// \brief (Internal) Return true if the "it" specification with the
+  /// firstMessage and the (NULL terminated) remaining messages is
+  /// selected by aFilter.
+  static bool selectItSpecV(const SpecFilter &aFilter,
+                            const char *firstMessage,
+                            va_list apIt);
+
+  /// \brief (Internal) Get the selected describe funcs (in
+  /// registration order) as a newly allocated array which the caller
+  /// must free.
+  static size_t getSelectedDescribes(RunnerFunc *&funcs);
+
+  /// \brief (Internal) The WorkerPool task used by
+  /// runAllInParallelUsing to run one describe using its own
+  /// SpecRunner and buffered output.
+  static void runDescribeTask(size_t describeNum, void *aContext);
+
+  /// \brief (Internal) Run each of the numDescribes describe funcs in
+  /// its own child process (see runAllForkedUsing), without reporting.
+  static int runForkedDescribes(SpecRunner *aSpecRunner,
+                                RunnerFunc *funcs,
+                                size_t numDescribes,
+                                size_t maxChildren,
+                                double timeoutSeconds);
+
+  /// \brief (Internal) Fork the child process used by
+  /// runAllForkedUsing to run one describe.
+  static bool startForkedDescribe(SpecRunner *aSpecRunner,
+                                  ForkedDescribe *describe);
+
+  /// \brief (Internal) Collect the results of a child process started
+  /// by startForkedDescribe.
+  static int finishForkedDescribe(SpecRunner *aSpecRunner,
+                                  ForkedDescribe *describe);
 
 };
 
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "cUtils/specs/verboseRunner.h"
 
@@ -10,17 +11,7 @@ VerboseRunner::VerboseRunner(FILE *aLogFile) {
   descriptionFailed         = false;
   specFailed                = false;
 
-  numDescriptions           = 0;
-  numSpecs                  = 0;
-  numShoulds                = 0;
-  numFailedDescriptions     = 0;
-  numFailedSpecs            = 0;
-  numFailedShoulds          = 0;
-  numSuccessfulDescriptions = 0;
-  numSuccessfulSpecs        = 0;
-  numSuccessfulShoulds      = 0;
-  numPendingDescriptions    = 0;
-  numPendingSpecs           = 0;
+  memset(&results, 0, sizeof(SpecResults));
 };
 
 VerboseRunner::~VerboseRunner(void) { };
@@ -33,7 +24,7 @@ void VerboseRunner::beginDescription(bool runDescribe,
 
   inSideSizeValues = false;
   descriptionFailed = false;
-  numDescriptions++;
+  results.numDescriptions++;
   const char *pendingMessage = NULL;
   if (runDescribe) {
     pendingMessage = "";
@@ -41,7 +32,7 @@ void VerboseRunner::beginDescription(bool runDescribe,
   } else {
     pendingMessage = "PENDING: ";
     descriptionPending = true;
-    numPendingDescriptions++;
+    results.numPendingDescriptions++;
   }
   fprintf(logFile, "%s%s\n", pendingMessage, firstMessage);
   for (const char* message = va_arg(apDescribe, const char*) ;
@@ -57,10 +48,10 @@ int VerboseRunner::endDescription(void) {
   fprintf(logFile, "\n");
   inSideSizeValues = false;
   if (descriptionFailed) {
-    numFailedDescriptions++;
+    results.numFailedDescriptions++;
     return 1;
   }
-  if (!descriptionPending) numSuccessfulDescriptions++;
+  if (!descriptionPending) results.numSuccessfulDescriptions++;
   return 0;
 };
 
@@ -72,7 +63,7 @@ void VerboseRunner::beginItSpec(bool runIt,
 
   clearInSideSizeValues();
   specFailed = false;
-  numSpecs++;
+  results.numSpecs++;
   const char *pendingMessage = NULL;
   if (runIt) {
     pendingMessage = "  ";
@@ -80,7 +71,7 @@ void VerboseRunner::beginItSpec(bool runIt,
   } else {
     pendingMessage = "--PENDING: ";
     specPending = true;
-    numPendingSpecs++;
+    results.numPendingSpecs++;
   }
   fprintf(logFile, "%s%s\n", pendingMessage, firstMessage);
   for (const char *message = va_arg(apIt, const char*) ;
@@ -96,24 +87,20 @@ void VerboseRunner::endItSpec(void) {
   clearInSideSizeValues();
   if (specFailed) {
     descriptionFailed = true;
-    numFailedSpecs++;
-  } else if (!specPending) numSuccessfulSpecs++;
+    results.numFailedSpecs++;
+  } else if (!specPending) results.numSuccessfulSpecs++;
 };
 
 #define SHOULD_FAILED		\
   specFailed        = true;	\
   descriptionFailed = true;	\
-  numFailedShoulds++
+  results.numFailedShoulds++
 
-void VerboseRunner::assertionFailure(AssertionFailure af) {
+void VerboseRunner::assertionFailure(const AssertionFailure &af) {
   clearInSideSizeValues();
   fprintf(logFile, "-->>> assertion failure\n");
   fprintf(logFile, "----> %s(%zu)\n", af.fileName, af.lineNumber);
-  for (AssertionFailure::MessageHolder *curMessage = af.messages ;
-       curMessage ; curMessage = curMessage->next) {
-    fprintf(logFile, "----> %s\n", curMessage->message);
-  }
-  if (af.messages) delete af.messages;
+  af.printReport(logFile, "----> ");
   SHOULD_FAILED;
 };
 
@@ -144,7 +131,7 @@ bool VerboseRunner::assertShouldEqual(bool sense,
          const char* expectedStr, int64_t expectedValue,
          const char* fileName, size_t lineNum) {
   clearInSideSizeValues();
-  numShoulds++;
+  results.numShoulds++;
   bool condition = (actualValue == expectedValue);
   if (condition != sense) {
     fprintf(logFile, "-->>> should %s be equal (as int64_t)\n", (sense ? "" : "not"));
@@ -152,7 +139,7 @@ bool VerboseRunner::assertShouldEqual(bool sense,
     fprintf(logFile, "----> expected: [%s] = %lld\n", expectedStr, (long long int)expectedValue);
     fprintf(logFile, "----> file: %s(%zu)\n", fileName, lineNum);
     SHOULD_FAILED;
-  } else numSuccessfulShoulds++;
+  } else results.numSuccessfulShoulds++;
   return condition;
 };
 
@@ -161,7 +148,7 @@ bool VerboseRunner::assertShouldEqual(bool sense,
          const char* expectedStr, void *expectedValue,
          const char* fileName, size_t lineNum) {
   clearInSideSizeValues();
-  numShoulds++;
+  results.numShoulds++;
   bool condition = (actualValue == expectedValue);
   if (condition != sense) {
     fprintf(logFile, "-->>> should %s be equal (as void*)\n", (sense ? "" : "not"));
@@ -169,7 +156,7 @@ bool VerboseRunner::assertShouldEqual(bool sense,
     fprintf(logFile, "----> expected: [%s] = %p\n", expectedStr, expectedValue);
     fprintf(logFile, "----> file: %s(%zu)\n", fileName, lineNum);
     SHOULD_FAILED;
-  } else numSuccessfulShoulds++;
+  } else results.numSuccessfulShoulds++;
   return condition;
 };
 
@@ -178,7 +165,7 @@ bool VerboseRunner::assertShouldEqual(bool sense,
          const char* expectedStr, const char *expectedValue,
          const char* fileName, size_t lineNum) {
   clearInSideSizeValues();
-  numShoulds++;
+  results.numShoulds++;
   bool condition = (strcmp(actualValue, expectedValue) == 0);
   if (condition != sense) {
     fprintf(logFile, "-->>> should %s be equal (as const char*)\n", (sense ? "" : "not"));
@@ -186,7 +173,7 @@ bool VerboseRunner::assertShouldEqual(bool sense,
     fprintf(logFile, "----> expected: [%s] = [%s}(%p)\n", expectedStr, expectedValue, expectedValue);
     fprintf(logFile, "----> file: %s(%zu)\n", fileName, lineNum);
     SHOULD_FAILED;
-  } else numSuccessfulShoulds++;
+  } else results.numSuccessfulShoulds++;
   return condition;
 };
 
@@ -216,6 +203,24 @@ void VerboseRunner::logValueDbl(const char* valueName, double value) {
   fprintf(logFile, "  VALUE: %s = %f\n", valueName, value);
 };
 
+void VerboseRunner::logBenchmark(const BenchmarkResult &result) {
+  setInSideSizeValues();
+  fprintf(logFile, "  BENCHMARK: %s = %.2f ns min, %.2f ns median, %.2f ns p99"
+          " (%zu samples of %zu iterations)\n",
+          result.name, result.minNs, result.medianNs, result.p99Ns,
+          result.numSamples, result.numIterations);
+};
+
+void VerboseRunner::logMemoryUsage(const char* containerName,
+                                   const MemoryUsage &usage) {
+  setInSideSizeValues();
+  fprintf(logFile, "  MEMORY: %s = %zu bytes reserved, %zu used, %zu overhead,"
+          " %zu wasted (%.1f%% full, %zu allocations, %zu byte object)\n",
+          containerName, usage.bytesReserved, usage.bytesUsed,
+          usage.bytesOverhead, usage.bytesWasted, usage.fillRatio*100,
+          usage.numAllocations, usage.objectBytes);
+};
+
 void VerboseRunner::setInSideSizeValues(void) {
   if (!inSideSizeValues) {
     inSideSizeValues = true;
@@ -234,11 +239,33 @@ void VerboseRunner::logReport(void) {
   fprintf(logFile, "------------------------------------------------------\n");
   fprintf(logFile, "              Failed    Succeeded       Pending Total\n");
   fprintf(logFile, "Descriptions: %zu \t%zu\t\t%zu\t%zu\n",
-          numFailedDescriptions,  numSuccessfulDescriptions,
-          numPendingDescriptions, numDescriptions);
+          results.numFailedDescriptions,  results.numSuccessfulDescriptions,
+          results.numPendingDescriptions, results.numDescriptions);
   fprintf(logFile, "       Specs: %zu \t%zu\t\t%zu\t%zu\n",
-          numFailedSpecs, numSuccessfulSpecs, numPendingSpecs, numSpecs);
+          results.numFailedSpecs, results.numSuccessfulSpecs, results.numPendingSpecs, results.numSpecs);
   fprintf(logFile, "     Shoulds: %zu \t%zu\t\t%zu\t%zu\n",
-          numFailedShoulds, numSuccessfulShoulds, (size_t)0, numShoulds);
+          results.numFailedShoulds, results.numSuccessfulShoulds, (size_t)0, results.numShoulds);
   fprintf(logFile, "------------------------------------------------------\n");
 }
+
+SpecRunner *VerboseRunner::newWorkerRunner(FILE *aLogFile) {
+  return new VerboseRunner(aLogFile);
+}
+
+void VerboseRunner::getResults(SpecResults &someResults) {
+  someResults = results;
+}
+
+void VerboseRunner::addResults(const SpecResults &someResults) {
+  addSpecResults(results, someResults);
+}
+
+FILE *VerboseRunner::getLogFile(void) {
+  return logFile;
+}
+
+void VerboseRunner::logAbortedDescription(const char *reason) {
+  results.numDescriptions++;
+  results.numFailedDescriptions++;
+  fprintf(logFile, "DESCRIPTION ABORTED: %s\n\n", reason);
+}
@@ -58,7 +58,7 @@ public:
   void endItSpec(void);
 
   /// \brief Report an assertion failure.
-  void assertionFailure(AssertionFailure af);
+  void assertionFailure(const AssertionFailure &af);
 
   /// \brief Report the lack of success in reaching a given point.
   virtual void assertShouldReachThisPoint(bool sense,
@@ -105,8 +105,31 @@ public:
   /// \brief Report the value of an floating point number.
   void logValueDbl(const char* valueName, double   value);
 
+  /// \brief Report the timings of a benchmark.
+  void logBenchmark(const BenchmarkResult &result);
+
+  /// \brief Report the memory used by a container.
+  void logMemoryUsage(const char* containerName, const MemoryUsage &usage);
+
   void logReport(void);
 
+  /// \brief Create a new VerboseRunner which reports to aLogFile.
+  SpecRunner *newWorkerRunner(FILE *aLogFile);
+
+  /// \brief Get the counts of descriptions, specs and shoulds.
+  void getResults(SpecResults &someResults);
+
+  /// \brief Add someResults to the counts of descriptions, specs and
+  /// shoulds.
+  void addResults(const SpecResults &someResults);
+
+  /// \brief Get the io FILE pointer on which reports are made.
+  FILE *getLogFile(void);
+
+  /// \brief Report (and count as failed) a description which did not
+  /// complete.
+  void logAbortedDescription(const char *reason);
+
   void setInSideSizeValues(void);
   void clearInSideSizeValues(void);
 
@@ -125,17 +148,8 @@ protected:
   bool specFailed;
   bool specPending;
 
-  size_t numDescriptions;
-  size_t numSpecs;
-  size_t numShoulds;
-  size_t numFailedDescriptions;
-  size_t numFailedSpecs;
-  size_t numFailedShoulds;
-  size_t numSuccessfulDescriptions;
-  size_t numSuccessfulSpecs;
-  size_t numSuccessfulShoulds;
-  size_t numPendingDescriptions;
-  size_t numPendingSpecs;
+  /// \brief The counts of descriptions, specs and shoulds.
+  SpecResults results;
 };
 
 
@@ -0,0 +1,214 @@
+#ifndef STRING_INTERNER_H
+#define STRING_INTERNER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cUtils/blockAllocator.h"
+#include "cUtils/hashing.h"
+#include "cUtils/indexedHashMap.h"
+#include "cUtils/memoryUsage.h"
+#include "cUtils/varArray.h"
+
+/// \brief The StringInterner class holds a single (NUL terminated)
+/// copy of each distinct string it is given, identifying each string
+/// by a compact 32 bit id.
+///
+/// The bytes of the strings are stored contiguously in the blocks of a
+/// BlockAllocator (strings too large for a block are allocated
+/// individually), so interning a string has none of the per string
+/// heap overhead of strdup. The strings are indexed by an
+/// IndexedHashMap whose (contiguous, stable) entry indexes are the
+/// string ids.
+///
+/// Two interned strings are equal if and only if their ids (or their
+/// interned pointers) are equal. The interned strings remain valid
+/// (and never move) until the interner is cleared or destroyed.
+class StringInterner {
+
+  public:
+
+    /// \brief The id returned when a string has not been interned.
+    static const uint32_t noString = 0xFFFFFFFF;
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a StringInterner class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      return index.invariant() && bytes.invariant();
+    }
+
+    /// \brief Create an (empty) StringInterner which stores the bytes
+    /// of its strings in blocks of aBlockSize bytes.
+    ///
+    /// The blocks are obtained from aBlockSource (see BlockAllocator).
+    StringInterner(size_t aBlockSize = 65536,
+                   BlockSource *aBlockSource = NULL)
+      : bytes(aBlockSize, aBlockSource), index(aBlockSource) {
+      largeBytes = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy the StringInterner and all of its strings.
+    ~StringInterner(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      freeLargeStrings();
+    }
+
+    /// \brief Return the number of (distinct) strings interned.
+    size_t getNumStrings(void) const {
+      return index.getNumItems();
+    }
+
+    /// \brief Intern the (NUL terminated) aString, returning its id.
+    uint32_t intern(const char *aString) {
+      return intern(aString, strlen(aString));
+    }
+
+    /// \brief Intern the stringLength bytes at aString (which need not
+    /// be NUL terminated), returning its id.
+    uint32_t intern(const char *aString, size_t stringLength) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_MESSAGE(stringLength < noString, "string too long to intern");
+      StringMatcher matcher(aString, stringLength);
+      bool wasInserted = false;
+      uint32_t stringId = index.findOrInsertEntryUsing(
+        hashBytes(aString, stringLength), matcher, wasInserted);
+      if (wasInserted) {
+        StringIndex::Entry &entry = index.getEntry(stringId);
+        entry.key   = copyString(aString, stringLength);
+        entry.value = (uint32_t)stringLength;
+      }
+      ASSERT_INVARIANT(invariant());
+      return stringId;
+    }
+
+    /// \brief Intern the (NUL terminated) aString, returning the
+    /// (stable) interned copy.
+    const char *internString(const char *aString) {
+      return getString(intern(aString));
+    }
+
+    /// \brief Return the id of the (NUL terminated) aString (or
+    /// noString if it has not been interned).
+    uint32_t find(const char *aString) const {
+      return find(aString, strlen(aString));
+    }
+
+    /// \brief Return the id of the stringLength bytes at aString (or
+    /// noString if they have not been interned).
+    uint32_t find(const char *aString, size_t stringLength) const {
+      StringMatcher matcher(aString, stringLength);
+      uint32_t stringId =
+        index.findEntryUsing(hashBytes(aString, stringLength), matcher);
+      return (stringId == StringIndex::noEntry) ? noString : stringId;
+    }
+
+    /// \brief Return the interned string with this id (or NULL if there
+    /// is no such string).
+    const char *getString(uint32_t stringId) const {
+      if (index.getNumItems() <= stringId) return NULL;
+      return index.getEntry(stringId).key;
+    }
+
+    /// \brief Return the length of the interned string with this id (or
+    /// 0 if there is no such string).
+    size_t getLength(uint32_t stringId) const {
+      if (index.getNumItems() <= stringId) return 0;
+      return index.getEntry(stringId).value;
+    }
+
+    /// \brief Remove all of the strings (invalidating all ids and
+    /// interned strings).
+    void clearStrings(void) {
+      index.clearItems();
+      bytes.clearBlocks();
+      freeLargeStrings();
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this interner.
+    ///
+    /// The bytes of the strings (including their NUL terminators) are
+    /// used bytes, while the index is overhead.
+    MemoryUsage memoryUsage(void) const {
+      MemoryUsage bytesUsage = bytes.memoryUsage();
+      MemoryUsage indexUsage = index.memoryUsage();
+      MemoryUsage largeUsage = largeStrings.memoryUsage();
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(StringInterner);
+      usage.numAllocations = bytesUsage.numAllocations +
+        indexUsage.numAllocations + largeUsage.numAllocations +
+        largeStrings.getNumItems();
+      usage.bytesReserved  = bytesUsage.bytesReserved +
+        indexUsage.bytesReserved + largeUsage.bytesReserved + largeBytes;
+      usage.bytesUsed      = bytesUsage.bytesUsed + largeBytes;
+      usage.bytesOverhead  = bytesUsage.bytesOverhead +
+        indexUsage.bytesReserved + largeUsage.bytesReserved;
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief The index from (the hash of) a string to its id, whose
+    /// entries hold the interned string and its length.
+    typedef IndexedHashMap<const char*, uint32_t> StringIndex;
+
+    /// \brief (Internal) Matches the entry of a given string.
+    class StringMatcher {
+      public:
+        StringMatcher(const char *aString, size_t aLength)
+          : string(aString), length(aLength) { }
+
+        bool operator()(const StringIndex::Entry &anEntry) const {
+          return (anEntry.value == length) &&
+            (memcmp(anEntry.key, string, length) == 0);
+        }
+
+        const char *string;
+        size_t      length;
+    };
+
+    /// \brief Copy (and NUL terminate) the stringLength bytes at
+    /// aString into the blocks (or, if it is too large, into its own
+    /// allocation).
+    char *copyString(const char *aString, size_t stringLength) {
+      char *copy = NULL;
+      if (stringLength < bytes.getBlockSize()) {
+        copy = bytes.allocateNewStructure(stringLength + 1);
+      } else {
+        copy = (char*)malloc(stringLength + 1);
+        ASSERT(copy);
+        largeStrings.pushItem(copy);
+        largeBytes += stringLength + 1;
+      }
+      memcpy(copy, aString, stringLength);
+      copy[stringLength] = 0;
+      return copy;
+    }
+
+    /// \brief Free the strings which were too large for the blocks.
+    void freeLargeStrings(void) {
+      while (largeStrings.getNumItems()) free(largeStrings.popItem());
+      largeBytes = 0;
+    }
+
+    /// \brief The blocks holding the bytes of the strings.
+    BlockAllocator bytes;
+
+    /// \brief The index of the strings.
+    StringIndex index;
+
+    /// \brief The strings which were too large for the blocks.
+    VarArray<char*> largeStrings;
+
+    /// \brief The number of bytes in the largeStrings.
+    size_t largeBytes;
+};
+
+#endif
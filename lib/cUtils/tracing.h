@@ -0,0 +1,219 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// This header file provides the (opt-in) tracing of the "interesting"
+// events (such as growing a VarArray or adding a new block to a
+// BlockAllocator) of the cUtils containers.
+//
+// If the symbol CUTILS_TRACING is not defined, then the CUTILS_TRACE
+// macro compiles to nothing. The symbol SHOULD be defined (or not)
+// consistently across a whole program.
+//
+// If the symbol CUTILS_TRACING is defined, then each event is recorded,
+// together with a (monotonic) timestamp, in a ring buffer which belongs
+// to the thread which raised the event. Recording an event takes no
+// locks and does not use the heap (except for the first event raised
+// by each thread, which allocates that thread's buffer). Once a ring
+// buffer is full the oldest events are overwritten.
+
+#ifdef CUTILS_TRACING
+#define CUTILS_TRACE(eventType, arg0, arg1) \
+  Tracer::recordEvent((eventType), (uint64_t)(arg0), (uint64_t)(arg1))
+#else
+#define CUTILS_TRACE(eventType, arg0, arg1)
+#endif
+
+/// \brief The number of events held in each thread's ring buffer
+/// (MUST be a power of two).
+#ifndef CUTILS_TRACE_BUFFER_SIZE
+#define CUTILS_TRACE_BUFFER_SIZE 4096
+#endif
+
+/// \brief The types of the events which can be traced.
+typedef enum TraceEventType {
+  TraceVarArrayGrow        = 0, ///< arg0: old size,     arg1: new size
+  TraceBlockAlloc          = 1, ///< arg0: block size,   arg1: num blocks
+  TraceBitSetSegmentInsert = 2, ///< arg0: offset,       arg1: num items
+  TraceBitSetClone         = 3, ///< arg0: num segments, arg1: num items
+  TraceNumEventTypes       = 4
+} TraceEventType;
+
+/// \brief One traced event.
+typedef struct TraceEvent {
+  uint64_t timestampNs;
+  uint64_t eventType;
+  uint64_t arg0;
+  uint64_t arg1;
+} TraceEvent;
+
+/// \brief The ring buffer of the events traced by one thread.
+typedef struct TraceBuffer {
+  /// \brief The next buffer in the list of all buffers.
+  TraceBuffer *next;
+
+  /// \brief The (kernel) id of the thread which owns this buffer.
+  uint64_t threadId;
+
+  /// \brief The total number of events ever recorded in this buffer.
+  ///
+  /// Only the owning thread writes this count (with release
+  /// semantics), so readers may (carefully) read the buffer while
+  /// events are being recorded.
+  uint64_t numEvents;
+
+  TraceEvent events[CUTILS_TRACE_BUFFER_SIZE];
+} TraceBuffer;
+
+/// \brief The Tracer class records the traced events (of all threads)
+/// and exports them in the Chrome trace event (JSON) format.
+///
+/// The exported files can be viewed using chrome://tracing or
+/// [Perfetto](https://ui.perfetto.dev).
+class Tracer {
+
+public:
+
+  /// \brief Record an event in the calling thread's ring buffer.
+  static void recordEvent(TraceEventType eventType,
+                          uint64_t arg0, uint64_t arg1) {
+    static __thread TraceBuffer *threadBuffer = NULL;
+    if (!threadBuffer) threadBuffer = newThreadBuffer();
+    if (!threadBuffer) return;
+    uint64_t eventNum = threadBuffer->numEvents;
+    TraceEvent *event =
+      threadBuffer->events + (eventNum & (CUTILS_TRACE_BUFFER_SIZE-1));
+    event->timestampNs = nowNs();
+    event->eventType   = eventType;
+    event->arg0        = arg0;
+    event->arg1        = arg1;
+    __atomic_store_n(&threadBuffer->numEvents, eventNum+1, __ATOMIC_RELEASE);
+  }
+
+  /// \brief Return the current (monotonic) time in nanoseconds.
+  static uint64_t nowNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec)*1000000000ULL + now.tv_nsec;
+  }
+
+  /// \brief Return the name of an event type.
+  static const char *getEventName(uint64_t eventType) {
+    static const char *eventNames[TraceNumEventTypes] = {
+      "VarArray::grow",
+      "BlockAllocator::addNewBlock",
+      "BitSet::insertSegment",
+      "BitSet::clone"
+    };
+    if (TraceNumEventTypes <= eventType) return "unknown";
+    return eventNames[eventType];
+  }
+
+  /// \brief Return the list of all of the ring buffers (one per
+  /// thread which has ever recorded an event).
+  static TraceBuffer *getBuffers(void) {
+    return __atomic_load_n(&getBufferList(), __ATOMIC_ACQUIRE);
+  }
+
+  /// \brief Return the total number of events which are still held in
+  /// the ring buffers.
+  static size_t getNumEvents(void) {
+    size_t numEvents = 0;
+    for (TraceBuffer *buffer = getBuffers(); buffer; buffer = buffer->next) {
+      uint64_t bufferEvents =
+        __atomic_load_n(&buffer->numEvents, __ATOMIC_ACQUIRE);
+      if (CUTILS_TRACE_BUFFER_SIZE < bufferEvents) {
+        bufferEvents = CUTILS_TRACE_BUFFER_SIZE;
+      }
+      numEvents += bufferEvents;
+    }
+    return numEvents;
+  }
+
+  /// \brief Discard all of the events recorded so far.
+  ///
+  /// This MUST NOT be called while other threads are recording events.
+  static void clearEvents(void) {
+    for (TraceBuffer *buffer = getBuffers(); buffer; buffer = buffer->next) {
+      __atomic_store_n(&buffer->numEvents, 0, __ATOMIC_RELEASE);
+    }
+  }
+
+  /// \brief Write all of the events held in the ring buffers to aFile
+  /// in the Chrome trace event (JSON) format.
+  ///
+  /// Events may be recorded while the trace is being written, in which
+  /// case any event which might have been overwritten while it was
+  /// being copied is skipped.
+  ///
+  /// Returns the number of events written.
+  static size_t writeChromeTrace(FILE *aFile) {
+    pid_t processId = getpid();
+    size_t numWritten = 0;
+    fprintf(aFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (TraceBuffer *buffer = getBuffers(); buffer; buffer = buffer->next) {
+      uint64_t lastEvent =
+        __atomic_load_n(&buffer->numEvents, __ATOMIC_ACQUIRE);
+      uint64_t firstEvent = 0;
+      if (CUTILS_TRACE_BUFFER_SIZE < lastEvent) {
+        firstEvent = lastEvent - CUTILS_TRACE_BUFFER_SIZE;
+      }
+      for (uint64_t eventNum = firstEvent; eventNum < lastEvent; eventNum++) {
+        TraceEvent event =
+          buffer->events[eventNum & (CUTILS_TRACE_BUFFER_SIZE-1)];
+        // skip this event if it might have been overwritten while we
+        // copied it
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t numEvents =
+          __atomic_load_n(&buffer->numEvents, __ATOMIC_ACQUIRE);
+        if (CUTILS_TRACE_BUFFER_SIZE <= numEvents - eventNum) continue;
+        fprintf(aFile, "%s\n{\"name\":\"%s\",\"cat\":\"cUtils\",\"ph\":\"i\","
+                "\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%llu,"
+                "\"args\":{\"arg0\":%llu,\"arg1\":%llu}}",
+                (numWritten ? "," : ""), getEventName(event.eventType),
+                event.timestampNs/1000.0, (int)processId,
+                (unsigned long long)buffer->threadId,
+                (unsigned long long)event.arg0,
+                (unsigned long long)event.arg1);
+        numWritten++;
+      }
+    }
+    fprintf(aFile, "\n]}\n");
+    return numWritten;
+  }
+
+protected:
+
+  /// \brief The head of the (lock free) list of all ring buffers.
+  static TraceBuffer *&getBufferList(void) {
+    static TraceBuffer *bufferList = NULL;
+    return bufferList;
+  }
+
+  /// \brief Allocate a new ring buffer for the calling thread and add
+  /// it to the list of all ring buffers.
+  ///
+  /// Ring buffers are never freed, so that the events of threads which
+  /// have finished can still be exported.
+  static TraceBuffer *newThreadBuffer(void) {
+    TraceBuffer *buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+    if (!buffer) return NULL;
+    buffer->threadId = (uint64_t)syscall(SYS_gettid);
+    TraceBuffer *&bufferList = getBufferList();
+    TraceBuffer *head = __atomic_load_n(&bufferList, __ATOMIC_ACQUIRE);
+    do {
+      buffer->next = head;
+    } while (!__atomic_compare_exchange_n(&bufferList, &head, buffer, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    return buffer;
+  }
+};
+
+#endif
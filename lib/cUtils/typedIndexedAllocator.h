@@ -0,0 +1,115 @@
+#ifndef TYPED_INDEXED_ALLOCATOR_H
+#define TYPED_INDEXED_ALLOCATOR_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cUtils/blockAllocator.h"
+
+/// \brief The TypedIndexedAllocator template class holds the
+/// information required to allocate multiple blocks of items of type
+/// ItemT which are allocated at contiguous indexes.
+///
+/// Unlike the IndexedBlockAllocator, the item size and the (power of
+/// two) number of items per block are compile time constants, so the
+/// conversion of an index into an item is simply a shift, a mask and
+/// the load of the block pointer.
+///
+/// Items are allocated from zeroed memory and are never constructed
+/// nor destroyed, so ItemT should be a plain old data type.
+template<class ItemT, size_t BitShift = 5>
+class TypedIndexedAllocator : public BlockAllocator {
+
+  public:
+
+    /// \brief The size of each indexed item.
+    static const size_t itemSize  = sizeof(ItemT);
+
+    /// \brief The bitShift represents the power of two number of items
+    /// in a given block.
+    static const size_t bitShift  = BitShift;
+
+    /// \brief The mask used to compute the item within a block.
+    static const size_t itemMask  = (((size_t)1)<<BitShift) - 1;
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a TypedIndexedAllocator class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (blockSize != (((size_t)1)<<bitShift)*itemSize)
+        throw AssertionFailure("incorrect block size");
+      if (blocks.getNumItems() != ((numItems + itemMask) >> bitShift))
+        throw AssertionFailure("incorrect number of blocks for items");
+      return BlockAllocator::invariant();
+    }
+
+    /// \brief Create a new typed indexed allocator.
+    ///
+    /// The blocks are obtained from aBlockSource (see BlockAllocator).
+    TypedIndexedAllocator(BlockSource *aBlockSource = NULL)
+      : BlockAllocator((((size_t)1)<<BitShift)*sizeof(ItemT),
+                       aBlockSource) {
+      numItems = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Clear (free) all of the blocks.
+    void clearBlocks(void) {
+      BlockAllocator::clearBlocks();
+      numItems = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Allocate a new (zeroed) item returning its index.
+    ///
+    /// The indexes returned are contiguous.
+    size_t allocateNewStructure(void) {
+      ASSERT_INVARIANT(invariant());
+      BlockAllocator::allocateNewStructure(itemSize);
+      size_t itemNum = numItems++;
+      ASSERT_INVARIANT(invariant());
+      return itemNum;
+    }
+
+    /// \brief Return the index which will be returned by the next call
+    /// to allocateNewStructure.
+    size_t nextIndex(void) const {
+      return numItems;
+    }
+
+    /// \brief Compute the ItemT* pointer corresponding to this
+    /// itemNumber.
+    ///
+    /// Returns NULL if the itemNum has not yet been allocated.
+    ItemT *getItemPtr(size_t itemNum) const {
+      ASSERT_INVARIANT(invariant());
+      if (numItems <= itemNum) return NULL;
+      return ((ItemT*)blocks[itemNum >> bitShift]) + (itemNum & itemMask);
+    }
+
+    /// \brief Get a reference to the item at this itemNumber WITHOUT
+    /// any range checking (outside of DEBUG builds).
+    ///
+    /// This is intended for use in hot loops which have already
+    /// checked the range of itemNum against nextIndex().
+    ItemT &operator[](size_t itemNum) const {
+      ASSERT(itemNum < numItems);
+      return ((ItemT*)blocks[itemNum >> bitShift])[itemNum & itemMask];
+    }
+
+  protected:
+
+    /// \brief Override the BlockAllocator::allocateNewStructure to
+    /// prevent its use.
+    size_t allocateNewStructure(size_t structureSize) {
+      ASSERT_INVARIANT(invariant());
+      return 0;
+    }
+
+    /// \brief The number of items which have been allocated.
+    size_t numItems;
+};
+
+#endif
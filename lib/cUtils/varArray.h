@@ -5,7 +5,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "cUtils/arrayKernels.h"
 #include "cUtils/assertions.h"
+#include "cUtils/tracing.h"
+#include "cUtils/memoryUsage.h"
 
 #ifndef VarArrayIncrement
 #define VarArrayIncrement 10
@@ -34,7 +37,7 @@ class VarArray {
       numItems  = 0;
       arraySize = 0;
       itemArray = NULL;
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
     }
 
     /// \brief Explicitly destroy a VarArray.
@@ -54,9 +57,36 @@ class VarArray {
       return numItems;
     }
 
+    /// \brief Return the number of items the array can hold before it
+    /// must grow.
+    size_t getCapacity(void) const {
+      return arraySize;
+    }
+
+    /// \brief Ensure that the array can hold someItems items without
+    /// growing.
+    ///
+    /// Since pushItem grows the array by only VarArrayIncrement items
+    /// at a time, containers which push very many items should reserve
+    /// (geometrically increasing) space in advance.
+    void reserve(size_t someItems) {
+      ASSERT_INVARIANT(invariant());
+      if (someItems <= arraySize) return;
+      ItemT *oldArray = itemArray;
+      itemArray = (ItemT*)calloc(someItems, sizeof(ItemT));
+      ASSERT(itemArray);
+      if (oldArray) {
+        memcpy(itemArray, oldArray, arraySize*sizeof(ItemT));
+        free(oldArray);
+      }
+      CUTILS_TRACE(TraceVarArrayGrow, arraySize, someItems);
+      arraySize = someItems;
+      ASSERT_INVARIANT(invariant());
+    }
+
     /// \brief Push a new item onto the "top" of the array.
     void pushItem(ItemT anItem) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       if (arraySize <= numItems) {
         // we need to increase the size of the array
         ItemT *oldArray = itemArray;
@@ -65,46 +95,58 @@ class VarArray {
           memcpy(itemArray, oldArray, arraySize*sizeof(ItemT));
           free(oldArray);
         }
+        CUTILS_TRACE(TraceVarArrayGrow,
+                     arraySize, arraySize+VarArrayIncrement);
         arraySize += VarArrayIncrement;
       }
       itemArray[numItems] = anItem;
       numItems++;
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
     }
 
     /// \brief Get the requested item.
     ///
     /// Returns the default provided if the itemNumber is out of range.
     ItemT getItem(size_t itemNumber, ItemT defaultItem) const {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       if (numItems <= itemNumber) return defaultItem;
       return itemArray[itemNumber];
     }
 
+    /// \brief Get a reference to the requested item WITHOUT any range
+    /// checking (outside of DEBUG builds).
+    ///
+    /// This is intended for use in hot loops which have already
+    /// checked the range of itemNumber.
+    ItemT &operator[](size_t itemNumber) const {
+      ASSERT(itemNumber < numItems);
+      return itemArray[itemNumber];
+    }
+
     /// \brief Set the requested item to the value provided.
     void setItem(size_t itemNumber, ItemT anItem) {
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
       if (itemNumber < numItems) itemArray[itemNumber] = anItem;
     }
 
     /// \brief Get the top item
     ItemT getTop(void) const {
-      ASSERT(invariant());
-      ASSERT(numItems);
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems);
       return itemArray[numItems-1];
     }
 
     /// \brief Remove and return the "top" item on the array.
     ItemT popItem(void) {
-      ASSERT(invariant());
-      ASSERT(numItems); // incorrectly matched push/pops
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems); // incorrectly matched push/pops
       numItems--;
       return itemArray[numItems];
     }
 
     /// \brief Copy the items in this array into the buffer provided.
 //    void copyItems(void*buffer, size_t bufferSize) {
-//      ASSERT(invariant());
+//      ASSERT_INVARIANT(invariant());
 //      if (numItems*sizeof(ItemT) < bufferSize) {
 //        bufferSize = numItems*sizeof(ItemT);
 //      }
@@ -117,7 +159,121 @@ class VarArray {
     /// \brief Remove all items from this array.
     void clearItems(void) {
       numItems = 0;
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Sort the items (in place) into ascending order.
+    ///
+    /// Integer items are sorted using an LSD radix sort, all other
+    /// items using an introsort (and operator<). The sort is always
+    /// made in the calling thread (see parallelSort).
+    void sort(void) {
+      ASSERT_INVARIANT(invariant());
+      ArrayKernelTraits<ItemT>::sort(itemArray, numItems);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Sort the items (in place) into ascending order, using the
+    /// workers in aPool (a WorkerPool).
+    ///
+    /// Only arrays of at least ArrayKernelsParallelSortMinItems integers
+    /// are sorted in parallel, all others are sorted as by sort.
+    template<class PoolT>
+    void parallelSort(PoolT *aPool) {
+      ASSERT_INVARIANT(invariant());
+      ArrayKernelTraits<ItemT>::parallelSort(itemArray, numItems,
+                                             getSortPool(aPool));
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Sort the items (in place) into the order given by
+    /// compare(anItem, otherItem) (which returns true if anItem MUST be
+    /// before otherItem).
+    template<class CompareT>
+    void sortUsing(const CompareT &compare) {
+      ASSERT_INVARIANT(invariant());
+      compareSortItems(itemArray, numItems, compare);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Sort the items (in place) into ascending order, keeping
+    /// equal items in their original order (see sort).
+    void stableSort(void) {
+      ASSERT_INVARIANT(invariant());
+      ArrayKernelTraits<ItemT>::stableSort(itemArray, numItems);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Sort the items (in place) into ascending order, keeping
+    /// equal items in their original order, using the workers in aPool
+    /// (see parallelSort).
+    template<class PoolT>
+    void parallelStableSort(PoolT *aPool) {
+      ASSERT_INVARIANT(invariant());
+      ArrayKernelTraits<ItemT>::parallelStableSort(itemArray, numItems,
+                                                   getSortPool(aPool));
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Sort the items (in place) into the order given by
+    /// compare, keeping equal items in their original order (see
+    /// sortUsing).
+    template<class CompareT>
+    void stableSortUsing(const CompareT &compare) {
+      ASSERT_INVARIANT(invariant());
+      mergeSortItems(itemArray, numItems, compare);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Return the number of the first item of this (sorted)
+    /// array which is not less than anItem (or getNumItems() if there
+    /// is none).
+    size_t lowerBound(const ItemT &anItem) const {
+      ASSERT_INVARIANT(invariant());
+      return lowerBoundItem(itemArray, numItems, anItem, ArrayLess<ItemT>());
+    }
+
+    /// \brief Return the number of the first item of this array (sorted
+    /// using compare) which is not ordered before anItem (or
+    /// getNumItems() if there is none).
+    template<class CompareT>
+    size_t lowerBoundUsing(const ItemT &anItem,
+                           const CompareT &compare) const {
+      ASSERT_INVARIANT(invariant());
+      return lowerBoundItem(itemArray, numItems, anItem, compare);
+    }
+
+    /// \brief Return the number of the first item equal to anItem (or
+    /// getNumItems() if there is none).
+    ///
+    /// Integer items are compared using SSE2 (if it is available).
+    size_t find(const ItemT &anItem) const {
+      ASSERT_INVARIANT(invariant());
+      return ArrayKernelTraits<ItemT>::find(itemArray, numItems, anItem);
+    }
+
+    /// \brief Return the number of items equal to anItem.
+    ///
+    /// Integer items are compared using SSE2 (if it is available).
+    size_t count(const ItemT &anItem) const {
+      ASSERT_INVARIANT(invariant());
+      return ArrayKernelTraits<ItemT>::count(itemArray, numItems, anItem);
+    }
+
+    /// \brief Report the memory used by this array.
+    ///
+    /// Only the array of items is counted, not any memory owned by the
+    /// items themselves.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(VarArray<ItemT>);
+      usage.numAllocations = (itemArray ? 1 : 0);
+      usage.bytesReserved  = arraySize*sizeof(ItemT);
+      usage.bytesUsed      = numItems*sizeof(ItemT);
+      finishMemoryUsage(usage);
+      return usage;
     }
 
     VarArrayIterator<ItemT> getIterator(void) {
@@ -131,7 +287,7 @@ class VarArray {
     /// instance.
     void operator=(const VarArray &other) {
 //        ASSERT_MESSAGE(false, "VarArgs<>::operator= must NOT be used");
-      ASSERT(other.invariant());
+      ASSERT_INVARIANT(other.invariant());
       numItems  = 0;
       arraySize = 0;
       if (itemArray) free(itemArray);
@@ -139,7 +295,15 @@ class VarArray {
       for (size_t i = 0; i < other.numItems; i++) {
         pushItem(other.itemArray[i]);
       }
-      ASSERT(invariant());
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief (Internal) Return the pool used to sort the items (or
+    /// NULL if there are too few items to sort in parallel).
+    template<class PoolT>
+    PoolT *getSortPool(PoolT *aPool) const {
+      if (numItems < ArrayKernelsParallelSortMinItems) return NULL;
+      return aPool;
     }
 
     /// \brief The current number of items in the array.
@@ -0,0 +1,401 @@
+#ifndef VAR_HEAP_H
+#define VAR_HEAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cUtils/assertions.h"
+#include "cUtils/memoryUsage.h"
+#include "cUtils/varArray.h"
+
+#ifndef VarHeapMinCapacity
+#define VarHeapMinCapacity 16
+#endif
+
+/// \brief The default ordering of the items of a VarHeap (the smallest
+/// item is at the top of the heap).
+template<class ItemT>
+struct VarHeapLess {
+  bool operator()(const ItemT &anItem, const ItemT &otherItem) const {
+    return anItem < otherItem;
+  }
+};
+
+/// \brief The VarHeap template class holds the information required
+/// to manage a priority queue of identical objects.
+///
+/// The items are held in a VarArray as an implicit d-ary heap. By
+/// default each node has four children, so the heap is half as deep as
+/// a binary heap (pushing or decreasing an item visits half as many
+/// levels) and the children compared when popping an item are adjacent
+/// in memory (so each level costs one or two cache misses rather than
+/// one per child). The Arity can be changed to suit other workloads.
+///
+/// The top of the heap is the item which CompareT orders before all of
+/// the others, so the default VarHeapLess makes a min-heap (the
+/// earliest timer, the most urgent task, ...).
+///
+/// Every item pushed is given a 32 bit handle which remains valid
+/// until the item is popped or removed (after which the handle may be
+/// reused). The handle can be used to get, update (for example to
+/// decrease the key of) or remove the item in O(log n) time.
+///
+/// Like a VarArray, the items are copied and are never constructed nor
+/// destroyed, so ItemT should be a plain old data type.
+template<class ItemT, class CompareT = VarHeapLess<ItemT>, size_t Arity = 4>
+class VarHeap {
+
+  public:
+
+    /// \brief The handle of an item in the heap.
+    typedef uint32_t Handle;
+
+    /// \brief The handle (and position) used for "no item".
+    static const Handle noHandle = 0xFFFFFFFF;
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a VarHeap class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (Arity < 2)
+        throw AssertionFailure("heap arity less than two");
+      if (!nodes.invariant() || !positions.invariant() ||
+          !freeHandles.invariant())
+        throw AssertionFailure("heap arrays invalid");
+      if (positions.getNumItems() !=
+          nodes.getNumItems() + freeHandles.getNumItems())
+        throw AssertionFailure("handles lost");
+      return true;
+    }
+
+    /// \brief A (paranoid, O(n)) invariant which checks that every
+    /// item is ordered after its parent and that every handle maps to
+    /// the position of its item.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool heapInvariant(void) const {
+      invariant();
+      for (size_t i = 0; i < nodes.getNumItems(); i++) {
+        if (positions[nodes[i].handle] != i)
+          throw AssertionFailure("handle does not locate its item");
+        if (i && compare(nodes[i].item, nodes[(i - 1)/Arity].item))
+          throw AssertionFailure("item ordered before its parent");
+      }
+      for (size_t i = 0; i < freeHandles.getNumItems(); i++) {
+        if (positions[freeHandles[i]] != noHandle)
+          throw AssertionFailure("free handle still in use");
+      }
+      return true;
+    }
+
+    /// \brief Create an (empty) VarHeap which orders its items using
+    /// aCompare.
+    VarHeap(const CompareT &aCompare = CompareT()) : compare(aCompare) {
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy a VarHeap.
+    ~VarHeap(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+    }
+
+    /// \brief Return the current number of items in the heap.
+    size_t getNumItems(void) const {
+      return nodes.getNumItems();
+    }
+
+    bool isEmpty(void) const {
+      return 0 == nodes.getNumItems();
+    }
+
+    /// \brief Push a new item onto the heap, returning its handle.
+    Handle pushItem(ItemT anItem) {
+      ASSERT_INVARIANT(invariant());
+      Node aNode;
+      aNode.item   = anItem;
+      aNode.handle = newHandle();
+      reserveItems(nodes, nodes.getNumItems() + 1);
+      nodes.pushItem(aNode);
+      siftUp(nodes.getNumItems() - 1, aNode);
+      ASSERT_INVARIANT(invariant());
+      return aNode.handle;
+    }
+
+    /// \brief Push numItems items onto the heap at once.
+    ///
+    /// The whole heap is rebuilt in O(n) time (rather than O(m log n)
+    /// for m separate pushes), so this is the fastest way to build a
+    /// heap from bulk input. If someHandles is not NULL, the handles of
+    /// the items are stored in it.
+    void pushItems(const ItemT *someItems, size_t numItems,
+                   Handle *someHandles = NULL) {
+      ASSERT_INVARIANT(invariant());
+      reserveItems(nodes, nodes.getNumItems() + numItems);
+      reserveItems(positions, positions.getNumItems() + numItems);
+      for (size_t i = 0; i < numItems; i++) {
+        Node aNode;
+        aNode.item   = someItems[i];
+        aNode.handle = newHandle();
+        positions[aNode.handle] = (Handle)nodes.getNumItems();
+        nodes.pushItem(aNode);
+        if (someHandles) someHandles[i] = aNode.handle;
+      }
+      heapify();
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Push all of the items of someItems onto the heap at once
+    /// (see pushItems).
+    void pushItems(const VarArray<ItemT> &someItems) {
+      ASSERT_INVARIANT(invariant());
+      reserveItems(nodes, nodes.getNumItems() + someItems.getNumItems());
+      reserveItems(positions,
+                   positions.getNumItems() + someItems.getNumItems());
+      for (size_t i = 0; i < someItems.getNumItems(); i++) {
+        Node aNode;
+        aNode.item   = someItems[i];
+        aNode.handle = newHandle();
+        positions[aNode.handle] = (Handle)nodes.getNumItems();
+        nodes.pushItem(aNode);
+      }
+      heapify();
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Get the top item.
+    ItemT getTop(void) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(nodes.getNumItems());
+      return nodes[0].item;
+    }
+
+    /// \brief Get the handle of the top item.
+    Handle getTopHandle(void) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(nodes.getNumItems());
+      return nodes[0].handle;
+    }
+
+    /// \brief Remove and return the top item.
+    ItemT popItem(void) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(nodes.getNumItems()); // incorrectly matched push/pops
+      Node topNode  = nodes[0];
+      Node lastNode = nodes.popItem();
+      if (nodes.getNumItems()) siftDown(0, lastNode);
+      freeHandle(topNode.handle);
+      ASSERT_INVARIANT(invariant());
+      return topNode.item;
+    }
+
+    /// \brief Return true if aHandle is the handle of an item in the
+    /// heap.
+    bool contains(Handle aHandle) const {
+      return (aHandle < positions.getNumItems()) &&
+        (positions[aHandle] != noHandle);
+    }
+
+    /// \brief Get the item with this handle.
+    ItemT getItem(Handle aHandle) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT(contains(aHandle));
+      return nodes[positions[aHandle]].item;
+    }
+
+    /// \brief Replace the item with this handle by anItem, which MUST
+    /// NOT be ordered after the item it replaces (that is decrease the
+    /// key of a min-heap).
+    void decreaseItem(Handle aHandle, ItemT anItem) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT(contains(aHandle));
+      size_t position = positions[aHandle];
+      ASSERT_MESSAGE(!compare(nodes[position].item, anItem),
+                     "item would move down the heap");
+      Node aNode;
+      aNode.item   = anItem;
+      aNode.handle = aHandle;
+      siftUp(position, aNode);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Replace the item with this handle by anItem (which may
+    /// move the item either up or down the heap).
+    void updateItem(Handle aHandle, ItemT anItem) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT(contains(aHandle));
+      Node aNode;
+      aNode.item   = anItem;
+      aNode.handle = aHandle;
+      placeNode(positions[aHandle], aNode);
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Remove (and return) the item with this handle.
+    ItemT removeItem(Handle aHandle) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT(contains(aHandle));
+      size_t position = positions[aHandle];
+      ItemT anItem    = nodes[position].item;
+      Node lastNode   = nodes.popItem();
+      if (position < nodes.getNumItems()) placeNode(position, lastNode);
+      freeHandle(aHandle);
+      ASSERT_INVARIANT(invariant());
+      return anItem;
+    }
+
+    /// \brief Remove all items from this heap (invalidating all
+    /// handles).
+    void clearItems(void) {
+      nodes.clearItems();
+      positions.clearItems();
+      freeHandles.clearItems();
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this heap.
+    ///
+    /// The handle positions and free handles are overhead.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage nodeUsage     = nodes.memoryUsage();
+      MemoryUsage positionUsage = positions.memoryUsage();
+      MemoryUsage freeUsage     = freeHandles.memoryUsage();
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(VarHeap);
+      usage.numAllocations = nodeUsage.numAllocations +
+        positionUsage.numAllocations + freeUsage.numAllocations;
+      usage.bytesReserved  = nodeUsage.bytesReserved +
+        positionUsage.bytesReserved + freeUsage.bytesReserved;
+      usage.bytesUsed      = nodeUsage.bytesUsed;
+      usage.bytesOverhead  = positionUsage.bytesUsed + freeUsage.bytesUsed;
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief (Internal) An item together with its handle.
+    typedef struct Node {
+      ItemT  item;
+      Handle handle;
+    } Node;
+
+    /// \brief (Internal) Ensure that anArray can hold someItems items,
+    /// growing it geometrically (rather than by VarArrayIncrement).
+    template<class ArrayItemT>
+    static void reserveItems(VarArray<ArrayItemT> &anArray, size_t someItems) {
+      if (someItems <= anArray.getCapacity()) return;
+      size_t newCapacity = 2*anArray.getCapacity();
+      if (newCapacity < VarHeapMinCapacity) newCapacity = VarHeapMinCapacity;
+      if (newCapacity < someItems) newCapacity = someItems;
+      anArray.reserve(newCapacity);
+    }
+
+    /// \brief (Internal) Allocate a handle (whose position is not yet
+    /// known).
+    Handle newHandle(void) {
+      if (freeHandles.getNumItems()) return freeHandles.popItem();
+      ASSERT_MESSAGE(positions.getNumItems() < noHandle, "too many items");
+      reserveItems(positions, positions.getNumItems() + 1);
+      positions.pushItem(noHandle);
+      return (Handle)(positions.getNumItems() - 1);
+    }
+
+    /// \brief (Internal) Return aHandle to the free handles.
+    void freeHandle(Handle aHandle) {
+      positions[aHandle] = noHandle;
+      reserveItems(freeHandles, freeHandles.getNumItems() + 1);
+      freeHandles.pushItem(aHandle);
+    }
+
+    /// \brief (Internal) Put aNode at this position, moving it up or
+    /// down the heap as required.
+    void placeNode(size_t position, const Node &aNode) {
+      if (position && compare(aNode.item, nodes[(position - 1)/Arity].item)) {
+        siftUp(position, aNode);
+      } else {
+        siftDown(position, aNode);
+      }
+    }
+
+    /// \brief (Internal) Move aNode up from the (hole at this)
+    /// position until its parent is not ordered after it.
+    ///
+    /// The parents are moved down into the hole (rather than swapped),
+    /// so each level costs one copy.
+    void siftUp(size_t position, const Node &aNode) {
+      while (position) {
+        size_t parent = (position - 1)/Arity;
+        if (!compare(aNode.item, nodes[parent].item)) break;
+        nodes[position] = nodes[parent];
+        positions[nodes[position].handle] = (Handle)position;
+        position = parent;
+      }
+      nodes[position] = aNode;
+      positions[aNode.handle] = (Handle)position;
+    }
+
+    /// \brief (Internal) Move aNode down from the (hole at this)
+    /// position until none of its children are ordered before it.
+    void siftDown(size_t position, const Node &aNode) {
+      size_t numNodes = nodes.getNumItems();
+      while (true) {
+        size_t firstChild = position*Arity + 1;
+        if (numNodes <= firstChild) break;
+        size_t lastChild = firstChild + Arity;
+        if (numNodes < lastChild) lastChild = numNodes;
+        size_t bestChild = firstChild;
+        for (size_t child = firstChild + 1; child < lastChild; child++) {
+          if (compare(nodes[child].item, nodes[bestChild].item)) {
+            bestChild = child;
+          }
+        }
+        if (!compare(nodes[bestChild].item, aNode.item)) break;
+        nodes[position] = nodes[bestChild];
+        positions[nodes[position].handle] = (Handle)position;
+        position = bestChild;
+      }
+      nodes[position] = aNode;
+      positions[aNode.handle] = (Handle)position;
+    }
+
+    /// \brief (Internal) Restore the heap order of all of the nodes in
+    /// O(n) time by sifting down every parent, bottom up (Floyd's
+    /// method).
+    void heapify(void) {
+      size_t numNodes = nodes.getNumItems();
+      if (numNodes < 2) return;
+      for (size_t parent = (numNodes - 2)/Arity + 1; parent--; ) {
+        Node aNode = nodes[parent];
+        siftDown(parent, aNode);
+      }
+      ASSERT_EXPENSIVE(heapInvariant());
+    }
+
+    /// \brief The ordering of the items.
+    CompareT compare;
+
+    /// \brief The items (and their handles) in heap order.
+    VarArray<Node> nodes;
+
+    /// \brief The position (in the nodes) of the item with each handle
+    /// (or noHandle if the handle is free).
+    VarArray<Handle> positions;
+
+    /// \brief The handles which are free to be reused.
+    VarArray<Handle> freeHandles;
+
+  private:
+
+    /// \brief VarHeaps MUST NOT be copied.
+    VarHeap(const VarHeap &other);
+    void operator=(const VarHeap &other);
+};
+
+#endif
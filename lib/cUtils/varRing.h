@@ -0,0 +1,405 @@
+#ifndef VAR_RING_H
+#define VAR_RING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cUtils/assertions.h"
+#include "cUtils/memoryUsage.h"
+
+#ifndef VarRingMinCapacity
+#define VarRingMinCapacity 16
+#endif
+
+/// \brief The VarRing template class holds the information required
+/// to manage a variable (double ended) queue of identical objects.
+///
+/// The items are held in a ring buffer whose (power of two) capacity
+/// doubles whenever it is full, so items can be pushed and popped at
+/// either end in (amortized) O(1) time. Whenever the ring grows, its
+/// items are "unrolled" so that the front item is at the start of the
+/// new buffer.
+///
+/// Like a VarArray, the items are copied (using memcpy) when the ring
+/// grows and are never constructed nor destroyed, so ItemT should be a
+/// plain old data type.
+template<class ItemT>
+class VarRing {
+  public:
+
+    /// \brief An invariant which should ALWAYS be true for any
+    /// instance of a VarRing<ItemT> class.
+    ///
+    /// Throws an AssertionFailure with a brief description of any
+    /// inconsistencies discovered.
+    bool invariant(void) const {
+      if (capacity & (capacity - 1))
+        throw AssertionFailure("capacity not a power of two");
+      if (capacity < numItems)
+        throw AssertionFailure("too many items");
+      if (capacity && (capacity <= frontItem))
+        throw AssertionFailure("front item outside of the ring");
+      if (!itemArray && capacity)
+        throw AssertionFailure("no items array");
+      return true;
+    }
+
+    /// \brief Create an (empty) VarRing.
+    VarRing(void) {
+      itemArray = NULL;
+      capacity  = 0;
+      frontItem = 0;
+      numItems  = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Destroy a VarRing.
+    ~VarRing(void) {
+      ASSERT_INSIDE_DELETE(invariant());
+      if (itemArray) free(itemArray);
+      itemArray = NULL;
+      capacity  = 0;
+      frontItem = 0;
+      numItems  = 0;
+    }
+
+    /// \brief Return the current number of items in the ring.
+    size_t getNumItems(void) const {
+      return numItems;
+    }
+
+    /// \brief Return the number of items the ring can hold before it
+    /// must grow.
+    size_t getCapacity(void) const {
+      return capacity;
+    }
+
+    bool isEmpty(void) const {
+      return 0 == numItems;
+    }
+
+    /// \brief Push a new item onto the back of the ring.
+    void pushBack(ItemT anItem) {
+      ASSERT_INVARIANT(invariant());
+      if (capacity <= numItems) grow();
+      itemArray[(frontItem + numItems) & (capacity - 1)] = anItem;
+      numItems++;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Push a new item onto the front of the ring.
+    void pushFront(ItemT anItem) {
+      ASSERT_INVARIANT(invariant());
+      if (capacity <= numItems) grow();
+      frontItem = (frontItem - 1) & (capacity - 1);
+      itemArray[frontItem] = anItem;
+      numItems++;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Remove and return the front item of the ring.
+    ItemT popFront(void) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems); // incorrectly matched push/pops
+      ItemT anItem = itemArray[frontItem];
+      frontItem = (frontItem + 1) & (capacity - 1);
+      numItems--;
+      return anItem;
+    }
+
+    /// \brief Remove and return the back item of the ring.
+    ItemT popBack(void) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems); // incorrectly matched push/pops
+      numItems--;
+      return itemArray[(frontItem + numItems) & (capacity - 1)];
+    }
+
+    /// \brief Get the front item.
+    ItemT getFront(void) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems);
+      return itemArray[frontItem];
+    }
+
+    /// \brief Get the back item.
+    ItemT getBack(void) const {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(numItems);
+      return itemArray[(frontItem + numItems - 1) & (capacity - 1)];
+    }
+
+    /// \brief Get the requested item (counting from the front).
+    ///
+    /// Returns the default provided if the itemNumber is out of range.
+    ItemT getItem(size_t itemNumber, ItemT defaultItem) const {
+      ASSERT_INVARIANT(invariant());
+      if (numItems <= itemNumber) return defaultItem;
+      return itemArray[(frontItem + itemNumber) & (capacity - 1)];
+    }
+
+    /// \brief Get a reference to the requested item (counting from the
+    /// front) WITHOUT any range checking (outside of DEBUG builds).
+    ItemT &operator[](size_t itemNumber) const {
+      ASSERT(itemNumber < numItems);
+      return itemArray[(frontItem + itemNumber) & (capacity - 1)];
+    }
+
+    /// \brief Get the items as (at most) two contiguous spans, the
+    /// first starting with the front item.
+    ///
+    /// This allows batch consumers to process the items without
+    /// wrapping each index. Returns the number of items in the two
+    /// spans (that is getNumItems()).
+    size_t getSpans(ItemT *&firstSpan,  size_t &firstNumItems,
+                    ItemT *&secondSpan, size_t &secondNumItems) const {
+      ASSERT_INVARIANT(invariant());
+      firstSpan      = itemArray + frontItem;
+      firstNumItems  = numItems;
+      secondSpan     = itemArray;
+      secondNumItems = 0;
+      if (capacity < frontItem + numItems) {
+        firstNumItems  = capacity - frontItem;
+        secondNumItems = numItems - firstNumItems;
+      }
+      return numItems;
+    }
+
+    /// \brief Remove someItems items from the front of the ring (for
+    /// example once a batch consumer has processed them).
+    void dropFront(size_t someItems) {
+      ASSERT_INVARIANT(invariant());
+      ASSERT_CHEAP(someItems <= numItems);
+      if (!someItems) return;
+      frontItem = (frontItem + someItems) & (capacity - 1);
+      numItems -= someItems;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Remove all items from this ring.
+    void clearItems(void) {
+      frontItem = 0;
+      numItems  = 0;
+      ASSERT_INVARIANT(invariant());
+    }
+
+    /// \brief Report the memory used by this ring.
+    MemoryUsage memoryUsage(void) const {
+      ASSERT_INVARIANT(invariant());
+      MemoryUsage usage;
+      memset(&usage, 0, sizeof(MemoryUsage));
+      usage.objectBytes    = sizeof(VarRing<ItemT>);
+      usage.numAllocations = (itemArray ? 1 : 0);
+      usage.bytesReserved  = capacity*sizeof(ItemT);
+      usage.bytesUsed      = numItems*sizeof(ItemT);
+      finishMemoryUsage(usage);
+      return usage;
+    }
+
+  protected:
+
+    /// \brief Double the capacity of the ring, unrolling the items so
+    /// that the front item is at the start of the new items array.
+    void grow(void) {
+      size_t newCapacity = (capacity ? 2*capacity : VarRingMinCapacity);
+      ItemT *newArray = (ItemT*)calloc(newCapacity, sizeof(ItemT));
+      ASSERT(newArray);
+      if (itemArray) {
+        ItemT *firstSpan, *secondSpan;
+        size_t firstNumItems, secondNumItems;
+        getSpans(firstSpan, firstNumItems, secondSpan, secondNumItems);
+        memcpy(newArray, firstSpan, firstNumItems*sizeof(ItemT));
+        memcpy(newArray + firstNumItems, secondSpan,
+               secondNumItems*sizeof(ItemT));
+        free(itemArray);
+      }
+      itemArray = newArray;
+      capacity  = newCapacity;
+      frontItem = 0;
+    }
+
+    /// \brief The ring buffer of items.
+    ItemT *itemArray;
+
+    /// \brief The (power of two) number of items in the itemArray.
+    size_t capacity;
+
+    /// \brief The position (in the itemArray) of the front item.
+    size_t frontItem;
+
+    /// \brief The current number of items in the ring.
+    size_t numItems;
+
+  private:
+
+    /// \brief VarRings MUST NOT be copied (the items would be freed
+    /// twice).
+    VarRing(const VarRing &other);
+    void operator=(const VarRing &other);
+};
+
+/// \brief The size of the cache lines which the SpscRing keeps its
+/// producer and consumer positions on (separately).
+#ifndef SPSC_RING_CACHE_LINE_SIZE
+#define SPSC_RING_CACHE_LINE_SIZE 64
+#endif
+
+/// \brief The SpscRing template class holds the information required
+/// to pass items from a single producer thread to a single consumer
+/// thread without locks.
+///
+/// The ring has a fixed (power of two) capacity. Only the producer
+/// thread may call tryPush (and pushBatch), and only the consumer
+/// thread may call tryPop (and popBatch). Each thread owns one position
+/// (on its own cache line), publishing it with release semantics, and
+/// keeps a cached copy of the other thread's position so that the
+/// shared cache lines are only read when the ring appears full (or
+/// empty).
+///
+/// As for VarRing, ItemT should be a plain old data type.
+template<class ItemT>
+class SpscRing {
+  public:
+
+    /// \brief Create an (empty) SpscRing which can hold (at least)
+    /// minCapacity items.
+    SpscRing(size_t minCapacity) {
+      capacity = VarRingMinCapacity;
+      while (capacity < minCapacity) capacity *= 2;
+      itemArray = (ItemT*)calloc(capacity, sizeof(ItemT));
+      ASSERT(itemArray);
+      mask             = capacity - 1;
+      producer.next    = 0;
+      producer.cached  = 0;
+      consumer.next    = 0;
+      consumer.cached  = 0;
+    }
+
+    /// \brief Destroy an SpscRing (which MUST no longer be used by
+    /// either thread).
+    ~SpscRing(void) {
+      if (itemArray) free(itemArray);
+      itemArray = NULL;
+    }
+
+    /// \brief Return the (fixed) number of items the ring can hold.
+    size_t getCapacity(void) const {
+      return capacity;
+    }
+
+    /// \brief Return the number of items in the ring.
+    ///
+    /// This is only a snapshot if either thread is active.
+    size_t getNumItems(void) const {
+      uint64_t tail = __atomic_load_n(&producer.next, __ATOMIC_ACQUIRE);
+      uint64_t head = __atomic_load_n(&consumer.next, __ATOMIC_ACQUIRE);
+      return (size_t)(tail - head);
+    }
+
+    /// \brief (Producer) Push anItem onto the back of the ring.
+    ///
+    /// Returns false (and does not push the item) if the ring is full.
+    bool tryPush(const ItemT &anItem) {
+      uint64_t tail = producer.next;
+      if (tail - producer.cached == capacity) {
+        producer.cached = __atomic_load_n(&consumer.next, __ATOMIC_ACQUIRE);
+        if (tail - producer.cached == capacity) return false;
+      }
+      itemArray[tail & mask] = anItem;
+      __atomic_store_n(&producer.next, tail + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    /// \brief (Consumer) Pop the front item of the ring into anItem.
+    ///
+    /// Returns false (and leaves anItem unchanged) if the ring is
+    /// empty.
+    bool tryPop(ItemT &anItem) {
+      uint64_t head = consumer.next;
+      if (head == consumer.cached) {
+        consumer.cached = __atomic_load_n(&producer.next, __ATOMIC_ACQUIRE);
+        if (head == consumer.cached) return false;
+      }
+      anItem = itemArray[head & mask];
+      __atomic_store_n(&consumer.next, head + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    /// \brief (Producer) Push as many of the numItems someItems as will
+    /// fit, publishing them all at once.
+    ///
+    /// Returns the number of items pushed.
+    size_t pushBatch(const ItemT *someItems, size_t numItems) {
+      uint64_t tail = producer.next;
+      if (capacity - (tail - producer.cached) < numItems) {
+        producer.cached = __atomic_load_n(&consumer.next, __ATOMIC_ACQUIRE);
+      }
+      size_t numFree = capacity - (size_t)(tail - producer.cached);
+      if (numFree < numItems) numItems = numFree;
+      for (size_t i = 0; i < numItems; i++) {
+        itemArray[(tail + i) & mask] = someItems[i];
+      }
+      __atomic_store_n(&producer.next, tail + numItems, __ATOMIC_RELEASE);
+      return numItems;
+    }
+
+    /// \brief (Consumer) Pop up to maxItems items into someItems,
+    /// consuming them all at once.
+    ///
+    /// Returns the number of items popped.
+    size_t popBatch(ItemT *someItems, size_t maxItems) {
+      uint64_t head = consumer.next;
+      if (consumer.cached - head < maxItems) {
+        consumer.cached = __atomic_load_n(&producer.next, __ATOMIC_ACQUIRE);
+      }
+      size_t numItems = (size_t)(consumer.cached - head);
+      if (maxItems < numItems) numItems = maxItems;
+      for (size_t i = 0; i < numItems; i++) {
+        someItems[i] = itemArray[(head + i) & mask];
+      }
+      __atomic_store_n(&consumer.next, head + numItems, __ATOMIC_RELEASE);
+      return numItems;
+    }
+
+  protected:
+
+    /// \brief The position owned by one thread, together with that
+    /// thread's cached copy of the other thread's position.
+    typedef struct Position {
+      /// \brief The (ever increasing) number of the next item to be
+      /// pushed (producer) or popped (consumer).
+      uint64_t next;
+
+      /// \brief The last value read of the other thread's next.
+      uint64_t cached;
+
+      /// \brief Padding which keeps the positions of the two threads on
+      /// different cache lines.
+      char padding[SPSC_RING_CACHE_LINE_SIZE - 2*sizeof(uint64_t)];
+    } Position;
+
+    /// \brief The position of the producer.
+    Position producer;
+
+    /// \brief The position of the consumer.
+    Position consumer;
+
+    /// \brief The ring buffer of items.
+    ItemT *itemArray;
+
+    /// \brief The (power of two) number of items in the itemArray.
+    size_t capacity;
+
+    /// \brief The mask used to compute the position of an item.
+    size_t mask;
+
+  private:
+
+    /// \brief SpscRings MUST NOT be copied.
+    SpscRing(const SpscRing &other);
+    void operator=(const SpscRing &other);
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "cUtils/assertions.h"
+
+/// \brief The signature of a task to be run by a WorkerPool.
+///
+/// The taskNum ranges from 0 to numTasks-1 of the corresponding call
+/// to WorkerPool::runTasks.
+typedef void (*WorkerTaskFunc)(size_t taskNum, void *context);
+
+/// \brief The WorkerPool class holds the information required to
+/// manage a (persistent) pool of worker threads which run batches of
+/// numbered tasks.
+///
+/// The thread which calls runTasks also works on the batch of tasks,
+/// so a WorkerPool with numWorkers workers creates numWorkers-1
+/// threads.
+///
+/// Tasks MUST NOT throw exceptions (including AssertionFailures),
+/// since there is nowhere to rethrow them.
+///
+/// Any number of threads may share a WorkerPool (such as the default
+/// pool), their batches are simply run one after the other. A task
+/// which (itself) calls runTasks on the pool running it does not wait
+/// for the (busy) pool, instead the nested batch is run serially by
+/// the calling thread.
+class WorkerPool {
+  public:
+
+    /// \brief Create a new WorkerPool with aNumWorkers workers.
+    ///
+    /// If aNumWorkers is zero, the number of online processors is
+    /// used.
+    WorkerPool(size_t aNumWorkers = 0) {
+      numWorkers = aNumWorkers;
+      if (!numWorkers) {
+        long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+        numWorkers = (0 < numProcessors) ? numProcessors : 1;
+      }
+      pthread_mutex_init(&batchMutex, NULL);
+      pthread_mutex_init(&mutex, NULL);
+      pthread_cond_init(&workReady, NULL);
+      pthread_cond_init(&workDone, NULL);
+      batchNum       = 0;
+      numBusyThreads = 0;
+      shuttingDown   = false;
+      taskFunc       = NULL;
+      taskContext    = NULL;
+      numTasks       = 0;
+      nextTask       = 0;
+      numThreads     = 0;
+      threads = (pthread_t*)calloc(numWorkers, sizeof(pthread_t));
+      for (size_t i = 1; i < numWorkers; i++) {
+        if (pthread_create(&threads[numThreads], NULL, workerMain, this))
+          break;
+        numThreads++;
+      }
+    }
+
+    /// \brief Destroy the WorkerPool, waiting for all of its threads
+    /// to finish.
+    ~WorkerPool(void) {
+      pthread_mutex_lock(&mutex);
+      shuttingDown = true;
+      pthread_cond_broadcast(&workReady);
+      pthread_mutex_unlock(&mutex);
+      for (size_t i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+      }
+      free(threads);
+      threads    = NULL;
+      numThreads = 0;
+      pthread_cond_destroy(&workDone);
+      pthread_cond_destroy(&workReady);
+      pthread_mutex_destroy(&mutex);
+      pthread_mutex_destroy(&batchMutex);
+    }
+
+    /// \brief Return the number of workers (including the calling
+    /// thread) which work on each batch of tasks.
+    size_t getNumWorkers(void) const {
+      return numThreads + 1;
+    }
+
+    /// \brief Run aTaskFunc for each of the task numbers 0 to
+    /// someTasks-1 (in no particular order), returning only once ALL of
+    /// the tasks have completed.
+    ///
+    /// Only one batch of tasks is run at a time, a call made while
+    /// another thread's batch is running waits for that batch to
+    /// complete. A call made by a task of this pool runs the nested
+    /// batch serially (in the calling thread).
+    void runTasks(size_t someTasks,
+                  WorkerTaskFunc aTaskFunc,
+                  void *aContext) {
+      if (!someTasks) return;
+      if (getRunningPool() == this) {
+        for (size_t taskNum = 0; taskNum < someTasks; taskNum++) {
+          (*aTaskFunc)(taskNum, aContext);
+        }
+        return;
+      }
+      pthread_mutex_lock(&batchMutex);
+      pthread_mutex_lock(&mutex);
+      taskFunc       = aTaskFunc;
+      taskContext    = aContext;
+      numTasks       = someTasks;
+      nextTask       = 0;
+      numBusyThreads = numThreads;
+      batchNum++;
+      pthread_cond_broadcast(&workReady);
+      pthread_mutex_unlock(&mutex);
+
+      runBatch();
+
+      pthread_mutex_lock(&mutex);
+      while (numBusyThreads) pthread_cond_wait(&workDone, &mutex);
+      taskFunc    = NULL;
+      taskContext = NULL;
+      pthread_mutex_unlock(&mutex);
+      pthread_mutex_unlock(&batchMutex);
+    }
+
+    /// \brief (Internal) get a WorkerPool, shared by the whole
+    /// program, with one worker per online processor.
+    static WorkerPool *getDefault(void) {
+      static WorkerPool defaultPool;
+      return &defaultPool;
+    }
+
+  protected:
+
+    /// \brief (Internal) Return a reference to the pool whose tasks
+    /// the calling thread is running (or NULL).
+    static WorkerPool *&getRunningPool(void) {
+      static __thread WorkerPool *runningPool = NULL;
+      return runningPool;
+    }
+
+    /// \brief Run tasks from the current batch until there are none
+    /// left.
+    void runBatch(void) {
+      WorkerPool *outerPool = getRunningPool();
+      getRunningPool() = this;
+      while (true) {
+        size_t taskNum = __sync_fetch_and_add(&nextTask, 1);
+        if (numTasks <= taskNum) break;
+        (*taskFunc)(taskNum, taskContext);
+      }
+      getRunningPool() = outerPool;
+    }
+
+    /// \brief The main loop of each worker thread.
+    static void *workerMain(void *aPool) {
+      WorkerPool *pool = (WorkerPool*)aPool;
+      size_t lastBatchNum = 0;
+      while (true) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->shuttingDown && (pool->batchNum == lastBatchNum)) {
+          pthread_cond_wait(&pool->workReady, &pool->mutex);
+        }
+        if (pool->shuttingDown) {
+          pthread_mutex_unlock(&pool->mutex);
+          break;
+        }
+        lastBatchNum = pool->batchNum;
+        pthread_mutex_unlock(&pool->mutex);
+
+        pool->runBatch();
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->numBusyThreads--;
+        if (!pool->numBusyThreads) pthread_cond_signal(&pool->workDone);
+        pthread_mutex_unlock(&pool->mutex);
+      }
+      return NULL;
+    }
+
+    /// \brief The number of workers requested.
+    size_t numWorkers;
+
+    /// \brief The number of threads actually created.
+    size_t numThreads;
+
+    /// \brief The threads created.
+    pthread_t *threads;
+
+    /// \brief The mutex held (by the calling thread) for the whole of
+    /// each batch, so that batches are run one at a time.
+    pthread_mutex_t batchMutex;
+
+    /// \brief The mutex which protects the batch information.
+    pthread_mutex_t mutex;
+
+    /// \brief Signalled when a new batch of tasks is ready (or the pool
+    /// is shutting down).
+    pthread_cond_t workReady;
+
+    /// \brief Signalled when the last thread has finished the current
+    /// batch.
+    pthread_cond_t workDone;
+
+    /// \brief The number of the current batch of tasks.
+    size_t batchNum;
+
+    /// \brief The number of threads still working on the current
+    /// batch.
+    size_t numBusyThreads;
+
+    /// \brief True when the threads should exit.
+    bool shuttingDown;
+
+    /// \brief The function run for each task in the current batch.
+    WorkerTaskFunc taskFunc;
+
+    /// \brief The context passed to each task in the current batch.
+    void *taskContext;
+
+    /// \brief The number of tasks in the current batch.
+    size_t numTasks;
+
+    /// \brief The next task number to be run.
+    size_t nextTask;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/indexedBlockAllocator.h>
+
+/// \brief We test the correctness of the (opt-in) statistics of the
+/// BlockAllocator family.
+///
+/// Most of these specifications only make sense if the whole program
+/// has been compiled with CUTILS_ALLOCATOR_STATS defined, so they are
+/// run by the cUtilsInstrumentedTests runner (see tests/CMakeLists.txt).
+describe(AllocatorStats) {
+
+  specSize(AllocatorStats);
+
+  it("should always report the blocks reserved") {
+    BlockAllocator *blockAllocator = new BlockAllocator(10);
+    for (size_t j = 0; j < 25; j++) blockAllocator->allocateNewStructure(3);
+    AllocatorStats stats;
+    blockAllocator->getStats(stats);
+    shouldBeEqual(stats.blockSize, 10);
+    shouldBeEqual(stats.numBlocks, 9);
+    shouldBeEqual(stats.bytesReserved, 90);
+#ifdef CUTILS_ALLOCATOR_STATS
+    shouldBeTrue(stats.enabled);
+#else
+    shouldBeFalse(stats.enabled);
+    shouldBeZero(stats.numAllocations);
+#endif
+    delete blockAllocator;
+  } endIt();
+
+#ifdef CUTILS_ALLOCATOR_STATS
+  it("should count the allocations, bytes and tail waste") {
+    BlockAllocator *blockAllocator = new BlockAllocator(10);
+    for (size_t j = 0; j < 25; j++) blockAllocator->allocateNewStructure(3);
+    AllocatorStats stats;
+    blockAllocator->getStats(stats);
+    shouldBeEqual(stats.numAllocations, 25);
+    shouldBeEqual(stats.totalNumAllocations, 25);
+    shouldBeEqual(stats.bytesRequested, 75);
+    shouldBeEqual(stats.highWaterNumBlocks, 9);
+    shouldBeEqual(stats.highWaterBytesReserved, 90);
+    // each of the 8 filled blocks holds 3 structures and wastes 1 byte
+    shouldBeEqual(stats.tailWasteBytes, 8);
+    shouldBeEqual(stats.maxTailWasteBytes, 1);
+    delete blockAllocator;
+  } endIt();
+
+  it("should keep the high water marks and totals across clears") {
+    IndexedBlockAllocator *iba = new IndexedBlockAllocator(11, 4);
+    for (size_t i = 0; i < 100; i++) iba->allocateNewStructure();
+    iba->clearBlocks();
+    for (size_t i = 0; i < 10; i++) iba->allocateNewStructure();
+    AllocatorStats stats;
+    iba->getStats(stats);
+    shouldBeEqual(stats.numClears, 1);
+    shouldBeEqual(stats.numBlocks, 1);
+    shouldBeEqual(stats.highWaterNumBlocks, 7);
+    shouldBeEqual(stats.totalNumBlocks, 8);
+    shouldBeEqual(stats.numAllocations, 10);
+    shouldBeEqual(stats.totalNumAllocations, 110);
+    shouldBeEqual(stats.bytesRequested, 110);
+    shouldBeZero(stats.tailWasteBytes);
+    delete iba;
+  } endIt();
+#endif
+
+  it("should dump the statistics") {
+    IndexedBlockAllocator *iba = new IndexedBlockAllocator(11, 4);
+    for (size_t i = 0; i < 100; i++) iba->allocateNewStructure();
+    char  *dumpBuffer = NULL;
+    size_t dumpSize   = 0;
+    FILE *dumpFile = open_memstream(&dumpBuffer, &dumpSize);
+    shouldNotBeNULL(dumpFile);
+    iba->dumpStats(dumpFile, "iba");
+    fclose(dumpFile);
+    shouldNotBeNULL(strstr(dumpBuffer, "AllocatorStats: iba"));
+    shouldNotBeNULL(strstr(dumpBuffer, "blockSize = 176"));
+    free(dumpBuffer);
+    delete iba;
+  } endIt();
+
+} endDescribe(AllocatorStats);
@@ -0,0 +1,193 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/arrayKernels.h>
+#include <cUtils/workerPool.h>
+
+/// \brief (Internal) Fill someKeys with pseudo random keys.
+template<class KeyT>
+static void fillKernelTestKeys(KeyT *someKeys, size_t numKeys) {
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < numKeys; i++) {
+    state = state*6364136223846793005ULL + 1442695040888963407ULL;
+    someKeys[i] = (KeyT)(state >> 17);
+  }
+}
+
+/// \brief (Internal) Return true if the numKeys someKeys are in
+/// ascending order.
+template<class KeyT>
+static bool kernelTestKeysSorted(const KeyT *someKeys, size_t numKeys) {
+  for (size_t i = 1; i < numKeys; i++) {
+    if (someKeys[i] < someKeys[i - 1]) return false;
+  }
+  return true;
+}
+
+/// \brief (Internal) Compares the qsort way.
+static int compareKernelTestKeys(const void *aKey, const void *otherKey) {
+  uint32_t key = *(const uint32_t*)aKey;
+  uint32_t other = *(const uint32_t*)otherKey;
+  return (key < other) ? -1 : ((other < key) ? 1 : 0);
+}
+
+/// \brief We test the correctness of the sorting and searching kernels
+/// used by the VarArray.
+///
+describe(ArrayKernels) {
+
+  it("should sort using introsort, heap sort and merge sort") {
+    const size_t numKeys = 5000;
+    int keys[numKeys];
+    fillKernelTestKeys(keys, numKeys);
+    compareSortItems(keys, numKeys, ArrayLess<int>());
+    shouldBeTrue(kernelTestKeysSorted(keys, numKeys));
+    fillKernelTestKeys(keys, numKeys);
+    heapSortItems(keys, numKeys, ArrayLess<int>());
+    shouldBeTrue(kernelTestKeysSorted(keys, numKeys));
+    fillKernelTestKeys(keys, numKeys);
+    mergeSortItems(keys, numKeys, ArrayLess<int>());
+    shouldBeTrue(kernelTestKeysSorted(keys, numKeys));
+    // already sorted, reversed and constant inputs
+    for (size_t i = 0; i < numKeys; i++) keys[i] = numKeys - i;
+    compareSortItems(keys, numKeys, ArrayLess<int>());
+    shouldBeTrue(kernelTestKeysSorted(keys, numKeys));
+    compareSortItems(keys, numKeys, ArrayLess<int>());
+    shouldBeTrue(kernelTestKeysSorted(keys, numKeys));
+    for (size_t i = 0; i < numKeys; i++) keys[i] = 42;
+    compareSortItems(keys, numKeys, ArrayLess<int>());
+    shouldBeEqual(keys[numKeys - 1], 42);
+    compareSortItems(keys, 0, ArrayLess<int>());
+    mergeSortItems(keys, 1, ArrayLess<int>());
+  } endIt();
+
+  it("should radix sort signed and unsigned integers") {
+    const size_t numKeys = 5000;
+    int ints[numKeys];
+    fillKernelTestKeys(ints, numKeys);
+    ArrayKernelTraits<int>::sort(ints, numKeys);
+    shouldBeTrue(kernelTestKeysSorted(ints, numKeys));
+    shouldBeTrue(ints[0] < 0);
+    long long longs[numKeys];
+    fillKernelTestKeys(longs, numKeys);
+    for (size_t i = 0; i < numKeys; i += 2) longs[i] = -longs[i];
+    ArrayKernelTraits<long long>::sort(longs, numKeys);
+    shouldBeTrue(kernelTestKeysSorted(longs, numKeys));
+    unsigned char bytes[numKeys];
+    fillKernelTestKeys(bytes, numKeys);
+    ArrayKernelTraits<unsigned char>::stableSort(bytes, numKeys);
+    shouldBeTrue(kernelTestKeysSorted(bytes, numKeys));
+    short shorts[numKeys];
+    fillKernelTestKeys(shorts, numKeys);
+    ArrayKernelTraits<short>::sort(shorts, numKeys);
+    shouldBeTrue(kernelTestKeysSorted(shorts, numKeys));
+    // the passes over constant digits are skipped
+    uint64_t smallKeys[numKeys];
+    for (size_t i = 0; i < numKeys; i++) smallKeys[i] = (i*7919) % 256;
+    ArrayKernelTraits<uint64_t>::sort(smallKeys, numKeys);
+    shouldBeTrue(kernelTestKeysSorted(smallKeys, numKeys));
+  } endIt();
+
+  it("should radix sort in parallel") {
+    const size_t numKeys = 100000;
+    uint32_t *keys   = (uint32_t*)calloc(numKeys, sizeof(uint32_t));
+    uint32_t *copies = (uint32_t*)calloc(numKeys, sizeof(uint32_t));
+    fillKernelTestKeys(keys, numKeys);
+    memcpy(copies, keys, numKeys*sizeof(uint32_t));
+    WorkerPool pool(4);
+    radixSortItems(keys, numKeys, (uint32_t)0, &pool);
+    qsort(copies, numKeys, sizeof(uint32_t), compareKernelTestKeys);
+    shouldBeZero(memcmp(keys, copies, numKeys*sizeof(uint32_t)));
+    free(copies);
+    free(keys);
+  } endIt();
+
+  it("should find the lower bound of an item") {
+    uint32_t keys[7] = { 1, 3, 3, 3, 5, 7, 9 };
+    shouldBeZero(lowerBoundItem(keys, 0, 3U, ArrayLess<uint32_t>()));
+    shouldBeZero(lowerBoundItem(keys, 7, 0U, ArrayLess<uint32_t>()));
+    shouldBeZero(lowerBoundItem(keys, 7, 1U, ArrayLess<uint32_t>()));
+    shouldBeEqual(lowerBoundItem(keys, 7, 3U, ArrayLess<uint32_t>()), 1);
+    shouldBeEqual(lowerBoundItem(keys, 7, 4U, ArrayLess<uint32_t>()), 4);
+    shouldBeEqual(lowerBoundItem(keys, 7, 9U, ArrayLess<uint32_t>()), 6);
+    shouldBeEqual(lowerBoundItem(keys, 7, 10U, ArrayLess<uint32_t>()), 7);
+  } endIt();
+
+  it("should find and count integers of every width") {
+    uint8_t  bytes[100];
+    uint16_t shorts[100];
+    uint32_t ints[100];
+    uint64_t longs[100];
+    for (size_t i = 0; i < 100; i++) {
+      bytes[i] = shorts[i] = ints[i] = (uint32_t)(i % 50);
+      longs[i] = (i % 50) << 32;
+    }
+    for (size_t i = 0; i < 50; i++) {
+      shouldBeEqual(simdFindItem(bytes, 100, (uint8_t)i), i);
+      shouldBeEqual(simdFindItem(shorts, 100, (uint16_t)i), i);
+      shouldBeEqual(simdFindItem(ints, 100, (uint32_t)i), i);
+      shouldBeEqual(simdFindItem(longs, 100, ((uint64_t)i) << 32), i);
+      shouldBeEqual(simdCountItems(bytes, 100, (uint8_t)i), 2);
+      shouldBeEqual(simdCountItems(longs, 100, ((uint64_t)i) << 32), 2);
+      shouldBeEqual(simdFindItem(ints + 50, 50 - i, (uint32_t)i),
+                    scalarFindItem(ints + 50, 50 - i, (uint32_t)i));
+    }
+    // only one half of a 64 bit item matches
+    shouldBeEqual(simdFindItem(longs, 100, (uint64_t)1), 100);
+    shouldBeZero(simdCountItems(longs, 100, (uint64_t)1));
+  } endIt();
+
+  it("should sort and search 10^5 items like qsort and a scalar scan",
+     "[benchmark]") {
+    const size_t numKeys = 100000;
+    uint32_t *keys = (uint32_t*)calloc(numKeys, sizeof(uint32_t));
+    uint32_t *sorted = (uint32_t*)calloc(numKeys, sizeof(uint32_t));
+    uint32_t *copies = (uint32_t*)calloc(numKeys, sizeof(uint32_t));
+    fillKernelTestKeys(keys, numKeys);
+    benchmarkSamples("qsort<uint32_t> (10^5 items)", 5) {
+      memcpy(sorted, keys, numKeys*sizeof(uint32_t));
+      qsort(sorted, numKeys, sizeof(uint32_t), compareKernelTestKeys);
+    } endBenchmark();
+    shouldBeTrue(kernelTestKeysSorted(sorted, numKeys));
+    benchmarkSamples("radixSortItems<uint32_t> (10^5 items)", 5) {
+      memcpy(copies, keys, numKeys*sizeof(uint32_t));
+      radixSortItems(copies, numKeys, (uint32_t)0);
+    } endBenchmark();
+    shouldBeZero(memcmp(copies, sorted, numKeys*sizeof(uint32_t)));
+    benchmarkSamples("compareSortItems<uint32_t> (10^5 items)", 5) {
+      memcpy(copies, keys, numKeys*sizeof(uint32_t));
+      compareSortItems(copies, numKeys, ArrayLess<uint32_t>());
+    } endBenchmark();
+    shouldBeZero(memcmp(copies, sorted, numKeys*sizeof(uint32_t)));
+    uint32_t missing = 1;
+    while (scalarFindItem(keys, numKeys, missing) < numKeys) missing++;
+    uint32_t present = keys[numKeys - 1];
+    size_t presentPosition = scalarFindItem(keys, numKeys, present);
+    size_t simdPosition = 0;
+    size_t scalarPosition = 0;
+    benchmark("simdFindItem<uint32_t> (10^5 items)") {
+      simdPosition = simdFindItem(keys, numKeys, missing);
+      specDoNotOptimize(simdPosition);
+    } endBenchmark();
+    benchmark("scalarFindItem<uint32_t> (10^5 items)") {
+      scalarPosition = scalarFindItem(keys, numKeys, missing);
+      specDoNotOptimize(scalarPosition);
+    } endBenchmark();
+    shouldBeEqual(simdPosition, numKeys);
+    shouldBeEqual(scalarPosition, numKeys);
+    shouldBeEqual(simdFindItem(keys, numKeys, present), presentPosition);
+    free(copies);
+    free(sorted);
+    free(keys);
+  } endIt();
+
+} endDescribe(ArrayKernels);
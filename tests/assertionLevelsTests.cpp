@@ -0,0 +1,36 @@
+#include <cUtils/specs/specs.h>
+
+/// \brief (Internal) Return true if the statement throws an
+/// AssertionFailure.
+#define throwsAssertionFailure(statement, result)	\
+  result = false;					\
+  try { statement; } catch (AssertionFailure &af) { result = true; }
+
+describe(AssertionLevels) {
+
+  specUValue(CUTILS_ASSERT_LEVEL);
+
+  it("should only compile the assertions of the current level") {
+    bool cheapFailed     = false;
+    bool normalFailed    = false;
+    bool expensiveFailed = false;
+    bool cheapPassed     = true;
+    throwsAssertionFailure(ASSERT_CHEAP(1 == 2),     cheapFailed);
+    throwsAssertionFailure(ASSERT(1 == 2),           normalFailed);
+    throwsAssertionFailure(ASSERT_EXPENSIVE(1 == 2), expensiveFailed);
+    throwsAssertionFailure(ASSERT_CHEAP(1 == 1),     cheapPassed);
+    shouldBeEqual(cheapFailed,     (1 <= CUTILS_ASSERT_LEVEL));
+    shouldBeEqual(normalFailed,    (2 <= CUTILS_ASSERT_LEVEL));
+    shouldBeEqual(expensiveFailed, (3 <= CUTILS_ASSERT_LEVEL));
+    shouldBeFalse(cheapPassed);
+  } endIt();
+
+  it("should not evaluate the conditions of uncompiled assertions") {
+    size_t numEvaluations = 0;
+    ASSERT_CHEAP(++numEvaluations);
+    ASSERT(++numEvaluations);
+    ASSERT_EXPENSIVE(++numEvaluations);
+    shouldBeEqual(numEvaluations, CUTILS_ASSERT_LEVEL);
+  } endIt();
+
+} endDescribe(AssertionLevels);
@@ -0,0 +1,77 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cUtils/specs/specs.h>
+
+#if 2 <= CUTILS_ASSERT_LEVEL
+
+static void assertionsTestFailingFunction(int value) {
+  ASSERT_MESSAGE(value == 0, "value should be zero");
+}
+
+describe(AssertionFailure) {
+
+  specSize(AssertionFailure);
+
+  it("should record the message, location and recent call stack") {
+    bool caughtFailure = false;
+    try {
+      assertionsTestFailingFunction(1);
+    } catch (AssertionFailure &af) {
+      caughtFailure = true;
+      shouldBeEqual(af.message,
+                    "(value == 0) is false \"value should be zero\"");
+      shouldBeEqual(af.fileName, __FILE__);
+      shouldBeEqual(af.lineNumber, 10);
+      shouldNotBeZero(af.getNumFrames());
+      shouldBeTrue(af.getNumFrames() <= ASSERTION_FAILURE_MAX_FRAMES);
+    }
+    shouldBeTrue(caughtFailure);
+  } endIt();
+
+  it("should symbolize the recent call stack only when reported") {
+    bool caughtFailure = false;
+    try {
+      assertionsTestFailingFunction(2);
+    } catch (AssertionFailure &af) {
+      caughtFailure = true;
+      char frameName[1024];
+      af.getFrameName(0, frameName, 1024);
+      shouldNotBeZero(strlen(frameName));
+      af.getFrameName(af.getNumFrames(), frameName, 1024);
+      shouldBeZero(strlen(frameName));
+
+      char  *buffer     = NULL;
+      size_t bufferSize = 0;
+      FILE *reportFile = open_memstream(&buffer, &bufferSize);
+      af.printReport(reportFile, ">> ");
+      fclose(reportFile);
+      shouldBeEqual(strncmp(buffer, ">> (value == 0) is false", 24), 0);
+      shouldNotBeNULL(strstr(buffer, "\n>> Recent call stack:\n>>   "));
+      free(buffer);
+    }
+    shouldBeTrue(caughtFailure);
+  } endIt();
+
+  it("should be locatable when thrown without a location") {
+    bool caughtFailure = false;
+    try {
+      throw AssertionFailure("invariant failed");
+    } catch (AssertionFailure &af) {
+      caughtFailure = true;
+      shouldBeNULL((void*)af.fileName);
+      shouldBeZero(af.getNumFrames());
+      af.locate("someFile.cpp", 42);
+      shouldBeEqual(af.fileName, "someFile.cpp");
+      shouldBeEqual(af.lineNumber, 42);
+      shouldNotBeZero(af.getNumFrames());
+      af.locate("otherFile.cpp", 24);
+      shouldBeEqual(af.fileName, "someFile.cpp");
+    }
+    shouldBeTrue(caughtFailure);
+  } endIt();
+
+} endDescribe(AssertionFailure);
+
+#endif
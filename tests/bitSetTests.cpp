@@ -231,4 +231,85 @@ describe(BitSet) {
     delete bitSet;
   } endIt();
 
+  it("should keep distinct bits in the same item distinct") {
+    BitSet *bitSet = new BitSet();
+    shouldNotBeNULL(bitSet);
+    bitSet->setBit(1);
+    shouldBeTrue(bitSet->getBit(1));
+    shouldBeFalse(bitSet->getBit(33));
+    shouldBeFalse(bitSet->getBit(0));
+    bitSet->setBit(64+63);
+    shouldBeTrue(bitSet->getBit(64+63));
+    shouldBeFalse(bitSet->getBit(64+31));
+    shouldBeEqual(bitSet->numNonZero(), 2);
+    delete bitSet;
+  } endIt();
+
+  it("should be able to append many segments") {
+    BitSet *bitSet = new BitSet();
+    shouldNotBeNULL(bitSet);
+    for (size_t bitNum = 0; bitNum < 1000; bitNum += 64) {
+      bitSet->setBit(bitNum);
+    }
+    for (size_t bitNum = 0; bitNum < 1000; bitNum++) {
+      if (bitNum % 64) shouldBeFalse(bitSet->getBit(bitNum));
+      else             shouldBeTrue(bitSet->getBit(bitNum));
+    }
+    shouldBeEqual(bitSet->numNonZero(), 16);
+    delete bitSet;
+  } endIt();
+
+  it("should not read or write past the end of a segment") {
+    BitSet *bitSet = new BitSet();
+    shouldNotBeNULL(bitSet);
+    bitSet->setBit(0);
+    shouldBeFalse(bitSet->getBit(64));
+    bitSet->setBit(64);
+    shouldBeTrue(bitSet->getBit(0));
+    shouldBeTrue(bitSet->getBit(64));
+    shouldBeFalse(bitSet->getBit(128));
+    shouldBeEqual(bitSet->numNonZero(), 2);
+    delete bitSet;
+  } endIt();
+
+  it("should report its memory usage") {
+    BitSet bitSet;
+    MemoryUsage usage = bitSet.memoryUsage();
+    shouldBeEqual(usage.objectBytes, sizeof(BitSet));
+    shouldBeZero(usage.numAllocations);
+    shouldBeZero(usage.bytesReserved);
+    bitSet.setBit(0);
+    bitSet.setBit(1000);
+    bitSet.setBit(2000);
+    usage = bitSet.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 3);
+    shouldBeEqual(usage.bytesUsed, 3*sizeof(size_t));
+    shouldBeEqual(usage.bytesOverhead, 3*sizeof(BitSet::Segment));
+    shouldBeEqual(usage.bytesReserved, usage.bytesUsed + usage.bytesOverhead);
+    shouldBeZero(usage.bytesWasted);
+    shouldBeTrue(usage.fillRatio < 1.0);
+    specMemoryUsage(bitSet);
+  } endIt();
+
+  it("should get back exactly the bits it has set", "[benchmark]") {
+    BitSet *bitSet = new BitSet();
+    shouldNotBeNULL(bitSet);
+    bool wasSet[1000];
+    memset(wasSet, 0, sizeof(wasSet));
+    size_t bitNum = 0;
+    benchmark("BitSet::setBit") {
+      bitSet->setBit(bitNum);
+      wasSet[bitNum] = true;
+      bitNum = (bitNum + 7) % 1000;
+    } endBenchmark();
+    size_t numWrong = 0;
+    benchmark("BitSet::getBit") {
+      if ((bitSet->getBit(bitNum) != 0) != wasSet[bitNum]) numWrong++;
+      bitNum = (bitNum + 7) % 1000;
+      specDoNotOptimize(numWrong);
+    } endBenchmark();
+    shouldBeZero(numWrong);
+    delete bitSet;
+  } endIt();
+
 } endDescribe(BitSet);
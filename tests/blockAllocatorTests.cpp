@@ -91,6 +91,48 @@ describe(BlockAllocator) {
     delete blockAllocator;
   } endIt();
 
+  it("should report its memory usage") {
+    BlockAllocator *blockAllocator = new BlockAllocator(4096);
+    MemoryUsage usage = blockAllocator->memoryUsage();
+    shouldBeEqual(usage.objectBytes, sizeof(BlockAllocator));
+    shouldBeZero(usage.numAllocations);
+    shouldBeZero(usage.bytesReserved);
+    for (size_t i = 0; i < 3; i++) blockAllocator->allocateNewStructure(16);
+    usage = blockAllocator->memoryUsage();
+    size_t blockTableBytes = VarArrayIncrement*sizeof(char*);
+    shouldBeEqual(usage.numAllocations, 2);
+    shouldBeEqual(usage.bytesReserved, 4096 + blockTableBytes);
+    shouldBeEqual(usage.bytesUsed, 3*16);
+    shouldBeEqual(usage.bytesOverhead, blockTableBytes);
+    shouldBeEqual(usage.bytesWasted, 4096 - 3*16);
+    specMemoryUsage(*blockAllocator);
+    blockAllocator->clearBlocks();
+    usage = blockAllocator->memoryUsage();
+    shouldBeZero(usage.bytesUsed);
+    delete blockAllocator;
+  } endIt();
+
+  it("AllocateNewStructure should pack 1000 structures into 4 blocks",
+     "[benchmark]") {
+    BlockAllocator *blockAllocator = new BlockAllocator(4096);
+    size_t numNewBlocks = 0;
+    benchmark("BlockAllocator::allocateNewStructure(16) (1000 structures)") {
+      blockAllocator->clearBlocks();
+      char *prevStructure = NULL;
+      numNewBlocks = 0;
+      for (size_t j = 0; j < 1000; j++) {
+        char *aStructure = blockAllocator->allocateNewStructure(16);
+        if (!prevStructure || aStructure != prevStructure + 16)
+          numNewBlocks++;
+        prevStructure = aStructure;
+      }
+      specDoNotOptimize(prevStructure);
+    } endBenchmark();
+    shouldBeEqual(numNewBlocks, 4);
+    shouldBeEqual(blockAllocator->blocks.getNumItems(), 4);
+    delete blockAllocator;
+  } endIt();
+
 } endDescribe(BlockAllocator);
 
 //static int somethingSilly = SpecRunner::registerRunner(runBlockAllocator);
@@ -0,0 +1,175 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/blockSource.h>
+#include <cUtils/indexedBlockAllocator.h>
+
+/// \brief (Test) An MmapBlockSource which records the order of the
+/// system calls made for each block (while still making them).
+class OrderedMmapBlockSource : public MmapBlockSource {
+public:
+  OrderedMmapBlockSource(int someOptions, int aNumaNode)
+    : MmapBlockSource(someOptions, aNumaNode) {
+    callOrder[0] = 0;
+    numCalls     = 0;
+  }
+
+  void recordCall(char aCall) {
+    if (numCalls < sizeof(callOrder) - 1) {
+      callOrder[numCalls++] = aCall;
+      callOrder[numCalls]   = 0;
+    }
+  }
+
+  virtual void *mapMemory(size_t mappedSize, int flags) {
+    recordCall((flags & MAP_POPULATE) ? 'P' : 'm');
+    return MmapBlockSource::mapMemory(mappedSize, flags);
+  }
+  virtual void adviseHugePages(void *aBlock, size_t mappedSize) {
+    recordCall('a');
+    MmapBlockSource::adviseHugePages(aBlock, mappedSize);
+  }
+  virtual void bindToNumaNode(void *aBlock, size_t mappedSize) {
+    recordCall('b');
+    MmapBlockSource::bindToNumaNode(aBlock, mappedSize);
+  }
+  virtual void prefault(void *aBlock, size_t mappedSize) {
+    recordCall('p');
+    MmapBlockSource::prefault(aBlock, mappedSize);
+  }
+
+  char   callOrder[16];
+  size_t numCalls;
+};
+
+/// \brief (Test) A BlockSource which can not allocate any blocks.
+class FailingBlockSource : public BlockSource {
+public:
+  virtual char *allocateBlock(size_t /* blockSize */) { return NULL; }
+};
+
+/// \brief We test the correctness of the BlockSource classes.
+///
+describe(BlockSource) {
+
+  specSize(BlockSource);
+  specSize(MmapBlockSource);
+
+  it("the default BlockSource should allocate zeroed blocks") {
+    BlockSource *blockSource = BlockSource::getDefault();
+    shouldNotBeNULL(blockSource);
+    shouldBeEqual(blockSource, BlockSource::getDefault());
+    char *aBlock = blockSource->allocateBlock(100);
+    shouldNotBeNULL(aBlock);
+    for (size_t i = 0; i < 100; i++) shouldBeZero(aBlock[i]);
+    blockSource->freeBlock(aBlock, 100);
+  } endIt();
+
+  it("a BlockAllocator should use the default BlockSource") {
+    BlockAllocator *blockAllocator = new BlockAllocator(10);
+    shouldNotBeNULL(blockAllocator);
+    shouldBeEqual(blockAllocator->blockSource, BlockSource::getDefault());
+    delete blockAllocator;
+  } endIt();
+
+  it("an MmapBlockSource should round blocks up to whole pages") {
+    MmapBlockSource blockSource;
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    shouldBeEqual(blockSource.getMappedSize(1), pageSize);
+    shouldBeEqual(blockSource.getMappedSize(pageSize), pageSize);
+    shouldBeEqual(blockSource.getMappedSize(pageSize+1), 2*pageSize);
+  } endIt();
+
+  it("an MmapBlockSource should only round large blocks up to huge pages") {
+    MmapBlockSource hugeBlockSource(MmapBlockSource::AdviseHugePages);
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    shouldBeEqual(hugeBlockSource.getMappedSize(176), pageSize);
+    shouldBeFalse(hugeBlockSource.usesHugePages(176));
+    shouldBeTrue(hugeBlockSource.usesHugePages(BlockSourceHugePageSize));
+    shouldBeEqual(hugeBlockSource.getMappedSize(BlockSourceHugePageSize),
+                  BlockSourceHugePageSize);
+    shouldBeEqual(hugeBlockSource.getMappedSize(BlockSourceHugePageSize+1),
+                  2*BlockSourceHugePageSize);
+  } endIt();
+
+  it("an MmapBlockSource should allocate zeroed writable blocks") {
+    MmapBlockSource blockSource(MmapBlockSource::Populate);
+    char *aBlock = blockSource.allocateBlock(10000);
+    shouldNotBeNULL(aBlock);
+    for (size_t i = 0; i < 10000; i++) shouldBeZero(aBlock[i]);
+    memset(aBlock, 0xAB, 10000);
+    blockSource.freeBlock(aBlock, 10000);
+  } endIt();
+
+  it("an MmapBlockSource should prefault a block only once it is advised and bound") {
+    OrderedMmapBlockSource blockSource(MmapBlockSource::AdviseHugePages |
+                                       MmapBlockSource::Populate, 0);
+    char *aBlock = blockSource.allocateBlock(BlockSourceHugePageSize);
+    shouldNotBeNULL(aBlock);
+    shouldBeEqual(blockSource.callOrder, "mabp");
+    shouldBeZero(aBlock[BlockSourceHugePageSize-1]);
+    blockSource.freeBlock(aBlock, BlockSourceHugePageSize);
+    // small blocks are neither advised nor populated by mmap
+    blockSource.numCalls = 0;
+    aBlock = blockSource.allocateBlock(100);
+    shouldNotBeNULL(aBlock);
+    shouldBeEqual(blockSource.callOrder, "mbp");
+    blockSource.freeBlock(aBlock, 100);
+  } endIt();
+
+  it("an MmapBlockSource should fall back when no huge pages are reserved") {
+    MmapBlockSource blockSource(MmapBlockSource::UseHugeTLB, 0);
+    char *aBlock = blockSource.allocateBlock(BlockSourceHugePageSize);
+    shouldNotBeNULL(aBlock);
+    aBlock[0] = 1;
+    aBlock[BlockSourceHugePageSize-1] = 1;
+    blockSource.freeBlock(aBlock, BlockSourceHugePageSize);
+  } endIt();
+
+  it("an IndexedBlockAllocator can allocate from an MmapBlockSource") {
+    MmapBlockSource blockSource(MmapBlockSource::AdviseHugePages);
+    IndexedBlockAllocator *iba =
+      new IndexedBlockAllocator(11, 4, &blockSource);
+    shouldNotBeNULL(iba);
+    shouldBeEqual(iba->blockSource, &blockSource);
+    for (size_t i = 0; i < 100; i++) {
+      size_t itemNum = iba->allocateNewStructure();
+      shouldBeEqual(itemNum, i);
+      char *itemPtr = iba->getItemPtr(itemNum);
+      shouldNotBeNULL(itemPtr);
+      shouldBeZero(itemPtr[0]);
+      memset(itemPtr, 0x5A, 11);
+    }
+    shouldBeEqual(iba->blocks.getNumItems(), 7);
+    iba->clearBlocks();
+    shouldBeZero(iba->blocks.getNumItems());
+    delete iba;
+  } endIt();
+
+  it("a BlockAllocator should fail cleanly when no block can be allocated") {
+    FailingBlockSource blockSource;
+    BlockAllocator *blockAllocator = new BlockAllocator(100, &blockSource);
+    bool caughtFailedBlock = false;
+    try {
+      blockAllocator->allocateNewStructure(10);
+    } catch (AssertionFailure &af) {
+      caughtFailedBlock = true;
+    }
+    shouldBeTrue(caughtFailedBlock);
+    shouldBeTrue(blockAllocator->isEmpty());
+    shouldBeZero(blockAllocator->blocks.getNumItems());
+    shouldBeNULL(blockAllocator->curAllocationByte);
+    shouldBeNULL(blockAllocator->endAllocationByte);
+    shouldBeTrue(blockAllocator->invariant());
+    delete blockAllocator;
+  } endIt();
+
+} endDescribe(BlockSource);
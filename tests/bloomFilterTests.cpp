@@ -0,0 +1,152 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/bloomFilter.h>
+#include <cUtils/varArray.h>
+
+/// \brief We test the correctness of the C-based BloomFilter structure.
+///
+describe(BloomFilter) {
+
+  specSize(BloomFilter<uint64_t>);
+
+  it("should create an empty BloomFilter") {
+    BloomFilter<uint64_t> *aFilter = new BloomFilter<uint64_t>(1000);
+    shouldNotBeNULL(aFilter);
+    // 1000 items of 12 bits in blocks of 512 bits
+    shouldBeEqual(aFilter->getNumBlocks(), 24);
+    shouldBeEqual(aFilter->getNumBits(), 24*512);
+    shouldBeZero(((uintptr_t)aFilter->blocks) % 64);
+    for (uint64_t key = 0; key < 1000; key++) {
+      shouldBeFalse(aFilter->mayContain(key));
+    }
+    delete aFilter;
+    BloomFilter<uint64_t> tinyFilter(0);
+    shouldBeEqual(tinyFilter.getNumBlocks(), 1);
+  } endIt();
+
+  it("should set exactly one bit in each lane of one block") {
+    BloomFilter<uint64_t> aFilter(1000);
+    aFilter.insertKey(42);
+    size_t numSetBlocks = 0;
+    for (size_t blockNum = 0; blockNum < aFilter.getNumBlocks(); blockNum++) {
+      uint64_t *block = aFilter.blocks + blockNum*8;
+      if (!block[0]) continue;
+      numSetBlocks++;
+      for (size_t laneNum = 0; laneNum < 8; laneNum++) {
+        shouldBeEqual(__builtin_popcountll(block[laneNum]), 1);
+      }
+    }
+    shouldBeEqual(numSetBlocks, 1);
+    shouldBeTrue(aFilter.mayContain(42));
+  } endIt();
+
+  it("should contain every inserted key and few others") {
+    size_t numKeys = 100000;
+    BloomFilter<uint64_t> aFilter(numKeys);
+    for (uint64_t key = 0; key < numKeys; key++) aFilter.insertKey(key*3);
+    for (uint64_t key = 0; key < numKeys; key++) {
+      shouldBeTrue(aFilter.mayContain(key*3));
+    }
+    size_t numFalsePositives = 0;
+    for (uint64_t key = 0; key < numKeys; key++) {
+      if (aFilter.mayContain(key*3 + 1)) numFalsePositives++;
+    }
+    // about 0.5% are expected at 12 bits per item
+    shouldBeTrue(numFalsePositives < numKeys/100);
+  } endIt();
+
+  it("should insert and query batches of keys") {
+    VarArray<uint64_t> someKeys;
+    for (uint64_t key = 0; key < 1000; key++) someKeys.pushItem(key*7 + 5);
+    BloomFilter<uint64_t> aFilter(1000);
+    aFilter.insertKeys(&someKeys[0], 1000);
+    bool results[1000];
+    shouldBeEqual(aFilter.mayContainKeys(&someKeys[0], 1000, results), 1000);
+    for (size_t i = 0; i < 1000; i++) shouldBeTrue(results[i]);
+    for (size_t i = 0; i < 1000; i++) someKeys[i] = someKeys[i] + 1;
+    size_t numFound = aFilter.mayContainKeys(&someKeys[0], 1000, results);
+    for (size_t i = 0; i < 1000; i++) {
+      shouldBeEqual(results[i], aFilter.mayContain(someKeys[i]));
+    }
+    shouldBeTrue(numFound < 50);
+    shouldBeZero(aFilter.mayContainKeys(&someKeys[0], 0));
+  } endIt();
+
+  it("should union two filters of the same size") {
+    BloomFilter<uint64_t> aFilter(1000);
+    BloomFilter<uint64_t> otherFilter(1000);
+    BloomFilter<uint64_t> largerFilter(2000);
+    for (uint64_t key = 0; key < 500; key++) {
+      aFilter.insertKey(key);
+      otherFilter.insertKey(key + 500);
+    }
+    shouldBeFalse(aFilter.unionWith(largerFilter));
+    shouldBeTrue(aFilter.unionWith(otherFilter));
+    for (uint64_t key = 0; key < 1000; key++) {
+      shouldBeTrue(aFilter.mayContain(key));
+    }
+    aFilter.clearKeys();
+    shouldBeFalse(aFilter.mayContain(1));
+  } endIt();
+
+  it("should hash strings by their contents") {
+    BloomFilter<const char*> aFilter(10);
+    char aString[] = "hello";
+    aFilter.insertKey(aString);
+    shouldBeTrue(aFilter.mayContain("hello"));
+  } endIt();
+
+  it("should report its memory usage") {
+    BloomFilter<uint64_t> aFilter(1000);
+    MemoryUsage usage = aFilter.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 1);
+    shouldBeEqual(usage.bytesReserved, 24*64);
+    shouldBeEqual(usage.bytesUsed, 24*64);
+    specMemoryUsage(aFilter);
+  } endIt();
+
+  it("should give the same answers for batches as for single keys",
+     "[benchmark]") {
+    size_t numKeys = 1 << 20;
+    VarArray<uint64_t> someKeys;
+    someKeys.reserve(numKeys);
+    for (uint64_t key = 0; key < numKeys; key++) someKeys.pushItem(key);
+    BloomFilter<uint64_t> aFilter(numKeys*8);
+    aFilter.insertKeys(&someKeys[0], numKeys);
+    size_t singleFound = 0;
+    benchmark("BloomFilter mayContain (2^20 keys)") {
+      size_t numFound = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        if (aFilter.mayContain(someKeys[i])) numFound++;
+      }
+      singleFound = numFound;
+      specDoNotOptimize(singleFound);
+    } endBenchmark();
+    size_t batchFound = 0;
+    benchmark("BloomFilter mayContainKeys (2^20 keys)") {
+      batchFound = aFilter.mayContainKeys(&someKeys[0], numKeys);
+      specDoNotOptimize(batchFound);
+    } endBenchmark();
+    shouldBeEqual(singleFound, numKeys);
+    shouldBeEqual(batchFound, numKeys);
+    // the (few) false positives of absent keys should also agree
+    size_t singleFalse = 0;
+    for (size_t i = 0; i < numKeys; i++) {
+      someKeys[i] += numKeys;
+      if (aFilter.mayContain(someKeys[i])) singleFalse++;
+    }
+    shouldBeEqual(aFilter.mayContainKeys(&someKeys[0], numKeys), singleFalse);
+    shouldBeTrue(singleFalse < numKeys/100);
+  } endIt();
+
+} endDescribe(BloomFilter);
@@ -0,0 +1,94 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/bloomFilter.h>
+
+/// \brief We test the correctness of the C-based CountingBloomFilter
+/// structure.
+///
+describe(CountingBloomFilter) {
+
+  specSize(CountingBloomFilter<uint64_t>);
+
+  it("should create an empty CountingBloomFilter") {
+    CountingBloomFilter<uint64_t> *aFilter =
+      new CountingBloomFilter<uint64_t>(1000);
+    shouldNotBeNULL(aFilter);
+    // 1000 items of 12 counters in blocks of 128 counters
+    shouldBeEqual(aFilter->getNumBlocks(), 94);
+    shouldBeEqual(aFilter->getNumCounters(), 94*128);
+    shouldBeFalse(aFilter->mayContain(1));
+    shouldBeFalse(aFilter->removeKey(1));
+    delete aFilter;
+  } endIt();
+
+  it("should insert and remove keys") {
+    size_t numKeys = 10000;
+    CountingBloomFilter<uint64_t> aFilter(numKeys);
+    for (uint64_t key = 0; key < numKeys; key++) aFilter.insertKey(key);
+    for (uint64_t key = 0; key < numKeys; key++) {
+      shouldBeTrue(aFilter.mayContain(key));
+    }
+    // remove the even keys, the odd keys must remain
+    for (uint64_t key = 0; key < numKeys; key += 2) {
+      shouldBeTrue(aFilter.removeKey(key));
+    }
+    size_t numFalsePositives = 0;
+    for (uint64_t key = 0; key < numKeys; key++) {
+      if (key & 1) shouldBeTrue(aFilter.mayContain(key));
+      else if (aFilter.mayContain(key)) numFalsePositives++;
+    }
+    shouldBeTrue(numFalsePositives < numKeys/100);
+    for (uint64_t key = 1; key < numKeys; key += 2) aFilter.removeKey(key);
+    for (size_t i = 0; i < aFilter.getNumBlocks()*8; i++) {
+      shouldBeZero(aFilter.blocks[i]);
+    }
+  } endIt();
+
+  it("should count repeated insertions of a key") {
+    CountingBloomFilter<uint64_t> aFilter(100);
+    aFilter.insertKey(7);
+    aFilter.insertKey(7);
+    aFilter.removeKey(7);
+    shouldBeTrue(aFilter.mayContain(7));
+    aFilter.removeKey(7);
+    shouldBeFalse(aFilter.mayContain(7));
+  } endIt();
+
+  it("should never decrement a saturated counter") {
+    CountingBloomFilter<uint64_t> aFilter(100);
+    for (size_t i = 0; i < 20; i++) aFilter.insertKey(7);
+    for (size_t i = 0; i < 20; i++) shouldBeTrue(aFilter.removeKey(7));
+    shouldBeTrue(aFilter.mayContain(7));
+    aFilter.clearKeys();
+    shouldBeFalse(aFilter.mayContain(7));
+  } endIt();
+
+  it("should insert and query batches of keys") {
+    uint64_t someKeys[100];
+    for (uint64_t i = 0; i < 100; i++) someKeys[i] = i*i;
+    CountingBloomFilter<uint64_t> aFilter(100);
+    aFilter.insertKeys(someKeys, 100);
+    bool results[100];
+    shouldBeEqual(aFilter.mayContainKeys(someKeys, 100, results), 100);
+    for (size_t i = 0; i < 100; i++) shouldBeTrue(results[i]);
+  } endIt();
+
+  it("should report its memory usage") {
+    CountingBloomFilter<uint64_t> aFilter(1000);
+    MemoryUsage usage = aFilter.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 1);
+    shouldBeEqual(usage.bytesReserved, 94*64);
+    specMemoryUsage(aFilter);
+  } endIt();
+
+} endDescribe(CountingBloomFilter);
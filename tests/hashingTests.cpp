@@ -0,0 +1,44 @@
+#include <string.h>
+#include <stdio.h>
+
+#include <cUtils/specs/specs.h>
+#include <cUtils/hashing.h>
+
+/// \brief We test the hash functions used by the hashed containers.
+///
+describe(Hashing) {
+
+  it("should mix every bit of a value") {
+    shouldBeZero(hashMix64(0));
+    shouldNotBeEqual(hashMix64(1), hashMix64(2));
+    uint64_t hash = hashMix64(1);
+    for (size_t bitNum = 0; bitNum < 64; bitNum++) {
+      uint64_t otherHash = hashMix64(((uint64_t)1) | (((uint64_t)1) << bitNum));
+      if (!bitNum) continue;
+      shouldBeTrue(16 < __builtin_popcountll(hash ^ otherHash));
+    }
+  } endIt();
+
+  it("should hash bytes by their contents") {
+    char aString[]     = "a string which is longer than eight bytes";
+    char otherString[] = "a string which is longer than eight bytes";
+    shouldBeEqual(hashBytes(aString, strlen(aString)),
+                  hashBytes(otherString, strlen(otherString)));
+    shouldBeEqual(hashString(aString), hashString(otherString));
+    otherString[strlen(otherString)-1] = 'S';
+    shouldNotBeEqual(hashString(aString), hashString(otherString));
+    shouldNotBeEqual(hashBytes(aString, 8), hashBytes(aString, 9));
+    shouldNotBeEqual(hashBytes(aString, 8), hashBytes(aString, 8, 1));
+    shouldNotBeEqual(hashBytes("", 0), hashBytes("\0", 1));
+  } endIt();
+
+  it("should provide the HashTraits of integers and strings") {
+    shouldBeEqual(HashTraits<size_t>::hash(42), hashMix64(42));
+    shouldBeTrue(HashTraits<int>::equal(3, 3));
+    shouldBeEqual(HashTraits<const char*>::hash("abc"), hashString("abc"));
+    char aString[] = "abc";
+    shouldBeTrue(HashTraits<const char*>::equal(aString, "abc"));
+    shouldBeFalse(HashTraits<const char*>::equal(aString, "abd"));
+  } endIt();
+
+} endDescribe(Hashing);
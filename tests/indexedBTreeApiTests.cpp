@@ -0,0 +1,50 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+// Unlike the other specs, these specs do NOT define protected as public,
+// so that they only compile if the IndexedBTree uses nothing but the
+// public interface of the containers it is built upon.
+
+#include <cUtils/indexedBTree.h>
+
+/// \brief (Internal) A tree with small nodes, so that a bulk load
+/// builds several levels of inner nodes.
+typedef IndexedBTree<uint32_t, uint32_t, ArrayLess<uint32_t>, 64> ApiBTree;
+
+/// \brief We test the IndexedBTree using only its public interface.
+///
+describe(IndexedBTreeApi) {
+
+  it("should bulk load several levels using only public interfaces") {
+    VarArray<ApiBTree::Entry> someEntries;
+    someEntries.reserve(5000);
+    for (uint32_t i = 0; i < 5000; i++) {
+      ApiBTree::Entry anEntry = { 2*i, i };
+      someEntries.pushItem(anEntry);
+    }
+    ApiBTree tree;
+    shouldBeTrue(tree.loadSorted(someEntries));
+    shouldBeTrue(2 < tree.getHeight());
+    shouldBeTrue(tree.treeInvariant());
+    shouldBeEqual(tree.getNumItems(), 5000);
+    ApiBTree::Iterator iterator = tree.getIterator();
+    uint32_t aKey   = 0;
+    uint32_t aValue = 0;
+    size_t numVisited = 0;
+    while (iterator.nextItem(aKey, aValue)) {
+      shouldBeEqual(aKey, 2*numVisited);
+      shouldBeEqual(aValue, numVisited);
+      numVisited++;
+    }
+    shouldBeEqual(numVisited, 5000);
+    shouldBeTrue(tree.insert(3, 42));
+    shouldBeEqual(*tree.find(3), 42);
+    shouldBeTrue(tree.erase(4));
+    shouldBeFalse(tree.contains(4));
+  } endIt();
+
+} endDescribe(IndexedBTreeApi);
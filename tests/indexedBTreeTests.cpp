@@ -0,0 +1,245 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+#include <map>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/indexedBTree.h>
+
+typedef IndexedBTree<uint64_t, uint64_t> Uint64BTree;
+
+/// \brief (Internal) A tree with the smallest nodes, so that every
+/// split path is exercised by a few items.
+typedef IndexedBTree<uint64_t, uint64_t, ArrayLess<uint64_t>, 64> SmallBTree;
+
+/// \brief (Internal) Sums the keys and values visited.
+class BTreeSumVisitor {
+public:
+  BTreeSumVisitor(void) : keySum(0), valueSum(0), numVisited(0) { }
+
+  void operator()(const uint64_t &aKey, uint64_t &aValue) {
+    keySum   += aKey;
+    valueSum += aValue;
+    numVisited++;
+  }
+
+  uint64_t keySum;
+  uint64_t valueSum;
+  size_t   numVisited;
+};
+
+/// \brief (Internal) A simple pseudo random sequence for the tests.
+static uint64_t bTreeTestRandom(uint64_t &aState) {
+  aState ^= aState << 13;
+  aState ^= aState >> 7;
+  aState ^= aState << 17;
+  return aState;
+}
+
+/// \brief We test the correctness of the C-based IndexedBTree
+/// structure.
+///
+describe(IndexedBTree) {
+
+  specSize(Uint64BTree);
+  specSize(Uint64BTree::Node);
+
+  it("should create an empty IndexedBTree") {
+    Uint64BTree *tree = new Uint64BTree();
+    shouldNotBeNULL(tree);
+    shouldBeZero(tree->getNumItems());
+    shouldBeZero(tree->getHeight());
+    shouldBeNULL(tree->find(1));
+    shouldBeFalse(tree->erase(1));
+    shouldBeFalse(tree->getIterator().hasMoreItems());
+    shouldBeFalse(tree->getIteratorFrom(1).hasMoreItems());
+    shouldBeTrue(tree->treeInvariant());
+    // a node should fit in 256 bytes
+    shouldBeEqual(Uint64BTree::nodeKeys, 15);
+    shouldBeTrue(sizeof(Uint64BTree::Node) <= 256);
+    delete tree;
+  } endIt();
+
+  it("should insert, find and update items") {
+    SmallBTree tree;
+    for (uint64_t i = 0; i < 1000; i++) {
+      shouldBeTrue(tree.insert(i*2, i));
+    }
+    shouldBeEqual(tree.getNumItems(), 1000);
+    shouldBeTrue(3 < tree.getHeight());
+    shouldBeTrue(tree.treeInvariant());
+    for (uint64_t i = 0; i < 1000; i++) {
+      uint64_t *value = tree.find(i*2);
+      shouldNotBeNULL(value);
+      shouldBeEqual(*value, i);
+      shouldBeFalse(tree.contains(i*2 + 1));
+    }
+    shouldBeFalse(tree.insert(10, 42));
+    shouldBeEqual(*tree.find(10), 42);
+    shouldBeEqual(tree.getNumItems(), 1000);
+  } endIt();
+
+  it("should agree with std::map for random inserts and erases") {
+    SmallBTree tree;
+    std::map<uint64_t, uint64_t> stdMap;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < 20000; i++) {
+      uint64_t key = bTreeTestRandom(state) % 5000;
+      if (i % 3) {
+        shouldBeEqual(tree.insert(key, i), (stdMap.count(key) == 0));
+        stdMap[key] = i;
+      } else {
+        shouldBeEqual(tree.erase(key), (stdMap.erase(key) == 1));
+      }
+    }
+    shouldBeTrue(tree.treeInvariant());
+    shouldBeEqual(tree.getNumItems(), stdMap.size());
+    SmallBTree::Iterator iterator = tree.getIterator();
+    std::map<uint64_t, uint64_t>::iterator stdIterator = stdMap.begin();
+    uint64_t key = 0;
+    uint64_t value = 0;
+    while (iterator.nextItem(key, value)) {
+      shouldBeEqual(key, stdIterator->first);
+      shouldBeEqual(value, stdIterator->second);
+      stdIterator++;
+    }
+    shouldBeTrue(stdIterator == stdMap.end());
+    for (uint64_t key = 0; key < 5000; key++) {
+      shouldBeEqual(tree.contains(key), (stdMap.count(key) == 1));
+    }
+  } endIt();
+
+  it("should bulk load a sorted VarArray") {
+    VarArray<SmallBTree::Entry> someEntries;
+    SmallBTree tree;
+    shouldBeTrue(tree.loadSorted(someEntries));
+    shouldBeZero(tree.getNumItems());
+    for (uint64_t numEntries = 1; numEntries < 200; numEntries += 7) {
+      someEntries.clearItems();
+      for (uint64_t i = 0; i < numEntries; i++) {
+        SmallBTree::Entry anEntry = { i*3, i };
+        someEntries.pushItem(anEntry);
+      }
+      shouldBeTrue(tree.loadSorted(someEntries));
+      shouldBeTrue(tree.treeInvariant());
+      shouldBeEqual(tree.getNumItems(), numEntries);
+      for (uint64_t i = 0; i < numEntries; i++) {
+        shouldBeEqual(*tree.find(i*3), i);
+        shouldBeNULL(tree.find(i*3 + 1));
+      }
+    }
+    // the leaves are packed full
+    shouldBeTrue(tree.numLeaves*SmallBTree::nodeKeys < tree.getNumItems() + 4);
+    // a bulk loaded tree can then grow
+    for (uint64_t i = 0; i < 200; i++) tree.insert(i*3 + 1, i);
+    shouldBeTrue(tree.treeInvariant());
+    shouldBeEqual(*tree.find(7), 2);
+    // unsorted entries are refused
+    SmallBTree::Entry anEntry = { 0, 0 };
+    someEntries.pushItem(anEntry);
+    shouldBeFalse(tree.loadSorted(someEntries));
+    shouldBeEqual(*tree.find(7), 2);
+  } endIt();
+
+  it("should visit the items in a range in key order") {
+    SmallBTree tree;
+    for (uint64_t i = 0; i < 500; i++) tree.insert(i*10, 1);
+    BTreeSumVisitor allVisitor;
+    tree.forEachItem(allVisitor);
+    shouldBeEqual(allVisitor.numVisited, 500);
+    shouldBeEqual(allVisitor.keySum, 10*(499*500/2));
+    BTreeSumVisitor rangeVisitor;
+    tree.forEachItemInRange(95, 200, rangeVisitor);
+    // the keys 100, 110, ..., 190
+    shouldBeEqual(rangeVisitor.numVisited, 10);
+    shouldBeEqual(rangeVisitor.keySum, 1450);
+    SmallBTree::Iterator iterator = tree.getIteratorFrom(4985);
+    uint64_t key = 0;
+    uint64_t value = 0;
+    shouldBeTrue(iterator.nextItem(key, value));
+    shouldBeEqual(key, 4990);
+    shouldBeFalse(iterator.nextItem(key, value));
+    // emptied leaves are skipped
+    for (uint64_t i = 10; i < 400; i++) tree.erase(i*10);
+    iterator = tree.getIteratorFrom(95);
+    shouldBeTrue(iterator.nextItem(key, value));
+    shouldBeEqual(key, 4000);
+  } endIt();
+
+  it("should report its memory usage") {
+    Uint64BTree tree;
+    for (uint64_t i = 0; i < 1000; i++) tree.insert(i, i);
+    MemoryUsage usage = tree.memoryUsage();
+    shouldBeEqual(usage.bytesUsed, 1000*16);
+    shouldBeTrue(usage.bytesUsed + usage.bytesOverhead <= usage.bytesReserved);
+    specMemoryUsage(tree);
+    tree.clearItems();
+    shouldBeZero(tree.getNumItems());
+    shouldBeNULL(tree.find(1));
+  } endIt();
+
+  it("should hold, find and scan the same items as std::map",
+     "[benchmark]") {
+    const size_t numKeys = 100000;
+    Uint64BTree tree;
+    std::map<uint64_t, uint64_t> stdMap;
+    benchmark("IndexedBTree<uint64_t,uint64_t>::insert (10^5 keys)") {
+      tree.clearItems();
+      for (size_t i = 0; i < numKeys; i++) tree.insert(i*7919 % 1000003, i);
+    } endBenchmark();
+    benchmark("std::map<uint64_t,uint64_t>::insert (10^5 keys)") {
+      stdMap.clear();
+      for (size_t i = 0; i < numKeys; i++) stdMap[i*7919 % 1000003] = i;
+    } endBenchmark();
+    shouldBeEqual(tree.getNumItems(), numKeys);
+    shouldBeEqual(stdMap.size(), numKeys);
+    uint64_t treeSum = 0;
+    benchmark("IndexedBTree<uint64_t,uint64_t>::find (10^5 keys)") {
+      uint64_t sum = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        uint64_t *value = tree.find(i*7919 % 1000003);
+        if (value) sum += *value;
+      }
+      treeSum = sum;
+      specDoNotOptimize(treeSum);
+    } endBenchmark();
+    uint64_t stdSum = 0;
+    benchmark("std::map<uint64_t,uint64_t>::find (10^5 keys)") {
+      uint64_t sum = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        std::map<uint64_t, uint64_t>::iterator value =
+          stdMap.find(i*7919 % 1000003);
+        if (value != stdMap.end()) sum += value->second;
+      }
+      stdSum = sum;
+      specDoNotOptimize(stdSum);
+    } endBenchmark();
+    shouldBeEqual(treeSum, (uint64_t)numKeys*(numKeys - 1)/2);
+    shouldBeEqual(stdSum, treeSum);
+    BTreeSumVisitor treeVisitor;
+    benchmark("IndexedBTree<uint64_t,uint64_t>::forEachItem (10^5 keys)") {
+      treeVisitor.valueSum = 0;
+      tree.forEachItem(treeVisitor);
+      specDoNotOptimize(treeVisitor.valueSum);
+    } endBenchmark();
+    uint64_t scanSum = 0;
+    benchmark("std::map<uint64_t,uint64_t> iteration (10^5 keys)") {
+      uint64_t sum = 0;
+      for (std::map<uint64_t, uint64_t>::iterator item = stdMap.begin();
+           item != stdMap.end(); item++) {
+        sum += item->second;
+      }
+      scanSum = sum;
+      specDoNotOptimize(scanSum);
+    } endBenchmark();
+    shouldBeEqual(treeVisitor.valueSum, scanSum);
+  } endIt();
+
+} endDescribe(IndexedBTree);
@@ -11,6 +11,56 @@
 #include <stdio.h>
 #include <cUtils/indexedBlockAllocator.h>
 
+/// \brief (Test) Sums the first byte of each item visited.
+class ItemSumVisitor {
+public:
+  ItemSumVisitor(void) { sum = 0; numItems = 0; lastItemNum = 0; }
+  void operator()(size_t itemNum, char *itemPtr) {
+    sum += *itemPtr;
+    numItems++;
+    lastItemNum = itemNum;
+  }
+  size_t sum;
+  size_t numItems;
+  size_t lastItemNum;
+};
+
+/// \brief (Test) Sums the first byte of each item in each block
+/// visited (thread safely).
+class BlockSumVisitor {
+public:
+  BlockSumVisitor(size_t anItemSize) {
+    itemSize = anItemSize; sum = 0; numItems = 0; numBlocks = 0;
+  }
+  void operator()(size_t /* firstItemNum */, char *blockPtr,
+                  size_t numItemsInBlock) {
+    size_t blockSum = 0;
+    for (size_t i = 0; i < numItemsInBlock; i++) {
+      blockSum += blockPtr[i*itemSize];
+    }
+    __sync_fetch_and_add(&sum, blockSum);
+    __sync_fetch_and_add(&numItems, numItemsInBlock);
+    __sync_fetch_and_add(&numBlocks, 1);
+  }
+  size_t itemSize;
+  size_t sum;
+  size_t numItems;
+  size_t numBlocks;
+};
+
+/// \brief (Test) Sums the first byte of each item visited (thread
+/// safely).
+class ParallelItemSumVisitor {
+public:
+  ParallelItemSumVisitor(void) { sum = 0; numItems = 0; }
+  void operator()(size_t /* itemNum */, char *itemPtr) {
+    __sync_fetch_and_add(&sum, (size_t)*itemPtr);
+    __sync_fetch_and_add(&numItems, 1);
+  }
+  size_t sum;
+  size_t numItems;
+};
+
 /// \brief We test the correctness of the C-based
 /// IndexedBlockAllocator structure.
 ///
@@ -105,4 +155,54 @@ describe(IndexedBlockAllocator) {
     delete iba;
   } endIt();
 
+  it("should count the items in each block") {
+    IndexedBlockAllocator *iba = new IndexedBlockAllocator(11, 4);
+    shouldNotBeNULL(iba);
+    shouldBeZero(iba->getNumItemsInBlock(0));
+    for (size_t i = 0; i < 20; i++) iba->allocateNewStructure();
+    shouldBeEqual(iba->getNumItemsInBlock(0), 16);
+    shouldBeEqual(iba->getNumItemsInBlock(1), 4);
+    shouldBeZero(iba->getNumItemsInBlock(2));
+    delete iba;
+  } endIt();
+
+  it("should visit each item in index order") {
+    IndexedBlockAllocator *iba = new IndexedBlockAllocator(11, 4);
+    shouldNotBeNULL(iba);
+    for (size_t i = 0; i < 100; i++) {
+      size_t itemNum = iba->allocateNewStructure();
+      *iba->getItemPtr(itemNum) = (char)(itemNum % 7);
+    }
+    size_t expectedSum = 0;
+    for (size_t i = 0; i < 100; i++) expectedSum += i % 7;
+    ItemSumVisitor visitor;
+    iba->forEachItem(visitor);
+    shouldBeEqual(visitor.numItems, 100);
+    shouldBeEqual(visitor.lastItemNum, 99);
+    shouldBeEqual(visitor.sum, expectedSum);
+    delete iba;
+  } endIt();
+
+  it("should visit each block in parallel") {
+    IndexedBlockAllocator *iba = new IndexedBlockAllocator(11, 4);
+    shouldNotBeNULL(iba);
+    for (size_t i = 0; i < 1000; i++) {
+      size_t itemNum = iba->allocateNewStructure();
+      *iba->getItemPtr(itemNum) = (char)(itemNum % 7);
+    }
+    size_t expectedSum = 0;
+    for (size_t i = 0; i < 1000; i++) expectedSum += i % 7;
+    WorkerPool pool(4);
+    BlockSumVisitor blockVisitor(11);
+    iba->parallelForEachBlock(blockVisitor, &pool);
+    shouldBeEqual(blockVisitor.numBlocks, iba->blocks.getNumItems());
+    shouldBeEqual(blockVisitor.numItems, 1000);
+    shouldBeEqual(blockVisitor.sum, expectedSum);
+    ParallelItemSumVisitor itemVisitor;
+    iba->parallelForEach(itemVisitor);
+    shouldBeEqual(itemVisitor.numItems, 1000);
+    shouldBeEqual(itemVisitor.sum, expectedSum);
+    delete iba;
+  } endIt();
+
 } endDescribe(IndexedBlockAllocator);
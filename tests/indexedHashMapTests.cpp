@@ -0,0 +1,257 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+#include <unordered_map>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/indexedHashMap.h>
+
+typedef IndexedHashMap<size_t, size_t> SizeHashMap;
+
+/// \brief (Internal) Matches the entries whose key is the length of a
+/// given string.
+class KeyLengthMatcher {
+public:
+  KeyLengthMatcher(const char *aString) : string(aString) { }
+
+  bool operator()(const SizeHashMap::Entry &anEntry) const {
+    return anEntry.key == strlen(string);
+  }
+
+  const char *string;
+};
+
+/// \brief (Internal) Sums the keys and values visited.
+class SumVisitor {
+public:
+  SumVisitor(void) : keySum(0), valueSum(0) { }
+
+  void operator()(const size_t &aKey, size_t &aValue) {
+    keySum   += aKey;
+    valueSum += aValue;
+  }
+
+  size_t keySum;
+  size_t valueSum;
+};
+
+/// \brief We test the correctness of the C-based IndexedHashMap
+/// structure.
+///
+describe(IndexedHashMap) {
+
+  specSize(SizeHashMap);
+  specSize(SizeHashMap::Entry);
+
+  it("should create an empty IndexedHashMap") {
+    SizeHashMap *map = new SizeHashMap();
+    shouldNotBeNULL(map);
+    shouldBeZero(map->getNumItems());
+    shouldBeZero(map->getCapacity());
+    shouldBeNULL(map->ctrl);
+    shouldBeNULL(map->find(1));
+    shouldBeFalse(map->contains(1));
+    shouldBeEqual(map->findEntry(1), map->noEntry);
+    shouldBeFalse(map->erase(1));
+    delete map;
+  } endIt();
+
+  it("should insert, find and update items") {
+    SizeHashMap map;
+    shouldBeTrue(map.insert(42, 1));
+    shouldBeEqual(map.getNumItems(), 1);
+    shouldBeEqual(map.getCapacity(), map.groupWidth);
+    shouldNotBeNULL(map.find(42));
+    shouldBeEqual(*map.find(42), 1);
+    shouldBeFalse(map.insert(42, 2));
+    shouldBeEqual(map.getNumItems(), 1);
+    shouldBeEqual(*map.find(42), 2);
+    shouldBeZero(map.findEntry(42));
+    shouldBeEqual(map.getEntry(0).key, 42);
+    bool wasInserted = true;
+    shouldBeZero(map.findOrInsertEntry(42, wasInserted));
+    shouldBeFalse(wasInserted);
+    shouldBeEqual(map.findOrInsertEntry(43, wasInserted), 1);
+    shouldBeTrue(wasInserted);
+    shouldBeZero(*map.find(43));
+  } endIt();
+
+  it("should keep the entries in place while the index table grows") {
+    SizeHashMap map;
+    VarArray<size_t*> valuePtrs;
+    for (size_t i = 0; i < 10000; i++) {
+      shouldBeTrue(map.insert(i*7, i));
+      valuePtrs.pushItem(map.find(i*7));
+    }
+    shouldBeEqual(map.getNumItems(), 10000);
+    shouldBeTrue(10000*8 <= map.getCapacity()*7);
+    shouldBeZero(map.getCapacity() & (map.getCapacity() - 1));
+    for (size_t i = 0; i < 10000; i++) {
+      shouldBeEqual(map.findEntry(i*7), i);
+      shouldBeEqual((void*)map.find(i*7), (void*)valuePtrs[i]);
+      shouldBeEqual(*map.find(i*7), i);
+      shouldBeFalse(map.contains(i*7 + 1));
+    }
+  } endIt();
+
+  it("should erase items and reuse their entries") {
+    SizeHashMap map;
+    for (size_t i = 0; i < 100; i++) map.insert(i, i);
+    for (size_t i = 0; i < 100; i += 2) shouldBeTrue(map.erase(i));
+    shouldBeFalse(map.erase(0));
+    shouldBeEqual(map.getNumItems(), 50);
+    shouldBeEqual(map.freeEntries.getNumItems(), 50);
+    for (size_t i = 0; i < 100; i++) {
+      if (i % 2) shouldBeEqual(*map.find(i), i);
+      else       shouldBeNULL(map.find(i));
+    }
+    shouldBeTrue(map.insert(1000, 7));
+    shouldBeEqual(map.freeEntries.getNumItems(), 49);
+    shouldBeTrue(map.findEntry(1000) < 100);
+    shouldBeEqual(*map.find(1000), 7);
+    shouldBeEqual(map.entries.nextIndex(), 100);
+  } endIt();
+
+  it("should not grow while items are repeatedly inserted and erased") {
+    SizeHashMap map;
+    for (size_t i = 0; i < 10; i++) map.insert(i, i);
+    size_t capacity = map.getCapacity();
+    for (size_t i = 10; i < 10000; i++) {
+      shouldBeTrue(map.insert(i, i));
+      shouldBeTrue(map.erase(i - 10));
+    }
+    shouldBeEqual(map.getNumItems(), 10);
+    shouldBeEqual(map.getCapacity(), capacity);
+    shouldBeEqual(map.entries.nextIndex(), 11);
+    for (size_t i = 9990; i < 10000; i++) shouldBeEqual(*map.find(i), i);
+  } endIt();
+
+  it("should reserve and clear its items") {
+    SizeHashMap map;
+    map.reserve(1000);
+    size_t capacity = map.getCapacity();
+    shouldBeTrue(1000*8 <= capacity*7);
+    for (size_t i = 0; i < 1000; i++) map.insert(i, i);
+    shouldBeEqual(map.getCapacity(), capacity);
+    map.clearItems();
+    shouldBeZero(map.getNumItems());
+    shouldBeEqual(map.getCapacity(), capacity);
+    shouldBeNULL(map.find(1));
+    shouldBeTrue(map.insert(1, 2));
+    shouldBeZero(map.findEntry(1));
+  } endIt();
+
+  it("should visit each item") {
+    SizeHashMap map;
+    for (size_t i = 1; i <= 100; i++) map.insert(i, 2*i);
+    map.erase(100);
+    SumVisitor visitor;
+    map.forEachItem(visitor);
+    shouldBeEqual(visitor.keySum, 4950);
+    shouldBeEqual(visitor.valueSum, 9900);
+  } endIt();
+
+  it("should find and insert entries using a matcher") {
+    SizeHashMap map;
+    map.insert(3, 30);
+    KeyLengthMatcher matcher("abc");
+    uint64_t hash = HashTraits<size_t>::hash(3);
+    shouldBeZero(map.findEntryUsing(hash, matcher));
+    KeyLengthMatcher otherMatcher("abcd");
+    uint64_t otherHash = HashTraits<size_t>::hash(4);
+    shouldBeEqual(map.findEntryUsing(otherHash, otherMatcher), map.noEntry);
+    bool wasInserted = false;
+    uint32_t entryIndex =
+      map.findOrInsertEntryUsing(otherHash, otherMatcher, wasInserted);
+    shouldBeTrue(wasInserted);
+    map.getEntry(entryIndex).key   = 4;
+    map.getEntry(entryIndex).value = 40;
+    shouldBeEqual(*map.find(4), 40);
+  } endIt();
+
+  it("should map strings by their contents") {
+    IndexedHashMap<const char*, size_t> map;
+    char aKey[] = "hello";
+    map.insert(aKey, 1);
+    map.insert("world", 2);
+    shouldBeEqual(*map.find("hello"), 1);
+    shouldBeEqual(*map.find("world"), 2);
+    shouldBeNULL(map.find("hello world"));
+  } endIt();
+
+  it("should report its memory usage") {
+    SizeHashMap map;
+    for (size_t i = 0; i < 100; i++) map.insert(i, i);
+    MemoryUsage usage = map.memoryUsage();
+    shouldBeEqual(usage.bytesUsed, 100*sizeof(SizeHashMap::Entry));
+    shouldBeTrue(map.getCapacity()*9 <= usage.bytesOverhead);
+    shouldBeTrue(usage.bytesUsed + usage.bytesOverhead <= usage.bytesReserved);
+    specMemoryUsage(map);
+  } endIt();
+
+  it("should insert and find the same items as std::unordered_map",
+     "[benchmark]") {
+    const size_t numKeys = 10000;
+    SizeHashMap map;
+    benchmark("IndexedHashMap<size_t,size_t>::insert (10000 keys)") {
+      map.clearItems();
+      for (size_t i = 0; i < numKeys; i++) map.insert(i*7919, i);
+    } endBenchmark();
+    std::unordered_map<size_t, size_t> stdMap;
+    benchmark("std::unordered_map<size_t,size_t>::insert (10000 keys)") {
+      stdMap.clear();
+      for (size_t i = 0; i < numKeys; i++) stdMap[i*7919] = i;
+    } endBenchmark();
+    shouldBeEqual(map.getNumItems(), stdMap.size());
+    size_t mapSum = 0;
+    benchmark("IndexedHashMap<size_t,size_t>::find (10000 keys)") {
+      size_t sum = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        size_t *value = map.find(i*7919);
+        if (value) sum += *value;
+      }
+      mapSum = sum;
+      specDoNotOptimize(mapSum);
+    } endBenchmark();
+    size_t stdSum = 0;
+    benchmark("std::unordered_map<size_t,size_t>::find (10000 keys)") {
+      size_t sum = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        std::unordered_map<size_t, size_t>::iterator value =
+          stdMap.find(i*7919);
+        if (value != stdMap.end()) sum += value->second;
+      }
+      stdSum = sum;
+      specDoNotOptimize(stdSum);
+    } endBenchmark();
+    shouldBeEqual(mapSum, numKeys*(numKeys - 1)/2);
+    shouldBeEqual(stdSum, mapSum);
+    size_t mapMisses = 0;
+    benchmark("IndexedHashMap<size_t,size_t>::find (10000 misses)") {
+      size_t numMisses = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        numMisses += (map.find(i*7919 + 1) == NULL);
+      }
+      mapMisses = numMisses;
+      specDoNotOptimize(mapMisses);
+    } endBenchmark();
+    size_t stdMisses = 0;
+    benchmark("std::unordered_map<size_t,size_t>::find (10000 misses)") {
+      size_t numMisses = 0;
+      for (size_t i = 0; i < numKeys; i++) {
+        numMisses += (stdMap.find(i*7919 + 1) == stdMap.end());
+      }
+      stdMisses = numMisses;
+      specDoNotOptimize(stdMisses);
+    } endBenchmark();
+    shouldBeEqual(mapMisses, numKeys);
+    shouldBeEqual(stdMisses, numKeys);
+  } endIt();
+
+} endDescribe(IndexedHashMap);
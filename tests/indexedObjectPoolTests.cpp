@@ -0,0 +1,151 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/indexedObjectPool.h>
+
+/// \brief We test the correctness of the C-based
+/// IndexedObjectPool structure.
+///
+describe(IndexedObjectPool) {
+
+  specSize(IndexedObjectPool);
+
+  it("should create an IndexedObjectPool") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    shouldBeEqual(pool->itemSize, 11);
+    shouldBeEqual(pool->bitShift, 4);
+    shouldBeEqual(pool->freeList, IndexedObjectPool::noIndex);
+    shouldBeZero(pool->getNumLiveItems());
+    shouldBeZero(pool->getNumFreeItems());
+    delete pool;
+  } endIt();
+
+  it("should make small items large enough to hold the free list") {
+    IndexedObjectPool *pool = new IndexedObjectPool(1, 4);
+    shouldNotBeNULL(pool);
+    shouldBeEqual(pool->itemSize, sizeof(size_t));
+    delete pool;
+  } endIt();
+
+  it("should allocate contiguous indexes when nothing is released") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    for (size_t i = 0; i < 1<<5; i++) {
+      size_t itemNum = pool->allocate();
+      shouldBeEqual(itemNum, i);
+      shouldNotBeNULL(pool->getItemPtr(itemNum));
+    }
+    shouldBeEqual(pool->blocks.getNumItems(), 2);
+    shouldBeEqual(pool->getNumLiveItems(), 1<<5);
+    shouldBeZero(pool->getNumFreeItems());
+    delete pool;
+  } endIt();
+
+  it("should re-use released items in LIFO order") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    for (size_t i = 0; i < 10; i++) pool->allocate();
+    char *item3Ptr = pool->getItemPtr(3);
+    char *item7Ptr = pool->getItemPtr(7);
+    pool->release(3);
+    pool->release(7);
+    shouldBeEqual(pool->getNumLiveItems(), 8);
+    shouldBeEqual(pool->getNumFreeItems(), 2);
+    shouldBeEqual(pool->freeList, 7);
+    size_t itemNum = pool->allocate();
+    shouldBeEqual(itemNum, 7);
+    shouldBeEqual(pool->getItemPtr(itemNum), item7Ptr);
+    itemNum = pool->allocate();
+    shouldBeEqual(itemNum, 3);
+    shouldBeEqual(pool->getItemPtr(itemNum), item3Ptr);
+    shouldBeEqual(pool->freeList, IndexedObjectPool::noIndex);
+    itemNum = pool->allocate();
+    shouldBeEqual(itemNum, 10);
+    shouldBeEqual(pool->getNumLiveItems(), 11);
+    shouldBeZero(pool->getNumFreeItems());
+    delete pool;
+  } endIt();
+
+  it("should not grow while items are churned") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    for (size_t i = 0; i < 16; i++) pool->allocate();
+    shouldBeEqual(pool->blocks.getNumItems(), 1);
+    for (size_t j = 0; j < 100; j++) {
+      for (size_t i = 0; i < 16; i++) pool->release(i);
+      for (size_t i = 0; i < 16; i++) pool->allocate();
+    }
+    shouldBeEqual(pool->blocks.getNumItems(), 1);
+    shouldBeEqual(pool->nextIndex(), 16);
+    delete pool;
+  } endIt();
+
+  it("should clear the free list together with the blocks") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    for (size_t i = 0; i < 10; i++) pool->allocate();
+    pool->release(5);
+    pool->clearBlocks();
+    shouldBeZero(pool->blocks.getNumItems());
+    shouldBeEqual(pool->freeList, IndexedObjectPool::noIndex);
+    shouldBeZero(pool->allocate());
+    delete pool;
+  } endIt();
+
+#ifdef DEBUG
+  it("should track the generation of each index") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    size_t itemNum = pool->allocate();
+    shouldBeZero(pool->getGeneration(itemNum));
+    pool->release(itemNum);
+    shouldBeEqual(pool->getGeneration(itemNum), 1);
+    shouldBeEqual(pool->allocate(), itemNum);
+    shouldBeEqual(pool->getGeneration(itemNum), 2);
+    shouldNotBeNULL(pool->getItemPtr(itemNum, 2));
+    delete pool;
+  } endIt();
+
+  it("should catch the use of a stale index") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    size_t itemNum = pool->allocate();
+    size_t generation = pool->getGeneration(itemNum);
+    pool->release(itemNum);
+    pool->allocate();
+    bool caughtStaleIndex = false;
+    try {
+      pool->getItemPtr(itemNum, generation);
+    } catch (AssertionFailure &af) {
+      caughtStaleIndex = true;
+    }
+    shouldBeTrue(caughtStaleIndex);
+    delete pool;
+  } endIt();
+
+  it("should catch releasing an item twice") {
+    IndexedObjectPool *pool = new IndexedObjectPool(11, 4);
+    shouldNotBeNULL(pool);
+    size_t itemNum = pool->allocate();
+    pool->release(itemNum);
+    bool caughtDoubleRelease = false;
+    try {
+      pool->release(itemNum);
+    } catch (AssertionFailure &af) {
+      caughtDoubleRelease = true;
+    }
+    shouldBeTrue(caughtDoubleRelease);
+    delete pool;
+  } endIt();
+#endif
+
+} endDescribe(IndexedObjectPool);
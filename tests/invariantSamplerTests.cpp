@@ -0,0 +1,80 @@
+#include <cUtils/specs/specs.h>
+#include <cUtils/varArray.h>
+
+/// \brief (Internal) Restore the default sampling when a spec ends
+/// (even if it fails).
+class RestoreInvariantSampling {
+public:
+  ~RestoreInvariantSampling(void) {
+    InvariantSampler::setSampleRate(1);
+  }
+};
+
+describe(InvariantSampler) {
+
+  it("should check every call by default") {
+    RestoreInvariantSampling restore;
+    InvariantSampler::setSampleRate(1);
+    size_t numChecks = 0;
+    for (size_t i = 0; i < 100; i++) {
+      if (InvariantSampler::shouldCheck()) numChecks++;
+    }
+    shouldBeEqual(numChecks, 100);
+  } endIt();
+
+  it("should check every Nth call") {
+    RestoreInvariantSampling restore;
+    InvariantSampler::setSampleRate(4);
+    size_t numChecks = 0;
+    for (size_t i = 0; i < 100; i++) {
+      if (InvariantSampler::shouldCheck()) numChecks++;
+    }
+    shouldBeEqual(numChecks, 25);
+  } endIt();
+
+  it("should check calls with a given probability") {
+    RestoreInvariantSampling restore;
+    InvariantSampler::setSampleProbability(0.25);
+    size_t numChecks = 0;
+    for (size_t i = 0; i < 100000; i++) {
+      if (InvariantSampler::shouldCheck()) numChecks++;
+    }
+    shouldBeTrue(20000 < numChecks);
+    shouldBeTrue(numChecks < 30000);
+    InvariantSampler::setSampleProbability(0.0);
+    numChecks = 0;
+    for (size_t i = 0; i < 100000; i++) {
+      if (InvariantSampler::shouldCheck()) numChecks++;
+    }
+    shouldBeZero(numChecks);
+  } endIt();
+
+  it("should only check the sampled invariants") {
+    RestoreInvariantSampling restore;
+    InvariantSampler::setSampleRate(3);
+    size_t numFailures = 0;
+    for (size_t i = 0; i < 9; i++) {
+      try {
+        ASSERT_INVARIANT(false);
+      } catch (AssertionFailure &af) {
+        numFailures++;
+      }
+    }
+    shouldBeEqual(numFailures, ((2 <= CUTILS_ASSERT_LEVEL) ? 3 : 0));
+  } endIt();
+
+  it("should benchmark pushItem with all or sampled invariants", "[benchmark]") {
+    RestoreInvariantSampling restore;
+    VarArray<size_t> aVarArray;
+    benchmark("VarArray::pushItem (every invariant)") {
+      if (1000 <= aVarArray.getNumItems()) aVarArray.clearItems();
+      aVarArray.pushItem(1);
+    } endBenchmark();
+    InvariantSampler::setSampleRate(64);
+    benchmark("VarArray::pushItem (1 in 64 invariants)") {
+      if (1000 <= aVarArray.getNumItems()) aVarArray.clearItems();
+      aVarArray.pushItem(1);
+    } endBenchmark();
+  } endIt();
+
+} endDescribe(InvariantSampler);
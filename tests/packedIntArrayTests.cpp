@@ -0,0 +1,166 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/packedIntArray.h>
+#include <cUtils/varArray.h>
+
+/// \brief We test the correctness of the C-based PackedIntArray
+/// structure.
+///
+describe(PackedIntArray) {
+
+  specSize(PackedIntArray);
+
+  it("should create an empty PackedIntArray") {
+    PackedIntArray *anArray = new PackedIntArray(12);
+    shouldNotBeNULL(anArray);
+    shouldBeZero(anArray->getNumItems());
+    shouldBeZero(anArray->getCapacity());
+    shouldBeEqual(anArray->getBitWidth(), 12);
+    shouldBeEqual(anArray->getItem(0, 42), 42);
+    delete anArray;
+  } endIt();
+
+  it("should compute the bits needed for an item") {
+    shouldBeEqual(PackedIntArray::bitsNeeded(0), 1);
+    shouldBeEqual(PackedIntArray::bitsNeeded(1), 1);
+    shouldBeEqual(PackedIntArray::bitsNeeded(1023), 10);
+    shouldBeEqual(PackedIntArray::bitsNeeded(1024), 11);
+    shouldBeEqual(PackedIntArray::bitsNeeded(~0ULL), 64);
+  } endIt();
+
+  it("should push, get, set and pop items of every width") {
+    for (size_t bitWidth = 1; bitWidth <= 64; bitWidth++) {
+      PackedIntArray anArray(bitWidth);
+      uint64_t mask = (~0ULL) >> (64 - bitWidth);
+      for (uint64_t i = 0; i < 200; i++) {
+        anArray.pushItem((i*0x9E3779B97F4A7C15ULL) & mask);
+      }
+      shouldBeEqual(anArray.getBitWidth(), bitWidth);
+      size_t numErrors = 0;
+      for (uint64_t i = 0; i < 200; i++) {
+        if (anArray[i] != ((i*0x9E3779B97F4A7C15ULL) & mask)) numErrors++;
+      }
+      for (uint64_t i = 0; i < 200; i += 3) anArray.setItem(i, mask - (i & mask));
+      for (uint64_t i = 0; i < 200; i++) {
+        uint64_t expected = (i % 3) ? ((i*0x9E3779B97F4A7C15ULL) & mask) :
+          (mask - (i & mask));
+        if (anArray.getItem(i, 0) != expected) numErrors++;
+      }
+      shouldBeZero(numErrors);
+      shouldBeEqual(anArray.getTop(), (199*0x9E3779B97F4A7C15ULL) & mask);
+      shouldBeEqual(anArray.popItem(), (199*0x9E3779B97F4A7C15ULL) & mask);
+      shouldBeEqual(anArray.getNumItems(), 199);
+    }
+  } endIt();
+
+  it("should widen its items when an item overflows") {
+    PackedIntArray anArray(4);
+    for (uint64_t i = 0; i < 100; i++) anArray.pushItem(i % 16);
+    shouldBeEqual(anArray.getBitWidth(), 4);
+    anArray.pushItem(1000);
+    shouldBeEqual(anArray.getBitWidth(), 10);
+    anArray.setItem(3, 1ULL << 40);
+    shouldBeEqual(anArray.getBitWidth(), 41);
+    for (uint64_t i = 0; i < 100; i++) {
+      if (i != 3) shouldBeEqual(anArray[i], i % 16);
+    }
+    shouldBeEqual(anArray[3], 1ULL << 40);
+    shouldBeEqual(anArray[100], 1000);
+    anArray.widen(20);
+    shouldBeEqual(anArray.getBitWidth(), 41);
+    anArray.clearItems();
+    shouldBeZero(anArray.getNumItems());
+    shouldBeEqual(anArray.getBitWidth(), 41);
+  } endIt();
+
+  it("should unpack runs of items into a buffer") {
+    size_t bitWidths[] = { 3, 8, 13, 16, 20, 32, 33, 63, 64 };
+    uint64_t buffer[300];
+    for (size_t w = 0; w < sizeof(bitWidths)/sizeof(size_t); w++) {
+      PackedIntArray anArray(bitWidths[w]);
+      uint64_t mask = (~0ULL) >> (64 - bitWidths[w]);
+      for (uint64_t i = 0; i < 300; i++) {
+        anArray.pushItem((i*0x9E3779B97F4A7C15ULL) & mask);
+      }
+      size_t numErrors = 0;
+      size_t starts[] = { 0, 1, 7, 63, 64, 65, 250 };
+      for (size_t s = 0; s < sizeof(starts)/sizeof(size_t); s++) {
+        size_t numUnpacked = anArray.getItems(starts[s], 100, buffer);
+        if (numUnpacked != ((starts[s] < 200) ? 100 : 300 - starts[s])) {
+          numErrors++;
+        }
+        for (size_t i = 0; i < numUnpacked; i++) {
+          if (buffer[i] != anArray[starts[s] + i]) numErrors++;
+        }
+      }
+      shouldBeZero(numErrors);
+      shouldBeZero(anArray.getItems(300, 10, buffer));
+    }
+    PackedIntArray bytes(8);
+    for (uint32_t i = 0; i < 10; i++) bytes.pushItem(i);
+    uint32_t smallBuffer[10];
+    shouldBeEqual(bytes.getItems(0, 10, smallBuffer), 10);
+    shouldBeEqual(smallBuffer[9], 9);
+  } endIt();
+
+  it("should use a fraction of the memory of a VarArray") {
+    PackedIntArray anArray(12);
+    VarArray<size_t> aVarArray;
+    anArray.reserve(10000);
+    aVarArray.reserve(10000);
+    for (size_t i = 0; i < 10000; i++) {
+      anArray.pushItem(i % 4096);
+      aVarArray.pushItem(i % 4096);
+    }
+    MemoryUsage packedUsage = anArray.memoryUsage();
+    MemoryUsage arrayUsage  = aVarArray.memoryUsage();
+    shouldBeEqual(packedUsage.numAllocations, 1);
+    shouldBeEqual(packedUsage.bytesUsed, 15000);
+    shouldBeTrue(5*packedUsage.bytesReserved < arrayUsage.bytesReserved);
+    specMemoryUsage(anArray);
+  } endIt();
+
+  it("should get and unpack the same 10^4 items as a VarArray",
+     "[benchmark]") {
+    PackedIntArray anArray(17);
+    for (size_t i = 0; i < 10000; i++) anArray.pushItem(i*13 % 100000);
+    VarArray<size_t> aVarArray;
+    aVarArray.reserve(10000);
+    for (size_t i = 0; i < 10000; i++) aVarArray.pushItem(i*13 % 100000);
+    uint64_t packedSum = 0;
+    benchmark("PackedIntArray::operator[] (17 bits, 10^4 items)") {
+      packedSum = 0;
+      for (size_t i = 0; i < 10000; i++) packedSum += anArray[i];
+      specDoNotOptimize(packedSum);
+    } endBenchmark();
+    uint32_t buffer[10000];
+    benchmark("PackedIntArray::getItems (17 bits, 10^4 items)") {
+      anArray.getItems(0, 10000, buffer);
+      specDoNotOptimize(buffer[9999]);
+    } endBenchmark();
+    uint64_t arraySum = 0;
+    benchmark("VarArray<size_t>::operator[] (10^4 items)") {
+      arraySum = 0;
+      for (size_t i = 0; i < 10000; i++) arraySum += aVarArray[i];
+      specDoNotOptimize(arraySum);
+    } endBenchmark();
+    size_t numDifferent = 0;
+    for (size_t i = 0; i < 10000; i++) {
+      if (anArray[i] != aVarArray[i]) numDifferent++;
+      if (buffer[i] != aVarArray[i]) numDifferent++;
+    }
+    shouldBeZero(numDifferent);
+    shouldBeEqual(packedSum, arraySum);
+  } endIt();
+
+} endDescribe(PackedIntArray);
@@ -0,0 +1,176 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/rankSelectBitSet.h>
+#include <cUtils/varArray.h>
+
+/// \brief (Internal) Fill someWords with pseudo random bits, roughly
+/// one in every spacing bits being set.
+static void rankSelectTestFill(VarArray<uint64_t> &someWords,
+                               size_t numWords, size_t spacing) {
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < numWords; i++) someWords.pushItem(0);
+  for (size_t bitNum = 0; bitNum < numWords*64; ) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    bitNum += 1 + (state % (2*spacing));
+    if (bitNum < numWords*64) someWords[bitNum >> 6] |= 1ULL << (bitNum & 63);
+  }
+}
+
+/// \brief We test the correctness of the C-based RankSelectBitSet
+/// structure.
+///
+describe(RankSelectBitSet) {
+
+  specSize(RankSelectBitSet);
+
+  it("should create an empty RankSelectBitSet from an empty BitSet") {
+    BitSet aBitSet;
+    RankSelectBitSet *rsBitSet = new RankSelectBitSet(aBitSet);
+    shouldNotBeNULL(rsBitSet);
+    shouldBeZero(rsBitSet->getNumBits());
+    shouldBeZero(rsBitSet->getNumSetBits());
+    shouldBeFalse(rsBitSet->getBit(10));
+    shouldBeZero(rsBitSet->rank(10));
+    shouldBeEqual(rsBitSet->select(0), RankSelectBitSet::noBit);
+    delete rsBitSet;
+  } endIt();
+
+  it("should copy the bits of a BitSet") {
+    BitSet aBitSet;
+    size_t bitNums[] = { 3, 64, 65, 700, 701, 4000, 70000 };
+    size_t numBitNums = sizeof(bitNums)/sizeof(size_t);
+    for (size_t i = 0; i < numBitNums; i++) aBitSet.setBit(bitNums[i]);
+    RankSelectBitSet rsBitSet(aBitSet);
+    shouldBeEqual(rsBitSet.getNumSetBits(), numBitNums);
+    shouldBeTrue(70000 < rsBitSet.getNumBits());
+    shouldBeZero(rsBitSet.getNumBits() % 512);
+    for (size_t bitNum = 0; bitNum < rsBitSet.getNumBits(); bitNum++) {
+      shouldBeEqual(rsBitSet.getBit(bitNum), aBitSet.getBit(bitNum));
+    }
+    for (size_t i = 0; i < numBitNums; i++) {
+      shouldBeEqual(rsBitSet.rank(bitNums[i]), i);
+      shouldBeEqual(rsBitSet.rank(bitNums[i] + 1), i + 1);
+      shouldBeEqual(rsBitSet.select(i), bitNums[i]);
+    }
+    shouldBeEqual(rsBitSet.rank(1000000), numBitNums);
+    shouldBeEqual(rsBitSet.select(numBitNums), RankSelectBitSet::noBit);
+  } endIt();
+
+  it("should agree with a linear scan for dense and sparse bits") {
+    size_t spacings[] = { 1, 3, 64, 5000 };
+    for (size_t s = 0; s < sizeof(spacings)/sizeof(size_t); s++) {
+      VarArray<uint64_t> someWords;
+      rankSelectTestFill(someWords, 4096 + 3, spacings[s]);
+      RankSelectBitSet rsBitSet(&someWords[0], someWords.getNumItems());
+      shouldBeTrue(rsBitSet.invariant());
+      size_t setBits = 0;
+      for (size_t bitNum = 0; bitNum < rsBitSet.getNumBits(); bitNum++) {
+        bool isSet = rsBitSet.getBit(bitNum);
+        shouldBeEqual(isSet, (bitNum < someWords.getNumItems()*64) &&
+          ((someWords[bitNum >> 6] >> (bitNum & 63)) & 1));
+        shouldBeEqual(rsBitSet.rank(bitNum), setBits);
+        if (isSet) {
+          shouldBeEqual(rsBitSet.select(setBits), bitNum);
+          setBits++;
+        }
+      }
+      shouldBeEqual(rsBitSet.getNumSetBits(), setBits);
+      shouldNotBeZero(setBits);
+    }
+  } endIt();
+
+  it("should handle an all ones bit set") {
+    VarArray<uint64_t> someWords;
+    for (size_t i = 0; i < 2048; i++) someWords.pushItem(~0ULL);
+    RankSelectBitSet rsBitSet(&someWords[0], someWords.getNumItems());
+    shouldBeEqual(rsBitSet.getNumSetBits(), 2048*64);
+    for (size_t bitNum = 0; bitNum < 2048*64; bitNum += 61) {
+      shouldBeEqual(rsBitSet.rank(bitNum), bitNum);
+      shouldBeEqual(rsBitSet.select(bitNum), bitNum);
+    }
+  } endIt();
+
+  it("should report its memory usage") {
+    VarArray<uint64_t> someWords;
+    rankSelectTestFill(someWords, 1 << 14, 8);
+    RankSelectBitSet rsBitSet(&someWords[0], someWords.getNumItems());
+    MemoryUsage usage = rsBitSet.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 4);
+    shouldBeEqual(usage.bytesUsed, (1 << 14)*8);
+    // the directories should cost less than 4% of the bits
+    shouldBeTrue(usage.bytesOverhead*100 < usage.bytesUsed*4);
+    specMemoryUsage(rsBitSet);
+  } endIt();
+
+  it("should rank and select as a linear scan does, timing both",
+     "[benchmark]") {
+    const size_t numWords = 1 << 14;
+    VarArray<uint64_t> someWords;
+    rankSelectTestFill(someWords, numWords, 4);
+    RankSelectBitSet rsBitSet(&someWords[0], numWords);
+    const uint64_t *wordsPtr = &someWords[0];
+    size_t numQueries = 1000;
+    size_t scanSum = 0;
+    benchmark("linear scan rank (10^3 queries of 10^6 bits)") {
+      size_t sum = 0;
+      for (size_t q = 0; q < numQueries; q++) {
+        size_t bitNum = (q*7919*64) % (numWords*64);
+        size_t setBits = 0;
+        for (size_t i = 0; i < (bitNum >> 6); i++) {
+          setBits += __builtin_popcountll(wordsPtr[i]);
+        }
+        setBits += __builtin_popcountll(wordsPtr[bitNum >> 6] &
+                                        ((1ULL << (bitNum & 63)) - 1));
+        sum += setBits;
+      }
+      scanSum = sum;
+      specDoNotOptimize(scanSum);
+    } endBenchmark();
+    size_t rankSum = 0;
+    benchmark("RankSelectBitSet rank (10^3 queries of 10^6 bits)") {
+      size_t sum = 0;
+      for (size_t q = 0; q < numQueries; q++) {
+        sum += rsBitSet.rank((q*7919*64) % (numWords*64));
+      }
+      rankSum = sum;
+      specDoNotOptimize(rankSum);
+    } endBenchmark();
+    shouldBeEqual(scanSum, rankSum);
+    size_t selectSum = 0;
+    benchmark("RankSelectBitSet select (10^3 queries of 10^6 bits)") {
+      size_t sum = 0;
+      for (size_t q = 0; q < numQueries; q++) {
+        sum += rsBitSet.select((q*7919) % rsBitSet.getNumSetBits());
+      }
+      selectSum = sum;
+      specDoNotOptimize(selectSum);
+    } endBenchmark();
+    // select each queried set bit again, by counting bits one by one
+    size_t scanSelectSum = 0;
+    for (size_t q = 0; q < numQueries; q++) {
+      size_t n = (q*7919) % rsBitSet.getNumSetBits();
+      size_t bitNum = 0;
+      for ( ; ; bitNum++) {
+        if ((wordsPtr[bitNum >> 6] >> (bitNum & 63)) & 1) {
+          if (!n) break;
+          n--;
+        }
+      }
+      scanSelectSum += bitNum;
+    }
+    shouldBeEqual(selectSum, scanSelectSum);
+  } endIt();
+
+} endDescribe(RankSelectBitSet);
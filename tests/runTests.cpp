@@ -1,8 +1,52 @@
 #include <cUtils/specs/verboseRunner.h>
+#include <cUtils/specs/jsonRunner.h>
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 int main(int argc, char* argv[]) {
+  // use --json=fileName to write machine readable results to fileName
+  // use --jobs=N to run the describes in parallel using N threads
+  //   (--jobs=0 uses one thread per processor)
+  // use --fork=N to run each describe in its own process, N at a time
+  //   (--fork=0 uses one process per processor)
+  // use --timeout=S to kill (forked) describes which take more than S
+  //   seconds
+  // use --describe=, --it=, --tag=, --shard=i/N and --list to select
+  //   (or list) the specs to be run (see SpecRunner::parseOptions)
+  // use --benchmarks to also run the specs tagged [benchmark]
+  if (!SpecRunner::parseOptions(argc, argv)) {
+    fprintf(stderr, "malformed spec selection options\n");
+    return -1;
+  }
+  if (SpecRunner::getFilter().listOnly) {
+    SpecRunner::listAll(stdout);
+    return 0;
+  }
+  FILE *jsonFile = NULL;
+  bool  inParallel = false;
+  bool  forked     = false;
+  size_t numJobs = 0;
+  double timeout = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--jobs=", 7) == 0) {
+      inParallel = true;
+      numJobs    = strtoul(argv[i]+7, NULL, 10);
+    } else if (strncmp(argv[i], "--fork=", 7) == 0) {
+      forked  = true;
+      numJobs = strtoul(argv[i]+7, NULL, 10);
+    } else if (strncmp(argv[i], "--timeout=", 10) == 0) {
+      timeout = strtod(argv[i]+10, NULL);
+    } else if (strncmp(argv[i], "--json=", 7) == 0) {
+      jsonFile = fopen(argv[i]+7, "w");
+      if (!jsonFile) {
+        fprintf(stderr, "could not open json results [%s]\n", argv[i]+7);
+        return -1;
+      }
+    }
+  }
+
   printf("----------------------------------------------------------------\n");
   fprintf(stdout, "        void* = %zu bytes (%zu bits)\n", sizeof(void*),     sizeof(void*)*8);
   fprintf(stdout, "         char = %zu bytes (%zu bits)\n", sizeof(char),      sizeof(char)*8);
@@ -14,7 +58,22 @@ int main(int argc, char* argv[]) {
   fprintf(stdout, "     uint64_t = %zu bytes (%zu bits)\n", sizeof(uint64_t),  sizeof(uint64_t)*8);
   fprintf(stdout, "       size_t = %zu bytes (%zu bits)\n", sizeof(size_t),    sizeof(size_t)*8);
   printf("----------------------------------------------------------------\n");
-  int result = SpecRunner::runAllUsing(new VerboseRunner()) - 1;
+  SpecRunner *runner = NULL;
+  if (jsonFile) runner = new JsonRunner(jsonFile);
+  else          runner = new VerboseRunner();
+  int result = 0;
+  if (forked) {
+    result = SpecRunner::runAllForkedUsing(runner, numJobs, timeout);
+  } else if (inParallel) {
+    result = SpecRunner::runAllInParallelUsing(runner, numJobs);
+  } else {
+    result = SpecRunner::runAllUsing(runner);
+  }
+  // the VerboseRunner specs are expected to fail (if they are run)
+  const SpecFilter &filter = SpecRunner::getFilter();
+  if (SpecRunner::selectDescribe("VerboseRunner") &&
+      !filter.itPattern && !filter.tagPattern) result -= 1;
+  if (jsonFile) fclose(jsonFile);
   printf("----------------------------------------------------------------\n");
   printf("number of unexpected failures: %d\n", result);
   printf("----------------------------------------------------------------\n");
@@ -0,0 +1,162 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/soaVarArray.h>
+#include <cUtils/varArray.h>
+
+/// \brief (Internal) The records scanned by the benchmarks (stored as
+/// an "array of structures").
+typedef struct SoATestRecord {
+  uint64_t key;
+  double   value;
+  uint32_t flags;
+  char     name[44];
+} SoATestRecord;
+
+typedef SoAVarArray<uint64_t, double, uint32_t> SoATestArray;
+typedef SoAVarArray<uint64_t, double, uint32_t, SoATestRecord> SoATestWideArray;
+
+/// \brief We test the correctness of the C-based SoAVarArray structure.
+///
+describe(SoAVarArray) {
+
+  specSize(SoATestArray);
+
+  it("should create an empty SoAVarArray") {
+    SoATestArray *anArray = new SoATestArray();
+    shouldNotBeNULL(anArray);
+    shouldBeEqual(anArray->numFields, 3);
+    shouldBeZero(anArray->getNumItems());
+    shouldBeZero(anArray->getCapacity());
+    shouldBeNULL(anArray->getColumn<0>());
+    uint64_t key = 42;
+    double value = 1.5;
+    uint32_t flags = 7;
+    shouldBeFalse(anArray->getItem(0, key, value, flags));
+    shouldBeEqual(key, 42);
+    delete anArray;
+  } endIt();
+
+  it("should push, get and pop items") {
+    SoATestArray anArray;
+    for (uint64_t i = 0; i < 100; i++) {
+      anArray.pushItem(i, 0.5*i, (uint32_t)(i % 3));
+    }
+    shouldBeEqual(anArray.getNumItems(), 100);
+    shouldBeEqual(anArray.getCapacity(), 128);
+    uint64_t key = 0;
+    double value = 0;
+    uint32_t flags = 0;
+    for (uint64_t i = 0; i < 100; i++) {
+      shouldBeTrue(anArray.getItem(i, key, value, flags));
+      shouldBeEqual(key, i);
+      shouldBeTrue(value == 0.5*i);
+      shouldBeEqual(flags, i % 3);
+      shouldBeEqual(anArray.getField<0>(i), i);
+      shouldBeEqual(anArray.getField<2>(i), i % 3);
+    }
+    anArray.setItem(10, 1000, 2.5, 9);
+    anArray.getField<1>(11) = 3.5;
+    shouldBeTrue(anArray.getItem(10, key, value, flags));
+    shouldBeEqual(key, 1000);
+    shouldBeEqual(flags, 9);
+    shouldBeTrue(anArray.getColumn<1>()[11] == 3.5);
+    anArray.getTop(key, value, flags);
+    shouldBeEqual(key, 99);
+    anArray.popItem(key, value, flags);
+    shouldBeEqual(key, 99);
+    shouldBeEqual(flags, 0);
+    shouldBeEqual(anArray.getNumItems(), 99);
+    anArray.clearItems();
+    shouldBeZero(anArray.getNumItems());
+    shouldBeEqual(anArray.getCapacity(), 128);
+  } endIt();
+
+  it("should keep its columns aligned as it grows") {
+    SoATestWideArray anArray;
+    SoATestRecord aRecord;
+    memset(&aRecord, 0, sizeof(SoATestRecord));
+    for (uint64_t i = 0; i < 1000; i++) {
+      aRecord.key = i;
+      anArray.pushItem(i, 0.0, (uint32_t)i, aRecord);
+      if ((i % 100) == 0) {
+        shouldBeZero(((uintptr_t)anArray.getColumn<0>()) % 64);
+        shouldBeZero(((uintptr_t)anArray.getColumn<2>()) % 64);
+        shouldBeZero(((uintptr_t)anArray.getColumn<3>()) % 64);
+      }
+    }
+    for (uint64_t i = 0; i < 1000; i++) {
+      shouldBeEqual(anArray.getField<0>(i), i);
+      shouldBeEqual(anArray.getField<2>(i), i);
+      shouldBeEqual(anArray.getField<3>(i).key, i);
+    }
+    shouldBeTrue(anArray.invariant());
+  } endIt();
+
+  it("should reserve space for items in advance") {
+    SoATestArray anArray;
+    anArray.pushItem(1, 1.0, 1);
+    anArray.reserve(1000);
+    shouldBeEqual(anArray.getCapacity(), 1000);
+    shouldBeEqual(anArray.getField<0>(0), 1);
+    anArray.reserve(10);
+    shouldBeEqual(anArray.getCapacity(), 1000);
+  } endIt();
+
+  it("should report its memory usage") {
+    SoATestArray anArray;
+    for (uint64_t i = 0; i < 3; i++) anArray.pushItem(i, 0.0, 0);
+    MemoryUsage usage = anArray.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 1);
+    // 16 items of 8, 8 and 4 bytes, each column a multiple of 64 bytes
+    shouldBeEqual(usage.bytesReserved, 128 + 128 + 64);
+    shouldBeEqual(usage.bytesUsed, 3*20);
+    shouldBeZero(usage.bytesOverhead);
+    specMemoryUsage(anArray);
+  } endIt();
+
+  it("should sum a column to the same total as an array of records",
+     "[benchmark]") {
+    const size_t numItems = 100000;
+    SoATestWideArray soaArray;
+    VarArray<SoATestRecord> aosArray;
+    soaArray.reserve(numItems);
+    aosArray.reserve(numItems);
+    SoATestRecord aRecord;
+    memset(&aRecord, 0, sizeof(SoATestRecord));
+    for (size_t i = 0; i < numItems; i++) {
+      aRecord.key   = i;
+      aRecord.value = 0.25*i;
+      aRecord.flags = (uint32_t)i;
+      aosArray.pushItem(aRecord);
+      soaArray.pushItem(i, 0.25*i, (uint32_t)i, aRecord);
+    }
+    uint64_t aosSum = 0;
+    benchmark("VarArray<Record> sum of one field (10^5 items)") {
+      uint64_t sum = 0;
+      for (size_t i = 0; i < numItems; i++) sum += aosArray[i].key;
+      aosSum = sum;
+      specDoNotOptimize(aosSum);
+    } endBenchmark();
+    uint64_t soaSum = 0;
+    benchmark("SoAVarArray column sum of one field (10^5 items)") {
+      const uint64_t *keys = soaArray.getColumn<0>();
+      uint64_t sum = 0;
+      for (size_t i = 0; i < numItems; i++) sum += keys[i];
+      soaSum = sum;
+      specDoNotOptimize(soaSum);
+    } endBenchmark();
+    shouldBeEqual(soaSum, (uint64_t)numItems*(numItems - 1)/2);
+    shouldBeEqual(aosSum, soaSum);
+  } endIt();
+
+} endDescribe(SoAVarArray);
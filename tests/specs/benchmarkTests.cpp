@@ -0,0 +1,70 @@
+#ifndef protected
+#define protected public
+#endif
+
+#include <cUtils/specs/verboseRunner.h>
+
+describe(SpecBenchmark) {
+
+  specSize(SpecBenchmark);
+  specSize(BenchmarkResult);
+
+  it("should run the benchmarked code for every iteration of every sample") {
+    size_t numRuns = 0;
+    SpecBenchmark specBenchmark("counting", 5);
+    while (specBenchmark.keepRunning()) {
+      numRuns++;
+    }
+    shouldBeEqual(specBenchmark.phase, SpecBenchmark::Finished);
+    shouldBeEqual(specBenchmark.numSamplesTaken, 5);
+    shouldBeFalse(specBenchmark.keepRunning());
+    // at least one calibration, one warm up and five timed samples
+    shouldBeTrue(7*specBenchmark.sampleIterations <= numRuns);
+    BenchmarkResult result;
+    specBenchmark.getResult(result);
+    shouldBeEqual(result.name, "counting");
+    shouldBeEqual(result.numSamples, 5);
+    shouldBeEqual(result.numIterations, specBenchmark.sampleIterations);
+    shouldBeTrue(result.minNs <= result.medianNs);
+    shouldBeTrue(result.medianNs <= result.p99Ns);
+    shouldBeTrue(result.minNs <= result.meanNs);
+    shouldBeTrue(result.meanNs <= result.p99Ns);
+  } endIt();
+
+  it("should calibrate the number of iterations of fast code") {
+    size_t sum = 0;
+    SpecBenchmark specBenchmark("fast", 3);
+    while (specBenchmark.keepRunning()) {
+      sum++;
+      specDoNotOptimize(sum);
+    }
+    shouldBeTrue(100 < specBenchmark.sampleIterations);
+  } endIt();
+
+  it("should compute the median and p99 of the samples") {
+    SpecBenchmark specBenchmark("statistics", 4);
+    specBenchmark.phase            = SpecBenchmark::Finished;
+    specBenchmark.numSamplesTaken  = 4;
+    specBenchmark.samples[0]       = 4;
+    specBenchmark.samples[1]       = 1;
+    specBenchmark.samples[2]       = 3;
+    specBenchmark.samples[3]       = 2;
+    BenchmarkResult result;
+    specBenchmark.getResult(result);
+    shouldBeEqual((int64_t)(result.minNs*10),    10);
+    shouldBeEqual((int64_t)(result.medianNs*10), 25);
+    shouldBeEqual((int64_t)(result.p99Ns*10),    40);
+    shouldBeEqual((int64_t)(result.meanNs*10),   25);
+  } endIt();
+
+  it("should report a benchmark using the macros") {
+    size_t value = 0;
+    benchmarkSamples("benchmark macros", 3) {
+      value += 3;
+      specDoNotOptimize(value);
+      specClobberMemory();
+    } endBenchmark();
+    shouldNotBeZero(value);
+  } endIt();
+
+} endDescribe(SpecBenchmark);
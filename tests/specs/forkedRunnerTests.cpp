@@ -0,0 +1,75 @@
+#ifndef protected
+#define protected public
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cUtils/specs/jsonRunner.h>
+
+static int forkedPassingDescribe(void) {
+  SpecRunner *runner = SpecRunner::get();
+  runner->beginDescription(true, "Passing", NULL);
+  runner->beginItSpec(true, "should pass", NULL);
+  runner->assertShouldEqual(true, "1", 1, "1", 1, "file.cpp", 10);
+  runner->endItSpec();
+  return runner->endDescription();
+}
+
+static int forkedCrashingDescribe(void) {
+  SpecRunner::get()->beginDescription(true, "Crashing", NULL);
+  abort();
+  return 0;
+}
+
+static int forkedHangingDescribe(void) {
+  SpecRunner::get()->beginDescription(true, "Hanging", NULL);
+  while (true) sleep(1);
+  return 0;
+}
+
+describe(ForkedRunner) {
+
+  it("should report crashed and timed out describes as aborted") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *jsonFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(jsonFile);
+    JsonRunner *runner = new JsonRunner(jsonFile);
+    RunnerFunc funcs[] = {
+      forkedPassingDescribe,
+      forkedCrashingDescribe,
+      forkedHangingDescribe,
+      forkedPassingDescribe
+    };
+    shouldBeEqual(SpecRunner::runForkedDescribes(runner, funcs, 4, 2, 0.5), 2);
+    SpecResults results;
+    runner->getResults(results);
+    delete runner;
+    fclose(jsonFile);
+    shouldBeEqual(results.numDescriptions, 4);
+    shouldBeEqual(results.numFailedDescriptions, 2);
+    shouldBeEqual(results.numSuccessfulDescriptions, 2);
+    shouldBeEqual(results.numSuccessfulSpecs, 2);
+    shouldBeEqual(results.numSuccessfulShoulds, 2);
+
+    // the reports are in registration order
+    char *passing  = strstr(buffer, "\"describe\":\"Passing\"");
+    char *crashing = strstr(buffer, "\"describe\":\"Crashing\"");
+    char *hanging  = strstr(buffer, "\"describe\":\"Hanging\"");
+    shouldNotBeNULL(passing);
+    shouldNotBeNULL(crashing);
+    shouldNotBeNULL(hanging);
+    shouldBeTrue(passing < crashing);
+    shouldBeTrue(crashing < hanging);
+    char killedReason[100];
+    snprintf(killedReason, 100, "\"reason\":\"killed by signal %d", SIGABRT);
+    shouldNotBeNULL(strstr(buffer, killedReason));
+    shouldNotBeNULL(strstr(buffer, "\"reason\":\"timed out\""));
+    free(buffer);
+  } endIt();
+
+} endDescribe(ForkedRunner);
@@ -0,0 +1,223 @@
+#ifndef protected
+#define protected public
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include <cUtils/specs/jsonRunner.h>
+#include <cUtils/specs/resultComparison.h>
+
+describe(JsonRunner) {
+
+  specSize(JsonRunner);
+
+  it("should write JSON strings with escapes") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *jsonFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(jsonFile);
+    JsonRunner::writeJsonString(jsonFile, "a \"quoted\"\\\n\x01 string");
+    JsonRunner::writeJsonString(jsonFile, NULL);
+    fclose(jsonFile);
+    shouldBeEqual(buffer, "\"a \\\"quoted\\\"\\\\\\n\\u0001 string\"null");
+    free(buffer);
+  } endIt();
+
+  it("should write one record per line") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *jsonFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(jsonFile);
+    JsonRunner *runner = new JsonRunner(jsonFile);
+    runner->beginDescription(true, "Example", "more", NULL);
+    runner->logSize("int", 4);
+    runner->beginItSpec(true, "should pass", NULL);
+    runner->assertShouldEqual(true, "1", 1, "1", 1, "file.cpp", 10);
+    runner->endItSpec();
+    runner->beginItSpec(true, "should fail", NULL);
+    runner->assertShouldEqual(true, "1", 1, "2", 2, "file.cpp", 20);
+    BenchmarkResult result = { "bench", 10, 3, 1.0, 2.0, 3.0, 2.0 };
+    runner->logBenchmark(result);
+    runner->endItSpec();
+    shouldBeEqual(runner->endDescription(), 1);
+    runner->logReport();
+    delete runner;
+    fclose(jsonFile);
+
+    const char *expectedRecords[] = {
+      "{\"type\":\"describe\",\"describe\":\"Example\",\"it\":null,"
+        "\"pending\":false,\"messages\":[\"more\"]}",
+      "{\"type\":\"value\",\"describe\":\"Example\",\"it\":null,"
+        "\"kind\":\"size\",\"name\":\"int\",\"value\":4}",
+      "{\"type\":\"it\",\"describe\":\"Example\",\"it\":\"should pass\","
+        "\"status\":\"passed\"}",
+      "{\"type\":\"failure\",\"describe\":\"Example\",\"it\":\"should fail\","
+        "\"kind\":\"shouldBeEqual\",\"file\":\"file.cpp\",\"line\":20,"
+        "\"actualExpr\":\"1\",\"actual\":1,\"expectedExpr\":\"2\","
+        "\"expected\":2}",
+      "{\"type\":\"benchmark\",\"describe\":\"Example\",\"it\":\"should fail\","
+        "\"name\":\"bench\",\"iterations\":10,\"samples\":3,"
+        "\"min_ns\":1.000,\"median_ns\":2.000,\"p99_ns\":3.000,"
+        "\"mean_ns\":2.000}",
+      "{\"type\":\"it\",\"describe\":\"Example\",\"it\":\"should fail\","
+        "\"status\":\"failed\"}",
+      "{\"type\":\"summary\",\"descriptions\":{\"failed\":1,\"succeeded\":0,"
+        "\"pending\":0,\"total\":1},\"specs\":{\"failed\":1,\"succeeded\":1,"
+        "\"pending\":0,\"total\":2},\"shoulds\":{\"failed\":1,\"succeeded\":1,"
+        "\"pending\":0,\"total\":2}}",
+      NULL
+    };
+    char *line = buffer;
+    for (size_t i = 0; expectedRecords[i]; i++) {
+      char *endOfLine = strchr(line, '\n');
+      shouldNotBeNULL(endOfLine);
+      *endOfLine = 0;
+      shouldBeEqual(line, expectedRecords[i]);
+      line = endOfLine + 1;
+    }
+    shouldBeZero(*line);
+    free(buffer);
+  } endIt();
+
+  it("should create worker runners and add their results") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *jsonFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(jsonFile);
+    JsonRunner *runner = new JsonRunner(jsonFile);
+    SpecRunner *worker = runner->newWorkerRunner(jsonFile);
+    shouldNotBeNULL(worker);
+    shouldBeEqual(worker->getLogFile(), jsonFile);
+    worker->beginDescription(true, "Worker", NULL);
+    worker->beginItSpec(true, "should pass", NULL);
+    worker->assertShouldEqual(true, "1", 1, "1", 1, "file.cpp", 10);
+    worker->endItSpec();
+    worker->beginItSpec(false, "is pending", NULL);
+    worker->endItSpec();
+    shouldBeZero(worker->endDescription());
+    SpecResults results;
+    worker->getResults(results);
+    shouldBeEqual(results.numDescriptions, 1);
+    shouldBeEqual(results.numSuccessfulDescriptions, 1);
+    shouldBeEqual(results.numSpecs, 2);
+    shouldBeEqual(results.numPendingSpecs, 1);
+    shouldBeEqual(results.numSuccessfulShoulds, 1);
+    delete worker;
+    runner->addResults(results);
+    runner->addResults(results);
+    runner->getResults(results);
+    shouldBeEqual(results.numDescriptions, 2);
+    shouldBeEqual(results.numSuccessfulDescriptions, 2);
+    shouldBeEqual(results.numSpecs, 4);
+    shouldBeEqual(results.numPendingSpecs, 2);
+    shouldBeEqual(results.numShoulds, 2);
+    delete runner;
+    fclose(jsonFile);
+    free(buffer);
+  } endIt();
+
+  it("should extract the fields of a record") {
+    const char *record =
+      "{\"type\":\"benchmark\",\"describe\":\"A \\\"b\\\"\",\"it\":null,"
+      "\"name\":\"type\",\"median_ns\":12.500}";
+    char value[100];
+    shouldBeTrue(getJsonRecordField(record, "type", value, 100));
+    shouldBeEqual(value, "benchmark");
+    shouldBeTrue(getJsonRecordField(record, "describe", value, 100));
+    shouldBeEqual(value, "A \"b\"");
+    shouldBeTrue(getJsonRecordField(record, "name", value, 100));
+    shouldBeEqual(value, "type");
+    shouldBeTrue(getJsonRecordField(record, "median_ns", value, 100));
+    shouldBeEqual(value, "12.500");
+    shouldBeTrue(getJsonRecordField(record, "it", value, 100));
+    shouldBeEqual(value, "null");
+    shouldBeFalse(getJsonRecordField(record, "missing", value, 100));
+    shouldBeTrue(getJsonRecordField(record, "type", value, 4));
+    shouldBeEqual(value, "ben");
+  } endIt();
+
+  it("should flag benchmarks which regressed beyond the threshold") {
+    char baseline[] =
+      "{\"type\":\"describe\",\"describe\":\"A\",\"it\":null}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"A\",\"it\":\"x\","
+        "\"name\":\"fast\",\"median_ns\":100.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"A\",\"it\":\"x\","
+        "\"name\":\"slow\",\"median_ns\":100.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"B\",\"it\":\"x\","
+        "\"name\":\"slow\",\"median_ns\":100.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"B\",\"it\":\"y\","
+        "\"name\":\"slow\",\"median_ns\":10.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"D\",\"it\":\"x\","
+        "\"name\":\"gone\",\"median_ns\":10.0}\n";
+    char current[] =
+      "{\"type\":\"benchmark\",\"describe\":\"A\",\"it\":\"x\","
+        "\"name\":\"fast\",\"median_ns\":105.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"A\",\"it\":\"x\","
+        "\"name\":\"slow\",\"median_ns\":150.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"B\",\"it\":\"x\","
+        "\"name\":\"slow\",\"median_ns\":50.0}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"B\",\"it\":\"y\","
+        "\"name\":\"slow\",\"median_ns\":10.5}\n"
+      "{\"type\":\"benchmark\",\"describe\":\"C\",\"it\":\"x\","
+        "\"name\":\"new\",\"median_ns\":50.0}\n";
+    FILE *baselineFile = fmemopen(baseline, strlen(baseline), "r");
+    FILE *currentFile  = fmemopen(current,  strlen(current),  "r");
+    char  *report     = NULL;
+    size_t reportSize = 0;
+    FILE *reportFile = open_memstream(&report, &reportSize);
+    shouldBeEqual(compareSpecResults(baselineFile, currentFile,
+                                     0.10, reportFile), 1);
+    fclose(reportFile);
+    fclose(currentFile);
+    fclose(baselineFile);
+    shouldNotBeNULL(strstr(report, "REGRESSION: A/x/slow"));
+    shouldNotBeNULL(strstr(report, "OK:         A/x/fast"));
+    shouldNotBeNULL(strstr(report, "IMPROVED:   B/x/slow"));
+    shouldNotBeNULL(strstr(report, "OK:         B/y/slow"));
+    shouldNotBeNULL(strstr(report, "NEW:        C/x/new"));
+    shouldNotBeNULL(strstr(report, "MISSING:    D/x/gone"));
+    shouldNotBeNULL(strstr(report, "1 baseline benchmarks are missing"));
+    free(report);
+  } endIt();
+
+  it("should write non-finite doubles as null") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *jsonFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(jsonFile);
+    JsonRunner *runner = new JsonRunner(jsonFile);
+    runner->logValueDbl("nan", NAN);
+    runner->logValueDbl("inf", -INFINITY);
+    runner->logValueDbl("half", 0.5);
+    delete runner;
+    fclose(jsonFile);
+    shouldBeEqual(buffer,
+      "{\"type\":\"value\",\"describe\":null,\"it\":null,"
+      "\"kind\":\"double\",\"name\":\"nan\",\"value\":null}\n"
+      "{\"type\":\"value\",\"describe\":null,\"it\":null,"
+      "\"kind\":\"double\",\"name\":\"inf\",\"value\":null}\n"
+      "{\"type\":\"value\",\"describe\":null,\"it\":null,"
+      "\"kind\":\"double\",\"name\":\"half\",\"value\":0.5}\n");
+    free(buffer);
+  } endIt();
+
+  it("should write memory usage records") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *jsonFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(jsonFile);
+    JsonRunner *runner = new JsonRunner(jsonFile);
+    MemoryUsage usage = { 24, 1, 80, 24, 0, 56, 0.3 };
+    runner->logMemoryUsage("anArray", usage);
+    delete runner;
+    fclose(jsonFile);
+    shouldBeEqual(buffer,
+      "{\"type\":\"memory\",\"describe\":null,\"it\":null,"
+      "\"name\":\"anArray\",\"object_bytes\":24,\"allocations\":1,"
+      "\"reserved_bytes\":80,\"used_bytes\":24,\"overhead_bytes\":0,"
+      "\"wasted_bytes\":56,\"fill_ratio\":0.300000}\n");
+    free(buffer);
+  } endIt();
+
+} endDescribe(JsonRunner);
@@ -0,0 +1,108 @@
+#ifndef protected
+#define protected public
+#endif
+
+#include <string.h>
+
+#include <cUtils/specs/specs.h>
+
+describe(SpecFilter) {
+
+  specSize(SpecFilter);
+
+  it("should select everything with an empty filter") {
+    SpecFilter aFilter = { NULL, NULL, NULL, 0, 0, false, false };
+    shouldBeTrue(SpecRunner::selectDescribe(aFilter, "SpecFilter"));
+    shouldBeTrue(SpecRunner::selectDescribe(aFilter, NULL));
+    shouldBeTrue(SpecRunner::selectItSpec(aFilter, "anything", NULL));
+  } endIt();
+
+  it("should select describes and its using globs") {
+    SpecFilter aFilter = { "Var*", "should *", NULL, 0, 0, false, false };
+    shouldBeTrue(SpecRunner::selectDescribe(aFilter, "VarArray"));
+    shouldBeFalse(SpecRunner::selectDescribe(aFilter, "BitSet"));
+    shouldBeTrue(SpecRunner::selectItSpec(aFilter, "should grow", NULL));
+    shouldBeFalse(SpecRunner::selectItSpec(aFilter, "can grow", NULL));
+  } endIt();
+
+  it("should select its using tags in any of their messages") {
+    SpecFilter aFilter = { NULL, NULL, "bench*", 0, 0, false, true };
+    shouldBeTrue(SpecRunner::selectItSpec(aFilter,
+      "is fast", "[slow] [benchmark]", NULL));
+    shouldBeFalse(SpecRunner::selectItSpec(aFilter,
+      "is fast [slow]", "more", NULL));
+    shouldBeFalse(SpecRunner::selectItSpec(aFilter, "is [fast", NULL));
+  } endIt();
+
+  it("should only select benchmarks when asked to") {
+    SpecFilter aFilter = { NULL, NULL, NULL, 0, 0, false, false };
+    shouldBeFalse(SpecRunner::selectItSpec(aFilter,
+      "is fast", "[benchmark]", NULL));
+    shouldBeTrue(SpecRunner::selectItSpec(aFilter,
+      "is correct", "[slow]", NULL));
+    aFilter.runBenchmarks = true;
+    shouldBeTrue(SpecRunner::selectItSpec(aFilter,
+      "is fast", "[benchmark]", NULL));
+  } endIt();
+
+  it("should place each describe in exactly one shard") {
+    const char *names[] = { "VarArray", "BitSet", "BlockAllocator",
+                            "WorkerPool", "SpecFilter", NULL };
+    size_t numSelected = 0;
+    for (size_t shardNum = 0; shardNum < 3; shardNum++) {
+      SpecFilter aFilter = { NULL, NULL, NULL, shardNum, 3, false, false };
+      for (size_t i = 0; names[i]; i++) {
+        if (SpecRunner::selectDescribe(aFilter, names[i])) numSelected++;
+      }
+    }
+    shouldBeEqual(numSelected, 5);
+  } endIt();
+
+  it("should parse the command line options") {
+    char arg0[] = "runTests";
+    char arg1[] = "--describe=Bit*";
+    char arg2[] = "--it=should*";
+    char arg3[] = "--tag=fast";
+    char arg4[] = "--shard=1/4";
+    char arg5[] = "--list";
+    char arg6[] = "--jobs=2";
+    char arg7[] = "--benchmarks";
+    char *argv[] = { arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, NULL };
+    SpecFilter aFilter = { NULL, NULL, NULL, 0, 0, false, false };
+    shouldBeTrue(SpecRunner::parseOptions(8, argv, aFilter));
+    shouldBeEqual(aFilter.describePattern, "Bit*");
+    shouldBeEqual(aFilter.itPattern, "should*");
+    shouldBeEqual(aFilter.tagPattern, "fast");
+    shouldBeEqual(aFilter.shardNum, 1);
+    shouldBeEqual(aFilter.numShards, 4);
+    shouldBeTrue(aFilter.listOnly);
+    shouldBeTrue(aFilter.runBenchmarks);
+    char badArg[] = "--shard=4/4";
+    char *badArgv[] = { arg0, badArg, NULL };
+    shouldBeFalse(SpecRunner::parseOptions(2, badArgv, aFilter));
+  } endIt();
+
+  it("should only set the current filter once") {
+    char arg0[] = "runTests";
+    char arg1[] = "--describe=NoSuchDescribe";
+    char *argv[] = { arg0, arg1, NULL };
+    // runTests has already set the current filter
+    shouldBeFalse(SpecRunner::parseOptions(2, argv));
+    shouldBeTrue(SpecRunner::selectDescribe("SpecFilter"));
+  } endIt();
+
+  it("should list (rather than select) its when listing") {
+    char  *buffer     = NULL;
+    size_t bufferSize = 0;
+    FILE *listFile = open_memstream(&buffer, &bufferSize);
+    shouldNotBeNULL(listFile);
+    SpecRunner::listFile = listFile;
+    bool selected = SpecRunner::selectItSpec("is listed", NULL);
+    SpecRunner::listFile = NULL;
+    fclose(listFile);
+    shouldBeFalse(selected);
+    shouldBeEqual(buffer, "  is listed\n");
+    free(buffer);
+  } endIt();
+
+} endDescribe(SpecFilter);
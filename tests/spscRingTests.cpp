@@ -0,0 +1,109 @@
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/varRing.h>
+
+#define SPSC_TEST_NUM_ITEMS 100000
+
+/// \brief (Internal) Push the numbers 1..SPSC_TEST_NUM_ITEMS through
+/// the ring (some of them in batches), yielding whenever the ring is
+/// full (so that the test also makes progress on a single core).
+static void *spscProducer(void *aRing) {
+  SpscRing<size_t> *ring = (SpscRing<size_t>*)aRing;
+  size_t batch[7];
+  size_t next = 1;
+  while (next <= SPSC_TEST_NUM_ITEMS) {
+    if (next % 3) {
+      if (ring->tryPush(next)) next++;
+      else sched_yield();
+      continue;
+    }
+    size_t numItems = 0;
+    for ( ; (numItems < 7) && (next + numItems <= SPSC_TEST_NUM_ITEMS);
+          numItems++) batch[numItems] = next + numItems;
+    size_t numPushed = ring->pushBatch(batch, numItems);
+    if (!numPushed) sched_yield();
+    next += numPushed;
+  }
+  return NULL;
+}
+
+/// \brief We test the correctness of the C-based SpscRing structure.
+///
+describe(SpscRing) {
+
+  specSize(SpscRing<size_t>);
+
+  it("should round its capacity up to a power of two") {
+    SpscRing<size_t> ring(100);
+    shouldBeEqual(ring.getCapacity(), 128);
+    shouldBeZero(ring.getNumItems());
+    shouldBeTrue(((char*)&ring.consumer) - ((char*)&ring.producer) >=
+                 SPSC_RING_CACHE_LINE_SIZE);
+  } endIt();
+
+  it("should push and pop items until full or empty") {
+    SpscRing<size_t> ring(16);
+    size_t anItem = 42;
+    shouldBeFalse(ring.tryPop(anItem));
+    shouldBeEqual(anItem, 42);
+    for (size_t i = 0; i < 16; i++) shouldBeTrue(ring.tryPush(i));
+    shouldBeFalse(ring.tryPush(16));
+    shouldBeEqual(ring.getNumItems(), 16);
+    for (size_t i = 0; i < 16; i++) {
+      shouldBeTrue(ring.tryPop(anItem));
+      shouldBeEqual(anItem, i);
+    }
+    shouldBeFalse(ring.tryPop(anItem));
+  } endIt();
+
+  it("should push and pop batches of items") {
+    SpscRing<size_t> ring(16);
+    size_t items[20];
+    for (size_t i = 0; i < 20; i++) items[i] = i;
+    shouldBeEqual(ring.pushBatch(items, 10), 10);
+    shouldBeEqual(ring.pushBatch(items + 10, 10), 6);
+    size_t popped[20];
+    shouldBeEqual(ring.popBatch(popped, 4), 4);
+    shouldBeEqual(popped[3], 3);
+    shouldBeEqual(ring.popBatch(popped, 20), 12);
+    shouldBeEqual(popped[0], 4);
+    shouldBeEqual(popped[11], 15);
+    shouldBeZero(ring.popBatch(popped, 20));
+  } endIt();
+
+  it("should hand items from one thread to another in order") {
+    SpscRing<size_t> ring(64);
+    pthread_t producer;
+    shouldBeZero(pthread_create(&producer, NULL, spscProducer, &ring));
+    size_t expected   = 1;
+    size_t numErrors  = 0;
+    size_t batch[5];
+    while (expected <= SPSC_TEST_NUM_ITEMS) {
+      size_t numItems = 0;
+      if (expected % 2) {
+        numItems = ring.tryPop(batch[0]) ? 1 : 0;
+      } else {
+        numItems = ring.popBatch(batch, 5);
+      }
+      if (!numItems) sched_yield();
+      for (size_t i = 0; i < numItems; i++, expected++) {
+        if (batch[i] != expected) numErrors++;
+      }
+    }
+    pthread_join(producer, NULL);
+    shouldBeZero(numErrors);
+    shouldBeZero(ring.getNumItems());
+  } endIt();
+
+} endDescribe(SpscRing);
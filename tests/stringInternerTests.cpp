@@ -0,0 +1,142 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/stringInterner.h>
+
+/// \brief We test the correctness of the C-based StringInterner
+/// structure.
+///
+describe(StringInterner) {
+
+  specSize(StringInterner);
+
+  it("should create an empty StringInterner") {
+    StringInterner *interner = new StringInterner();
+    shouldNotBeNULL(interner);
+    shouldBeZero(interner->getNumStrings());
+    shouldBeEqual(interner->find("hello"), interner->noString);
+    shouldBeNULL((void*)interner->getString(0));
+    shouldBeZero(interner->getLength(0));
+    delete interner;
+  } endIt();
+
+  it("should intern each distinct string once") {
+    StringInterner interner;
+    char hello[] = "hello";
+    uint32_t helloId = interner.intern(hello);
+    uint32_t worldId = interner.intern("world");
+    shouldBeZero(helloId);
+    shouldBeEqual(worldId, 1);
+    shouldBeEqual(interner.intern("hello"), helloId);
+    shouldBeEqual(interner.intern("hello world", 5), helloId);
+    shouldBeEqual(interner.getNumStrings(), 2);
+    shouldBeEqual(interner.find("world"), worldId);
+    shouldBeEqual(interner.find("worl"), interner.noString);
+    shouldBeEqual(interner.getString(helloId), "hello");
+    shouldNotBeEqual((void*)interner.getString(helloId), (void*)hello);
+    shouldBeEqual(interner.getLength(worldId), 5);
+    shouldBeEqual((void*)interner.internString("world"),
+                  (void*)interner.getString(worldId));
+    uint32_t emptyId = interner.intern("");
+    shouldBeEqual(interner.getString(emptyId), "");
+    shouldBeEqual(interner.intern("", 0), emptyId);
+  } endIt();
+
+  it("should store the strings contiguously in blocks") {
+    StringInterner interner(64);
+    const char *first  = interner.internString("abc");
+    const char *second = interner.internString("defg");
+    shouldBeEqual((void*)second, (void*)(first + 4));
+    shouldBeEqual(interner.bytes.blocks.getNumItems(), 1);
+    shouldBeZero(interner.largeStrings.getNumItems());
+  } endIt();
+
+  it("should intern strings too large for a block") {
+    StringInterner interner(16);
+    char longString[100];
+    memset(longString, 'x', 99);
+    longString[99] = 0;
+    uint32_t longId = interner.intern(longString);
+    shouldBeEqual(interner.largeStrings.getNumItems(), 1);
+    shouldBeEqual(interner.getString(longId), longString);
+    shouldBeEqual(interner.intern(longString), longId);
+    shouldBeEqual(interner.getLength(longId), 99);
+    MemoryUsage usage = interner.memoryUsage();
+    shouldBeEqual(usage.bytesUsed, 100);
+    interner.clearStrings();
+    shouldBeZero(interner.largeStrings.getNumItems());
+    shouldBeZero(interner.getNumStrings());
+    shouldBeEqual(interner.find(longString), interner.noString);
+  } endIt();
+
+  it("should keep its strings in place while it grows") {
+    StringInterner interner(1024);
+    char aString[32];
+    VarArray<const char*> interned;
+    for (size_t i = 0; i < 10000; i++) {
+      snprintf(aString, 32, "identifier%zu", i);
+      uint32_t stringId = interner.intern(aString);
+      shouldBeEqual(stringId, i);
+      interned.pushItem(interner.getString(stringId));
+    }
+    for (size_t i = 0; i < 10000; i++) {
+      snprintf(aString, 32, "identifier%zu", i);
+      shouldBeEqual(interner.find(aString), i);
+      shouldBeEqual((void*)interner.getString(i), (void*)interned[i]);
+      shouldBeEqual(interned[i], aString);
+    }
+    MemoryUsage usage = interner.memoryUsage();
+    shouldBeTrue(usage.bytesUsed < 10000*16);
+    specMemoryUsage(interner);
+  } endIt();
+
+  it("should keep one id for each of 1000 strings interned repeatedly",
+     "[benchmark]") {
+    const size_t numStrings = 1000;
+    char (*strings)[32] = (char(*)[32])calloc(numStrings, 32);
+    for (size_t i = 0; i < numStrings; i++) {
+      snprintf(strings[i], 32, "identifier%zu", i);
+    }
+    uint32_t *newIds = (uint32_t*)calloc(numStrings, sizeof(uint32_t));
+    uint32_t *internedIds = (uint32_t*)calloc(numStrings, sizeof(uint32_t));
+    StringInterner interner;
+    benchmark("StringInterner::intern (1000 new strings)") {
+      interner.clearStrings();
+      for (size_t i = 0; i < numStrings; i++)
+        newIds[i] = interner.intern(strings[i]);
+      specDoNotOptimize(newIds);
+    } endBenchmark();
+    benchmark("StringInterner::intern (1000 interned strings)") {
+      for (size_t i = 0; i < numStrings; i++)
+        internedIds[i] = interner.intern(strings[i]);
+      specDoNotOptimize(internedIds);
+    } endBenchmark();
+    size_t numWrongIds = 0;
+    for (size_t i = 0; i < numStrings; i++) {
+      if (internedIds[i] != newIds[i]) numWrongIds++;
+      if (interner.find(strings[i]) != newIds[i]) numWrongIds++;
+      const char *aString = interner.getString(newIds[i]);
+      if (!aString || strcmp(aString, strings[i]) != 0) numWrongIds++;
+    }
+    char **copies = (char**)calloc(numStrings, sizeof(char*));
+    benchmark("strdup/free (1000 strings)") {
+      for (size_t i = 0; i < numStrings; i++) copies[i] = strdup(strings[i]);
+      for (size_t i = 0; i < numStrings; i++) free(copies[i]);
+    } endBenchmark();
+    free(copies);
+    free(internedIds);
+    free(newIds);
+    free(strings);
+    shouldBeZero(numWrongIds);
+    shouldBeEqual(interner.getNumStrings(), numStrings);
+  } endIt();
+
+} endDescribe(StringInterner);
@@ -0,0 +1,95 @@
+#include <cUtils/specs/specs.h>
+#include <cUtils/tracing.h>
+#include <cUtils/varArray.h>
+
+/// \brief (Internal) Find the ring buffer of the calling thread.
+static TraceBuffer *findThreadBuffer(void) {
+  uint64_t threadId = (uint64_t)syscall(SYS_gettid);
+  for (TraceBuffer *buffer = Tracer::getBuffers(); buffer; buffer = buffer->next) {
+    if (buffer->threadId == threadId) return buffer;
+  }
+  return NULL;
+}
+
+describe(Tracer) {
+
+  it("should name each type of event") {
+    shouldBeEqual(Tracer::getEventName(TraceVarArrayGrow), "VarArray::grow");
+    shouldBeEqual(Tracer::getEventName(TraceBlockAlloc),
+                  "BlockAllocator::addNewBlock");
+    shouldBeEqual(Tracer::getEventName(TraceBitSetSegmentInsert),
+                  "BitSet::insertSegment");
+    shouldBeEqual(Tracer::getEventName(TraceBitSetClone), "BitSet::clone");
+    shouldBeEqual(Tracer::getEventName(TraceNumEventTypes), "unknown");
+  } endIt();
+
+  it("should record events in the calling thread's buffer") {
+    Tracer::recordEvent(TraceVarArrayGrow, 1, 2);
+    TraceBuffer *buffer = findThreadBuffer();
+    shouldNotBeNULL(buffer);
+    uint64_t numEvents = buffer->numEvents;
+    Tracer::recordEvent(TraceBlockAlloc, 42, 7);
+    shouldBeEqual(buffer->numEvents, numEvents+1);
+    TraceEvent &event =
+      buffer->events[numEvents & (CUTILS_TRACE_BUFFER_SIZE-1)];
+    shouldBeEqual(event.eventType, TraceBlockAlloc);
+    shouldBeEqual(event.arg0, 42);
+    shouldBeEqual(event.arg1, 7);
+    shouldNotBeZero(event.timestampNs);
+    shouldBeTrue(1 <= Tracer::getNumEvents());
+  } endIt();
+
+  it("should overwrite the oldest events once a buffer is full") {
+    Tracer::recordEvent(TraceVarArrayGrow, 0, 0);
+    TraceBuffer *buffer = findThreadBuffer();
+    shouldNotBeNULL(buffer);
+    uint64_t numEvents = buffer->numEvents;
+    for (size_t i = 0; i < CUTILS_TRACE_BUFFER_SIZE + 10; i++) {
+      Tracer::recordEvent(TraceBitSetClone, i, 0);
+    }
+    shouldBeEqual(buffer->numEvents, numEvents + CUTILS_TRACE_BUFFER_SIZE + 10);
+    uint64_t lastEvent = buffer->numEvents - 1;
+    shouldBeEqual(buffer->events[lastEvent & (CUTILS_TRACE_BUFFER_SIZE-1)].arg0,
+                  CUTILS_TRACE_BUFFER_SIZE + 9);
+    uint64_t oldestEvent = buffer->numEvents - CUTILS_TRACE_BUFFER_SIZE;
+    shouldBeEqual(buffer->events[oldestEvent & (CUTILS_TRACE_BUFFER_SIZE-1)].arg0,
+                  10);
+  } endIt();
+
+  it("should write the events as a Chrome trace") {
+    Tracer::recordEvent(TraceBitSetSegmentInsert, 3, 4);
+    char  *traceStr  = NULL;
+    size_t traceSize = 0;
+    FILE *traceFile = open_memstream(&traceStr, &traceSize);
+    size_t numWritten = Tracer::writeChromeTrace(traceFile);
+    fclose(traceFile);
+    shouldBeTrue(1 <= numWritten);
+    shouldBeTrue(numWritten <= Tracer::getNumEvents());
+    shouldBeZero(strncmp(traceStr,
+                         "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 39));
+    shouldNotBeNULL(strstr(traceStr,
+      "{\"name\":\"BitSet::insertSegment\",\"cat\":\"cUtils\",\"ph\":\"i\""));
+    shouldNotBeNULL(strstr(traceStr, "\"args\":{\"arg0\":3,\"arg1\":4}}"));
+    shouldNotBeNULL(strstr(traceStr, "\n]}\n"));
+    free(traceStr);
+  } endIt();
+
+  // run by the cUtilsInstrumentedTests runner (see tests/CMakeLists.txt)
+#ifdef CUTILS_TRACING
+  it("should trace the growth of a VarArray") {
+    Tracer::recordEvent(TraceVarArrayGrow, 0, 0);
+    TraceBuffer *buffer = findThreadBuffer();
+    shouldNotBeNULL(buffer);
+    uint64_t numEvents = buffer->numEvents;
+    VarArray<size_t> anArray;
+    anArray.pushItem(1);
+    shouldBeEqual(buffer->numEvents, numEvents+1);
+    TraceEvent &event =
+      buffer->events[numEvents & (CUTILS_TRACE_BUFFER_SIZE-1)];
+    shouldBeEqual(event.eventType, TraceVarArrayGrow);
+    shouldBeEqual(event.arg0, 0);
+    shouldBeEqual(event.arg1, VarArrayIncrement);
+  } endIt();
+#endif
+
+} endDescribe(Tracer);
@@ -0,0 +1,90 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/typedIndexedAllocator.h>
+
+typedef struct TypedTestItem {
+  size_t value;
+  char   name[3];
+} TypedTestItem;
+
+/// \brief We test the correctness of the C-based
+/// TypedIndexedAllocator structure.
+///
+describe(TypedIndexedAllocator) {
+
+  specSize(TypedIndexedAllocator<TypedTestItem>);
+  specSize(TypedTestItem);
+
+  it("should create a TypedIndexedAllocator") {
+    TypedIndexedAllocator<TypedTestItem, 4> *tia =
+      new TypedIndexedAllocator<TypedTestItem, 4>();
+    shouldNotBeNULL(tia);
+    shouldBeEqual(tia->itemSize, sizeof(TypedTestItem));
+    shouldBeEqual(tia->bitShift, 4);
+    shouldBeEqual(tia->itemMask, 0xF);
+    shouldBeEqual(tia->blockSize, 16*sizeof(TypedTestItem));
+    shouldBeZero(tia->nextIndex());
+    shouldBeNULL(tia->getItemPtr(0));
+    delete tia;
+  } endIt();
+
+  it("can allocate lots of new items") {
+    TypedIndexedAllocator<TypedTestItem, 4> *tia =
+      new TypedIndexedAllocator<TypedTestItem, 4>();
+    shouldNotBeNULL(tia);
+    for (size_t i = 0; i < 1<<5; i++) {
+      size_t itemNum = tia->allocateNewStructure();
+      shouldBeEqual(itemNum, i);
+      shouldBeEqual(tia->nextIndex(), i+1);
+    }
+    shouldBeEqual(tia->blocks.getNumItems(), 2);
+    shouldBeEqual((char*)tia->getItemPtr(0),  tia->blocks.getItem(0, NULL));
+    shouldBeEqual((char*)tia->getItemPtr(17), tia->blocks.getItem(1, NULL) +
+                                              sizeof(TypedTestItem));
+    shouldBeNULL(tia->getItemPtr(1<<5));
+    size_t itemNum = tia->allocateNewStructure();
+    shouldBeEqual(itemNum, (1<<5));
+    shouldBeEqual(tia->blocks.getNumItems(), 3);
+    shouldBeEqual((char*)tia->getItemPtr(itemNum), tia->blocks.getTop());
+    delete tia;
+  } endIt();
+
+  it("unchecked access should agree with checked access") {
+    TypedIndexedAllocator<TypedTestItem, 3> *tia =
+      new TypedIndexedAllocator<TypedTestItem, 3>();
+    shouldNotBeNULL(tia);
+    for (size_t i = 0; i < 100; i++) {
+      size_t itemNum = tia->allocateNewStructure();
+      shouldBeZero(tia->getItemPtr(itemNum)->value);
+      (*tia)[itemNum].value = i*3;
+    }
+    for (size_t i = 0; i < 100; i++) {
+      shouldBeEqual(&(*tia)[i], tia->getItemPtr(i));
+      shouldBeEqual(tia->getItemPtr(i)->value, i*3);
+    }
+    delete tia;
+  } endIt();
+
+  it("can clear the blocks and then allocate some more") {
+    TypedIndexedAllocator<size_t> *tia = new TypedIndexedAllocator<size_t>();
+    shouldNotBeNULL(tia);
+    for (size_t i = 0; i < 100; i++) tia->allocateNewStructure();
+    shouldBeEqual(tia->nextIndex(), 100);
+    tia->clearBlocks();
+    shouldBeZero(tia->blocks.getNumItems());
+    shouldBeZero(tia->nextIndex());
+    shouldBeZero(tia->allocateNewStructure());
+    shouldBeEqual(tia->blocks.getNumItems(), 1);
+    delete tia;
+  } endIt();
+
+} endDescribe(TypedIndexedAllocator);
@@ -1,6 +1,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <exception>
+#include <new>
 
 #include <cUtils/specs/specs.h>
 
@@ -10,7 +11,29 @@
 
 #include <stdio.h>
 #include <cUtils/varArray.h>
+#include <cUtils/workerPool.h>
 
+/// \brief (Internal) Orders items in descending order.
+struct VarArrayTestGreater {
+  template<class ItemT>
+  bool operator()(const ItemT &anItem, const ItemT &otherItem) const {
+    return otherItem < anItem;
+  }
+};
+
+/// \brief (Internal) A key together with its original order.
+typedef struct VarArrayTestPair {
+  size_t key;
+  size_t order;
+} VarArrayTestPair;
+
+/// \brief (Internal) Orders VarArrayTestPairs by their keys only.
+struct VarArrayTestPairLess {
+  bool operator()(const VarArrayTestPair &aPair,
+                  const VarArrayTestPair &otherPair) const {
+    return aPair.key < otherPair.key;
+  }
+};
 
 /// \brief We test the correctness of the C-based VarArray structure.
 describe(VarArray) {
@@ -24,9 +47,9 @@ describe(VarArray) {
     shouldBeZero(aVarArray.arraySize);
     shouldBeNULL(aVarArray.itemArray);
     aVarArray.~VarArray<int>();
-    shouldBeNULL(aVarArray.itemArray);
-    shouldBeZero(aVarArray.numItems);
-    shouldBeZero(aVarArray.arraySize);
+    // recreate the (destroyed) array so that it is not destroyed twice
+    // when it goes out of scope
+    new (&aVarArray) VarArray<int>();
   } endIt();
 
   it("should be able to push and pop lots of items when instantiated with int") {
@@ -41,9 +64,9 @@ describe(VarArray) {
       shouldBeEqual(aVarArray.itemArray[i], (i));
     }
     aVarArray.~VarArray<int>();
-    shouldBeNULL(aVarArray.itemArray);
-    shouldBeZero(aVarArray.numItems);
-    shouldBeZero(aVarArray.arraySize);
+    // recreate the (destroyed) array so that it is not destroyed twice
+    // when it goes out of scope
+    new (&aVarArray) VarArray<int>();
   } endIt();
 
   it("should be created with correct values when instantiated with const char*") {
@@ -52,9 +75,9 @@ describe(VarArray) {
     shouldBeZero(aVarArray.arraySize);
     shouldBeNULL(aVarArray.itemArray);
     aVarArray.~VarArray<const char*>();
-    shouldBeNULL(aVarArray.itemArray);
-    shouldBeZero(aVarArray.numItems);
-    shouldBeZero(aVarArray.arraySize);
+    // recreate the (destroyed) array so that it is not destroyed twice
+    // when it goes out of scope
+    new (&aVarArray) VarArray<const char*>();
   } endIt();
 
   it("should be able to push/pop lots of items when instantiated with const char*") {
@@ -78,9 +101,9 @@ describe(VarArray) {
     shouldBeZero(aVarArray.getNumItems());
     shouldBeEqual(aVarArray.arraySize, (arraySize));
     aVarArray.~VarArray<int>();
-    shouldBeNULL(aVarArray.itemArray);
-    shouldBeZero(aVarArray.numItems);
-    shouldBeZero(aVarArray.arraySize);
+    // recreate the (destroyed) array so that it is not destroyed twice
+    // when it goes out of scope
+    new (&aVarArray) VarArray<int>();
   } endIt();
 
   it("should be able to push/pop lots of items when instantiated with const char*") {
@@ -104,9 +127,139 @@ describe(VarArray) {
     shouldBeZero(aVarArray.getNumItems());
     shouldBeEqual(aVarArray.arraySize, (arraySize));
     aVarArray.~VarArray<const char*>();
-    shouldBeNULL(aVarArray.itemArray);
-    shouldBeZero(aVarArray.numItems);
-    shouldBeZero(aVarArray.arraySize);
+    // recreate the (destroyed) array so that it is not destroyed twice
+    // when it goes out of scope
+    new (&aVarArray) VarArray<const char*>();
+  } endIt();
+
+  it("should reserve space for items in advance") {
+    VarArray<size_t> aVarArray;
+    shouldBeZero(aVarArray.getCapacity());
+    aVarArray.pushItem(1);
+    aVarArray.reserve(1000);
+    shouldBeEqual(aVarArray.getCapacity(), 1000);
+    shouldBeEqual(aVarArray.getNumItems(), 1);
+    shouldBeEqual(aVarArray[0], 1);
+    aVarArray.reserve(10);
+    shouldBeEqual(aVarArray.getCapacity(), 1000);
+    for (size_t i = 1; i < 1000; i++) aVarArray.pushItem(i);
+    shouldBeEqual(aVarArray.getCapacity(), 1000);
+    shouldBeEqual(aVarArray[999], 999);
+  } endIt();
+
+  it("should sort its items") {
+    VarArray<int> ints;
+    for (int i = 0; i < 1000; i++) ints.pushItem(((i*7919) % 1000) - 500);
+    ints.sort();
+    for (int i = 0; i < 1000; i++) shouldBeEqual(ints[i], i - 500);
+    VarArray<double> doubles;
+    for (int i = 0; i < 100; i++) doubles.pushItem((double)((i*37) % 100));
+    doubles.sort();
+    for (int i = 0; i < 100; i++) shouldBeTrue(doubles[i] == (double)i);
+    doubles.sortUsing(VarArrayTestGreater());
+    shouldBeTrue(doubles[0] == 99.0);
+    shouldBeTrue(doubles[99] == 0.0);
+  } endIt();
+
+  it("should sort large arrays in parallel") {
+    VarArray<uint32_t> keys;
+    size_t numKeys = ArrayKernelsParallelSortMinItems;
+    keys.reserve(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+      keys.pushItem((uint32_t)((i*2654435761U) % numKeys));
+    }
+    WorkerPool pool(2);
+    shouldBeEqual(keys.getSortPool(&pool), &pool);
+    keys.parallelSort(&pool);
+    for (size_t i = 1; i < numKeys; i++) {
+      if (keys[i] < keys[i - 1]) shouldBeTrue(keys[i - 1] <= keys[i]);
+    }
+    keys.popItem();
+    shouldBeNULL(keys.getSortPool(&pool));
+    keys.parallelStableSort(&pool);
+    shouldBeEqual(keys[0], 0);
+  } endIt();
+
+  it("should stable sort its items") {
+    VarArray<VarArrayTestPair> pairs;
+    for (size_t i = 0; i < 200; i++) {
+      VarArrayTestPair aPair = { (i*13) % 10, i };
+      pairs.pushItem(aPair);
+    }
+    pairs.stableSortUsing(VarArrayTestPairLess());
+    for (size_t i = 1; i < 200; i++) {
+      shouldBeTrue(pairs[i - 1].key <= pairs[i].key);
+      if (pairs[i - 1].key == pairs[i].key) {
+        shouldBeTrue(pairs[i - 1].order < pairs[i].order);
+      }
+    }
+    VarArray<uint64_t> keys;
+    for (uint64_t i = 0; i < 1000; i++) keys.pushItem((i*7919) % 1000);
+    keys.stableSort();
+    for (uint64_t i = 0; i < 1000; i++) shouldBeEqual(keys[i], i);
+  } endIt();
+
+  it("should find the lower bound of an item") {
+    VarArray<uint32_t> keys;
+    shouldBeZero(keys.lowerBound(1));
+    for (uint32_t i = 0; i < 100; i++) keys.pushItem(2*i);
+    shouldBeZero(keys.lowerBound(0));
+    shouldBeEqual(keys.lowerBound(1), 1);
+    shouldBeEqual(keys.lowerBound(2), 1);
+    shouldBeEqual(keys.lowerBound(198), 99);
+    shouldBeEqual(keys.lowerBound(199), 100);
+    keys.sortUsing(VarArrayTestGreater());
+    shouldBeEqual(keys.lowerBoundUsing(3, VarArrayTestGreater()), 98);
+  } endIt();
+
+  it("should find and count items") {
+    VarArray<uint32_t> keys;
+    shouldBeZero(keys.find(7));
+    for (uint32_t i = 0; i < 1000; i++) keys.pushItem(i % 100);
+    shouldBeEqual(keys.find(7), 7);
+    shouldBeEqual(keys.find(99), 99);
+    shouldBeEqual(keys.find(100), 1000);
+    shouldBeEqual(keys.count(7), 10);
+    shouldBeZero(keys.count(100));
+    VarArray<const char*> strings;
+    const char *hello = "hello";
+    strings.pushItem("world");
+    strings.pushItem(hello);
+    shouldBeEqual(strings.find(hello), 1);
+    shouldBeEqual(strings.count(hello), 1);
+  } endIt();
+
+  it("should report its memory usage") {
+    VarArray<size_t> aVarArray;
+    MemoryUsage usage = aVarArray.memoryUsage();
+    shouldBeEqual(usage.objectBytes, sizeof(VarArray<size_t>));
+    shouldBeZero(usage.numAllocations);
+    shouldBeZero(usage.bytesReserved);
+    shouldBeTrue(usage.fillRatio == 1.0);
+    for (size_t i = 0; i < 3; i++) aVarArray.pushItem(i);
+    usage = aVarArray.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 1);
+    shouldBeEqual(usage.bytesReserved, VarArrayIncrement*sizeof(size_t));
+    shouldBeEqual(usage.bytesUsed, 3*sizeof(size_t));
+    shouldBeZero(usage.bytesOverhead);
+    shouldBeEqual(usage.bytesWasted, (VarArrayIncrement-3)*sizeof(size_t));
+    specMemoryUsage(aVarArray);
+  } endIt();
+
+  it("should get back each of 1000 pushed items", "[benchmark]") {
+    VarArray<size_t> aVarArray;
+    benchmark("VarArray<size_t>::pushItem (1000 items)") {
+      aVarArray.clearItems();
+      for (size_t i = 0; i < 1000; i++) aVarArray.pushItem(i);
+    } endBenchmark();
+    shouldBeEqual(aVarArray.getNumItems(), 1000);
+    size_t numWrong = 0;
+    benchmark("VarArray<size_t>::getItem (1000 items)") {
+      for (size_t i = 0; i < 1000; i++)
+        if (aVarArray.getItem(i, 0) != i) numWrong++;
+      specDoNotOptimize(numWrong);
+    } endBenchmark();
+    shouldBeZero(numWrong);
   } endIt();
 
 } endDescribe(VarArray);
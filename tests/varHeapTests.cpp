@@ -0,0 +1,196 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/varHeap.h>
+
+/// \brief (Internal) Orders the items of a max-heap.
+struct VarHeapTestGreater {
+  bool operator()(const size_t &anItem, const size_t &otherItem) const {
+    return otherItem < anItem;
+  }
+};
+
+typedef VarHeap<size_t, VarHeapLess<size_t>, 2> BinaryHeap;
+typedef VarHeap<size_t, VarHeapTestGreater> MaxHeap;
+
+/// \brief (Internal) Fill someKeys with pseudo random keys.
+static void fillHeapTestKeys(size_t *someKeys, size_t numKeys) {
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < numKeys; i++) {
+    state = state*6364136223846793005ULL + 1442695040888963407ULL;
+    someKeys[i] = (size_t)(state >> 33);
+  }
+}
+
+/// \brief We test the correctness of the C-based VarHeap structure.
+///
+describe(VarHeap) {
+
+  specSize(VarHeap<size_t>);
+  specSize(BinaryHeap);
+
+  it("should create an empty VarHeap") {
+    VarHeap<size_t> *aHeap = new VarHeap<size_t>();
+    shouldNotBeNULL(aHeap);
+    shouldBeZero(aHeap->getNumItems());
+    shouldBeTrue(aHeap->isEmpty());
+    shouldBeFalse(aHeap->contains(0));
+    shouldBeTrue(aHeap->heapInvariant());
+    delete aHeap;
+  } endIt();
+
+  it("should pop items in order") {
+    VarHeap<size_t> aHeap;
+    size_t keys[1000];
+    fillHeapTestKeys(keys, 1000);
+    for (size_t i = 0; i < 1000; i++) aHeap.pushItem(keys[i] % 100);
+    shouldBeTrue(aHeap.heapInvariant());
+    shouldBeEqual(aHeap.getNumItems(), 1000);
+    size_t lastItem = 0;
+    for (size_t i = 0; i < 1000; i++) {
+      size_t anItem = aHeap.popItem();
+      shouldBeTrue(lastItem <= anItem);
+      lastItem = anItem;
+    }
+    shouldBeTrue(aHeap.isEmpty());
+    shouldBeTrue(aHeap.heapInvariant());
+  } endIt();
+
+  it("should order items using the comparison provided") {
+    MaxHeap aHeap;
+    for (size_t i = 0; i < 100; i++) aHeap.pushItem((i*37) % 100);
+    for (size_t i = 100; i--; ) {
+      shouldBeEqual(aHeap.getTop(), i);
+      shouldBeEqual(aHeap.popItem(), i);
+    }
+  } endIt();
+
+  it("should build a heap from bulk input") {
+    BinaryHeap aHeap;
+    aHeap.pushItem(500);
+    size_t keys[1000];
+    BinaryHeap::Handle handles[1000];
+    for (size_t i = 0; i < 1000; i++) keys[i] = 999 - i;
+    aHeap.pushItems(keys, 1000, handles);
+    shouldBeTrue(aHeap.heapInvariant());
+    shouldBeEqual(aHeap.getNumItems(), 1001);
+    for (size_t i = 0; i < 1000; i++) {
+      shouldBeEqual(aHeap.getItem(handles[i]), 999 - i);
+    }
+    VarArray<size_t> moreKeys;
+    for (size_t i = 0; i < 10; i++) moreKeys.pushItem(i);
+    aHeap.pushItems(moreKeys);
+    shouldBeTrue(aHeap.heapInvariant());
+    for (size_t i = 0; i < 10; i++) {
+      shouldBeEqual(aHeap.popItem(), i);
+      shouldBeEqual(aHeap.popItem(), i);
+    }
+    shouldBeEqual(aHeap.getTop(), 10);
+  } endIt();
+
+  it("should update and remove items using their handles") {
+    VarHeap<size_t> aHeap;
+    VarHeap<size_t>::Handle handles[100];
+    for (size_t i = 0; i < 100; i++) handles[i] = aHeap.pushItem(100 + i);
+    aHeap.decreaseItem(handles[50], 1);
+    shouldBeEqual(aHeap.getTop(), 1);
+    shouldBeEqual(aHeap.getTopHandle(), handles[50]);
+    aHeap.updateItem(handles[50], 1000);
+    shouldBeEqual(aHeap.getTop(), 100);
+    aHeap.updateItem(handles[99], 2);
+    shouldBeEqual(aHeap.getTopHandle(), handles[99]);
+    shouldBeEqual(aHeap.removeItem(handles[99]), 2);
+    shouldBeFalse(aHeap.contains(handles[99]));
+    shouldBeEqual(aHeap.removeItem(handles[0]), 100);
+    shouldBeTrue(aHeap.heapInvariant());
+    shouldBeEqual(aHeap.getNumItems(), 98);
+    shouldBeEqual(aHeap.popItem(), 101);
+    shouldBeFalse(aHeap.contains(handles[1]));
+    // the freed handles are reused
+    VarHeap<size_t>::Handle aHandle = aHeap.pushItem(3);
+    shouldBeTrue(aHandle == handles[1] || aHandle == handles[0] ||
+                 aHandle == handles[99]);
+    shouldBeEqual(aHeap.getItem(aHandle), 3);
+    size_t lastItem = 0;
+    while (!aHeap.isEmpty()) {
+      size_t anItem = aHeap.popItem();
+      shouldBeTrue(lastItem <= anItem);
+      lastItem = anItem;
+    }
+    shouldBeEqual(lastItem, 1000);
+    shouldBeTrue(aHeap.heapInvariant());
+  } endIt();
+
+  it("should report its memory usage") {
+    VarHeap<size_t> aHeap;
+    for (size_t i = 0; i < 3; i++) aHeap.pushItem(i);
+    MemoryUsage usage = aHeap.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 2);
+    shouldBeEqual(usage.bytesUsed, 3*sizeof(VarHeap<size_t>::Node));
+    shouldBeEqual(usage.bytesOverhead, 3*sizeof(uint32_t));
+    aHeap.clearItems();
+    shouldBeTrue(aHeap.isEmpty());
+    shouldBeFalse(aHeap.contains(0));
+  } endIt();
+
+  it("should pop the same sorted 10^6 items from 2-ary and 4-ary heaps",
+     "[benchmark]") {
+    const size_t numKeys = 1000000;
+    size_t *keys = (size_t*)calloc(numKeys, sizeof(size_t));
+    size_t *binaryItems = (size_t*)calloc(numKeys, sizeof(size_t));
+    size_t *quaternaryItems = (size_t*)calloc(numKeys, sizeof(size_t));
+    fillHeapTestKeys(keys, numKeys);
+    size_t numUnsorted = 0;
+    size_t numDifferent = 0;
+    BinaryHeap binaryHeap;
+    VarHeap<size_t> quaternaryHeap;
+    benchmarkSamples("VarHeap (2-ary) pushItem/popItem (10^6 items)", 3) {
+      for (size_t i = 0; i < numKeys; i++) binaryHeap.pushItem(keys[i]);
+      for (size_t i = 0; i < numKeys; i++)
+        binaryItems[i] = binaryHeap.popItem();
+      specDoNotOptimize(binaryItems);
+    } endBenchmark();
+    benchmarkSamples("VarHeap (4-ary) pushItem/popItem (10^6 items)", 3) {
+      for (size_t i = 0; i < numKeys; i++) quaternaryHeap.pushItem(keys[i]);
+      for (size_t i = 0; i < numKeys; i++)
+        quaternaryItems[i] = quaternaryHeap.popItem();
+      specDoNotOptimize(quaternaryItems);
+    } endBenchmark();
+    for (size_t i = 0; i < numKeys; i++) {
+      if (0 < i && binaryItems[i] < binaryItems[i-1]) numUnsorted++;
+      if (binaryItems[i] != quaternaryItems[i]) numDifferent++;
+    }
+    benchmarkSamples("VarHeap (2-ary) pushItems/popItem (10^6 items)", 3) {
+      binaryHeap.pushItems(keys, numKeys);
+      for (size_t i = 0; i < numKeys; i++)
+        binaryItems[i] = binaryHeap.popItem();
+      specDoNotOptimize(binaryItems);
+    } endBenchmark();
+    benchmarkSamples("VarHeap (4-ary) pushItems/popItem (10^6 items)", 3) {
+      quaternaryHeap.pushItems(keys, numKeys);
+      for (size_t i = 0; i < numKeys; i++)
+        quaternaryItems[i] = quaternaryHeap.popItem();
+      specDoNotOptimize(quaternaryItems);
+    } endBenchmark();
+    for (size_t i = 0; i < numKeys; i++) {
+      if (0 < i && binaryItems[i] < binaryItems[i-1]) numUnsorted++;
+      if (binaryItems[i] != quaternaryItems[i]) numDifferent++;
+    }
+    shouldBeZero(numUnsorted);
+    shouldBeZero(numDifferent);
+    shouldBeTrue(binaryHeap.isEmpty());
+    shouldBeTrue(quaternaryHeap.isEmpty());
+    free(quaternaryItems);
+    free(binaryItems);
+    free(keys);
+  } endIt();
+
+} endDescribe(VarHeap);
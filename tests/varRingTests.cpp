@@ -0,0 +1,131 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/varRing.h>
+
+/// \brief We test the correctness of the C-based VarRing structure.
+///
+describe(VarRing) {
+
+  specSize(VarRing<size_t>);
+
+  it("should create an empty VarRing") {
+    VarRing<size_t> *aRing = new VarRing<size_t>();
+    shouldNotBeNULL(aRing);
+    shouldBeZero(aRing->getNumItems());
+    shouldBeZero(aRing->getCapacity());
+    shouldBeTrue(aRing->isEmpty());
+    shouldBeEqual(aRing->getItem(0, 42), 42);
+    delete aRing;
+  } endIt();
+
+  it("should push and pop items at both ends") {
+    VarRing<size_t> aRing;
+    aRing.pushBack(2);
+    aRing.pushBack(3);
+    aRing.pushFront(1);
+    aRing.pushFront(0);
+    shouldBeEqual(aRing.getNumItems(), 4);
+    shouldBeEqual(aRing.getCapacity(), VarRingMinCapacity);
+    shouldBeEqual(aRing.getFront(), 0);
+    shouldBeEqual(aRing.getBack(), 3);
+    for (size_t i = 0; i < 4; i++) {
+      shouldBeEqual(aRing.getItem(i, 42), i);
+      shouldBeEqual(aRing[i], i);
+    }
+    shouldBeEqual(aRing.getItem(4, 42), 42);
+    shouldBeEqual(aRing.popFront(), 0);
+    shouldBeEqual(aRing.popBack(), 3);
+    shouldBeEqual(aRing.popBack(), 2);
+    shouldBeEqual(aRing.popFront(), 1);
+    shouldBeTrue(aRing.isEmpty());
+  } endIt();
+
+  it("should be used as a FIFO queue without growing") {
+    VarRing<size_t> aRing;
+    for (size_t i = 0; i < 8; i++) aRing.pushBack(i);
+    for (size_t i = 8; i < 10000; i++) {
+      aRing.pushBack(i);
+      shouldBeEqual(aRing.popFront(), i - 8);
+    }
+    shouldBeEqual(aRing.getNumItems(), 8);
+    shouldBeEqual(aRing.getCapacity(), VarRingMinCapacity);
+  } endIt();
+
+  it("should unroll its items when it grows") {
+    VarRing<size_t> aRing;
+    for (size_t i = 0; i < 10; i++) aRing.pushBack(i);
+    for (size_t i = 0; i < 10; i++) aRing.popFront();
+    for (size_t i = 0; i < VarRingMinCapacity; i++) aRing.pushBack(i);
+    shouldNotBeZero(aRing.frontItem);
+    shouldBeEqual(aRing.getCapacity(), VarRingMinCapacity);
+    aRing.pushBack(VarRingMinCapacity);
+    shouldBeEqual(aRing.getCapacity(), 2*VarRingMinCapacity);
+    shouldBeZero(aRing.frontItem);
+    for (size_t i = 0; i <= VarRingMinCapacity; i++) {
+      shouldBeEqual(aRing.itemArray[i], i);
+    }
+    for (size_t i = 1; i < 1000; i++) aRing.pushFront(1000 - i);
+    shouldBeEqual(aRing.getNumItems(), 999 + VarRingMinCapacity + 1);
+    shouldBeEqual(aRing.getCapacity(), 1024);
+    shouldBeEqual(aRing.getFront(), 1);
+    shouldBeEqual(aRing.getBack(), VarRingMinCapacity);
+  } endIt();
+
+  it("should provide its items as two spans") {
+    VarRing<size_t> aRing;
+    size_t *firstSpan, *secondSpan;
+    size_t firstNumItems, secondNumItems;
+    for (size_t i = 0; i < 4; i++) aRing.pushBack(i);
+    shouldBeEqual(aRing.getSpans(firstSpan, firstNumItems,
+                                 secondSpan, secondNumItems), 4);
+    shouldBeEqual(firstNumItems, 4);
+    shouldBeZero(secondNumItems);
+    shouldBeEqual(firstSpan[3], 3);
+    aRing.dropFront(4);
+    for (size_t i = 0; i < VarRingMinCapacity; i++) aRing.pushBack(i);
+    shouldBeEqual(aRing.getSpans(firstSpan, firstNumItems,
+                                 secondSpan, secondNumItems),
+                  VarRingMinCapacity);
+    shouldBeEqual(firstNumItems, VarRingMinCapacity - 4);
+    shouldBeEqual(secondNumItems, 4);
+    shouldBeZero(firstSpan[0]);
+    shouldBeEqual(secondSpan[0], VarRingMinCapacity - 4);
+    aRing.dropFront(firstNumItems);
+    shouldBeEqual(aRing.getFront(), VarRingMinCapacity - 4);
+    aRing.clearItems();
+    shouldBeTrue(aRing.isEmpty());
+  } endIt();
+
+  it("should report its memory usage") {
+    VarRing<size_t> aRing;
+    for (size_t i = 0; i < 3; i++) aRing.pushBack(i);
+    MemoryUsage usage = aRing.memoryUsage();
+    shouldBeEqual(usage.numAllocations, 1);
+    shouldBeEqual(usage.bytesReserved, VarRingMinCapacity*sizeof(size_t));
+    shouldBeEqual(usage.bytesUsed, 3*sizeof(size_t));
+  } endIt();
+
+  it("should pop 1000 items in the order they were pushed",
+     "[benchmark]") {
+    VarRing<size_t> aRing;
+    size_t numOutOfOrder = 0;
+    benchmark("VarRing<size_t>::pushBack/popFront (1000 items)") {
+      for (size_t i = 0; i < 1000; i++) aRing.pushBack(i);
+      for (size_t i = 0; i < 1000; i++)
+        if (aRing.popFront() != i) numOutOfOrder++;
+      specDoNotOptimize(numOutOfOrder);
+    } endBenchmark();
+    shouldBeZero(numOutOfOrder);
+    shouldBeTrue(aRing.isEmpty());
+  } endIt();
+
+} endDescribe(VarRing);
@@ -0,0 +1,121 @@
+#include <string.h>
+#include <stdio.h>
+#include <exception>
+
+#include <cUtils/specs/specs.h>
+
+#ifndef protected
+#define protected public
+#endif
+
+#include <stdio.h>
+#include <cUtils/workerPool.h>
+
+/// \brief (Test) Counts the number of times each task is run.
+static void countTaskRuns(size_t taskNum, void *context) {
+  size_t *taskRuns = (size_t*)context;
+  __sync_fetch_and_add(&taskRuns[taskNum], 1);
+}
+
+/// \brief (Test) The context of the threads which share one pool.
+typedef struct SharedPoolContext {
+  WorkerPool *pool;
+  size_t     *taskRuns;
+} SharedPoolContext;
+
+/// \brief (Test) Run many batches on a pool shared with other threads.
+static void *runSharedBatches(void *context) {
+  SharedPoolContext *shared = (SharedPoolContext*)context;
+  for (size_t batch = 0; batch < 50; batch++) {
+    shared->pool->runTasks(100, countTaskRuns, shared->taskRuns);
+  }
+  return NULL;
+}
+
+/// \brief (Test) Run a nested batch from within a task.
+static void runNestedBatch(size_t taskNum, void *context) {
+  SharedPoolContext *shared = (SharedPoolContext*)context;
+  shared->pool->runTasks(10, countTaskRuns, shared->taskRuns + taskNum*10);
+}
+
+/// \brief We test the correctness of the WorkerPool.
+///
+describe(WorkerPool) {
+
+  specSize(WorkerPool);
+
+  it("should create the requested number of workers") {
+    WorkerPool *pool = new WorkerPool(3);
+    shouldNotBeNULL(pool);
+    shouldBeEqual(pool->getNumWorkers(), 3);
+    shouldBeEqual(pool->numThreads, 2);
+    delete pool;
+    pool = new WorkerPool(1);
+    shouldBeEqual(pool->getNumWorkers(), 1);
+    shouldBeZero(pool->numThreads);
+    delete pool;
+  } endIt();
+
+  it("should default to one worker per processor") {
+    shouldNotBeNULL(WorkerPool::getDefault());
+    shouldBeEqual(WorkerPool::getDefault()->getNumWorkers(),
+                  sysconf(_SC_NPROCESSORS_ONLN));
+  } endIt();
+
+  it("should run every task exactly once in many batches") {
+    WorkerPool *pool = new WorkerPool(4);
+    shouldNotBeNULL(pool);
+    size_t taskRuns[100];
+    memset(taskRuns, 0, sizeof(taskRuns));
+    for (size_t batch = 0; batch < 50; batch++) {
+      pool->runTasks(100, countTaskRuns, taskRuns);
+    }
+    pool->runTasks(0, countTaskRuns, taskRuns);
+    size_t numWrongRuns = 0;
+    for (size_t i = 0; i < 100; i++) {
+      if (taskRuns[i] != 50) numWrongRuns++;
+    }
+    shouldBeZero(numWrongRuns);
+    delete pool;
+  } endIt();
+
+  it("should run the batches of threads sharing a pool one at a time") {
+    WorkerPool *pool = new WorkerPool(4);
+    size_t taskRuns[4][100];
+    memset(taskRuns, 0, sizeof(taskRuns));
+    SharedPoolContext contexts[4];
+    pthread_t threads[4];
+    for (size_t i = 0; i < 4; i++) {
+      contexts[i].pool     = pool;
+      contexts[i].taskRuns = taskRuns[i];
+      pthread_create(&threads[i], NULL, runSharedBatches, &contexts[i]);
+    }
+    for (size_t i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+    size_t numWrongRuns = 0;
+    for (size_t i = 0; i < 4; i++) {
+      for (size_t j = 0; j < 100; j++) {
+        if (taskRuns[i][j] != 50) numWrongRuns++;
+      }
+    }
+    shouldBeZero(numWrongRuns);
+    delete pool;
+  } endIt();
+
+  it("should run nested batches serially") {
+    WorkerPool *pool = new WorkerPool(4);
+    size_t taskRuns[100];
+    memset(taskRuns, 0, sizeof(taskRuns));
+    SharedPoolContext context = { pool, taskRuns };
+    // (under --jobs this describe is itself run by a pool's worker)
+    WorkerPool *outerPool = WorkerPool::getRunningPool();
+    pool->runTasks(10, runNestedBatch, &context);
+    size_t numWrongRuns = 0;
+    for (size_t i = 0; i < 100; i++) {
+      if (taskRuns[i] != 1) numWrongRuns++;
+    }
+    shouldBeZero(numWrongRuns);
+    shouldBeEqual(WorkerPool::getRunningPool(), outerPool);
+    delete pool;
+  } endIt();
+
+} endDescribe(WorkerPool);
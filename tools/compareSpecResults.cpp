@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cUtils/specs/resultComparison.h>
+
+/// \brief Compare the benchmark timings in two JsonRunner results
+/// files.
+///
+/// Usage: compareSpecResults [--threshold=0.10] baseline.jsonl current.jsonl
+///
+/// Exits with 1 if any benchmark regressed by more than the threshold
+/// (a fraction, 10% by default), 2 on a usage error and 0 otherwise.
+int main(int argc, char* argv[]) {
+  double threshold = 0.10;
+  const char *fileNames[2] = { NULL, NULL };
+  size_t numFileNames = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--threshold=", 12) == 0) {
+      threshold = strtod(argv[i]+12, NULL);
+    } else if (numFileNames < 2) {
+      fileNames[numFileNames++] = argv[i];
+    } else numFileNames++;
+  }
+  if (numFileNames != 2) {
+    fprintf(stderr,
+      "usage: %s [--threshold=0.10] baseline.jsonl current.jsonl\n", argv[0]);
+    return 2;
+  }
+  FILE *baselineFile = fopen(fileNames[0], "r");
+  if (!baselineFile) {
+    fprintf(stderr, "could not open baseline results [%s]\n", fileNames[0]);
+    return 2;
+  }
+  FILE *currentFile = fopen(fileNames[1], "r");
+  if (!currentFile) {
+    fprintf(stderr, "could not open current results [%s]\n", fileNames[1]);
+    fclose(baselineFile);
+    return 2;
+  }
+  size_t numRegressions =
+    compareSpecResults(baselineFile, currentFile, threshold, stdout);
+  fclose(currentFile);
+  fclose(baselineFile);
+  return numRegressions ? 1 : 0;
+}